@@ -43,3 +43,90 @@ bool FileManager::ReadFile(const std::string& filepath, uint8_t*& dataPtr, uint3
 
 	return true;
 }
+
+
+bool FileManager::WriteFile(const std::string& filepath, const uint8_t* dataPtr, uint32_t dataSize)
+{
+	errno_t err;
+	FILE* file = nullptr;
+	err = fopen_s(&file, filepath.c_str(), "wb");
+	if (err != 0 || !file)
+	{
+		Log::Error("Can't write file :" + filepath);
+		return false;
+	}
+
+	size_t written = fwrite(dataPtr, 1, dataSize, file);
+	fclose(file);
+
+	return written == dataSize;
+}
+
+bool FileManager::MapFile(const std::string& filepath, MappedFile& outFile)
+{
+	outFile = MappedFile();
+
+	HANDLE fileHandle = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > 0xFFFFFFFFLL)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	void* viewPtr = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (viewPtr == nullptr)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	outFile.dataPtr = (const uint8_t*)viewPtr;
+	outFile.dataSize = (uint32_t)fileSize.QuadPart;
+	outFile.fileHandle = fileHandle;
+	outFile.mappingHandle = mappingHandle;
+
+	return true;
+}
+
+void FileManager::UnmapFile(MappedFile& file)
+{
+	if (file.dataPtr) {
+		UnmapViewOfFile(file.dataPtr);
+	}
+
+	if (file.mappingHandle) {
+		CloseHandle(file.mappingHandle);
+	}
+
+	if (file.fileHandle) {
+		CloseHandle(file.fileHandle);
+	}
+
+	file = MappedFile();
+}
+
+bool FileManager::GetFileInfo(const std::string& filepath, uint64_t& outSize, uint64_t& outWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	if (!GetFileAttributesExA(filepath.c_str(), GetFileExInfoStandard, &attributeData)) {
+		return false;
+	}
+
+	outSize = ((uint64_t)attributeData.nFileSizeHigh << 32) | attributeData.nFileSizeLow;
+	outWriteTime = ((uint64_t)attributeData.ftLastWriteTime.dwHighDateTime << 32) | attributeData.ftLastWriteTime.dwLowDateTime;
+
+	return true;
+}
\ No newline at end of file
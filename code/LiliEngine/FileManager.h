@@ -1,7 +1,24 @@
 #pragma once
 
+struct MappedFile
+{
+	const uint8_t*	dataPtr = nullptr;
+	uint32_t		dataSize = 0;
+	void*			fileHandle = nullptr;
+	void*			mappingHandle = nullptr;
+};
+
 class FileManager
 {
 public:
 	static bool ReadFile(const std::string& filepath, uint8_t*& dataPtr, uint32_t& dataSize);
+
+	static bool WriteFile(const std::string& filepath, const uint8_t* dataPtr, uint32_t dataSize);
+
+	// read only view of the whole file, pages are loaded on first access.
+	static bool MapFile(const std::string& filepath, MappedFile& outFile);
+
+	static void UnmapFile(MappedFile& file);
+
+	static bool GetFileInfo(const std::string& filepath, uint64_t& outSize, uint64_t& outWriteTime);
 };
\ No newline at end of file
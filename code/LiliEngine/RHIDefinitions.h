@@ -51,6 +51,19 @@ enum VertexAttribute
 	VA_Custom1,
 	VA_Custom2,
 	VA_Custom3,
+	// compact encodings, see VertexPacking.h for the CPU side and the shader decode.
+	VA_PositionSNorm16,
+	VA_PositionHalf,
+	VA_NormalOct,
+	VA_TangentOct,
+	VA_UV0UNorm16,
+	VA_UV1UNorm16,
+	VA_SkinIndexUInt8,
+	VA_SkinWeightUNorm8,
+	VA_SkinWeightUNorm16,
+	// 8 influences, 8 uint8 bone indices and 8 unorm8 weights each packed into a uvec2.
+	VA_SkinIndex8,
+	VA_SkinWeight8,
 	VA_Count,
 };
 
@@ -135,6 +148,36 @@ FORCEINLINE VertexAttribute StringToVertexAttribute(const char* name)
 	else if (strcmp(name, "inCustom3") == 0) {
 		return VertexAttribute::VA_Custom3;
 	}
+	else if (strcmp(name, "inPositionSNorm") == 0) {
+		return VertexAttribute::VA_PositionSNorm16;
+	}
+	else if (strcmp(name, "inPositionHalf") == 0) {
+		return VertexAttribute::VA_PositionHalf;
+	}
+	else if (strcmp(name, "inNormalOct") == 0) {
+		return VertexAttribute::VA_NormalOct;
+	}
+	else if (strcmp(name, "inTangentOct") == 0) {
+		return VertexAttribute::VA_TangentOct;
+	}
+	else if (strcmp(name, "inUV0UNorm") == 0) {
+		return VertexAttribute::VA_UV0UNorm16;
+	}
+	else if (strcmp(name, "inUV1UNorm") == 0) {
+		return VertexAttribute::VA_UV1UNorm16;
+	}
+	else if (strcmp(name, "inSkinWeightUNorm8") == 0) {
+		return VertexAttribute::VA_SkinWeightUNorm8;
+	}
+	else if (strcmp(name, "inSkinWeightUNorm16") == 0) {
+		return VertexAttribute::VA_SkinWeightUNorm16;
+	}
+	else if (strcmp(name, "inSkinIndex8") == 0) {
+		return VertexAttribute::VA_SkinIndex8;
+	}
+	else if (strcmp(name, "inSkinWeight8") == 0) {
+		return VertexAttribute::VA_SkinWeight8;
+	}
 
 	return VertexAttribute::VA_None;
 }
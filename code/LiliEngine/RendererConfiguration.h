@@ -3,4 +3,9 @@
 struct RendererConfiguration
 {
 	bool vsync = false;
+	// global descriptor indexing texture table (VKBindlessTable), needs VK_EXT_descriptor_indexing.
+	// Reset to false at init when the device doesn't support it.
+	bool bindless = false;
+	// vkCmdDrawIndexedIndirectCount for VKIndirectDrawBuffer, needs VK_KHR_draw_indirect_count.
+	bool drawIndirectCount = false;
 };
\ No newline at end of file
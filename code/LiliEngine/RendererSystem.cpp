@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "RendererSystem.h"
+#include "Log.h"
+#include "VKBindlessTable.h"
 //-----------------------------------------------------------------------------
 // Indicates to hybrid graphics systems to prefer the discrete part by default
 //extern "C"
@@ -17,21 +19,57 @@ RendererSystem::RendererSystem(RendererConfiguration& configuration) noexcept
 //-----------------------------------------------------------------------------
 bool RendererSystem::Init(const WindowInfo& info, int32_t widthSwapChain, int32_t heightSwapChain) noexcept
 {
+	if (m_configuration.bindless)
+		enableBindless();
+
+	if (m_configuration.drawIndirectCount)
+		m_vulkanRHI.AddAppDeviceExtensions(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
 	if (!m_vulkanRHI.Init(info, widthSwapChain, heightSwapChain))
 		return false;
 
 	m_vulkanContext.Init();
 
+	// the count path of VKIndirectDrawBuffer needs the extension, plain indirect draws do not.
+	if (m_configuration.drawIndirectCount && !m_vulkanRHI.GetDevice()->IsAppExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		Log::Message("Draw indirect count is not available, using plain indirect draws");
+		m_configuration.drawIndirectCount = false;
+	}
+
+	// without descriptor indexing the renderer stays on classic per-material descriptor sets.
+	if (m_configuration.bindless && !VKBindlessTable::Init(m_vulkanRHI.GetDevice()))
+	{
+		Log::Message("Bindless textures are not available, using per-material descriptor sets");
+		m_configuration.bindless = false;
+	}
+
 	return true;
 }
 //-----------------------------------------------------------------------------
 void RendererSystem::Close() noexcept
 {
+	VKBindlessTable::Destroy();
 	m_vulkanContext.Close();
 	m_vulkanResource.Close();
 	m_vulkanRHI.Close();
 }
 //-----------------------------------------------------------------------------
+void RendererSystem::enableBindless() noexcept
+{
+	ZeroVulkanStruct(m_descriptorIndexingFeatures, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT);
+	m_descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	m_descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	m_descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	m_descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+	ZeroVulkanStruct(m_physicalDeviceFeatures2, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2);
+	m_physicalDeviceFeatures2.pNext = &m_descriptorIndexingFeatures;
+
+	m_vulkanRHI.AddAppDeviceExtensions(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	m_vulkanRHI.SetPhysicalDeviceFeatures(&m_physicalDeviceFeatures2);
+}
+//-----------------------------------------------------------------------------
 void RendererSystem::BeginFrame() noexcept
 {
 }
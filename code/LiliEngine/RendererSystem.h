@@ -27,8 +27,13 @@ private:
 	RendererSystem& operator=(const RendererSystem&) = delete;
 	RendererSystem& operator=(RendererSystem&&) = delete;
 
+	void enableBindless() noexcept;
+
 	RendererConfiguration& m_configuration;
 	VulkanRHI m_vulkanRHI;
 	VulkanContext m_vulkanContext;
 	VulkanResource m_vulkanResource;
+
+	VkPhysicalDeviceFeatures2 m_physicalDeviceFeatures2 = {};
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT m_descriptorIndexingFeatures = {};
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <type_traits>
+#include <utility>
+
 template<typename T>
 class Span
 {
@@ -8,6 +11,9 @@ public:
 	Span(T* nbegin, T* nend) : begin(nbegin), end(nend) {}
 	Span(T* nbegin, uint32_t len) : begin(nbegin), end(nbegin + len) {}
 	template <int N> explicit Span(T(&value)[N]) : begin(value), end(value + N) {}
+	// views a contiguous container such as std::vector without copying it.
+	template <typename Container, typename = typename std::enable_if<std::is_convertible<decltype(std::declval<Container&>().data()), T*>::value>::type>
+	Span(Container& container) : begin(container.data()), end(container.data() + container.size()) {}
 
 	T& operator[](uint32_t idx) const { assert(begin + idx < end); return begin[idx]; }
 	operator Span<const T>() const { return Span<const T>(begin, end); }
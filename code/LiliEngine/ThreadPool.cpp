@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int32_t threadCount)
+{
+	if (threadCount <= 0) {
+		threadCount = std::max<int32_t>(1, (int32_t)std::thread::hardware_concurrency() - 1);
+	}
+
+	for (int32_t i = 0; i < threadCount; ++i) {
+		m_Threads.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+
+	for (int32_t i = 0; i < m_Threads.size(); ++i) {
+		m_Threads[i].join();
+	}
+	m_Threads.clear();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+			if (m_Stop && m_Tasks.empty()) {
+				return;
+			}
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(int32_t count, const std::function<void(int32_t)>& func)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	if (count == 1 || m_Threads.size() == 0 || m_MaxParallelism == 1)
+	{
+		for (int32_t i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	// helpers may start after the caller returned, so they only touch the shared state.
+	struct Batch
+	{
+		std::atomic<int32_t>		next;
+		std::atomic<int32_t>		done;
+		int32_t						count;
+		std::function<void(int32_t)> func;
+		std::mutex					mutex;
+		std::condition_variable		finished;
+	};
+
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->next = 0;
+	batch->done = 0;
+	batch->count = count;
+	batch->func = func;
+
+	auto work = [batch]()
+	{
+		int32_t index = 0;
+		while ((index = batch->next.fetch_add(1)) < batch->count)
+		{
+			batch->func(index);
+			if (batch->done.fetch_add(1) + 1 == batch->count)
+			{
+				std::lock_guard<std::mutex> lock(batch->mutex);
+				batch->finished.notify_all();
+			}
+		}
+	};
+
+	int32_t helpers = std::min<int32_t>(count - 1, m_Threads.size());
+	if (m_MaxParallelism > 0) {
+		helpers = std::min(helpers, m_MaxParallelism - 1);
+	}
+	for (int32_t i = 0; i < helpers; ++i) {
+		Submit(work);
+	}
+
+	work();
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->finished.wait(lock, [&batch] { return batch->done.load() == batch->count; });
+}
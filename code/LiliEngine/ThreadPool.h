@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Fixed set of worker threads with a FIFO task queue.
+class ThreadPool
+{
+public:
+	// 0 picks one worker less than the hardware threads, the caller of ParallelFor is the last one.
+	explicit ThreadPool(int32_t threadCount = 0);
+
+	~ThreadPool();
+
+	// pool shared by the engine, created on first use.
+	static ThreadPool& Get();
+
+	void Submit(std::function<void()> task);
+
+	// runs func(i) for every i in [0, count) and returns when all are done. The calling thread
+	// takes items too, so nested calls from a worker cannot deadlock.
+	void ParallelFor(int32_t count, const std::function<void(int32_t)>& func);
+
+	inline int32_t GetThreadCount() const
+	{
+		return (int32_t)m_Threads.size();
+	}
+
+	// caps the threads one ParallelFor uses, the caller included, e.g. to measure scaling. 0 removes the cap.
+	inline void SetMaxParallelism(int32_t threadCount)
+	{
+		m_MaxParallelism = threadCount;
+	}
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread>			m_Threads;
+	std::deque<std::function<void()>>	m_Tasks;
+	std::mutex							m_Mutex;
+	std::condition_variable				m_Condition;
+	bool								m_Stop = false;
+	int32_t								m_MaxParallelism = 0;
+};
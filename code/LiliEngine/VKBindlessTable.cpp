@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "VKBindlessTable.h"
+#include "VKTexture.h"
+#include "VKDefaultRes.h"
+#include "VulkanDevice.h"
+
+VkDevice				VKBindlessTable::device = VK_NULL_HANDLE;
+VkDescriptorSetLayout	VKBindlessTable::descriptorSetLayout = VK_NULL_HANDLE;
+VkDescriptorPool		VKBindlessTable::descriptorPool = VK_NULL_HANDLE;
+VkDescriptorSet			VKBindlessTable::descriptorSet = VK_NULL_HANDLE;
+std::vector<VKTexture*>	VKBindlessTable::textures;
+std::vector<int32_t>	VKBindlessTable::freeSlots;
+
+// update-after-bind limits count every descriptor in the pipeline layout, the per-material sets need room too.
+static const uint32_t RESERVED_DESCRIPTORS = 256;
+
+bool VKBindlessTable::Init(std::shared_ptr<VulkanDevice> vulkanDevice, int32_t maxTextures)
+{
+	if (!vulkanDevice->IsDescriptorIndexingEnabled())
+	{
+		MLOGE("Bindless table needs descriptor indexing, the device doesn't support it.");
+		return false;
+	}
+
+	const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& properties = vulkanDevice->GetDescriptorIndexingProperties();
+	uint32_t limit = properties.maxUpdateAfterBindDescriptorsInAllPools;
+	limit = std::min(limit, properties.maxPerStageUpdateAfterBindResources);
+	limit = std::min(limit, properties.maxPerStageDescriptorUpdateAfterBindSamplers);
+	limit = std::min(limit, properties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	limit = std::min(limit, properties.maxDescriptorSetUpdateAfterBindSamplers);
+	limit = std::min(limit, properties.maxDescriptorSetUpdateAfterBindSampledImages);
+	limit = limit > RESERVED_DESCRIPTORS ? limit - RESERVED_DESCRIPTORS : 0;
+
+	if (limit < 2)
+	{
+		MLOGE("Bindless table doesn't fit the update-after-bind limits, limit=%d", (int32_t)limit);
+		return false;
+	}
+
+	if ((uint32_t)maxTextures > limit)
+	{
+		MLOG("Bindless table clamped to the device limits, %d -> %d", maxTextures, (int32_t)limit);
+		maxTextures = (int32_t)limit;
+	}
+
+	device = vulkanDevice->GetInstanceHandle();
+
+	VkDescriptorSetLayoutBinding setLayoutBinding = {};
+	setLayoutBinding.binding = 0;
+	setLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	setLayoutBinding.descriptorCount = maxTextures;
+	setLayoutBinding.stageFlags = VK_SHADER_STAGE_ALL;
+	setLayoutBinding.pImmutableSamplers = nullptr;
+
+	// slots can be empty and can be written while command buffers using the set are pending.
+	VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo;
+	ZeroVulkanStruct(bindingFlagsInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT);
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo descSetLayoutInfo;
+	ZeroVulkanStruct(descSetLayoutInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+	descSetLayoutInfo.pNext = &bindingFlagsInfo;
+	descSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	descSetLayoutInfo.bindingCount = 1;
+	descSetLayoutInfo.pBindings = &setLayoutBinding;
+	VERIFYVULKANRESULT(vkCreateDescriptorSetLayout(device, &descSetLayoutInfo, VULKAN_CPU_ALLOCATOR, &descriptorSetLayout));
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = maxTextures;
+
+	VkDescriptorPoolCreateInfo descriptorPoolInfo;
+	ZeroVulkanStruct(descriptorPoolInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO);
+	descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	descriptorPoolInfo.poolSizeCount = 1;
+	descriptorPoolInfo.pPoolSizes = &poolSize;
+	descriptorPoolInfo.maxSets = 1;
+	VERIFYVULKANRESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, VULKAN_CPU_ALLOCATOR, &descriptorPool));
+
+	VkDescriptorSetAllocateInfo allocInfo;
+	ZeroVulkanStruct(allocInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO);
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
+	VERIFYVULKANRESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+
+	textures.resize(maxTextures, nullptr);
+	freeSlots.resize(maxTextures);
+	for (int32_t i = 0; i < maxTextures; ++i) {
+		freeSlots[i] = maxTextures - 1 - i;
+	}
+
+	Register(VKDefaultRes::texture2D);
+
+	return true;
+}
+
+void VKBindlessTable::Destroy()
+{
+	if (device == VK_NULL_HANDLE) {
+		return;
+	}
+
+	for (int32_t i = 0; i < textures.size(); ++i)
+	{
+		if (textures[i]) {
+			textures[i]->bindlessIndex = -1;
+		}
+	}
+	textures.clear();
+	freeSlots.clear();
+
+	vkDestroyDescriptorPool(device, descriptorPool, VULKAN_CPU_ALLOCATOR);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, VULKAN_CPU_ALLOCATOR);
+
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+	descriptorSet = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+int32_t VKBindlessTable::Register(VKTexture* texture)
+{
+	if (texture->bindlessIndex >= 0) {
+		return texture->bindlessIndex;
+	}
+
+	if (freeSlots.size() == 0)
+	{
+		MLOGE("Bindless table is full, capacity=%d", (int32_t)textures.size());
+		return 0;
+	}
+
+	int32_t slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	textures[slot] = texture;
+	texture->bindlessIndex = slot;
+	WriteSlot(slot, texture);
+
+	return slot;
+}
+
+void VKBindlessTable::Unregister(VKTexture* texture)
+{
+	if (!IsEnabled() || texture->bindlessIndex < 0) {
+		return;
+	}
+
+	int32_t slot = texture->bindlessIndex;
+	texture->bindlessIndex = -1;
+	textures[slot] = nullptr;
+	freeSlots.push_back(slot);
+
+	if (textures[0]) {
+		WriteSlot(slot, textures[0]);
+	}
+}
+
+void VKBindlessTable::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set)
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+}
+
+void VKBindlessTable::WriteSlot(int32_t slot, VKTexture* texture)
+{
+	VkWriteDescriptorSet writeDescriptorSet;
+	ZeroVulkanStruct(writeDescriptorSet, VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET);
+	writeDescriptorSet.dstSet = descriptorSet;
+	writeDescriptorSet.dstBinding = 0;
+	writeDescriptorSet.dstArrayElement = slot;
+	writeDescriptorSet.descriptorCount = 1;
+	writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeDescriptorSet.pImageInfo = &(texture->descriptorInfo);
+	vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+}
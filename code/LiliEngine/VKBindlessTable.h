@@ -0,0 +1,47 @@
+#pragma once
+
+#include "VulkanGlobals.h"
+
+class VulkanDevice;
+class VKTexture;
+
+// Global array of sampled images (VK_EXT_descriptor_indexing), enabled by RendererConfiguration::bindless.
+// Shaders declare it as an unsized array in their last set, e.g.
+//     layout (set = 1, binding = 0) uniform sampler2D bindlessTextures[];
+// and index it with VKTexture::bindlessIndex passed through push constants.
+// Slot 0 always holds VKDefaultRes::texture2D, released slots fall back to it.
+// When the device can't provide the table IsEnabled() stays false, materials then need shaders that
+// use classic per-material sets.
+class VKBindlessTable
+{
+public:
+	// maxTextures is clamped to the device's update-after-bind limits. Returns false when the device
+	// has no descriptor indexing or its limits leave no room for a table.
+	static bool Init(std::shared_ptr<VulkanDevice> vulkanDevice, int32_t maxTextures = 4096);
+
+	static void Destroy();
+
+	static inline bool IsEnabled()
+	{
+		return descriptorSet != VK_NULL_HANDLE;
+	}
+
+	// returns the slot of the texture, registering twice returns the same slot.
+	static int32_t Register(VKTexture* texture);
+
+	static void Unregister(VKTexture* texture);
+
+	static void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
+
+private:
+	static void WriteSlot(int32_t slot, VKTexture* texture);
+
+public:
+	static VkDevice					device;
+	static VkDescriptorSetLayout	descriptorSetLayout;
+	static VkDescriptorPool			descriptorPool;
+	static VkDescriptorSet			descriptorSet;
+
+	static std::vector<VKTexture*>	textures;
+	static std::vector<int32_t>		freeSlots;
+};
@@ -0,0 +1,668 @@
+#include "stdafx.h"
+#include "VKBounds.h"
+#include "VulkanGlobals.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <random>
+
+static const int32_t TRANSFORM_BATCH_SIZE = 1024;
+static const int32_t SAH_BIN_COUNT = 16;
+
+static inline const float* GetPosition(const float* positions, int32_t stride, int32_t index)
+{
+	return (const float*)((const uint8_t*)positions + (size_t)index * stride);
+}
+
+static inline float DistanceSquared(const float* a, const Vector3& b)
+{
+	float x = a[0] - b.x;
+	float y = a[1] - b.y;
+	float z = a[2] - b.z;
+	return x * x + y * y + z * z;
+}
+
+// Arvo's box transform on center/extent, w lanes are ignored.
+static inline void TransformCenterExtent(const Matrix4x4& matrix, __m128 center, __m128 extent, __m128& outCenter, __m128& outExtent)
+{
+	const __m128 signBits = _mm_set1_ps(-0.0f);
+	const __m128 row0 = _mm_loadu_ps(matrix.m[0]);
+	const __m128 row1 = _mm_loadu_ps(matrix.m[1]);
+	const __m128 row2 = _mm_loadu_ps(matrix.m[2]);
+	const __m128 row3 = _mm_loadu_ps(matrix.m[3]);
+
+	outCenter = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0)), row0), _mm_mul_ps(_mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1)), row1)),
+		_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2)), row2), row3)
+	);
+
+	outExtent = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0)), _mm_andnot_ps(signBits, row0)), _mm_mul_ps(_mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1)), _mm_andnot_ps(signBits, row1))),
+		_mm_mul_ps(_mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2)), _mm_andnot_ps(signBits, row2))
+	);
+}
+
+static inline void LoadCenterExtent(const VKBoundingBox& box, __m128& outCenter, __m128& outExtent)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 bmin = _mm_set_ps(0.0f, box.min.z, box.min.y, box.min.x);
+	const __m128 bmax = _mm_set_ps(0.0f, box.max.z, box.max.y, box.max.x);
+	outCenter = _mm_mul_ps(_mm_add_ps(bmin, bmax), half);
+	outExtent = _mm_mul_ps(_mm_sub_ps(bmax, bmin), half);
+}
+
+VKBoundingBox VKBounds::TransformBox(const VKBoundingBox& box, const Matrix4x4& matrix)
+{
+	// empty boxes stay empty.
+	if (box.min.x > box.max.x) {
+		return box;
+	}
+
+	__m128 center;
+	__m128 extent;
+	LoadCenterExtent(box, center, extent);
+	TransformCenterExtent(matrix, center, extent, center, extent);
+
+	float bmin[4];
+	float bmax[4];
+	_mm_storeu_ps(bmin, _mm_sub_ps(center, extent));
+	_mm_storeu_ps(bmax, _mm_add_ps(center, extent));
+
+	VKBoundingBox result(Vector3(bmin[0], bmin[1], bmin[2]), Vector3(bmax[0], bmax[1], bmax[2]));
+	result.UpdateCorners();
+	return result;
+}
+
+VKBoundingSphere VKBounds::TransformSphere(const VKBoundingSphere& sphere, const Matrix4x4& matrix)
+{
+	VKBoundingSphere result;
+	result.center = matrix.TransformPosition(sphere.center);
+	if (sphere.radius < 0.0f)
+	{
+		result.radius = sphere.radius;
+		return result;
+	}
+
+	// the largest stretch is the root of the largest eigenvalue of the rows' Gram matrix. Its Gershgorin
+	// bound is the largest axis scale for orthogonal axes and stays conservative under shear.
+	float maxStretchSquared = 0.0f;
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		float sum = 0.0f;
+		for (int32_t j = 0; j < 3; ++j) {
+			sum += fabsf(matrix.m[i][0] * matrix.m[j][0] + matrix.m[i][1] * matrix.m[j][1] + matrix.m[i][2] * matrix.m[j][2]);
+		}
+		maxStretchSquared = std::max(maxStretchSquared, sum);
+	}
+	result.radius = sphere.radius * math::Sqrt(maxStretchSquared);
+	return result;
+}
+
+VKOrientedBox VKBounds::TransformOrientedBox(const VKOrientedBox& box, const Matrix4x4& matrix)
+{
+	VKOrientedBox result;
+	result.center = matrix.TransformPosition(box.center);
+
+	float extent[3] = { box.extent.x, box.extent.y, box.extent.z };
+	float outExtent[3];
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		Vector3 axis = matrix.TransformVector(box.axes[i]);
+		float scale = axis.Size();
+		result.axes[i] = scale > SMALL_NUMBER ? axis / scale : box.axes[i];
+		outExtent[i] = extent[i] * scale;
+	}
+	result.extent.Set(outExtent[0], outExtent[1], outExtent[2]);
+
+	return result;
+}
+
+void VKBounds::TransformBoxes(const VKBoundingBox* const* boxes, const Matrix4x4* const* matrices, int32_t count, VKBoxArray& outBoxes)
+{
+	outBoxes.Resize(count);
+
+	const int32_t batchCount = (count + TRANSFORM_BATCH_SIZE - 1) / TRANSFORM_BATCH_SIZE;
+	ThreadPool::Get().ParallelFor(batchCount, [&](int32_t batch) {
+		const int32_t first = batch * TRANSFORM_BATCH_SIZE;
+		const int32_t last = std::min(count, first + TRANSFORM_BATCH_SIZE);
+
+		float center[4];
+		float extent[4];
+		for (int32_t i = first; i < last; ++i)
+		{
+			__m128 c;
+			__m128 e;
+			LoadCenterExtent(*boxes[i], c, e);
+			TransformCenterExtent(*matrices[i], c, e, c, e);
+			_mm_storeu_ps(center, c);
+			_mm_storeu_ps(extent, e);
+
+			outBoxes.centerX[i] = center[0];
+			outBoxes.centerY[i] = center[1];
+			outBoxes.centerZ[i] = center[2];
+			outBoxes.extentX[i] = extent[0];
+			outBoxes.extentY[i] = extent[1];
+			outBoxes.extentZ[i] = extent[2];
+		}
+	});
+}
+
+VKBoundingSphere VKBounds::ComputeSphere(const float* positions, int32_t stride, int32_t count)
+{
+	VKBoundingSphere sphere;
+	if (count <= 0) {
+		return sphere;
+	}
+
+	// Ritter: start from the two points far apart along the spread, then grow over the outliers.
+	const float* p0 = GetPosition(positions, stride, 0);
+	Vector3 first(p0[0], p0[1], p0[2]);
+
+	int32_t farthest = 0;
+	float farthestDistance = 0.0f;
+	for (int32_t i = 0; i < count; ++i)
+	{
+		float distance = DistanceSquared(GetPosition(positions, stride, i), first);
+		if (distance > farthestDistance)
+		{
+			farthestDistance = distance;
+			farthest = i;
+		}
+	}
+
+	const float* pa = GetPosition(positions, stride, farthest);
+	Vector3 a(pa[0], pa[1], pa[2]);
+	farthest = 0;
+	farthestDistance = 0.0f;
+	for (int32_t i = 0; i < count; ++i)
+	{
+		float distance = DistanceSquared(GetPosition(positions, stride, i), a);
+		if (distance > farthestDistance)
+		{
+			farthestDistance = distance;
+			farthest = i;
+		}
+	}
+
+	const float* pb = GetPosition(positions, stride, farthest);
+	Vector3 b(pb[0], pb[1], pb[2]);
+	Vector3 center = (a + b) * 0.5f;
+	float radius = math::Sqrt(farthestDistance) * 0.5f;
+
+	Vector3 bmin(p0[0], p0[1], p0[2]);
+	Vector3 bmax = bmin;
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const float* p = GetPosition(positions, stride, i);
+		Vector3 position(p[0], p[1], p[2]);
+		bmin = Vector3::Min(bmin, position);
+		bmax = Vector3::Max(bmax, position);
+
+		float distance = DistanceSquared(p, center);
+		if (distance > radius * radius)
+		{
+			distance = math::Sqrt(distance);
+			float newRadius = (radius + distance) * 0.5f;
+			center += (position - center) * ((newRadius - radius) / distance);
+			radius = newRadius;
+		}
+	}
+
+	// the box center sphere wins for box like meshes.
+	Vector3 boxCenter = (bmin + bmax) * 0.5f;
+	float boxRadius = 0.0f;
+	for (int32_t i = 0; i < count; ++i) {
+		boxRadius = std::max(boxRadius, DistanceSquared(GetPosition(positions, stride, i), boxCenter));
+	}
+	boxRadius = math::Sqrt(boxRadius);
+
+	if (boxRadius < radius)
+	{
+		center = boxCenter;
+		radius = boxRadius;
+	}
+
+	sphere.center = center;
+	sphere.radius = radius;
+	return sphere;
+}
+
+// eigenvectors of the symmetric matrix a as columns of outVectors, cyclic Jacobi rotations.
+static void JacobiEigenVectors(float a[3][3], float outVectors[3][3])
+{
+	for (int32_t i = 0; i < 3; ++i) {
+		for (int32_t j = 0; j < 3; ++j) {
+			outVectors[i][j] = i == j ? 1.0f : 0.0f;
+		}
+	}
+
+	for (int32_t sweep = 0; sweep < 16; ++sweep)
+	{
+		float offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+		if (offDiagonal < 1e-12f) {
+			break;
+		}
+
+		for (int32_t p = 0; p < 2; ++p)
+		{
+			for (int32_t q = p + 1; q < 3; ++q)
+			{
+				if (fabsf(a[p][q]) < 1e-12f) {
+					continue;
+				}
+
+				float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+				float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+				float c = 1.0f / sqrtf(t * t + 1.0f);
+				float s = t * c;
+
+				for (int32_t k = 0; k < 3; ++k)
+				{
+					float akp = a[k][p];
+					float akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+
+				for (int32_t k = 0; k < 3; ++k)
+				{
+					float apk = a[p][k];
+					float aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+
+				for (int32_t k = 0; k < 3; ++k)
+				{
+					float vkp = outVectors[k][p];
+					float vkq = outVectors[k][q];
+					outVectors[k][p] = c * vkp - s * vkq;
+					outVectors[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+}
+
+static VKOrientedBox FitOrientedBox(const float* positions, int32_t stride, int32_t count, const Vector3 axes[3])
+{
+	float pmin[3] = { MAX_flt, MAX_flt, MAX_flt };
+	float pmax[3] = { -MAX_flt, -MAX_flt, -MAX_flt };
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const float* p = GetPosition(positions, stride, i);
+		Vector3 position(p[0], p[1], p[2]);
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			float d = position | axes[k];
+			pmin[k] = std::min(pmin[k], d);
+			pmax[k] = std::max(pmax[k], d);
+		}
+	}
+
+	VKOrientedBox box;
+	box.center.Set(0.0f, 0.0f, 0.0f);
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		box.axes[k] = axes[k];
+		box.center += axes[k] * ((pmin[k] + pmax[k]) * 0.5f);
+	}
+	box.extent.Set((pmax[0] - pmin[0]) * 0.5f, (pmax[1] - pmin[1]) * 0.5f, (pmax[2] - pmin[2]) * 0.5f);
+
+	return box;
+}
+
+VKOrientedBox VKBounds::ComputeOrientedBox(const float* positions, int32_t stride, int32_t count)
+{
+	Vector3 identity[3] = { Vector3(1.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f) };
+	if (count <= 0) {
+		return ToOrientedBox(VKBoundingBox(Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 0.0f)));
+	}
+
+	// covariance of the positions
+	double mean[3] = { 0.0, 0.0, 0.0 };
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const float* p = GetPosition(positions, stride, i);
+		mean[0] += p[0];
+		mean[1] += p[1];
+		mean[2] += p[2];
+	}
+	for (int32_t k = 0; k < 3; ++k) {
+		mean[k] /= count;
+	}
+
+	double covariance[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const float* p = GetPosition(positions, stride, i);
+		double d[3] = { p[0] - mean[0], p[1] - mean[1], p[2] - mean[2] };
+		for (int32_t j = 0; j < 3; ++j) {
+			for (int32_t k = j; k < 3; ++k) {
+				covariance[j][k] += d[j] * d[k];
+			}
+		}
+	}
+
+	float a[3][3];
+	for (int32_t j = 0; j < 3; ++j) {
+		for (int32_t k = j; k < 3; ++k) {
+			a[j][k] = a[k][j] = (float)(covariance[j][k] / count);
+		}
+	}
+
+	float vectors[3][3];
+	JacobiEigenVectors(a, vectors);
+
+	Vector3 axes[3];
+	axes[0] = Vector3(vectors[0][0], vectors[1][0], vectors[2][0]).GetSafeNormal();
+	axes[1] = Vector3(vectors[0][1], vectors[1][1], vectors[2][1]).GetSafeNormal();
+	axes[2] = axes[0] ^ axes[1];
+
+	VKOrientedBox pcaBox = FitOrientedBox(positions, stride, count, axes);
+	VKOrientedBox alignedBox = FitOrientedBox(positions, stride, count, identity);
+
+	float pcaVolume = pcaBox.extent.x * pcaBox.extent.y * pcaBox.extent.z;
+	float alignedVolume = alignedBox.extent.x * alignedBox.extent.y * alignedBox.extent.z;
+	return pcaVolume < alignedVolume ? pcaBox : alignedBox;
+}
+
+VKOrientedBox VKBounds::ToOrientedBox(const VKBoundingBox& box)
+{
+	VKOrientedBox result;
+	result.center = box.GetCenter();
+	result.axes[0].Set(1.0f, 0.0f, 0.0f);
+	result.axes[1].Set(0.0f, 1.0f, 0.0f);
+	result.axes[2].Set(0.0f, 0.0f, 1.0f);
+	result.extent = box.GetExtent();
+	return result;
+}
+
+int32_t VKBounds::PartitionSAH(const Vector3* mins, const Vector3* maxs, const Vector3* centers, int32_t* order, int32_t first, int32_t last, float* outCost)
+{
+	Vector3 centerMin = centers[order[first]];
+	Vector3 centerMax = centerMin;
+	for (int32_t i = first + 1; i < last; ++i)
+	{
+		centerMin = Vector3::Min(centerMin, centers[order[i]]);
+		centerMax = Vector3::Max(centerMax, centers[order[i]]);
+	}
+
+	Vector3 size = centerMax - centerMin;
+	int32_t axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	if (size[axis] <= SMALL_NUMBER)
+	{
+		if (outCost) {
+			*outCost = MAX_flt;
+		}
+		return (first + last) / 2;
+	}
+
+	const float axisMin = centerMin[axis];
+	const float scale = SAH_BIN_COUNT * (1.0f - 1e-5f) / size[axis];
+	auto binIndex = [&](int32_t index) {
+		return math::Min((int32_t)((centers[index][axis] - axisMin) * scale), SAH_BIN_COUNT - 1);
+	};
+
+	Vector3 binMin[SAH_BIN_COUNT];
+	Vector3 binMax[SAH_BIN_COUNT];
+	int32_t binCount[SAH_BIN_COUNT];
+	for (int32_t i = 0; i < SAH_BIN_COUNT; ++i)
+	{
+		binMin[i].Set(MAX_flt, MAX_flt, MAX_flt);
+		binMax[i].Set(-MAX_flt, -MAX_flt, -MAX_flt);
+		binCount[i] = 0;
+	}
+
+	for (int32_t i = first; i < last; ++i)
+	{
+		const int32_t index = order[i];
+		const int32_t bin = binIndex(index);
+		binMin[bin] = Vector3::Min(binMin[bin], mins[index]);
+		binMax[bin] = Vector3::Max(binMax[bin], maxs[index]);
+		binCount[bin] += 1;
+	}
+
+	// cost of splitting after bin i, swept from the right first.
+	float rightCost[SAH_BIN_COUNT];
+	Vector3 accumMin(MAX_flt, MAX_flt, MAX_flt);
+	Vector3 accumMax(-MAX_flt, -MAX_flt, -MAX_flt);
+	int32_t accumCount = 0;
+	for (int32_t i = SAH_BIN_COUNT - 1; i > 0; --i)
+	{
+		accumMin = Vector3::Min(accumMin, binMin[i]);
+		accumMax = Vector3::Max(accumMax, binMax[i]);
+		accumCount += binCount[i];
+		rightCost[i - 1] = accumCount > 0 ? HalfArea(accumMin, accumMax) * accumCount : -1.0f;
+	}
+
+	int32_t bestSplit = -1;
+	float bestCost = MAX_flt;
+	accumMin.Set(MAX_flt, MAX_flt, MAX_flt);
+	accumMax.Set(-MAX_flt, -MAX_flt, -MAX_flt);
+	accumCount = 0;
+	for (int32_t i = 0; i < SAH_BIN_COUNT - 1; ++i)
+	{
+		accumMin = Vector3::Min(accumMin, binMin[i]);
+		accumMax = Vector3::Max(accumMax, binMax[i]);
+		accumCount += binCount[i];
+		if (accumCount == 0 || rightCost[i] < 0.0f) {
+			continue;
+		}
+
+		float cost = HalfArea(accumMin, accumMax) * accumCount + rightCost[i];
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = i;
+		}
+	}
+
+	if (outCost) {
+		*outCost = bestCost;
+	}
+
+	if (bestSplit < 0) {
+		return (first + last) / 2;
+	}
+
+	int32_t* middle = std::partition(order + first, order + last, [&](int32_t index) { return binIndex(index) <= bestSplit; });
+	return (int32_t)(middle - order);
+}
+
+static inline bool NearlyEqual(float a, float b)
+{
+	return fabsf(a - b) <= 1e-4f * (1.0f + std::max(fabsf(a), fabsf(b)));
+}
+
+static inline bool NearlyEqual(const Vector3& a, const Vector3& b)
+{
+	return NearlyEqual(a.x, b.x) && NearlyEqual(a.y, b.y) && NearlyEqual(a.z, b.z);
+}
+
+// rotation, non uniform (possibly mirroring) scale and translation, or a raw affine matrix with shear.
+static Matrix4x4 RandomMatrix(std::mt19937& random, bool allowShear)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	Matrix4x4 matrix;
+	if (allowShear && (random() & 1))
+	{
+		for (int32_t i = 0; i < 3; ++i) {
+			for (int32_t j = 0; j < 3; ++j) {
+				matrix.m[i][j] = unit(random) * 4.0f;
+			}
+		}
+	}
+	else
+	{
+		Vector3 axis(unit(random), unit(random), unit(random));
+		axis = axis.SizeSquared() > SMALL_NUMBER ? axis.GetSafeNormal() : Vector3(0.0f, 1.0f, 0.0f);
+		matrix.AppendScale(Vector3(unit(random) * 4.0f, unit(random) * 4.0f, unit(random) * 4.0f));
+		matrix.AppendRotation(unit(random) * 180.0f, axis);
+	}
+	matrix.AppendTranslation(Vector3(unit(random) * 100.0f, unit(random) * 100.0f, unit(random) * 100.0f));
+
+	return matrix;
+}
+
+bool VKBounds::SelfTest()
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	int32_t failures = 0;
+
+	const int32_t count = 257;
+	std::vector<VKBoundingBox> boxes(count);
+	std::vector<Matrix4x4> matrices(count);
+	std::vector<const VKBoundingBox*> boxPtrs(count);
+	std::vector<const Matrix4x4*> matrixPtrs(count);
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		Vector3 center(unit(random) * 50.0f, unit(random) * 50.0f, unit(random) * 50.0f);
+		Vector3 extent(fabsf(unit(random)) * 10.0f, fabsf(unit(random)) * 10.0f, fabsf(unit(random)) * 10.0f);
+		boxes[i] = VKBoundingBox(center - extent, center + extent);
+		boxes[i].UpdateCorners();
+		matrices[i] = RandomMatrix(random, true);
+		boxPtrs[i] = &boxes[i];
+		matrixPtrs[i] = &matrices[i];
+
+		// the box around the 8 transformed corners.
+		VKBoundingBox expected;
+		expected.min.Set(MAX_flt, MAX_flt, MAX_flt);
+		expected.max.Set(-MAX_flt, -MAX_flt, -MAX_flt);
+		for (int32_t k = 0; k < 8; ++k)
+		{
+			Vector3 corner = matrices[i].TransformPosition(boxes[i].corners[k]);
+			expected.min = Vector3::Min(expected.min, corner);
+			expected.max = Vector3::Max(expected.max, corner);
+		}
+
+		VKBoundingBox result = TransformBox(boxes[i], matrices[i]);
+		if (!NearlyEqual(result.min, expected.min) || !NearlyEqual(result.max, expected.max))
+		{
+			MLOGE("TransformBox %d differs from its transformed corners.", i);
+			failures += 1;
+		}
+	}
+
+	VKBoxArray boxArray;
+	TransformBoxes(boxPtrs.data(), matrixPtrs.data(), count, boxArray);
+	for (int32_t i = 0; i < count; ++i)
+	{
+		VKBoundingBox expected = TransformBox(boxes[i], matrices[i]);
+		VKBoundingBox result = boxArray.Get(i);
+		if (!NearlyEqual(result.min, expected.min) || !NearlyEqual(result.max, expected.max))
+		{
+			MLOGE("TransformBoxes %d differs from TransformBox.", i);
+			failures += 1;
+		}
+	}
+	for (int32_t i = count; i < (int32_t)boxArray.extentX.size(); ++i)
+	{
+		if (boxArray.extentX[i] != 0.0f || boxArray.extentY[i] != 0.0f || boxArray.extentZ[i] != 0.0f)
+		{
+			MLOGE("TransformBoxes padding %d is not an empty box.", i);
+			failures += 1;
+		}
+	}
+
+	for (int32_t i = 0; i < 64; ++i)
+	{
+		// every point of the sphere stays inside the transformed sphere.
+		VKBoundingSphere sphere;
+		sphere.center.Set(unit(random) * 50.0f, unit(random) * 50.0f, unit(random) * 50.0f);
+		sphere.radius = fabsf(unit(random)) * 10.0f;
+		Matrix4x4 matrix = RandomMatrix(random, true);
+		VKBoundingSphere result = TransformSphere(sphere, matrix);
+
+		for (int32_t k = 0; k < 32; ++k)
+		{
+			Vector3 direction(unit(random), unit(random), unit(random));
+			if (direction.SizeSquared() <= SMALL_NUMBER) {
+				continue;
+			}
+			Vector3 point = matrix.TransformPosition(sphere.center + direction.GetSafeNormal() * sphere.radius);
+			if ((point - result.center).Size() > result.radius * (1.0f + 1e-4f) + 1e-4f)
+			{
+				MLOGE("TransformSphere %d leaves a surface point outside.", i);
+				failures += 1;
+				break;
+			}
+		}
+
+		// uniform scale keeps the sphere tight.
+		float scale = 0.5f + fabsf(unit(random)) * 4.0f;
+		Matrix4x4 uniform;
+		uniform.AppendScale(Vector3(scale, scale, scale));
+		uniform.AppendRotation(unit(random) * 180.0f, Vector3(0.0f, 0.0f, 1.0f));
+		if (!NearlyEqual(TransformSphere(sphere, uniform).radius, sphere.radius * scale))
+		{
+			MLOGE("TransformSphere %d is not tight under uniform scale.", i);
+			failures += 1;
+		}
+
+		// the corners of the transformed box are the transformed corners.
+		std::vector<float> points(8 * 3);
+		for (int32_t k = 0; k < 8 * 3; ++k) {
+			points[k] = unit(random) * 20.0f;
+		}
+		VKOrientedBox box = ComputeOrientedBox(points.data(), sizeof(float) * 3, 8);
+		Matrix4x4 rigid = RandomMatrix(random, false);
+		VKOrientedBox transformed = TransformOrientedBox(box, rigid);
+		for (int32_t k = 0; k < 8; ++k)
+		{
+			Vector3 corner = box.center;
+			Vector3 expected = transformed.center;
+			for (int32_t axis = 0; axis < 3; ++axis)
+			{
+				float sign = (k >> axis) & 1 ? 1.0f : -1.0f;
+				corner += box.axes[axis] * (box.extent[axis] * sign);
+				expected += transformed.axes[axis] * (transformed.extent[axis] * sign);
+			}
+			if (!NearlyEqual(Vector3(rigid.TransformPosition(corner)), expected))
+			{
+				MLOGE("TransformOrientedBox %d moves corner %d.", i, k);
+				failures += 1;
+				break;
+			}
+		}
+
+		// the fitted volumes hold every point they were built from.
+		VKBoundingSphere fitted = ComputeSphere(points.data(), sizeof(float) * 3, 8);
+		for (int32_t k = 0; k < 8; ++k)
+		{
+			Vector3 point(points[k * 3 + 0], points[k * 3 + 1], points[k * 3 + 2]);
+			bool inSphere = (point - fitted.center).Size() <= fitted.radius * (1.0f + 1e-4f) + 1e-4f;
+			bool inBox = true;
+			for (int32_t axis = 0; axis < 3; ++axis) {
+				inBox = inBox && fabsf((point - box.center) | box.axes[axis]) <= box.extent[axis] * (1.0f + 1e-4f) + 1e-4f;
+			}
+			if (!inSphere || !inBox)
+			{
+				MLOGE("Fitted bounds %d leave point %d outside.", i, k);
+				failures += 1;
+				break;
+			}
+		}
+	}
+
+	// empty volumes stay empty.
+	Matrix4x4 matrix = RandomMatrix(random, true);
+	VKBoundingBox empty = TransformBox(VKBoundingBox(), matrix);
+	if (!(empty.min.x > empty.max.x))
+	{
+		MLOGE("TransformBox made an empty box non empty.");
+		failures += 1;
+	}
+
+	VKBoundingSphere emptySphere;
+	if (TransformSphere(emptySphere, matrix).radius >= 0.0f || ComputeSphere(nullptr, sizeof(float) * 3, 0).radius >= 0.0f)
+	{
+		MLOGE("An empty sphere got a non negative radius.");
+		failures += 1;
+	}
+
+	return failures == 0;
+}
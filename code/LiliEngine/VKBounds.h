@@ -0,0 +1,204 @@
+#pragma once
+
+#include "CoreMath2.h"
+#include "Vector3.h"
+#include "Matrix4x4.h"
+
+#include <vector>
+
+struct VKBoundingBox
+{
+	Vector3 min;
+	Vector3 max;
+	Vector3 corners[8];
+
+	VKBoundingBox()
+		: min(MAX_flt, MAX_flt, MAX_flt)
+		, max(MIN_flt, MIN_flt, MIN_flt)
+	{
+
+	}
+
+	VKBoundingBox(const Vector3& inMin, const Vector3& inMax)
+		: min(inMin)
+		, max(inMax)
+	{
+
+	}
+
+	void UpdateCorners()
+	{
+		corners[0].Set(min.x, min.y, min.z);
+		corners[1].Set(max.x, min.y, min.z);
+		corners[2].Set(min.x, max.y, min.z);
+		corners[3].Set(max.x, max.y, min.z);
+
+		corners[4].Set(min.x, min.y, max.z);
+		corners[5].Set(max.x, min.y, max.z);
+		corners[6].Set(min.x, max.y, max.z);
+		corners[7].Set(max.x, max.y, max.z);
+	}
+
+	inline Vector3 GetCenter() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	inline Vector3 GetExtent() const
+	{
+		return (max - min) * 0.5f;
+	}
+
+	inline void Merge(const VKBoundingBox& other)
+	{
+		min = Vector3::Min(min, other.min);
+		max = Vector3::Max(max, other.max);
+	}
+};
+
+struct VKBoundingSphere
+{
+	Vector3		center;
+	// negative for an empty sphere.
+	float		radius = -1.0f;
+};
+
+// box along three orthonormal axes, extents are half sizes along them.
+struct VKOrientedBox
+{
+	Vector3		center;
+	Vector3		axes[3];
+	Vector3		extent;
+};
+
+// world space boxes as center/extent arrays, sized to a multiple of 4 so SIMD loops never need a tail.
+// Padding boxes sit at the origin with extent 0.
+struct VKBoxArray
+{
+	std::vector<float>	centerX;
+	std::vector<float>	centerY;
+	std::vector<float>	centerZ;
+	std::vector<float>	extentX;
+	std::vector<float>	extentY;
+	std::vector<float>	extentZ;
+	int32_t				count = 0;
+
+	void Resize(int32_t inCount)
+	{
+		const int32_t padded = (inCount + 3) & ~3;
+		count = inCount;
+		centerX.assign(padded, 0.0f);
+		centerY.assign(padded, 0.0f);
+		centerZ.assign(padded, 0.0f);
+		extentX.assign(padded, 0.0f);
+		extentY.assign(padded, 0.0f);
+		extentZ.assign(padded, 0.0f);
+	}
+
+	VKBoundingBox Get(int32_t index) const
+	{
+		Vector3 center(centerX[index], centerY[index], centerZ[index]);
+		Vector3 extent(extentX[index], extentY[index], extentZ[index]);
+		return VKBoundingBox(center - extent, center + extent);
+	}
+};
+
+// spheres in the same layout as VKBoxArray.
+struct VKSphereArray
+{
+	std::vector<float>	centerX;
+	std::vector<float>	centerY;
+	std::vector<float>	centerZ;
+	std::vector<float>	radius;
+	int32_t				count = 0;
+
+	void Resize(int32_t inCount)
+	{
+		const int32_t padded = (inCount + 3) & ~3;
+		count = inCount;
+		centerX.assign(padded, 0.0f);
+		centerY.assign(padded, 0.0f);
+		centerZ.assign(padded, 0.0f);
+		radius.assign(padded, 0.0f);
+	}
+
+	void Set(int32_t index, const VKBoundingSphere& sphere)
+	{
+		centerX[index] = sphere.center.x;
+		centerY[index] = sphere.center.y;
+		centerZ[index] = sphere.center.z;
+		radius[index] = sphere.radius;
+	}
+};
+
+// Bounding volume construction and transforms. Boxes are transformed with Arvo's method on the
+// center/extent form: the center goes through the matrix, the extent through the absolute 3x3.
+// That is exactly the box around all 8 transformed corners, at the cost of one position transform.
+class VKBounds
+{
+public:
+	static VKBoundingBox TransformBox(const VKBoundingBox& box, const Matrix4x4& matrix);
+
+	// the radius grows by the largest stretch of the matrix, exactly the largest axis scale without shear.
+	static VKBoundingSphere TransformSphere(const VKBoundingSphere& sphere, const Matrix4x4& matrix);
+
+	// axes stay orthonormal as long as the matrix has no shear.
+	static VKOrientedBox TransformOrientedBox(const VKOrientedBox& box, const Matrix4x4& matrix);
+
+	// *boxes[i] by *matrices[i] into outBoxes, which is resized to count. Large batches run on the thread pool.
+	static void TransformBoxes(const VKBoundingBox* const* boxes, const Matrix4x4* const* matrices, int32_t count, VKBoxArray& outBoxes);
+
+	// positions are 3 floats every stride bytes. Ritter's sphere or the sphere around the box center,
+	// whichever is smaller.
+	static VKBoundingSphere ComputeSphere(const float* positions, int32_t stride, int32_t count);
+
+	// axes from the principal components of the positions, falls back to the axis aligned box
+	// when that is not smaller.
+	static VKOrientedBox ComputeOrientedBox(const float* positions, int32_t stride, int32_t count);
+
+	static VKOrientedBox ToOrientedBox(const VKBoundingBox& box);
+
+	// half the surface area, the constant factor cancels in every SAH comparison.
+	static inline float HalfArea(const Vector3& min, const Vector3& max)
+	{
+		Vector3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	// slab test of origin + t * direction for t in [0, maxDistance]. invDirection is 1 / direction with
+	// MAX_flt for zero components, which keeps 0 * inf out of the test. outEntry is 0 when the ray starts inside.
+	static inline bool IntersectRay(const Vector3& min, const Vector3& max, const Vector3& origin, const Vector3& invDirection, float maxDistance, float& outEntry)
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int32_t axis = 0; axis < 3; ++axis)
+		{
+			float t0 = (min[axis] - origin[axis]) * invDirection[axis];
+			float t1 = (max[axis] - origin[axis]) * invDirection[axis];
+			entry = math::Max(entry, math::Min(t0, t1));
+			exit = math::Min(exit, math::Max(t0, t1));
+		}
+
+		outEntry = entry;
+		return entry <= exit;
+	}
+
+	static inline Vector3 InverseDirection(const Vector3& direction)
+	{
+		return Vector3(
+			direction.x != 0.0f ? 1.0f / direction.x : MAX_flt,
+			direction.y != 0.0f ? 1.0f / direction.y : MAX_flt,
+			direction.z != 0.0f ? 1.0f / direction.z : MAX_flt
+		);
+	}
+
+	// binned SAH split of order[first, last) on the longest centroid axis, returns the start of the right half.
+	// outCost is the split's sum of half area times count per side, MAX_flt when the centroids cannot be
+	// separated and the range is simply halved.
+	static int32_t PartitionSAH(const Vector3* mins, const Vector3* maxs, const Vector3* centers, int32_t* order, int32_t first, int32_t last, float* outCost = nullptr);
+
+	// checks the transforms and fits above against brute force references (box corners, sphere surface
+	// points, OBB corners) over random matrices, plus the empty box and negative radius cases.
+	// Every mismatch is logged, returns false if there was any. 41_Benchmarks runs it.
+	static bool SelfTest();
+};
@@ -0,0 +1,660 @@
+#include "stdafx.h"
+#include "VKDynamicBVH.h"
+#include "VKFrustumCuller.h"
+#include "VulkanGlobals.h"
+#include "ThreadPool.h"
+#include "Time.h"
+
+#include <numeric>
+
+static inline bool Overlaps(const Vector3& aMin, const Vector3& aMax, const Vector3& bMin, const Vector3& bMax)
+{
+	return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+		aMin.y <= bMax.y && aMax.y >= bMin.y &&
+		aMin.z <= bMax.z && aMax.z >= bMin.z;
+}
+
+static inline float DistanceSquared(const Vector3& min, const Vector3& max, const Vector3& point)
+{
+	Vector3 closest = Vector3::Min(Vector3::Max(point, min), max);
+	Vector3 delta = point - closest;
+	return delta | delta;
+}
+
+// area added by pairing the new leaf with child, an internal child only grows.
+static inline float ChildCost(const Vector3& childMin, const Vector3& childMax, bool leaf, const Vector3& min, const Vector3& max)
+{
+	float combinedArea = VKBounds::HalfArea(Vector3::Min(childMin, min), Vector3::Max(childMax, max));
+	return leaf ? combinedArea : combinedArea - VKBounds::HalfArea(childMin, childMax);
+}
+
+int32_t VKDynamicBVH::Insert(const VKBoundingBox& box, uint32_t userData)
+{
+	const int32_t leaf = AllocateNode();
+	m_Nodes[leaf].min = box.min;
+	m_Nodes[leaf].max = box.max;
+	m_Nodes[leaf].userData = userData;
+	m_LeafCount += 1;
+	m_Version += 1;
+
+	if (m_Root == NULL_NODE)
+	{
+		m_Root = leaf;
+		return leaf;
+	}
+
+	// descend towards the sibling that adds the least area. Pairing with a node creates a parent
+	// the size of both, going further down grows that node anyway.
+	int32_t sibling = m_Root;
+	while (!m_Nodes[sibling].IsLeaf())
+	{
+		const Node& node = m_Nodes[sibling];
+		const Node& child0 = m_Nodes[node.child0];
+		const Node& child1 = m_Nodes[node.child1];
+
+		const float area = VKBounds::HalfArea(node.min, node.max);
+		const float combinedArea = VKBounds::HalfArea(Vector3::Min(node.min, box.min), Vector3::Max(node.max, box.max));
+		const float cost = 2.0f * combinedArea;
+		const float inheritance = 2.0f * (combinedArea - area);
+		const float cost0 = ChildCost(child0.min, child0.max, child0.IsLeaf(), box.min, box.max) + inheritance;
+		const float cost1 = ChildCost(child1.min, child1.max, child1.IsLeaf(), box.min, box.max) + inheritance;
+
+		if (cost < cost0 && cost < cost1) {
+			break;
+		}
+		sibling = cost0 < cost1 ? node.child0 : node.child1;
+	}
+
+	const int32_t oldParent = m_Nodes[sibling].parent;
+	const int32_t newParent = AllocateNode();
+
+	Node& parent = m_Nodes[newParent];
+	parent.parent = oldParent;
+	parent.child0 = sibling;
+	parent.child1 = leaf;
+	parent.min = Vector3::Min(m_Nodes[sibling].min, box.min);
+	parent.max = Vector3::Max(m_Nodes[sibling].max, box.max);
+
+	m_Nodes[sibling].parent = newParent;
+	m_Nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE)
+	{
+		m_Root = newParent;
+	}
+	else
+	{
+		Node& grandParent = m_Nodes[oldParent];
+		if (grandParent.child0 == sibling) {
+			grandParent.child0 = newParent;
+		}
+		else {
+			grandParent.child1 = newParent;
+		}
+		RefitAncestors(oldParent);
+	}
+
+	return leaf;
+}
+
+void VKDynamicBVH::Remove(int32_t leaf)
+{
+	if (leaf < 0 || leaf >= m_Nodes.size() || !m_Nodes[leaf].allocated || !m_Nodes[leaf].IsLeaf())
+	{
+		MLOGE("Invalid BVH leaf %d.", leaf);
+		return;
+	}
+
+	m_LeafCount -= 1;
+	m_Version += 1;
+
+	if (leaf == m_Root)
+	{
+		m_Root = NULL_NODE;
+		FreeNode(leaf);
+		return;
+	}
+
+	// the sibling takes the place of the parent.
+	const int32_t parent = m_Nodes[leaf].parent;
+	const int32_t grandParent = m_Nodes[parent].parent;
+	const int32_t sibling = m_Nodes[parent].child0 == leaf ? m_Nodes[parent].child1 : m_Nodes[parent].child0;
+
+	m_Nodes[sibling].parent = grandParent;
+	if (grandParent == NULL_NODE)
+	{
+		m_Root = sibling;
+	}
+	else
+	{
+		Node& node = m_Nodes[grandParent];
+		if (node.child0 == parent) {
+			node.child0 = sibling;
+		}
+		else {
+			node.child1 = sibling;
+		}
+	}
+
+	FreeNode(parent);
+	FreeNode(leaf);
+	RefitAncestors(grandParent);
+}
+
+void VKDynamicBVH::Update(int32_t leaf, const VKBoundingBox& box)
+{
+	if (leaf < 0 || leaf >= m_Nodes.size() || !m_Nodes[leaf].allocated || !m_Nodes[leaf].IsLeaf())
+	{
+		MLOGE("Invalid BVH leaf %d.", leaf);
+		return;
+	}
+
+	Node& node = m_Nodes[leaf];
+	node.min = box.min;
+	node.max = box.max;
+
+	if (!node.moved)
+	{
+		node.moved = true;
+		m_Moved.push_back(leaf);
+	}
+}
+
+void VKDynamicBVH::Refit()
+{
+	if (m_Rebuild && m_Rebuild->done)
+	{
+		std::shared_ptr<RebuildJob> job = m_Rebuild;
+		m_Rebuild.reset();
+		ApplyRebuild(*job);
+	}
+
+	// removed leaves may still be listed, their ids can even be reused by now; refitting is harmless either way.
+	for (int32_t i = 0; i < m_Moved.size(); ++i)
+	{
+		Node& node = m_Nodes[m_Moved[i]];
+		if (!node.allocated) {
+			continue;
+		}
+		node.moved = false;
+		RefitAncestors(node.parent);
+	}
+	m_Moved.clear();
+
+	if (autoRebuild && !m_Rebuild && m_LeafCount > 2 && ComputeCost() > m_BuiltCost * rebuildThreshold) {
+		RebuildAsync();
+	}
+}
+
+void VKDynamicBVH::RebuildAsync()
+{
+	if (m_Rebuild || m_LeafCount < 2) {
+		return;
+	}
+
+	std::shared_ptr<RebuildJob> job = CreateRebuildJob();
+	m_Rebuild = job;
+
+	// the task owns the job, a tree cleared or destroyed meanwhile just never picks it up.
+	ThreadPool::Get().Submit([job]() {
+		BuildJob(*job);
+		job->done = true;
+	});
+}
+
+void VKDynamicBVH::Rebuild()
+{
+	m_Rebuild.reset();
+	if (m_LeafCount < 2) {
+		return;
+	}
+
+	std::shared_ptr<RebuildJob> job = CreateRebuildJob();
+	BuildJob(*job);
+	ApplyRebuild(*job);
+}
+
+void VKDynamicBVH::Clear()
+{
+	m_Nodes.clear();
+	m_Moved.clear();
+	m_Rebuild.reset();
+	m_Root = NULL_NODE;
+	m_FreeList = NULL_NODE;
+	m_LeafCount = 0;
+	m_Version += 1;
+	m_BuiltCost = 0.0f;
+}
+
+void VKDynamicBVH::Query(const VKBoundingBox& box, std::vector<uint32_t>& outResults)
+{
+	double startTime = GenericPlatformTime::Seconds();
+	int64_t tested = 0;
+
+	outResults.clear();
+	m_Stack.clear();
+	if (m_Root != NULL_NODE) {
+		m_Stack.push_back(m_Root);
+	}
+
+	while (!m_Stack.empty())
+	{
+		const Node& node = m_Nodes[m_Stack.back()];
+		m_Stack.pop_back();
+		tested += 1;
+
+		if (!Overlaps(node.min, node.max, box.min, box.max)) {
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			outResults.push_back(node.userData);
+			continue;
+		}
+
+		m_Stack.push_back(node.child0);
+		m_Stack.push_back(node.child1);
+	}
+
+	AddQueryStats(tested, startTime);
+}
+
+void VKDynamicBVH::Query(const VKBoundingSphere& sphere, std::vector<uint32_t>& outResults)
+{
+	double startTime = GenericPlatformTime::Seconds();
+	int64_t tested = 0;
+
+	outResults.clear();
+	m_Stack.clear();
+	if (m_Root != NULL_NODE && sphere.radius >= 0.0f) {
+		m_Stack.push_back(m_Root);
+	}
+
+	const float radiusSquared = sphere.radius * sphere.radius;
+	while (!m_Stack.empty())
+	{
+		const Node& node = m_Nodes[m_Stack.back()];
+		m_Stack.pop_back();
+		tested += 1;
+
+		if (DistanceSquared(node.min, node.max, sphere.center) > radiusSquared) {
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			outResults.push_back(node.userData);
+			continue;
+		}
+
+		m_Stack.push_back(node.child0);
+		m_Stack.push_back(node.child1);
+	}
+
+	AddQueryStats(tested, startTime);
+}
+
+void VKDynamicBVH::Query(const VKFrustumCuller& frustum, std::vector<uint32_t>& outResults)
+{
+	double startTime = GenericPlatformTime::Seconds();
+	int64_t tested = 0;
+
+	outResults.clear();
+	m_Stack.clear();
+	if (m_Root != NULL_NODE) {
+		m_Stack.push_back(m_Root);
+	}
+
+	while (!m_Stack.empty())
+	{
+		const int32_t index = m_Stack.back();
+		const Node& node = m_Nodes[index];
+		m_Stack.pop_back();
+		tested += 1;
+
+		VKBoundingBox box(node.min, node.max);
+		if (!frustum.IsVisible(box)) {
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			outResults.push_back(node.userData);
+			continue;
+		}
+
+		// a subtree fully inside needs no more plane tests.
+		if (frustum.Contains(box))
+		{
+			CollectLeaves(index, outResults);
+			continue;
+		}
+
+		m_Stack.push_back(node.child0);
+		m_Stack.push_back(node.child1);
+	}
+
+	AddQueryStats(tested, startTime);
+}
+
+bool VKDynamicBVH::RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, RayHit& outHit, const RayHitFunc& hitFunc)
+{
+	double startTime = GenericPlatformTime::Seconds();
+	int64_t tested = 0;
+
+	const Vector3 invDirection = VKBounds::InverseDirection(direction);
+
+	bool found = false;
+	float closest = maxDistance;
+	float entry = 0.0f;
+
+	m_Stack.clear();
+	m_Distances.clear();
+	if (m_Root != NULL_NODE)
+	{
+		tested += 1;
+		if (VKBounds::IntersectRay(m_Nodes[m_Root].min, m_Nodes[m_Root].max, origin, invDirection, maxDistance, entry))
+		{
+			m_Stack.push_back(m_Root);
+			m_Distances.push_back(entry);
+		}
+	}
+
+	while (!m_Stack.empty())
+	{
+		const Node& node = m_Nodes[m_Stack.back()];
+		const int32_t index = m_Stack.back();
+		const float distance = m_Distances.back();
+		m_Stack.pop_back();
+		m_Distances.pop_back();
+
+		if (distance > closest) {
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			float hitDistance = hitFunc ? hitFunc(node.userData, closest) : distance;
+			if (hitDistance >= 0.0f && hitDistance <= closest)
+			{
+				found = true;
+				closest = hitDistance;
+				outHit.leaf = index;
+				outHit.userData = node.userData;
+				outHit.distance = hitDistance;
+			}
+			continue;
+		}
+
+		// the nearer child goes on top so its hits shrink the ray before the farther one is visited.
+		float entry0 = 0.0f;
+		float entry1 = 0.0f;
+		const bool hit0 = VKBounds::IntersectRay(m_Nodes[node.child0].min, m_Nodes[node.child0].max, origin, invDirection, closest, entry0);
+		const bool hit1 = VKBounds::IntersectRay(m_Nodes[node.child1].min, m_Nodes[node.child1].max, origin, invDirection, closest, entry1);
+		tested += 2;
+
+		const int32_t child0 = node.child0;
+		const int32_t child1 = node.child1;
+		if (hit0 && hit1)
+		{
+			const bool swap = entry1 > entry0;
+			m_Stack.push_back(swap ? child1 : child0);
+			m_Distances.push_back(swap ? entry1 : entry0);
+			m_Stack.push_back(swap ? child0 : child1);
+			m_Distances.push_back(swap ? entry0 : entry1);
+		}
+		else if (hit0 || hit1)
+		{
+			m_Stack.push_back(hit0 ? child0 : child1);
+			m_Distances.push_back(hit0 ? entry0 : entry1);
+		}
+	}
+
+	AddQueryStats(tested, startTime);
+	return found;
+}
+
+float VKDynamicBVH::ComputeCost() const
+{
+	if (m_Root == NULL_NODE || m_Nodes[m_Root].IsLeaf()) {
+		return 0.0f;
+	}
+
+	const float rootArea = VKBounds::HalfArea(m_Nodes[m_Root].min, m_Nodes[m_Root].max);
+	if (rootArea <= 0.0f) {
+		return 0.0f;
+	}
+
+	float area = 0.0f;
+	for (int32_t i = 0; i < m_Nodes.size(); ++i)
+	{
+		const Node& node = m_Nodes[i];
+		if (node.allocated && !node.IsLeaf()) {
+			area += VKBounds::HalfArea(node.min, node.max);
+		}
+	}
+
+	return area / rootArea;
+}
+
+void VKDynamicBVH::ResetStats()
+{
+	stats = Stats();
+}
+
+void VKDynamicBVH::LogStats() const
+{
+	MLOG(
+		"BVH: %d objects, %lld queries, %.1f node tests per query against %.1f for a linear scan, %.2f us/query, cost %.2f, %lld rebuilds (%lld discarded)",
+		m_LeafCount, stats.queries,
+		stats.queries > 0 ? (double)stats.nodesTested / stats.queries : 0.0,
+		stats.queries > 0 ? (double)stats.bruteForceTests / stats.queries : 0.0,
+		stats.QueryUS(), ComputeCost(),
+		stats.rebuilds, stats.discardedRebuilds
+	);
+}
+
+int32_t VKDynamicBVH::AllocateNode()
+{
+	int32_t index = m_FreeList;
+	if (index != NULL_NODE)
+	{
+		m_FreeList = m_Nodes[index].parent;
+	}
+	else
+	{
+		index = m_Nodes.size();
+		m_Nodes.push_back(Node());
+	}
+
+	m_Nodes[index] = Node();
+	m_Nodes[index].allocated = true;
+	return index;
+}
+
+void VKDynamicBVH::FreeNode(int32_t index)
+{
+	Node& node = m_Nodes[index];
+	node.allocated = false;
+	node.moved = false;
+	node.parent = m_FreeList;
+	m_FreeList = index;
+}
+
+void VKDynamicBVH::RefitAncestors(int32_t index)
+{
+	while (index != NULL_NODE)
+	{
+		Node& node = m_Nodes[index];
+		const Node& child0 = m_Nodes[node.child0];
+		const Node& child1 = m_Nodes[node.child1];
+
+		Vector3 min = Vector3::Min(child0.min, child1.min);
+		Vector3 max = Vector3::Max(child0.max, child1.max);
+		if (min == node.min && max == node.max) {
+			break;
+		}
+
+		node.min = min;
+		node.max = max;
+		index = node.parent;
+	}
+}
+
+std::shared_ptr<VKDynamicBVH::RebuildJob> VKDynamicBVH::CreateRebuildJob() const
+{
+	std::shared_ptr<RebuildJob> job = std::make_shared<RebuildJob>();
+	job->version = m_Version;
+	job->leaves.reserve(m_LeafCount);
+	job->mins.reserve(m_LeafCount);
+	job->maxs.reserve(m_LeafCount);
+
+	for (int32_t i = 0; i < m_Nodes.size(); ++i)
+	{
+		const Node& node = m_Nodes[i];
+		if (node.allocated && node.IsLeaf())
+		{
+			job->leaves.push_back(i);
+			job->mins.push_back(node.min);
+			job->maxs.push_back(node.max);
+		}
+	}
+
+	return job;
+}
+
+void VKDynamicBVH::BuildJob(RebuildJob& job)
+{
+	struct BuildTask
+	{
+		int32_t		first;
+		int32_t		last;
+		int32_t		parent;
+		int32_t		side;
+	};
+
+	const int32_t count = job.leaves.size();
+
+	std::vector<Vector3> centers;
+	centers.reserve(count);
+	for (int32_t i = 0; i < count; ++i) {
+		centers.push_back((job.mins[i] + job.maxs[i]) * 0.5f);
+	}
+
+	std::vector<int32_t> order(count);
+	std::iota(order.begin(), order.end(), 0);
+
+	job.nodes.clear();
+	job.nodes.reserve(count > 1 ? count - 1 : 0);
+
+	// parents are emitted before their children, ApplyRebuild relies on that order.
+	std::vector<BuildTask> tasks;
+	tasks.push_back({ 0, count, -1, 0 });
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		int32_t child = ~order[task.first];
+		if (task.last - task.first > 1)
+		{
+			const int32_t middle = VKBounds::PartitionSAH(job.mins.data(), job.maxs.data(), centers.data(), order.data(), task.first, task.last);
+
+			child = job.nodes.size();
+			job.nodes.push_back(BuildNode());
+			tasks.push_back({ middle, task.last, child, 1 });
+			tasks.push_back({ task.first, middle, child, 0 });
+		}
+
+		if (task.parent < 0) {
+			job.root = child;
+		}
+		else {
+			job.nodes[task.parent].children[task.side] = child;
+		}
+	}
+}
+
+bool VKDynamicBVH::ApplyRebuild(RebuildJob& job)
+{
+	if (job.version != m_Version)
+	{
+		stats.discardedRebuilds += 1;
+		return false;
+	}
+
+	// leaves keep their ids, only the internal nodes are replaced.
+	for (int32_t i = 0; i < m_Nodes.size(); ++i)
+	{
+		if (m_Nodes[i].allocated && !m_Nodes[i].IsLeaf()) {
+			FreeNode(i);
+		}
+	}
+
+	std::vector<int32_t> mapping(job.nodes.size());
+	for (int32_t i = 0; i < job.nodes.size(); ++i) {
+		mapping[i] = AllocateNode();
+	}
+
+	auto resolve = [&](int32_t child) {
+		return child >= 0 ? mapping[child] : job.leaves[~child];
+	};
+
+	for (int32_t i = 0; i < job.nodes.size(); ++i)
+	{
+		const int32_t index = mapping[i];
+		const int32_t child0 = resolve(job.nodes[i].children[0]);
+		const int32_t child1 = resolve(job.nodes[i].children[1]);
+
+		m_Nodes[index].child0 = child0;
+		m_Nodes[index].child1 = child1;
+		m_Nodes[child0].parent = index;
+		m_Nodes[child1].parent = index;
+	}
+
+	m_Root = resolve(job.root);
+	m_Nodes[m_Root].parent = NULL_NODE;
+
+	// boxes come from the current leaves, objects may have moved since the snapshot.
+	// Children were emitted after their parents, so the reverse order refits bottom up.
+	for (int32_t i = (int32_t)job.nodes.size() - 1; i >= 0; --i)
+	{
+		Node& node = m_Nodes[mapping[i]];
+		node.min = Vector3::Min(m_Nodes[node.child0].min, m_Nodes[node.child1].min);
+		node.max = Vector3::Max(m_Nodes[node.child0].max, m_Nodes[node.child1].max);
+	}
+
+	m_BuiltCost = ComputeCost();
+	stats.rebuilds += 1;
+	return true;
+}
+
+void VKDynamicBVH::CollectLeaves(int32_t index, std::vector<uint32_t>& outResults)
+{
+	m_CollectStack.clear();
+	m_CollectStack.push_back(index);
+
+	while (!m_CollectStack.empty())
+	{
+		const Node& node = m_Nodes[m_CollectStack.back()];
+		m_CollectStack.pop_back();
+
+		if (node.IsLeaf())
+		{
+			outResults.push_back(node.userData);
+			continue;
+		}
+
+		m_CollectStack.push_back(node.child0);
+		m_CollectStack.push_back(node.child1);
+	}
+}
+
+void VKDynamicBVH::AddQueryStats(int64_t nodesTested, double startTime)
+{
+	stats.queries += 1;
+	stats.nodesTested += nodesTested;
+	stats.bruteForceTests += m_LeafCount;
+	stats.queryTime += GenericPlatformTime::Seconds() - startTime;
+}
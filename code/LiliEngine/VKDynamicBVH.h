@@ -0,0 +1,186 @@
+#pragma once
+
+#include "VKBounds.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+class VKFrustumCuller;
+
+// Dynamic bounding volume hierarchy over scene objects, one object per leaf. Leaf ids stay valid
+// until Remove. Inserts descend by surface area cost; moving objects only refit their ancestors,
+// and the tree quality lost to that is won back by a binned SAH rebuild that runs on the thread pool.
+// Not safe for concurrent use, a background rebuild only reads its own snapshot.
+class VKDynamicBVH
+{
+public:
+	static const int32_t NULL_NODE = -1;
+
+	struct Stats
+	{
+		int64_t		queries = 0;
+		int64_t		nodesTested = 0;
+		// leaves a linear scan would have tested for the same queries.
+		int64_t		bruteForceTests = 0;
+		int64_t		rebuilds = 0;
+		int64_t		discardedRebuilds = 0;
+		double		queryTime = 0.0;
+
+		inline double QueryUS() const
+		{
+			return queries > 0 ? queryTime * 1000000.0 / queries : 0.0;
+		}
+	};
+
+	struct RayHit
+	{
+		int32_t		leaf = NULL_NODE;
+		uint32_t	userData = 0;
+		float		distance = 0.0f;
+	};
+
+	// tests the object behind a leaf hit by the ray, returns its hit distance or a negative value for a miss.
+	typedef std::function<float(uint32_t userData, float maxDistance)> RayHitFunc;
+
+	VKDynamicBVH()
+	{
+
+	}
+
+	// returns the leaf id.
+	int32_t Insert(const VKBoundingBox& box, uint32_t userData);
+
+	void Remove(int32_t leaf);
+
+	// moves a leaf, its ancestors are fixed up by the next Refit.
+	void Update(int32_t leaf, const VKBoundingBox& box);
+
+	// once per frame after the Updates. Swaps in a finished background rebuild first and starts a new
+	// one when the tree cost has grown past rebuildThreshold times the cost of the last rebuild.
+	void Refit();
+
+	// snapshots the leaves and builds on the thread pool. The result is dropped if objects are
+	// inserted or removed before it is swapped in.
+	void RebuildAsync();
+
+	void Rebuild();
+
+	void Clear();
+
+	// the query results are the user data of the leaves, in no particular order.
+	void Query(const VKBoundingBox& box, std::vector<uint32_t>& outResults);
+
+	void Query(const VKBoundingSphere& sphere, std::vector<uint32_t>& outResults);
+
+	void Query(const VKFrustumCuller& frustum, std::vector<uint32_t>& outResults);
+
+	// closest hit along origin + t * direction for t in [0, maxDistance]. Without hitFunc the leaf
+	// boxes are the objects.
+	bool RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, RayHit& outHit, const RayHitFunc& hitFunc = nullptr);
+
+	// surface area heuristic cost relative to the root, sum of internal node areas over the root area.
+	float ComputeCost() const;
+
+	inline int32_t GetLeafCount() const
+	{
+		return m_LeafCount;
+	}
+
+	inline uint32_t GetUserData(int32_t leaf) const
+	{
+		return m_Nodes[leaf].userData;
+	}
+
+	inline VKBoundingBox GetBox(int32_t leaf) const
+	{
+		return VKBoundingBox(m_Nodes[leaf].min, m_Nodes[leaf].max);
+	}
+
+	void ResetStats();
+
+	void LogStats() const;
+
+public:
+	Stats		stats;
+	bool		autoRebuild = true;
+	float		rebuildThreshold = 1.3f;
+
+private:
+	struct Node
+	{
+		Vector3		min;
+		Vector3		max;
+		// next free node while on the free list.
+		int32_t		parent = NULL_NODE;
+		// child0 is NULL_NODE for leaves.
+		int32_t		child0 = NULL_NODE;
+		int32_t		child1 = NULL_NODE;
+		uint32_t	userData = 0;
+		bool		allocated = false;
+		bool		moved = false;
+
+		Node()
+			: min(0.0f, 0.0f, 0.0f)
+			, max(0.0f, 0.0f, 0.0f)
+		{
+
+		}
+
+		inline bool IsLeaf() const
+		{
+			return child0 == NULL_NODE;
+		}
+	};
+
+	// children >= 0 are build nodes, negative ones are ~slot into leaves.
+	struct BuildNode
+	{
+		int32_t		children[2];
+	};
+
+	struct RebuildJob
+	{
+		std::vector<int32_t>		leaves;
+		std::vector<Vector3>		mins;
+		std::vector<Vector3>		maxs;
+		std::vector<BuildNode>		nodes;
+		int32_t						root = 0;
+		uint32_t					version = 0;
+		std::atomic<bool>			done{ false };
+	};
+
+	int32_t AllocateNode();
+
+	void FreeNode(int32_t index);
+
+	// recomputes boxes from index up to the root, stops early once a box no longer changes.
+	void RefitAncestors(int32_t index);
+
+	std::shared_ptr<RebuildJob> CreateRebuildJob() const;
+
+	static void BuildJob(RebuildJob& job);
+
+	bool ApplyRebuild(RebuildJob& job);
+
+	// every leaf below index, without box tests.
+	void CollectLeaves(int32_t index, std::vector<uint32_t>& outResults);
+
+	void AddQueryStats(int64_t nodesTested, double startTime);
+
+private:
+	std::vector<Node>				m_Nodes;
+	int32_t							m_Root = NULL_NODE;
+	int32_t							m_FreeList = NULL_NODE;
+	int32_t							m_LeafCount = 0;
+	// bumped by Insert and Remove, a rebuild of an older version is stale.
+	uint32_t						m_Version = 0;
+	float							m_BuiltCost = 0.0f;
+
+	std::vector<int32_t>			m_Moved;
+	std::vector<int32_t>			m_Stack;
+	std::vector<int32_t>			m_CollectStack;
+	std::vector<float>				m_Distances;
+	std::shared_ptr<RebuildJob>		m_Rebuild;
+};
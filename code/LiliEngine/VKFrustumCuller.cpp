@@ -0,0 +1,276 @@
+#include "stdafx.h"
+#include "VKFrustumCuller.h"
+#include "VKCamera.h"
+#include "VKModel.h"
+#include "ThreadPool.h"
+#include "Plane.h"
+#include "Time.h"
+
+struct FrustumPlanes4
+{
+	__m128 nx[6];
+	__m128 ny[6];
+	__m128 nz[6];
+	__m128 w[6];
+	// |n|, projects a box extent onto the plane normal.
+	__m128 ax[6];
+	__m128 ay[6];
+	__m128 az[6];
+};
+
+static void LoadPlanes(const float planes[6][4], FrustumPlanes4& outPlanes)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		outPlanes.nx[i] = _mm_set1_ps(planes[i][0]);
+		outPlanes.ny[i] = _mm_set1_ps(planes[i][1]);
+		outPlanes.nz[i] = _mm_set1_ps(planes[i][2]);
+		outPlanes.w[i]  = _mm_set1_ps(planes[i][3]);
+		outPlanes.ax[i] = _mm_andnot_ps(signMask, outPlanes.nx[i]);
+		outPlanes.ay[i] = _mm_andnot_ps(signMask, outPlanes.ny[i]);
+		outPlanes.az[i] = _mm_andnot_ps(signMask, outPlanes.nz[i]);
+	}
+}
+
+static inline __m128 PlaneDistance(const FrustumPlanes4& planes, int32_t i, __m128 x, __m128 y, __m128 z)
+{
+	__m128 dist = _mm_mul_ps(planes.nx[i], x);
+	dist = _mm_add_ps(dist, _mm_mul_ps(planes.ny[i], y));
+	dist = _mm_add_ps(dist, _mm_mul_ps(planes.nz[i], z));
+	return _mm_sub_ps(dist, planes.w[i]);
+}
+
+// lanes set in mask are visible, lanes past count are padding.
+static inline int32_t WriteVisible(int32_t mask, int32_t first, int32_t count, uint32_t* outIndices)
+{
+	int32_t written = 0;
+	for (int32_t lane = 0; lane < 4; ++lane)
+	{
+		if ((mask & (1 << lane)) && first + lane < count) {
+			outIndices[written++] = first + lane;
+		}
+	}
+	return written;
+}
+
+static int32_t CullBoxRange(const float planes[6][4], const void* objects, int32_t first, int32_t last, int32_t count, uint32_t* outIndices)
+{
+	const VKBoxArray& boxes = *(const VKBoxArray*)objects;
+
+	FrustumPlanes4 planes4;
+	LoadPlanes(planes, planes4);
+
+	int32_t written = 0;
+	for (int32_t i = first; i < last; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+		const __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+		const __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+		const __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+		const __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+		const __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+		// a box is outside when its center is further out than its extent projected on the normal.
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+		for (int32_t p = 0; p < 6; ++p)
+		{
+			__m128 dist = PlaneDistance(planes4, p, cx, cy, cz);
+			__m128 radius = _mm_mul_ps(planes4.ax[p], ex);
+			radius = _mm_add_ps(radius, _mm_mul_ps(planes4.ay[p], ey));
+			radius = _mm_add_ps(radius, _mm_mul_ps(planes4.az[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmple_ps(dist, radius));
+		}
+
+		written += WriteVisible(_mm_movemask_ps(inside), i, count, outIndices + written);
+	}
+
+	return written;
+}
+
+static int32_t CullSphereRange(const float planes[6][4], const void* objects, int32_t first, int32_t last, int32_t count, uint32_t* outIndices)
+{
+	const VKSphereArray& spheres = *(const VKSphereArray*)objects;
+
+	FrustumPlanes4 planes4;
+	LoadPlanes(planes, planes4);
+
+	int32_t written = 0;
+	for (int32_t i = first; i < last; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(&spheres.centerX[i]);
+		const __m128 cy = _mm_loadu_ps(&spheres.centerY[i]);
+		const __m128 cz = _mm_loadu_ps(&spheres.centerZ[i]);
+		const __m128 radius = _mm_loadu_ps(&spheres.radius[i]);
+
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+		for (int32_t p = 0; p < 6; ++p) {
+			inside = _mm_and_ps(inside, _mm_cmple_ps(PlaneDistance(planes4, p, cx, cy, cz), radius));
+		}
+
+		written += WriteVisible(_mm_movemask_ps(inside), i, count, outIndices + written);
+	}
+
+	return written;
+}
+
+void VKFrustumCuller::Setup(const Matrix4x4& viewProjection)
+{
+	Plane planes[6];
+	viewProjection.GetFrustumNearPlane(planes[0]);
+	viewProjection.GetFrustumFarPlane(planes[1]);
+	viewProjection.GetFrustumLeftPlane(planes[2]);
+	viewProjection.GetFrustumRightPlane(planes[3]);
+	viewProjection.GetFrustumTopPlane(planes[4]);
+	viewProjection.GetFrustumBottomPlane(planes[5]);
+
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		m_Planes[i][0] = planes[i].x;
+		m_Planes[i][1] = planes[i].y;
+		m_Planes[i][2] = planes[i].z;
+		m_Planes[i][3] = planes[i].w;
+	}
+}
+
+void VKFrustumCuller::Setup(VKCamera& camera)
+{
+	Setup(camera.GetViewProjection());
+}
+
+bool VKFrustumCuller::IsVisible(const VKBoundingBox& box) const
+{
+	const Vector3 center = box.GetCenter();
+	const Vector3 extent = box.GetExtent();
+
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		float dist = m_Planes[i][0] * center.x + m_Planes[i][1] * center.y + m_Planes[i][2] * center.z - m_Planes[i][3];
+		float radius = math::Abs(m_Planes[i][0]) * extent.x + math::Abs(m_Planes[i][1]) * extent.y + math::Abs(m_Planes[i][2]) * extent.z;
+		if (dist > radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool VKFrustumCuller::IsVisible(const VKBoundingSphere& sphere) const
+{
+	const Vector3& center = sphere.center;
+
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		float dist = m_Planes[i][0] * center.x + m_Planes[i][1] * center.y + m_Planes[i][2] * center.z - m_Planes[i][3];
+		if (dist > sphere.radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool VKFrustumCuller::Contains(const VKBoundingBox& box) const
+{
+	const Vector3 center = box.GetCenter();
+	const Vector3 extent = box.GetExtent();
+
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		float dist = m_Planes[i][0] * center.x + m_Planes[i][1] * center.y + m_Planes[i][2] * center.z - m_Planes[i][3];
+		float radius = math::Abs(m_Planes[i][0]) * extent.x + math::Abs(m_Planes[i][1]) * extent.y + math::Abs(m_Planes[i][2]) * extent.z;
+		if (dist + radius > 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void VKFrustumCuller::Cull(const VKBoxArray& boxes, std::vector<uint32_t>& outIndices)
+{
+	CullBatches(CullBoxRange, &boxes, boxes.count, outIndices);
+}
+
+void VKFrustumCuller::Cull(const VKSphereArray& spheres, std::vector<uint32_t>& outIndices)
+{
+	CullBatches(CullSphereRange, &spheres, spheres.count, outIndices);
+}
+
+void VKFrustumCuller::Cull(const std::vector<VKMesh*>& meshes, std::vector<uint32_t>& outIndices)
+{
+	// world matrices are read here, on the calling thread, so a dirty hierarchy is updated only once.
+	const int32_t count = meshes.size();
+	m_MeshBounds.resize(count);
+	m_MeshMatrices.resize(count);
+	for (int32_t i = 0; i < count; ++i)
+	{
+		m_MeshBounds[i] = &meshes[i]->bounding;
+		m_MeshMatrices[i] = &meshes[i]->linkNode->GetGlobalMatrix();
+	}
+
+	VKBounds::TransformBoxes(m_MeshBounds.data(), m_MeshMatrices.data(), count, m_MeshBoxes);
+	Cull(m_MeshBoxes, outIndices);
+}
+
+void VKFrustumCuller::CullBatches(CullRangeFunc func, const void* objects, int32_t count, std::vector<uint32_t>& outIndices)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	const int32_t padded = (count + 3) & ~3;
+	const int32_t batch = math::Max((batchSize + 3) & ~3, 4);
+	const int32_t batchCount = (padded + batch - 1) / batch;
+
+	if (m_BatchIndices.size() < batchCount)
+	{
+		m_BatchIndices.resize(batchCount);
+	}
+	m_BatchCounts.resize(batchCount);
+
+	ThreadPool::Get().ParallelFor(batchCount, [&](int32_t index) {
+		const int32_t first = index * batch;
+		const int32_t last = math::Min(padded, first + batch);
+
+		std::vector<uint32_t>& indices = m_BatchIndices[index];
+		if (indices.size() < last - first) {
+			indices.resize(last - first);
+		}
+		m_BatchCounts[index] = func(m_Planes, objects, first, last, count, indices.data());
+	});
+
+	// batches are concatenated in order, the indices stay ascending.
+	int32_t visible = 0;
+	for (int32_t i = 0; i < batchCount; ++i) {
+		visible += m_BatchCounts[i];
+	}
+
+	outIndices.resize(visible);
+	uint32_t* output = outIndices.data();
+	for (int32_t i = 0; i < batchCount; ++i)
+	{
+		if (m_BatchCounts[i] > 0)
+		{
+			memcpy(output, m_BatchIndices[i].data(), m_BatchCounts[i] * sizeof(uint32_t));
+			output += m_BatchCounts[i];
+		}
+	}
+
+	stats.objectsTested += count;
+	stats.objectsVisible += visible;
+	stats.cullTime += GenericPlatformTime::Seconds() - startTime;
+}
+
+void VKFrustumCuller::ResetStats()
+{
+	stats = Stats();
+}
+
+void VKFrustumCuller::LogStats() const
+{
+	MLOG(
+		"Frustum cull: %lld/%lld objects visible (%.1f%% culled), %.1f objects/us",
+		stats.objectsVisible, stats.objectsTested,
+		stats.objectsTested > 0 ? 100.0 * (stats.objectsTested - stats.objectsVisible) / stats.objectsTested : 0.0,
+		stats.ObjectsPerUS()
+	);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "VKBounds.h"
+
+#include <vector>
+
+class VKCamera;
+struct VKMesh;
+
+// World space frustum culling of boxes and spheres. Objects are tested 4 at a time from the SoA
+// arrays in VKBounds.h, large arrays are split into batches for the thread pool. Visible objects
+// come out as a compact, ascending index list for the draw and instance builders.
+class VKFrustumCuller
+{
+public:
+	struct Stats
+	{
+		int64_t		objectsTested = 0;
+		int64_t		objectsVisible = 0;
+		double		cullTime = 0.0;
+
+		inline double ObjectsPerUS() const
+		{
+			return cullTime > 0.0 ? objectsTested / (cullTime * 1000000.0) : 0.0;
+		}
+	};
+
+	// world space planes of the view-projection, normals point out of the frustum.
+	void Setup(const Matrix4x4& viewProjection);
+
+	void Setup(VKCamera& camera);
+
+	bool IsVisible(const VKBoundingBox& box) const;
+
+	bool IsVisible(const VKBoundingSphere& sphere) const;
+
+	// box entirely on the inner side of all six planes.
+	bool Contains(const VKBoundingBox& box) const;
+
+	void Cull(const VKBoxArray& boxes, std::vector<uint32_t>& outIndices);
+
+	void Cull(const VKSphereArray& spheres, std::vector<uint32_t>& outIndices);
+
+	// world boxes of the meshes from their linked nodes, outIndices index into meshes.
+	void Cull(const std::vector<VKMesh*>& meshes, std::vector<uint32_t>& outIndices);
+
+	void ResetStats();
+
+	void LogStats() const;
+
+public:
+	Stats		stats;
+	// objects per thread pool task, rounded up to a multiple of 4.
+	int32_t		batchSize = 4096;
+
+private:
+	typedef int32_t (*CullRangeFunc)(const float planes[6][4], const void* objects, int32_t first, int32_t last, int32_t count, uint32_t* outIndices);
+
+	void CullBatches(CullRangeFunc func, const void* objects, int32_t count, std::vector<uint32_t>& outIndices);
+
+private:
+	float									m_Planes[6][4];
+
+	VKBoxArray								m_MeshBoxes;
+	std::vector<const VKBoundingBox*>		m_MeshBounds;
+	std::vector<const Matrix4x4*>			m_MeshMatrices;
+	std::vector<std::vector<uint32_t>>		m_BatchIndices;
+	std::vector<int32_t>					m_BatchCounts;
+};
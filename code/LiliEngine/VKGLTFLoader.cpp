@@ -0,0 +1,1279 @@
+#include "stdafx.h"
+#include "VKGLTFLoader.h"
+#include "FileManager.h"
+#include "Path.h"
+#include "StringUtils.h"
+#include "ThreadPool.h"
+#include "Time.h"
+
+#include <RapidJSON/include/rapidjson/document.h>
+
+// "glTF", "JSON" and "BIN\0" little endian.
+static const uint32_t GLB_MAGIC = 0x46546C67;
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+static const int32_t GLTF_BYTE = 5120;
+static const int32_t GLTF_UNSIGNED_BYTE = 5121;
+static const int32_t GLTF_SHORT = 5122;
+static const int32_t GLTF_UNSIGNED_SHORT = 5123;
+static const int32_t GLTF_UNSIGNED_INT = 5125;
+static const int32_t GLTF_FLOAT = 5126;
+
+static const int32_t GLTF_TRIANGLES = 4;
+
+struct GLTFAccessor
+{
+	const uint8_t*	data = nullptr;
+	int32_t			stride = 0;
+	int32_t			count = 0;
+	int32_t			componentType = 0;
+	int32_t			components = 0;
+	bool			normalized = false;
+	// min/max of VEC3 accessors, required by the spec for POSITION.
+	bool			hasBounds = false;
+	float			min[3];
+	float			max[3];
+};
+
+// one glTF primitive, a VKMesh of its own like an aiMesh.
+struct GLTFPrimitiveJob
+{
+	const rapidjson::Value*	primitive = nullptr;
+	int32_t					skin = -1;
+	VKNode*					node = nullptr;
+	VKMesh*					mesh = nullptr;
+	VKVertexCacheStats		cacheBefore;
+	VKVertexCacheStats		cacheAfter;
+	bool					failed = false;
+};
+
+struct GLTFContext
+{
+	VKModel*						model = nullptr;
+	rapidjson::Document				document;
+	const uint8_t*					binData = nullptr;
+	uint32_t						binSize = 0;
+
+	std::vector<GLTFAccessor>		accessors;
+	// per glTF node, names are made unique because nodesMap and the animation clips are keyed by them.
+	std::vector<std::string>		nodeNames;
+	std::vector<int32_t>			nodeParents;
+	// nullptr for nodes outside the loaded scene.
+	std::vector<VKNode*>			nodes;
+	std::vector<int32_t>			nodeBones;
+
+	std::vector<GLTFPrimitiveJob>	jobs;
+};
+
+static const rapidjson::Value* FindArray(const rapidjson::Value& value, const char* name)
+{
+	rapidjson::Value::ConstMemberIterator it = value.FindMember(name);
+	return it != value.MemberEnd() && it->value.IsArray() ? &(it->value) : nullptr;
+}
+
+static const rapidjson::Value* FindObject(const rapidjson::Value& value, const char* name)
+{
+	rapidjson::Value::ConstMemberIterator it = value.FindMember(name);
+	return it != value.MemberEnd() && it->value.IsObject() ? &(it->value) : nullptr;
+}
+
+static int32_t GetInt(const rapidjson::Value& value, const char* name, int32_t defaultValue)
+{
+	rapidjson::Value::ConstMemberIterator it = value.FindMember(name);
+	return it != value.MemberEnd() && it->value.IsInt() ? it->value.GetInt() : defaultValue;
+}
+
+static bool GetBool(const rapidjson::Value& value, const char* name)
+{
+	rapidjson::Value::ConstMemberIterator it = value.FindMember(name);
+	return it != value.MemberEnd() && it->value.IsBool() && it->value.GetBool();
+}
+
+static std::string GetString(const rapidjson::Value& value, const char* name)
+{
+	rapidjson::Value::ConstMemberIterator it = value.FindMember(name);
+	return it != value.MemberEnd() && it->value.IsString() ? std::string(it->value.GetString(), it->value.GetStringLength()) : std::string();
+}
+
+// outValues is only written when the member has exactly count numbers.
+static bool GetFloats(const rapidjson::Value& value, const char* name, float* outValues, int32_t count)
+{
+	const rapidjson::Value* values = FindArray(value, name);
+	if (values == nullptr || values->Size() != count) {
+		return false;
+	}
+
+	for (int32_t i = 0; i < count; ++i) {
+		if (!(*values)[i].IsNumber()) {
+			return false;
+		}
+	}
+
+	for (int32_t i = 0; i < count; ++i) {
+		outValues[i] = (*values)[i].GetFloat();
+	}
+
+	return true;
+}
+
+// element of an array member, nullptr when the index is out of range or not an object.
+static const rapidjson::Value* GetElement(const rapidjson::Value& value, const char* name, int32_t index)
+{
+	const rapidjson::Value* values = FindArray(value, name);
+	if (values == nullptr || index < 0 || index >= (int32_t)values->Size() || !(*values)[index].IsObject()) {
+		return nullptr;
+	}
+	return &(*values)[index];
+}
+
+static int32_t GetComponentSize(int32_t componentType)
+{
+	switch (componentType)
+	{
+	case GLTF_BYTE:
+	case GLTF_UNSIGNED_BYTE:
+		return 1;
+	case GLTF_SHORT:
+	case GLTF_UNSIGNED_SHORT:
+		return 2;
+	case GLTF_UNSIGNED_INT:
+	case GLTF_FLOAT:
+		return 4;
+	}
+	return 0;
+}
+
+static int32_t GetComponentCount(const std::string& type)
+{
+	if (type == "SCALAR") {
+		return 1;
+	}
+	else if (type == "VEC2") {
+		return 2;
+	}
+	else if (type == "VEC3") {
+		return 3;
+	}
+	else if (type == "VEC4") {
+		return 4;
+	}
+	else if (type == "MAT4") {
+		return 16;
+	}
+	return 0;
+}
+
+static float ReadFloat(const GLTFAccessor& accessor, int32_t index, int32_t component)
+{
+	const uint8_t* element = accessor.data + (size_t)index * accessor.stride;
+	float value = 0.0f;
+
+	switch (accessor.componentType)
+	{
+	case GLTF_FLOAT:
+		return ((const float*)element)[component];
+	case GLTF_BYTE:
+		value = ((const int8_t*)element)[component];
+		return accessor.normalized ? math::Max(value / 127.0f, -1.0f) : value;
+	case GLTF_UNSIGNED_BYTE:
+		value = element[component];
+		return accessor.normalized ? value / 255.0f : value;
+	case GLTF_SHORT:
+		value = ((const int16_t*)element)[component];
+		return accessor.normalized ? math::Max(value / 32767.0f, -1.0f) : value;
+	case GLTF_UNSIGNED_SHORT:
+		value = ((const uint16_t*)element)[component];
+		return accessor.normalized ? value / 65535.0f : value;
+	case GLTF_UNSIGNED_INT:
+		return (float)((const uint32_t*)element)[component];
+	}
+
+	return value;
+}
+
+static uint32_t ReadUInt(const GLTFAccessor& accessor, int32_t index, int32_t component)
+{
+	const uint8_t* element = accessor.data + (size_t)index * accessor.stride;
+
+	switch (accessor.componentType)
+	{
+	case GLTF_UNSIGNED_BYTE:
+		return element[component];
+	case GLTF_UNSIGNED_SHORT:
+		return ((const uint16_t*)element)[component];
+	case GLTF_UNSIGNED_INT:
+		return ((const uint32_t*)element)[component];
+	}
+
+	return 0;
+}
+
+static bool ParseGLB(GLTFContext& context, const uint8_t* dataPtr, uint32_t dataSize)
+{
+	if (dataSize < 12)
+	{
+		MLOGE("glTF file too small.");
+		return false;
+	}
+
+	const uint32_t* header = (const uint32_t*)dataPtr;
+	if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > dataSize)
+	{
+		MLOGE("Not a glTF 2.0 binary.");
+		return false;
+	}
+
+	const char* json = nullptr;
+	uint32_t jsonSize = 0;
+
+	uint32_t offset = 12;
+	while (offset + 8 <= header[2])
+	{
+		uint32_t chunkSize = *(const uint32_t*)(dataPtr + offset);
+		uint32_t chunkType = *(const uint32_t*)(dataPtr + offset + 4);
+		offset += 8;
+
+		if (chunkSize > header[2] - offset)
+		{
+			MLOGE("glTF chunk exceeds the file.");
+			return false;
+		}
+
+		if (chunkType == GLB_CHUNK_JSON && json == nullptr)
+		{
+			json = (const char*)(dataPtr + offset);
+			jsonSize = chunkSize;
+		}
+		else if (chunkType == GLB_CHUNK_BIN && context.binData == nullptr)
+		{
+			context.binData = dataPtr + offset;
+			context.binSize = chunkSize;
+		}
+
+		// chunks are 4 byte aligned.
+		offset += (chunkSize + 3) & ~3;
+	}
+
+	if (json == nullptr)
+	{
+		MLOGE("glTF binary without JSON chunk.");
+		return false;
+	}
+
+	context.document.Parse(json, jsonSize);
+	if (context.document.HasParseError() || !context.document.IsObject())
+	{
+		MLOGE("glTF JSON parse error %d at %d.", (int32_t)context.document.GetParseError(), (int32_t)context.document.GetErrorOffset());
+		return false;
+	}
+
+	const rapidjson::Value* extensions = FindArray(context.document, "extensionsRequired");
+	if (extensions && extensions->Size() > 0)
+	{
+		MLOGE("glTF requires extensions.");
+		return false;
+	}
+
+	// only the embedded BIN chunk is read, external and data uri buffers are left to Assimp.
+	const rapidjson::Value* buffers = FindArray(context.document, "buffers");
+	if (buffers)
+	{
+		for (int32_t i = 0; i < buffers->Size(); ++i)
+		{
+			if (!(*buffers)[i].IsObject() || (*buffers)[i].HasMember("uri"))
+			{
+				MLOGE("glTF references external buffers.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool ParseAccessors(GLTFContext& context)
+{
+	const rapidjson::Value* accessors = FindArray(context.document, "accessors");
+	if (accessors == nullptr) {
+		return true;
+	}
+
+	context.accessors.resize(accessors->Size());
+
+	for (int32_t i = 0; i < accessors->Size(); ++i)
+	{
+		const rapidjson::Value& source = (*accessors)[i];
+		if (!source.IsObject())
+		{
+			MLOGE("glTF accessor %d is invalid.", i);
+			return false;
+		}
+
+		if (source.HasMember("sparse"))
+		{
+			MLOGE("glTF sparse accessors are not supported.");
+			return false;
+		}
+
+		GLTFAccessor& accessor = context.accessors[i];
+		accessor.componentType = GetInt(source, "componentType", 0);
+		accessor.components = GetComponentCount(GetString(source, "type"));
+		accessor.count = GetInt(source, "count", 0);
+		accessor.normalized = GetBool(source, "normalized");
+
+		const int32_t elementSize = GetComponentSize(accessor.componentType) * accessor.components;
+		const rapidjson::Value* view = GetElement(context.document, "bufferViews", GetInt(source, "bufferView", -1));
+		if (elementSize == 0 || accessor.count < 0 || view == nullptr || GetInt(*view, "buffer", 0) != 0 || context.binData == nullptr)
+		{
+			MLOGE("glTF accessor %d is invalid.", i);
+			return false;
+		}
+
+		const int64_t viewOffset = GetInt(*view, "byteOffset", 0);
+		const int64_t viewSize = GetInt(*view, "byteLength", 0);
+		const int32_t viewStride = GetInt(*view, "byteStride", 0);
+		const int64_t offset = GetInt(source, "byteOffset", 0);
+
+		accessor.stride = viewStride > 0 ? viewStride : elementSize;
+
+		int64_t end = offset;
+		if (accessor.count > 0) {
+			end += (int64_t)accessor.stride * (accessor.count - 1) + elementSize;
+		}
+
+		if (viewOffset < 0 || viewSize < 0 || offset < 0 || viewOffset + viewSize > context.binSize || end > viewSize)
+		{
+			MLOGE("glTF accessor %d exceeds its buffer view.", i);
+			return false;
+		}
+
+		accessor.data = context.binData + viewOffset + offset;
+
+		if (accessor.components == 3) {
+			accessor.hasBounds = GetFloats(source, "min", accessor.min, 3) && GetFloats(source, "max", accessor.max, 3);
+		}
+	}
+
+	return true;
+}
+
+static const GLTFAccessor* GetAccessor(const GLTFContext& context, int32_t index)
+{
+	if (index < 0 || index >= context.accessors.size()) {
+		return nullptr;
+	}
+	return &context.accessors[index];
+}
+
+static const GLTFAccessor* GetAttribute(const GLTFContext& context, const rapidjson::Value& attributes, const char* name)
+{
+	return GetAccessor(context, GetInt(attributes, name, -1));
+}
+
+static void ReadLocalMatrix(const rapidjson::Value& node, Matrix4x4& outMatrix)
+{
+	// glTF stores column major matrices for column vectors, which is the same memory as our row vector matrices.
+	float values[16];
+	if (GetFloats(node, "matrix", values, 16))
+	{
+		for (int32_t i = 0; i < 16; ++i) {
+			outMatrix.m[i / 4][i % 4] = values[i];
+		}
+		return;
+	}
+
+	float translation[3] = { 0.0f, 0.0f, 0.0f };
+	float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	GetFloats(node, "translation", translation, 3);
+	GetFloats(node, "rotation", rotation, 4);
+	GetFloats(node, "scale", scale, 3);
+
+	outMatrix.SetIdentity();
+	outMatrix.AppendScale(Vector3(scale[0], scale[1], scale[2]));
+	outMatrix.Append(Quat(rotation[0], rotation[1], rotation[2], rotation[3]).ToMatrix());
+	outMatrix.AppendTranslation(Vector3(translation[0], translation[1], translation[2]));
+}
+
+// the rest pose as TRS, matrix nodes are decomposed.
+static void ReadRestPose(const rapidjson::Value& node, Vector3& outTranslation, Quat& outRotation, Vector3& outScale)
+{
+	if (node.HasMember("matrix"))
+	{
+		Matrix4x4 matrix;
+		ReadLocalMatrix(node, matrix);
+		outTranslation = matrix.GetOrigin();
+		outScale = matrix.GetScaleVector();
+		outRotation = matrix.GetMatrixWithoutScale().ToQuat();
+		return;
+	}
+
+	float translation[3] = { 0.0f, 0.0f, 0.0f };
+	float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	GetFloats(node, "translation", translation, 3);
+	GetFloats(node, "rotation", rotation, 4);
+	GetFloats(node, "scale", scale, 3);
+
+	outTranslation = Vector3(translation[0], translation[1], translation[2]);
+	outRotation = Quat(rotation[0], rotation[1], rotation[2], rotation[3]);
+	outScale = Vector3(scale[0], scale[1], scale[2]);
+}
+
+static bool ParseNodes(GLTFContext& context)
+{
+	const rapidjson::Value* nodes = FindArray(context.document, "nodes");
+	if (nodes == nullptr || nodes->Size() == 0)
+	{
+		MLOGE("glTF without nodes.");
+		return false;
+	}
+
+	const int32_t nodeCount = nodes->Size();
+	context.nodeNames.resize(nodeCount);
+	context.nodeParents.resize(nodeCount, -1);
+	context.nodes.resize(nodeCount, nullptr);
+	context.nodeBones.resize(nodeCount, -1);
+
+	std::unordered_map<std::string, int32_t> usedNames;
+	for (int32_t i = 0; i < nodeCount; ++i)
+	{
+		if (!(*nodes)[i].IsObject())
+		{
+			MLOGE("glTF node %d is invalid.", i);
+			return false;
+		}
+
+		std::string name = GetString((*nodes)[i], "name");
+		if (name.empty()) {
+			name = StringUtils::Printf("node_%d", i);
+		}
+		if (usedNames.find(name) != usedNames.end()) {
+			name += StringUtils::Printf("_%d", i);
+		}
+
+		usedNames.insert(std::make_pair(name, i));
+		context.nodeNames[i] = name;
+	}
+
+	// a node with two parents could also close a cycle.
+	for (int32_t i = 0; i < nodeCount; ++i)
+	{
+		const rapidjson::Value* children = FindArray((*nodes)[i], "children");
+		if (children == nullptr) {
+			continue;
+		}
+
+		for (int32_t j = 0; j < children->Size(); ++j)
+		{
+			int32_t child = (*children)[j].IsInt() ? (*children)[j].GetInt() : -1;
+			if (child < 0 || child >= nodeCount || child == i || context.nodeParents[child] != -1)
+			{
+				MLOGE("glTF node %d has invalid children.", i);
+				return false;
+			}
+			context.nodeParents[child] = i;
+		}
+	}
+
+	return true;
+}
+
+VKNode* VKGLTFLoader::BuildNode(GLTFContext& context, int32_t index, VKNode* parent)
+{
+	VKModel* model = context.model;
+	const rapidjson::Value& source = (*FindArray(context.document, "nodes"))[index];
+
+	if (context.nodes[index])
+	{
+		MLOGE("glTF node %d is referenced twice.", index);
+		return nullptr;
+	}
+
+	Matrix4x4 localMatrix;
+	ReadLocalMatrix(source, localMatrix);
+
+	// linked right away so a failed load still frees the whole tree.
+	VKNode* vkNode = new VKNode();
+	vkNode->name = context.nodeNames[index];
+	model->AddNode(vkNode, parent, localMatrix);
+	context.nodes[index] = vkNode;
+
+	int32_t meshIndex = GetInt(source, "mesh", -1);
+	if (meshIndex >= 0)
+	{
+		const rapidjson::Value* mesh = GetElement(context.document, "meshes", meshIndex);
+		const rapidjson::Value* primitives = mesh ? FindArray(*mesh, "primitives") : nullptr;
+		if (primitives == nullptr)
+		{
+			MLOGE("glTF node %d references an invalid mesh.", index);
+			return nullptr;
+		}
+
+		int32_t skin = GetInt(source, "skin", -1);
+		if (skin >= 0 && GetElement(context.document, "skins", skin) == nullptr)
+		{
+			MLOGE("glTF node %d references an invalid skin.", index);
+			return nullptr;
+		}
+
+		for (int32_t i = 0; i < primitives->Size(); ++i)
+		{
+			GLTFPrimitiveJob job;
+			job.primitive = &(*primitives)[i];
+			job.skin = skin;
+			job.node = vkNode;
+			context.jobs.push_back(job);
+		}
+	}
+
+	const rapidjson::Value* children = FindArray(source, "children");
+	if (children)
+	{
+		for (int32_t i = 0; i < children->Size(); ++i) {
+			if (BuildNode(context, (*children)[i].GetInt(), vkNode) == nullptr) {
+				return nullptr;
+			}
+		}
+	}
+
+	return vkNode;
+}
+
+bool VKGLTFLoader::BuildScene(GLTFContext& context)
+{
+	VKModel* model = context.model;
+	const int32_t nodeCount = context.nodes.size();
+
+	std::vector<int32_t> roots;
+	const rapidjson::Value* scene = GetElement(context.document, "scenes", GetInt(context.document, "scene", 0));
+	const rapidjson::Value* sceneNodes = scene ? FindArray(*scene, "nodes") : nullptr;
+	if (sceneNodes)
+	{
+		for (int32_t i = 0; i < sceneNodes->Size(); ++i)
+		{
+			int32_t root = (*sceneNodes)[i].IsInt() ? (*sceneNodes)[i].GetInt() : -1;
+			if (root < 0 || root >= nodeCount)
+			{
+				MLOGE("glTF scene references an invalid node.");
+				return false;
+			}
+			roots.push_back(root);
+		}
+	}
+	else
+	{
+		for (int32_t i = 0; i < nodeCount; ++i) {
+			if (context.nodeParents[i] == -1) {
+				roots.push_back(i);
+			}
+		}
+	}
+
+	if (roots.size() == 0)
+	{
+		MLOGE("glTF scene is empty.");
+		return false;
+	}
+
+	if (roots.size() == 1) {
+		return BuildNode(context, roots[0], nullptr) != nullptr;
+	}
+
+	// several scene roots hang below one node, like the root Assimp creates.
+	VKNode* vkNode = new VKNode();
+	vkNode->name = "RootNode";
+	while (std::find(context.nodeNames.begin(), context.nodeNames.end(), vkNode->name) != context.nodeNames.end()) {
+		vkNode->name += "_";
+	}
+	model->AddNode(vkNode, nullptr, Matrix4x4());
+
+	for (int32_t i = 0; i < roots.size(); ++i) {
+		if (BuildNode(context, roots[i], vkNode) == nullptr) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool ParseSkins(GLTFContext& context)
+{
+	VKModel* model = context.model;
+
+	const rapidjson::Value* skins = FindArray(context.document, "skins");
+	if (skins == nullptr) {
+		return true;
+	}
+
+	for (int32_t i = 0; i < skins->Size(); ++i)
+	{
+		const rapidjson::Value* joints = (*skins)[i].IsObject() ? FindArray((*skins)[i], "joints") : nullptr;
+		if (joints == nullptr)
+		{
+			MLOGE("glTF skin %d has no joints.", i);
+			return false;
+		}
+
+		const GLTFAccessor* inverseBindMatrices = GetAccessor(context, GetInt((*skins)[i], "inverseBindMatrices", -1));
+		if (inverseBindMatrices && (inverseBindMatrices->components != 16 || inverseBindMatrices->componentType != GLTF_FLOAT || inverseBindMatrices->count < joints->Size()))
+		{
+			MLOGE("glTF skin %d has invalid inverse bind matrices.", i);
+			return false;
+		}
+
+		for (int32_t j = 0; j < joints->Size(); ++j)
+		{
+			int32_t joint = (*joints)[j].IsInt() ? (*joints)[j].GetInt() : -1;
+			if (joint < 0 || joint >= context.nodes.size() || context.nodes[joint] == nullptr)
+			{
+				MLOGE("glTF skin %d references a joint outside the scene.", i);
+				return false;
+			}
+
+			// joints shared by several skins become one bone, as in VKModel::LoadBones.
+			if (context.nodeBones[joint] != -1) {
+				continue;
+			}
+
+			VKBone* bone = new VKBone();
+			bone->index = model->bones.size();
+			bone->parent = -1;
+			bone->name = context.nodeNames[joint];
+			if (inverseBindMatrices)
+			{
+				for (int32_t k = 0; k < 16; ++k) {
+					bone->inverseBindPose.m[k / 4][k % 4] = ReadFloat(*inverseBindMatrices, j, k);
+				}
+			}
+			else
+			{
+				bone->inverseBindPose.SetIdentity();
+			}
+
+			model->bones.push_back(bone);
+			model->bonesMap.insert(std::make_pair(bone->name, bone));
+			context.nodeBones[joint] = bone->index;
+		}
+	}
+
+	// a bone's parent is the bone of its parent node, if that node is a bone at all.
+	for (int32_t i = 0; i < context.nodes.size(); ++i)
+	{
+		int32_t parent = context.nodeParents[i];
+		if (context.nodeBones[i] != -1 && parent != -1 && context.nodeBones[parent] != -1) {
+			model->bones[context.nodeBones[i]]->parent = context.nodeBones[parent];
+		}
+	}
+
+	return true;
+}
+
+// STEP channels repeat the previous value at every key, so the linear sampling of VKAnimChannel holds it until the key.
+template<class ValueType>
+static void AddKey(float key, const ValueType& value, bool step, VKAnimChannel<ValueType>& outChannel)
+{
+	if (step && outChannel.values.size() > 0)
+	{
+		outChannel.keys.push_back(key);
+		outChannel.values.push_back(outChannel.values.back());
+	}
+
+	outChannel.keys.push_back(key);
+	outChannel.values.push_back(value);
+}
+
+static void ReadChannel(const GLTFAccessor& input, const GLTFAccessor& output, int32_t valueStride, int32_t valueOffset, bool step, VKAnimChannel<Vector3>& outChannel, float& outDuration)
+{
+	for (int32_t i = 0; i < input.count; ++i)
+	{
+		int32_t index = i * valueStride + valueOffset;
+		AddKey(ReadFloat(input, i, 0), Vector3(ReadFloat(output, index, 0), ReadFloat(output, index, 1), ReadFloat(output, index, 2)), step, outChannel);
+		outDuration = math::Max(outChannel.keys.back(), outDuration);
+	}
+}
+
+static void ReadChannel(const GLTFAccessor& input, const GLTFAccessor& output, int32_t valueStride, int32_t valueOffset, bool step, VKAnimChannel<Quat>& outChannel, float& outDuration)
+{
+	for (int32_t i = 0; i < input.count; ++i)
+	{
+		int32_t index = i * valueStride + valueOffset;
+		AddKey(ReadFloat(input, i, 0), Quat(ReadFloat(output, index, 0), ReadFloat(output, index, 1), ReadFloat(output, index, 2), ReadFloat(output, index, 3)), step, outChannel);
+		outDuration = math::Max(outChannel.keys.back(), outDuration);
+	}
+}
+
+// LINEAR and STEP are sampled as such, CUBICSPLINE keeps its values without the tangents. A node
+// animated by only some of translation, rotation and scale holds its rest pose in the others,
+// VKModel::GotoAnimation rebuilds the whole local matrix from the clip.
+static void ParseAnimations(GLTFContext& context)
+{
+	VKModel* model = context.model;
+
+	const rapidjson::Value* animations = FindArray(context.document, "animations");
+	const rapidjson::Value* nodes = FindArray(context.document, "nodes");
+	if (animations == nullptr) {
+		return;
+	}
+
+	for (int32_t i = 0; i < animations->Size(); ++i)
+	{
+		const rapidjson::Value& source = (*animations)[i];
+		const rapidjson::Value* channels = source.IsObject() ? FindArray(source, "channels") : nullptr;
+		if (channels == nullptr) {
+			continue;
+		}
+
+		model->animations.push_back(VKAnimation());
+		VKAnimation& dvkAnimation = model->animations.back();
+		dvkAnimation.name = GetString(source, "name");
+		std::shared_ptr<VKAnimation::ClipsMap> clips = std::make_shared<VKAnimation::ClipsMap>();
+		std::unordered_map<std::string, int32_t> clipNodes;
+
+		for (int32_t j = 0; j < channels->Size(); ++j)
+		{
+			const rapidjson::Value& channel = (*channels)[j];
+			const rapidjson::Value* target = channel.IsObject() ? FindObject(channel, "target") : nullptr;
+			const rapidjson::Value* sampler = channel.IsObject() ? GetElement(source, "samplers", GetInt(channel, "sampler", -1)) : nullptr;
+			if (target == nullptr || sampler == nullptr)
+			{
+				MLOGE("glTF animation %d channel %d is invalid.", i, j);
+				continue;
+			}
+
+			int32_t node = GetInt(*target, "node", -1);
+			if (node < 0 || node >= context.nodes.size() || context.nodes[node] == nullptr) {
+				continue;
+			}
+
+			const GLTFAccessor* input = GetAccessor(context, GetInt(*sampler, "input", -1));
+			const GLTFAccessor* output = GetAccessor(context, GetInt(*sampler, "output", -1));
+			const std::string interpolation = GetString(*sampler, "interpolation");
+			const bool cubic = interpolation == "CUBICSPLINE";
+			const bool step = interpolation == "STEP";
+			const int32_t valueStride = cubic ? 3 : 1;
+			const int32_t valueOffset = cubic ? 1 : 0;
+			if (input == nullptr || output == nullptr || input->components != 1 || output->count < input->count * valueStride)
+			{
+				MLOGE("glTF animation %d channel %d has invalid samples.", i, j);
+				continue;
+			}
+
+			const std::string& nodeName = context.nodeNames[node];
+			clips->insert(std::make_pair(nodeName, VKAnimationClip()));
+			clipNodes.insert(std::make_pair(nodeName, node));
+
+			VKAnimationClip& animClip = (*clips)[nodeName];
+			animClip.nodeName = nodeName;
+
+			const std::string path = GetString(*target, "path");
+			if (path == "translation" && output->components == 3) {
+				ReadChannel(*input, *output, valueStride, valueOffset, step, animClip.positions, animClip.duration);
+			}
+			else if (path == "scale" && output->components == 3) {
+				ReadChannel(*input, *output, valueStride, valueOffset, step, animClip.scales, animClip.duration);
+			}
+			else if (path == "rotation" && output->components == 4) {
+				ReadChannel(*input, *output, valueStride, valueOffset, step, animClip.rotations, animClip.duration);
+			}
+
+			dvkAnimation.duration = math::Max(animClip.duration, dvkAnimation.duration);
+		}
+
+		// channels the clip does not animate get the rest pose as a single key.
+		for (auto it = clips->begin(); it != clips->end(); ++it)
+		{
+			VKAnimationClip& animClip = it->second;
+
+			Vector3 translation;
+			Quat rotation;
+			Vector3 scale;
+			ReadRestPose((*nodes)[clipNodes[it->first]], translation, rotation, scale);
+
+			if (animClip.positions.keys.size() == 0) {
+				AddKey(0.0f, translation, false, animClip.positions);
+			}
+			if (animClip.rotations.keys.size() == 0) {
+				AddKey(0.0f, rotation, false, animClip.rotations);
+			}
+			if (animClip.scales.keys.size() == 0) {
+				AddKey(0.0f, scale, false, animClip.scales);
+			}
+		}
+
+		dvkAnimation.clips = clips;
+	}
+}
+
+static std::string GetTextureName(const GLTFContext& context, const rapidjson::Value* textureInfo)
+{
+	if (textureInfo == nullptr) {
+		return std::string();
+	}
+
+	const rapidjson::Value* texture = GetElement(context.document, "textures", GetInt(*textureInfo, "index", -1));
+	const rapidjson::Value* image = texture ? GetElement(context.document, "images", GetInt(*texture, "source", -1)) : nullptr;
+	if (image == nullptr) {
+		return std::string();
+	}
+
+	// embedded images only have a name, the engine looks textures up by name either way.
+	std::string name = GetString(*image, "uri");
+	if (name.empty()) {
+		name = GetString(*image, "name");
+	}
+
+	SimplifyTexturePath(name);
+	return name;
+}
+
+static void FillMaterial(const GLTFContext& context, int32_t index, VKMaterialInfo& material)
+{
+	const rapidjson::Value* source = GetElement(context.document, "materials", index);
+	if (source == nullptr) {
+		return;
+	}
+
+	const rapidjson::Value* pbr = FindObject(*source, "pbrMetallicRoughness");
+	material.diffuse = GetTextureName(context, pbr ? FindObject(*pbr, "baseColorTexture") : nullptr);
+	material.normalmap = GetTextureName(context, FindObject(*source, "normalTexture"));
+}
+
+// float accessors are viewed in place, other component types are converted into scratch once.
+static VKVertexStream GetStream(const GLTFAccessor* accessor, int32_t components, std::vector<float>& scratch)
+{
+	if (accessor == nullptr || accessor->components < components) {
+		return VKVertexStream();
+	}
+
+	if (accessor->componentType == GLTF_FLOAT) {
+		return VKVertexStream(accessor->data, accessor->stride);
+	}
+
+	scratch.resize((size_t)accessor->count * accessor->components);
+	for (int32_t i = 0; i < accessor->count; ++i) {
+		for (int32_t j = 0; j < accessor->components; ++j) {
+			scratch[(size_t)i * accessor->components + j] = ReadFloat(*accessor, i, j);
+		}
+	}
+
+	return VKVertexStream(scratch.data(), accessor->components * sizeof(float));
+}
+
+// area weighted vertex normals, for primitives without NORMAL (Assimp's aiProcess_GenSmoothNormals).
+static void GenerateNormals(const VKVertexStream& positions, int32_t count, const std::vector<uint32_t>& indices, std::vector<float>& outNormals)
+{
+	std::vector<Vector3> normals(count, Vector3(0.0f, 0.0f, 0.0f));
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const float* p0 = positions.Get(indices[i + 0]);
+		const float* p1 = positions.Get(indices[i + 1]);
+		const float* p2 = positions.Get(indices[i + 2]);
+		Vector3 edge0(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+		Vector3 edge1(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+		// the cross product length is twice the triangle area.
+		Vector3 normal = Vector3::CrossProduct(edge0, edge1);
+		normals[indices[i + 0]] += normal;
+		normals[indices[i + 1]] += normal;
+		normals[indices[i + 2]] += normal;
+	}
+
+	outNormals.resize((size_t)count * 3);
+	for (int32_t i = 0; i < count; ++i)
+	{
+		Vector3 normal = normals[i].GetSafeNormal();
+		if (normal.IsNearlyZero()) {
+			normal = Vector3(0.0f, 1.0f, 0.0f);
+		}
+		outNormals[i * 3 + 0] = normal.x;
+		outNormals[i * 3 + 1] = normal.y;
+		outNormals[i * 3 + 2] = normal.z;
+	}
+}
+
+// per vertex tangents with the handedness in w from the UV gradients, for primitives without TANGENT
+// (Assimp's aiProcess_CalcTangentSpace). Without UVs any direction perpendicular to the normal is used.
+static void GenerateTangents(const VKVertexStream& positions, const VKVertexStream& normals, const VKVertexStream& uvs, int32_t count, const std::vector<uint32_t>& indices, std::vector<float>& outTangents)
+{
+	std::vector<Vector3> tangents(count, Vector3(0.0f, 0.0f, 0.0f));
+	std::vector<Vector3> bitangents(count, Vector3(0.0f, 0.0f, 0.0f));
+	for (size_t i = 0; uvs.IsValid() && i + 2 < indices.size(); i += 3)
+	{
+		const float* p0 = positions.Get(indices[i + 0]);
+		const float* p1 = positions.Get(indices[i + 1]);
+		const float* p2 = positions.Get(indices[i + 2]);
+		const float* t0 = uvs.Get(indices[i + 0]);
+		const float* t1 = uvs.Get(indices[i + 1]);
+		const float* t2 = uvs.Get(indices[i + 2]);
+
+		Vector3 edge0(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+		Vector3 edge1(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+		float du0 = t1[0] - t0[0];
+		float dv0 = t1[1] - t0[1];
+		float du1 = t2[0] - t0[0];
+		float dv1 = t2[1] - t0[1];
+
+		float det = du0 * dv1 - du1 * dv0;
+		if (math::Abs(det) < 1e-12f) {
+			continue;
+		}
+
+		float invDet = 1.0f / det;
+		Vector3 tangent = (edge0 * dv1 - edge1 * dv0) * invDet;
+		Vector3 bitangent = (edge1 * du0 - edge0 * du1) * invDet;
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			tangents[indices[i + k]] += tangent;
+			bitangents[indices[i + k]] += bitangent;
+		}
+	}
+
+	outTangents.resize((size_t)count * 4);
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const float* n = normals.Get(i);
+		Vector3 normal(n[0], n[1], n[2]);
+
+		// Gram-Schmidt against the normal, falls back to an axis the normal is not parallel to.
+		Vector3 tangent = tangents[i] - normal * Vector3::DotProduct(normal, tangents[i]);
+		if (!tangent.Normalize())
+		{
+			Vector3 axis = math::Abs(normal.x) < 0.9f ? Vector3(1.0f, 0.0f, 0.0f) : Vector3(0.0f, 1.0f, 0.0f);
+			tangent = Vector3::CrossProduct(normal, axis).GetSafeNormal();
+		}
+
+		float handedness = Vector3::DotProduct(Vector3::CrossProduct(normal, tangent), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+		outTangents[i * 4 + 0] = tangent.x;
+		outTangents[i * 4 + 1] = tangent.y;
+		outTangents[i * 4 + 2] = tangent.z;
+		outTangents[i * 4 + 3] = handedness;
+	}
+}
+
+// when every attribute of the layout is a float stream of one interleaved buffer view, in the
+// layout's order and with the layout's stride, the vertices are that view and one memcpy does.
+static bool CopyInterleaved(const std::vector<VertexAttribute>& attributes, const VKVertexStreams& streams, const GLTFAccessor& positions, std::vector<float>& outVertices, Vector3& outMax, Vector3& outMin)
+{
+	if (!positions.hasBounds || streams.count == 0) {
+		return false;
+	}
+
+	int32_t stride = 0;
+	for (int32_t i = 0; i < attributes.size(); ++i) {
+		stride += VertexAttributeToSize(attributes[i]);
+	}
+
+	const uint8_t* base = nullptr;
+	int32_t offset = 0;
+	for (int32_t i = 0; i < attributes.size(); ++i)
+	{
+		const VKVertexStream* stream = nullptr;
+		switch (attributes[i])
+		{
+		case VertexAttribute::VA_Position:
+			stream = &streams.positions;
+			break;
+		case VertexAttribute::VA_Normal:
+			stream = &streams.normals;
+			break;
+		case VertexAttribute::VA_Tangent:
+			stream = streams.tangentW ? &streams.tangents : nullptr;
+			break;
+		case VertexAttribute::VA_UV0:
+			stream = &streams.uvs[0];
+			break;
+		case VertexAttribute::VA_UV1:
+			stream = &streams.uvs[1];
+			break;
+		case VertexAttribute::VA_Color:
+			stream = &streams.colors;
+			break;
+		default:
+			break;
+		}
+
+		if (stream == nullptr || !stream->IsValid() || stream->stride != stride) {
+			return false;
+		}
+
+		const uint8_t* streamBase = stream->data - offset;
+		if (base != nullptr && streamBase != base) {
+			return false;
+		}
+
+		base = streamBase;
+		offset += VertexAttributeToSize(attributes[i]);
+	}
+
+	outVertices.resize((size_t)streams.count * stride / sizeof(float));
+	memcpy(outVertices.data(), base, (size_t)streams.count * stride);
+
+	outMin.Set(positions.min[0], positions.min[1], positions.min[2]);
+	outMax.Set(positions.max[0], positions.max[1], positions.max[2]);
+
+	return true;
+}
+
+void VKGLTFLoader::LoadSkin(const GLTFContext& context, GLTFPrimitiveJob& job, const rapidjson::Value& attributes, int32_t count, std::vector<VKVertexSkin>& outSkins)
+{
+	const rapidjson::Value& joints = *FindArray((*FindArray(context.document, "skins"))[job.skin], "joints");
+	const int32_t maxInfluences = context.model->GetMaxSkinInfluences();
+	VKMesh* mesh = job.mesh;
+
+	outSkins.clear();
+	outSkins.resize(count);
+
+	// skin joint -> index in mesh->bones, filled as joints are used.
+	std::vector<int32_t> meshBones(joints.Size(), -1);
+
+	for (int32_t set = 0; set < 2; ++set)
+	{
+		const GLTFAccessor* jointsAccessor = GetAttribute(context, attributes, set == 0 ? "JOINTS_0" : "JOINTS_1");
+		const GLTFAccessor* weightsAccessor = GetAttribute(context, attributes, set == 0 ? "WEIGHTS_0" : "WEIGHTS_1");
+		if (jointsAccessor == nullptr || weightsAccessor == nullptr || jointsAccessor->components != 4 || weightsAccessor->components != 4 ||
+			jointsAccessor->count < count || weightsAccessor->count < count) {
+			continue;
+		}
+
+		for (int32_t i = 0; i < count; ++i)
+		{
+			for (int32_t j = 0; j < 4; ++j)
+			{
+				float weight = ReadFloat(*weightsAccessor, i, j);
+				uint32_t joint = ReadUInt(*jointsAccessor, i, j);
+				if (weight <= 0.0f || joint >= joints.Size()) {
+					continue;
+				}
+
+				if (meshBones[joint] == -1)
+				{
+					meshBones[joint] = mesh->bones.size();
+					mesh->bones.push_back(context.nodeBones[joints[joint].GetInt()]);
+				}
+
+				outSkins[i].Add(meshBones[joint], weight, maxInfluences);
+			}
+		}
+	}
+
+	mesh->isSkin = true;
+}
+
+void VKGLTFLoader::LoadPrimitive(const GLTFContext& context, GLTFPrimitiveJob& job)
+{
+	VKModel* model = context.model;
+	const rapidjson::Value& primitive = *job.primitive;
+
+	VKMesh* mesh = new VKMesh();
+	job.mesh = mesh;
+
+	const rapidjson::Value* attributes = primitive.IsObject() ? FindObject(primitive, "attributes") : nullptr;
+	const GLTFAccessor* positions = attributes ? GetAttribute(context, *attributes, "POSITION") : nullptr;
+	if (positions == nullptr || positions->components != 3 || positions->componentType != GLTF_FLOAT || GetInt(primitive, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES)
+	{
+		MLOGE("glTF primitive is not a triangle list with float positions.");
+		job.failed = true;
+		return;
+	}
+
+	const int32_t count = positions->count;
+
+	// load material
+	FillMaterial(context, GetInt(primitive, "material", -1), mesh->material);
+
+	// load bones
+	std::vector<VKVertexSkin> skins;
+	if (job.skin >= 0 && model->loadSkin) {
+		LoadSkin(context, job, *attributes, count, skins);
+	}
+
+	// load vertex data
+	const GLTFAccessor* normals = GetAttribute(context, *attributes, "NORMAL");
+	const GLTFAccessor* tangents = GetAttribute(context, *attributes, "TANGENT");
+	const GLTFAccessor* uv0 = GetAttribute(context, *attributes, "TEXCOORD_0");
+	const GLTFAccessor* uv1 = GetAttribute(context, *attributes, "TEXCOORD_1");
+	const GLTFAccessor* colors = GetAttribute(context, *attributes, "COLOR_0");
+
+	const GLTFAccessor* sources[5] = { normals, tangents, uv0, uv1, colors };
+	for (int32_t i = 0; i < 5; ++i)
+	{
+		if (sources[i] && sources[i]->count < count)
+		{
+			MLOGE("glTF vertex attribute shorter than POSITION.");
+			job.failed = true;
+			return;
+		}
+	}
+
+	std::vector<float> scratch[5];
+	VKVertexStreams streams;
+	streams.count = count;
+	streams.positions = VKVertexStream(positions->data, positions->stride);
+	streams.normals = GetStream(normals, 3, scratch[0]);
+	streams.tangents = GetStream(tangents, 4, scratch[1]);
+	streams.tangentW = streams.tangents.IsValid();
+	streams.uvs[0] = GetStream(uv0, 2, scratch[2]);
+	streams.uvs[1] = GetStream(uv1, 2, scratch[3]);
+	streams.colors = GetStream(colors, 3, scratch[4]);
+
+	// load indices
+	std::vector<uint32_t> indices;
+	int32_t indicesIndex = GetInt(primitive, "indices", -1);
+	if (indicesIndex >= 0)
+	{
+		const GLTFAccessor* indicesAccessor = GetAccessor(context, indicesIndex);
+		if (indicesAccessor == nullptr || indicesAccessor->components != 1 || indicesAccessor->componentType == GLTF_FLOAT)
+		{
+			MLOGE("glTF primitive has invalid indices.");
+			job.failed = true;
+			return;
+		}
+
+		indices.resize(indicesAccessor->count);
+		for (int32_t i = 0; i < indicesAccessor->count; ++i)
+		{
+			indices[i] = ReadUInt(*indicesAccessor, i, 0);
+			if (indices[i] >= count)
+			{
+				MLOGE("glTF index out of range.");
+				job.failed = true;
+				return;
+			}
+		}
+	}
+	else
+	{
+		indices.resize(count);
+		for (int32_t i = 0; i < count; ++i) {
+			indices[i] = i;
+		}
+	}
+
+	if (indices.size() % 3 != 0)
+	{
+		MLOGE("glTF triangle list with %d indices.", (int32_t)indices.size());
+		job.failed = true;
+		return;
+	}
+
+	// NORMAL and TANGENT are optional in glTF, the layout still gets real ones.
+	bool needsNormals = false;
+	bool needsTangents = false;
+	for (int32_t i = 0; i < model->attributes.size(); ++i)
+	{
+		needsNormals = needsNormals || model->attributes[i] == VertexAttribute::VA_Normal || model->attributes[i] == VertexAttribute::VA_NormalOct;
+		needsTangents = needsTangents || model->attributes[i] == VertexAttribute::VA_Tangent || model->attributes[i] == VertexAttribute::VA_TangentOct;
+	}
+
+	std::vector<float> generatedNormals;
+	std::vector<float> generatedTangents;
+	if ((needsNormals || needsTangents) && !streams.normals.IsValid())
+	{
+		GenerateNormals(streams.positions, count, indices, generatedNormals);
+		streams.normals = VKVertexStream(generatedNormals.data(), sizeof(float) * 3);
+	}
+	if (needsTangents && !streams.tangents.IsValid())
+	{
+		GenerateTangents(streams.positions, streams.normals, streams.uvs[0], count, indices, generatedTangents);
+		streams.tangents = VKVertexStream(generatedTangents.data(), sizeof(float) * 4);
+		streams.tangentW = true;
+	}
+
+	std::vector<float> vertices;
+	Vector3 mmin(MAX_int32, MAX_int32, MAX_int32);
+	Vector3 mmax(-MAX_int32, -MAX_int32, -MAX_int32);
+	if (!CopyInterleaved(model->attributes, streams, *positions, vertices, mmax, mmin)) {
+		model->LoadVertexDatas(skins, streams, vertices, mmax, mmin, mesh);
+	}
+
+	model->LoadTriangleBVH(streams, indices, mesh);
+
+	if (model->importFlags & VKModelImport_Optimize) {
+		model->OptimizeMesh(vertices, indices, job.cacheBefore, job.cacheAfter);
+	}
+
+	// load primitives
+	model->LoadPrimitives(vertices, indices, mesh, nullptr, nullptr);
+
+	model->LoadBoundingVolumes(streams, mmin, mmax, mesh);
+}
+
+bool VKGLTFLoader::IsGLBFile(const std::string& filename)
+{
+	return Path::HasExtension(filename.c_str(), "glb");
+}
+
+bool VKGLTFLoader::Load(VKModel* model, const std::string& filename)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	MappedFile mappedFile;
+	if (!FileManager::MapFile(filename, mappedFile)) {
+		return false;
+	}
+
+	GLTFContext context;
+	context.model = model;
+
+	bool success = ParseGLB(context, mappedFile.dataPtr, mappedFile.dataSize) &&
+		ParseAccessors(context) &&
+		ParseNodes(context) &&
+		BuildScene(context) &&
+		ParseSkins(context);
+
+	double parseTime = GenericPlatformTime::Seconds();
+
+	if (success)
+	{
+		ThreadPool::Get().ParallelFor(context.jobs.size(), [&](int32_t index) {
+			LoadPrimitive(context, context.jobs[index]);
+		});
+
+		for (int32_t i = 0; i < context.jobs.size(); ++i) {
+			success = success && !context.jobs[i].failed;
+		}
+	}
+
+	if (success)
+	{
+		for (int32_t i = 0; i < context.jobs.size(); ++i)
+		{
+			GLTFPrimitiveJob& job = context.jobs[i];
+			job.mesh->linkNode = job.node;
+			job.node->meshes.push_back(job.mesh);
+			model->meshes.push_back(job.mesh);
+
+			model->cacheStatsBefore.Append(job.cacheBefore);
+			model->cacheStatsAfter.Append(job.cacheAfter);
+		}
+
+		ParseAnimations(context);
+	}
+	else
+	{
+		// meshes are only owned by their nodes once linked.
+		for (int32_t i = 0; i < context.jobs.size(); ++i) {
+			delete context.jobs[i].mesh;
+		}
+	}
+
+	// every primitive owns its vertices now, nothing points into the file anymore.
+	FileManager::UnmapFile(mappedFile);
+
+	if (!success) {
+		return false;
+	}
+
+	double meshTime = GenericPlatformTime::Seconds();
+
+	model->UploadPrimitives();
+
+	MLOG(
+		"glTF %s: %d nodes, %d meshes, %d bones, %d animations, parsed in %.2fms, %d meshes processed in %.2fms, uploaded in %.2fms",
+		filename.c_str(), (int32_t)model->linearNodes.size(), (int32_t)model->meshes.size(), (int32_t)model->bones.size(), (int32_t)model->animations.size(),
+		(parseTime - startTime) * 1000.0, (int32_t)context.jobs.size(), (meshTime - parseTime) * 1000.0, (GenericPlatformTime::Seconds() - meshTime) * 1000.0
+	);
+
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "VKModel.h"
+
+#include <RapidJSON/include/rapidjson/fwd.h>
+
+struct GLTFContext;
+struct GLTFPrimitiveJob;
+
+// Native glTF 2.0 binary (.glb) import straight into a VKModel, without an aiScene in between.
+// Float accessors are read in place from the mapped file through VKVertexStream, other component
+// types are converted once, and an interleaved buffer view that already matches the requested
+// layout is copied with a single memcpy. Skins and animations are read from their accessors too.
+// Anything unsupported (external buffers, sparse accessors, required extensions, non triangle
+// primitives) makes Load fail so VKModel::LoadFromFile falls back to Assimp.
+class VKGLTFLoader
+{
+public:
+	static bool IsGLBFile(const std::string& filename);
+
+	// model has to be empty, it is left partially filled on failure.
+	static bool Load(VKModel* model, const std::string& filename);
+
+private:
+	// the steps that fill the model through its protected import functions.
+	static VKNode* BuildNode(GLTFContext& context, int32_t index, VKNode* parent);
+
+	static bool BuildScene(GLTFContext& context);
+
+	static void LoadSkin(const GLTFContext& context, GLTFPrimitiveJob& job, const rapidjson::Value& attributes, int32_t count, std::vector<VKVertexSkin>& outSkins);
+
+	static void LoadPrimitive(const GLTFContext& context, GLTFPrimitiveJob& job);
+};
@@ -0,0 +1,290 @@
+#include "stdafx.h"
+#include "VKGeometryArena.h"
+#include "VulkanDevice.h"
+
+VKGeometryArena::~VKGeometryArena()
+{
+	if (allocationCount > 0) {
+		MLOGE("Geometry arena destroyed with %d live allocations.", allocationCount);
+	}
+
+	delete vertexBuffer;
+	delete indexBuffer;
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+}
+
+VKGeometryArena* VKGeometryArena::Create(std::shared_ptr<VulkanDevice> vulkanDevice, const std::vector<VertexAttribute>& attributes, uint32_t maxVertices, uint32_t maxIndices, VkIndexType indexType)
+{
+	VKGeometryArena* arena = new VKGeometryArena();
+	arena->device = vulkanDevice;
+	arena->attributes = attributes;
+	arena->indexType = indexType;
+	arena->maxVertices = maxVertices;
+	arena->maxIndices = maxIndices;
+
+	for (int32_t i = 0; i < attributes.size(); ++i) {
+		arena->stride += VertexAttributeToSize(attributes[i]);
+	}
+
+	uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	arena->vertexBuffer = DVKBuffer::CreateBuffer(
+		vulkanDevice,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		(VkDeviceSize)maxVertices * arena->stride
+	);
+
+	arena->indexBuffer = DVKBuffer::CreateBuffer(
+		vulkanDevice,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		(VkDeviceSize)maxIndices * indexSize
+	);
+
+	VulkanRange vertexRange;
+	vertexRange.offset = 0;
+	vertexRange.size = maxVertices;
+	arena->m_FreeVertices.push_back(vertexRange);
+
+	VulkanRange indexRange;
+	indexRange.offset = 0;
+	indexRange.size = maxIndices;
+	arena->m_FreeIndices.push_back(indexRange);
+
+	return arena;
+}
+
+bool VKGeometryArena::AllocateRange(std::vector<VulkanRange>& freeList, uint32_t size, uint32_t& outOffset)
+{
+	outOffset = 0;
+	if (size == 0) {
+		return true;
+	}
+
+	for (int32_t index = 0; index < freeList.size(); ++index)
+	{
+		VulkanRange& entry = freeList[index];
+		if (size <= entry.size)
+		{
+			outOffset = entry.offset;
+			if (size < entry.size) {
+				entry.size -= size;
+				entry.offset += size;
+			}
+			else {
+				freeList.erase(freeList.begin() + index);
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t VKGeometryArena::GetLargestRange(const std::vector<VulkanRange>& freeList)
+{
+	uint32_t largest = 0;
+	for (int32_t i = 0; i < freeList.size(); ++i) {
+		largest = std::max(largest, freeList[i].size);
+	}
+	return largest;
+}
+
+bool VKGeometryArena::Allocate(uint32_t vertexCount, uint32_t indexCount, VKGeometryAllocation& outAllocation)
+{
+	// 16-bit arenas still work for any primitive whose local indices fit.
+	if (indexType == VK_INDEX_TYPE_UINT16 && vertexCount > 65536)
+	{
+		MLOGE("%d vertices do not fit 16-bit arena indices.", vertexCount);
+		return false;
+	}
+
+	if (GetLargestRange(m_FreeVertices) < vertexCount || GetLargestRange(m_FreeIndices) < indexCount)
+	{
+		MLOGE("Geometry arena full, %d vertices and %d indices requested, %d/%d vertices and %d/%d indices used.", vertexCount, indexCount, usedVertices, maxVertices, usedIndices, maxIndices);
+		return false;
+	}
+
+	uint32_t vertexOffset = 0;
+	uint32_t firstIndex = 0;
+	AllocateRange(m_FreeVertices, vertexCount, vertexOffset);
+	AllocateRange(m_FreeIndices, indexCount, firstIndex);
+
+	outAllocation.vertexOffset = vertexOffset;
+	outAllocation.vertexCount = vertexCount;
+	outAllocation.firstIndex = firstIndex;
+	outAllocation.indexCount = indexCount;
+
+	usedVertices += vertexCount;
+	usedIndices += indexCount;
+	allocationCount += 1;
+
+	return true;
+}
+
+void VKGeometryArena::Free(const VKGeometryAllocation& allocation)
+{
+	if (allocation.vertexCount > 0)
+	{
+		VulkanRange range;
+		range.offset = allocation.vertexOffset;
+		range.size = allocation.vertexCount;
+		m_FreeVertices.push_back(range);
+		VulkanRange::JoinConsecutiveRanges(m_FreeVertices);
+	}
+
+	if (allocation.indexCount > 0)
+	{
+		VulkanRange range;
+		range.offset = allocation.firstIndex;
+		range.size = allocation.indexCount;
+		m_FreeIndices.push_back(range);
+		VulkanRange::JoinConsecutiveRanges(m_FreeIndices);
+	}
+
+	usedVertices -= allocation.vertexCount;
+	usedIndices -= allocation.indexCount;
+	allocationCount -= 1;
+}
+
+void VKGeometryArena::Upload(VKCommandBuffer* cmdBuffer, const std::vector<VKGeometryUpload>& uploads)
+{
+	uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	VkDeviceSize vertexBytes = 0;
+	VkDeviceSize indexBytes = 0;
+	for (int32_t i = 0; i < uploads.size(); ++i)
+	{
+		vertexBytes += (VkDeviceSize)uploads[i].allocation.vertexCount * stride;
+		indexBytes += (VkDeviceSize)uploads[i].allocation.indexCount * indexSize;
+	}
+
+	if (vertexBytes + indexBytes == 0) {
+		return;
+	}
+
+	DVKBuffer* staging = DVKBuffer::CreateBuffer(
+		device,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		vertexBytes + indexBytes
+	);
+	staging->Map();
+
+	std::vector<VkBufferCopy> vertexRegions;
+	std::vector<VkBufferCopy> indexRegions;
+	uint8_t* vertexDst = (uint8_t*)staging->mapped;
+	uint8_t* indexDst = (uint8_t*)staging->mapped + vertexBytes;
+
+	for (int32_t i = 0; i < uploads.size(); ++i)
+	{
+		const VKGeometryUpload& upload = uploads[i];
+		const VKGeometryAllocation& allocation = upload.allocation;
+
+		if (allocation.vertexCount > 0)
+		{
+			VkBufferCopy region = {};
+			region.srcOffset = vertexDst - (uint8_t*)staging->mapped;
+			region.dstOffset = (VkDeviceSize)allocation.vertexOffset * stride;
+			region.size = (VkDeviceSize)allocation.vertexCount * stride;
+			vertexRegions.push_back(region);
+
+			memcpy(vertexDst, upload.vertexData, region.size);
+			vertexDst += region.size;
+		}
+
+		if (allocation.indexCount > 0)
+		{
+			VkBufferCopy region = {};
+			region.srcOffset = indexDst - (uint8_t*)staging->mapped;
+			region.dstOffset = (VkDeviceSize)allocation.firstIndex * indexSize;
+			region.size = (VkDeviceSize)allocation.indexCount * indexSize;
+			indexRegions.push_back(region);
+
+			if (upload.indexType == indexType) {
+				memcpy(indexDst, upload.indexData, region.size);
+			}
+			else if (indexType == VK_INDEX_TYPE_UINT32)
+			{
+				const uint16_t* src = (const uint16_t*)upload.indexData;
+				uint32_t* dst = (uint32_t*)indexDst;
+				for (uint32_t j = 0; j < allocation.indexCount; ++j) {
+					dst[j] = src[j];
+				}
+			}
+			else
+			{
+				const uint32_t* src = (const uint32_t*)upload.indexData;
+				uint16_t* dst = (uint16_t*)indexDst;
+				for (uint32_t j = 0; j < allocation.indexCount; ++j) {
+					dst[j] = (uint16_t)src[j];
+				}
+			}
+			indexDst += region.size;
+		}
+	}
+
+	staging->UnMap();
+
+	cmdBuffer->Begin();
+
+	if (vertexRegions.size() > 0) {
+		vkCmdCopyBuffer(cmdBuffer->cmdBuffer, staging->buffer, vertexBuffer->buffer, vertexRegions.size(), vertexRegions.data());
+	}
+
+	if (indexRegions.size() > 0) {
+		vkCmdCopyBuffer(cmdBuffer->cmdBuffer, staging->buffer, indexBuffer->buffer, indexRegions.size(), indexRegions.data());
+	}
+
+	cmdBuffer->End();
+	cmdBuffer->Submit();
+
+	delete staging;
+}
+
+void VKGeometryArena::Bind(VkCommandBuffer cmdBuffer)
+{
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &(vertexBuffer->buffer), &offset);
+	vkCmdBindIndexBuffer(cmdBuffer, indexBuffer->buffer, 0, indexType);
+}
+
+VkVertexInputBindingDescription VKGeometryArena::GetInputBinding()
+{
+	VkVertexInputBindingDescription vertexInputBinding = {};
+	vertexInputBinding.binding = 0;
+	vertexInputBinding.stride = stride;
+	vertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return vertexInputBinding;
+}
+
+std::vector<VkVertexInputAttributeDescription> VKGeometryArena::GetInputAttributes()
+{
+	std::vector<VkVertexInputAttributeDescription> vertexInputAttributs;
+	int32_t offset = 0;
+
+	for (int32_t i = 0; i < attributes.size(); ++i)
+	{
+		VkVertexInputAttributeDescription inputAttribute = {};
+		inputAttribute.binding = 0;
+		inputAttribute.location = i;
+		inputAttribute.format = VertexAttributeToVkFormat(attributes[i]);
+		inputAttribute.offset = offset;
+		offset += VertexAttributeToSize(attributes[i]);
+		vertexInputAttributs.push_back(inputAttribute);
+	}
+
+	return vertexInputAttributs;
+}
+
+uint32_t VKGeometryArena::GetLargestFreeVertices() const
+{
+	return GetLargestRange(m_FreeVertices);
+}
+
+uint32_t VKGeometryArena::GetLargestFreeIndices() const
+{
+	return GetLargestRange(m_FreeIndices);
+}
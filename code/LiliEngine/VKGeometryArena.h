@@ -0,0 +1,87 @@
+#pragma once
+
+#include "DVKBuffer.h"
+#include "VKCommandBuffer.h"
+#include "VKVertexBuffer.h"
+#include "VulkanMemory.h"
+
+// Range of a VKGeometryArena taken by one primitive. Indices are local to the primitive's
+// vertices, so a draw is vkCmdDrawIndexed(indexCount, ..., firstIndex, vertexOffset, ...).
+struct VKGeometryAllocation
+{
+	uint32_t	firstIndex = 0;
+	uint32_t	indexCount = 0;
+	int32_t		vertexOffset = 0;
+	uint32_t	vertexCount = 0;
+};
+
+struct VKGeometryUpload
+{
+	VKGeometryAllocation	allocation;
+	const void*				vertexData = nullptr;
+	const void*				indexData = nullptr;
+	// type of indexData, converted to the arena index type while staging.
+	VkIndexType				indexType = VK_INDEX_TYPE_UINT32;
+};
+
+// Shared vertex and index buffers for every primitive with the same vertex layout.
+// Primitives are suballocated from free lists of VulkanRange (in vertices and indices),
+// the arena is bound once and all of its primitives are drawn with offsets only.
+// The arena must outlive every primitive allocated from it.
+class VKGeometryArena
+{
+private:
+	VKGeometryArena()
+	{
+
+	}
+
+public:
+	~VKGeometryArena();
+
+	// maxVertices/maxIndices are fixed for the lifetime of the arena.
+	static VKGeometryArena* Create(std::shared_ptr<VulkanDevice> vulkanDevice, const std::vector<VertexAttribute>& attributes, uint32_t maxVertices, uint32_t maxIndices, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+
+	// first fit, false when either free list has no range large enough.
+	bool Allocate(uint32_t vertexCount, uint32_t indexCount, VKGeometryAllocation& outAllocation);
+
+	void Free(const VKGeometryAllocation& allocation);
+
+	// copies all uploads through a single staging buffer and submit.
+	void Upload(VKCommandBuffer* cmdBuffer, const std::vector<VKGeometryUpload>& uploads);
+
+	void Bind(VkCommandBuffer cmdBuffer);
+
+	VkVertexInputBindingDescription GetInputBinding();
+
+	std::vector<VkVertexInputAttributeDescription> GetInputAttributes();
+
+	// largest range a single primitive can still get.
+	uint32_t GetLargestFreeVertices() const;
+
+	uint32_t GetLargestFreeIndices() const;
+
+public:
+	std::shared_ptr<VulkanDevice>	device;
+	std::vector<VertexAttribute>	attributes;
+	uint32_t						stride = 0;
+	VkIndexType						indexType = VK_INDEX_TYPE_UINT32;
+
+	DVKBuffer*						vertexBuffer = nullptr;
+	DVKBuffer*						indexBuffer = nullptr;
+
+	uint32_t						maxVertices = 0;
+	uint32_t						maxIndices = 0;
+	uint32_t						usedVertices = 0;
+	uint32_t						usedIndices = 0;
+	int32_t							allocationCount = 0;
+
+private:
+	static bool AllocateRange(std::vector<VulkanRange>& freeList, uint32_t size, uint32_t& outOffset);
+
+	static uint32_t GetLargestRange(const std::vector<VulkanRange>& freeList);
+
+private:
+	std::vector<VulkanRange>		m_FreeVertices;
+	std::vector<VulkanRange>		m_FreeIndices;
+};
@@ -2,34 +2,45 @@
 #include "VKIndexBuffer.h"
 #include "VulkanDevice.h"
 
-VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, std::vector<uint32_t> indices)
+VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const uint32_t> indices)
+{
+	return Create(vulkanDevice, cmdBuffer, indices.begin, indices.length(), VK_INDEX_TYPE_UINT32);
+}
+
+VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const uint16_t> indices)
+{
+	return Create(vulkanDevice, cmdBuffer, indices.begin, indices.length(), VK_INDEX_TYPE_UINT16);
+}
+
+VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const void* dataPtr, uint32_t indexCount, VkIndexType indexType)
 {
 	VkDevice device = vulkanDevice->GetInstanceHandle();
+	uint32_t dataSize = indexCount * (indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
 
 	VKIndexBuffer* indexBuffer = new VKIndexBuffer();
 	indexBuffer->device = device;
-	indexBuffer->indexCount = indices.size();
-	indexBuffer->indexType = VK_INDEX_TYPE_UINT32;
+	indexBuffer->indexCount = indexCount;
+	indexBuffer->indexType = indexType;
 
 	DVKBuffer* indexStaging = DVKBuffer::CreateBuffer(
 		vulkanDevice,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indices.size() * sizeof(uint32_t),
-		indices.data()
+		dataSize,
+		(void*)dataPtr
 	);
 
 	indexBuffer->dvkBuffer = DVKBuffer::CreateBuffer(
 		vulkanDevice,
 		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indices.size() * sizeof(uint32_t)
+		dataSize
 	);
 
 	cmdBuffer->Begin();
 
 	VkBufferCopy copyRegion = {};
-	copyRegion.size = indices.size() * sizeof(uint32_t);
+	copyRegion.size = dataSize;
 
 	vkCmdCopyBuffer(cmdBuffer->cmdBuffer, indexStaging->buffer, indexBuffer->dvkBuffer->buffer, 1, &copyRegion);
 
@@ -41,41 +52,19 @@ VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice,
 	return indexBuffer;
 }
 
-VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, std::vector<uint16_t> indices)
+VKIndexBuffer* VKIndexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, uint32_t indexCount, VkIndexType indexType)
 {
-	VkDevice device = vulkanDevice->GetInstanceHandle();
-
 	VKIndexBuffer* indexBuffer = new VKIndexBuffer();
-	indexBuffer->device = device;
-	indexBuffer->indexCount = indices.size();
-	indexBuffer->indexType = VK_INDEX_TYPE_UINT16;
-
-	DVKBuffer* indexStaging = DVKBuffer::CreateBuffer(
-		vulkanDevice,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indices.size() * sizeof(uint16_t),
-		indices.data()
-	);
+	indexBuffer->device = vulkanDevice->GetInstanceHandle();
+	indexBuffer->indexCount = indexCount;
+	indexBuffer->indexType = indexType;
 
 	indexBuffer->dvkBuffer = DVKBuffer::CreateBuffer(
 		vulkanDevice,
 		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indices.size() * sizeof(uint16_t)
+		indexCount * (indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t))
 	);
 
-	cmdBuffer->Begin();
-
-	VkBufferCopy copyRegion = {};
-	copyRegion.size = indices.size() * sizeof(uint16_t);
-
-	vkCmdCopyBuffer(cmdBuffer->cmdBuffer, indexStaging->buffer, indexBuffer->dvkBuffer->buffer, 1, &copyRegion);
-
-	cmdBuffer->End();
-	cmdBuffer->Submit();
-
-	delete indexStaging;
-
 	return indexBuffer;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "DVKBuffer.h"
 #include "VKCommandBuffer.h"
+#include "Span.h"
 
 class VKIndexBuffer
 {
@@ -25,9 +26,15 @@ public:
 		vkCmdBindIndexBuffer(cmdBuffer, dvkBuffer->buffer, 0, indexType);
 	}
 
-	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, std::vector<uint16_t> indices);
+	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const uint16_t> indices);
 
-	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, std::vector<uint32_t> indices);
+	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const uint32_t> indices);
+
+	// uploads straight from dataPtr (e.g. a mapped file), no intermediate copy.
+	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const void* dataPtr, uint32_t indexCount, VkIndexType indexType);
+
+	// no data, the caller records the transfer (e.g. several buffers from one staging buffer).
+	static VKIndexBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, uint32_t indexCount, VkIndexType indexType);
 
 public:
 	VkDevice		device = VK_NULL_HANDLE;
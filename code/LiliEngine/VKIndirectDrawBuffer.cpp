@@ -0,0 +1,268 @@
+#include "stdafx.h"
+#include "VKIndirectDrawBuffer.h"
+#include "VulkanDevice.h"
+
+VKIndirectDrawBuffer::~VKIndirectDrawBuffer()
+{
+	if (commandBuffer) {
+		commandBuffer->UnMap();
+		delete commandBuffer;
+	}
+
+	if (countBuffer) {
+		countBuffer->UnMap();
+		delete countBuffer;
+	}
+
+	commandBuffer = nullptr;
+	countBuffer = nullptr;
+	m_Commands = nullptr;
+	m_Counts = nullptr;
+}
+
+VKIndirectDrawBuffer* VKIndirectDrawBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, uint32_t maxCommands, uint32_t maxBuckets, int32_t frameCount)
+{
+	VKIndirectDrawBuffer* drawBuffer = new VKIndirectDrawBuffer();
+	drawBuffer->maxCommands = maxCommands;
+	drawBuffer->maxBuckets = maxBuckets;
+	drawBuffer->frameCount = frameCount;
+
+	drawBuffer->commandBuffer = DVKBuffer::CreateBuffer(
+		vulkanDevice,
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		(VkDeviceSize)maxCommands * frameCount * sizeof(VkDrawIndexedIndirectCommand)
+	);
+	drawBuffer->commandBuffer->Map();
+	drawBuffer->m_Commands = (VkDrawIndexedIndirectCommand*)drawBuffer->commandBuffer->mapped;
+
+	drawBuffer->countBuffer = DVKBuffer::CreateBuffer(
+		vulkanDevice,
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		(VkDeviceSize)maxBuckets * frameCount * sizeof(uint32_t)
+	);
+	drawBuffer->countBuffer->Map();
+	drawBuffer->m_Counts = (uint32_t*)drawBuffer->countBuffer->mapped;
+
+	// without multiDrawIndirect every indirect call draws exactly one command.
+	drawBuffer->m_MultiDraw = vulkanDevice->GetPhysicalFeatures().multiDrawIndirect == VK_TRUE;
+	drawBuffer->m_MaxDrawCount = drawBuffer->m_MultiDraw ? vulkanDevice->GetLimits().maxDrawIndirectCount : 1;
+
+	// only resolves when VK_KHR_draw_indirect_count is enabled on the device.
+	VkDevice device = vulkanDevice->GetInstanceHandle();
+	drawBuffer->m_CmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCount)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+
+	return drawBuffer;
+}
+
+void VKIndirectDrawBuffer::Begin(int32_t frameIndex)
+{
+	m_FrameIndex = frameIndex % frameCount;
+	m_CommandCount = 0;
+	m_OpenBucket = -1;
+	buckets.clear();
+}
+
+int32_t VKIndirectDrawBuffer::BeginBucket()
+{
+	if (m_OpenBucket >= 0) {
+		EndBucket();
+	}
+
+	if (buckets.size() >= maxBuckets)
+	{
+		MLOGE("Indirect draw buffer has no room for more than %d buckets.", maxBuckets);
+		return -1;
+	}
+
+	Bucket bucket;
+	bucket.firstCommand = m_CommandCount;
+	buckets.push_back(bucket);
+
+	m_OpenBucket = buckets.size() - 1;
+	return m_OpenBucket;
+}
+
+void VKIndirectDrawBuffer::EndBucket()
+{
+	if (m_OpenBucket < 0) {
+		return;
+	}
+
+	m_OpenBucket = -1;
+}
+
+int32_t VKIndirectDrawBuffer::ReserveBucket(uint32_t capacity)
+{
+	if (m_OpenBucket >= 0) {
+		EndBucket();
+	}
+
+	// the count the shader writes may not exceed maxDrawIndirectCount.
+	if (m_CmdDrawIndexedIndirectCount && capacity > m_MaxDrawCount)
+	{
+		MLOGE("Indirect bucket capacity %u clamped to maxDrawIndirectCount %u.", capacity, m_MaxDrawCount);
+		capacity = m_MaxDrawCount;
+	}
+
+	if (buckets.size() >= maxBuckets || m_CommandCount + capacity > maxCommands)
+	{
+		MLOGE("Indirect draw buffer has no room for %d more commands.", capacity);
+		return -1;
+	}
+
+	Bucket bucket;
+	bucket.firstCommand = m_CommandCount;
+	bucket.commandCount = capacity;
+	bucket.gpuCount = true;
+	buckets.push_back(bucket);
+
+	m_CommandCount += capacity;
+	return buckets.size() - 1;
+}
+
+bool VKIndirectDrawBuffer::Add(const VkDrawIndexedIndirectCommand& command)
+{
+	if (m_OpenBucket < 0)
+	{
+		MLOGE("Indirect draw added outside of a bucket.");
+		return false;
+	}
+
+	if (m_CommandCount >= maxCommands)
+	{
+		MLOGE("Indirect draw buffer full, %d commands.", maxCommands);
+		return false;
+	}
+
+	m_Commands[m_FrameIndex * maxCommands + m_CommandCount] = command;
+	m_CommandCount += 1;
+	buckets[m_OpenBucket].commandCount += 1;
+
+	return true;
+}
+
+bool VKIndirectDrawBuffer::Add(const VKPrimitive* primitive)
+{
+	if (primitive->arena == nullptr)
+	{
+		MLOGE("Indirect draws need primitives in a geometry arena.");
+		return false;
+	}
+
+	if (!primitive->IsIndexed())
+	{
+		MLOGE("Indirect draws need indexed primitives.");
+		return false;
+	}
+
+	return Add(primitive->GetDrawCommand());
+}
+
+bool VKIndirectDrawBuffer::Add(const VKMesh* mesh)
+{
+	for (int32_t i = 0; i < mesh->primitives.size(); ++i) {
+		if (!Add(mesh->primitives[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool VKIndirectDrawBuffer::Add(const VKPrimitive* primitive, const std::vector<VkDrawIndexedIndirectCommand>& commands)
+{
+	if (primitive->arena == nullptr)
+	{
+		MLOGE("Indirect draws need primitives in a geometry arena.");
+		return false;
+	}
+
+	for (int32_t i = 0; i < commands.size(); ++i)
+	{
+		VkDrawIndexedIndirectCommand command = commands[i];
+		command.firstIndex += primitive->arenaAllocation.firstIndex;
+		command.vertexOffset += primitive->arenaAllocation.vertexOffset;
+		if (!Add(command)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void VKIndirectDrawBuffer::Draw(VkCommandBuffer cmdBuffer, int32_t bucketIndex)
+{
+	if (bucketIndex < 0 || bucketIndex >= buckets.size()) {
+		return;
+	}
+
+	if (bucketIndex == m_OpenBucket) {
+		EndBucket();
+	}
+
+	const Bucket& bucket = buckets[bucketIndex];
+	if (bucket.commandCount == 0) {
+		return;
+	}
+
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize offset = GetCommandOffset(bucketIndex);
+
+	stats.draws += bucket.commandCount;
+
+	// capacity of GPU buckets is clamped to maxDrawIndirectCount, CPU buckets are split below.
+	if (m_CmdDrawIndexedIndirectCount && bucket.gpuCount)
+	{
+		m_CmdDrawIndexedIndirectCount(cmdBuffer, commandBuffer->buffer, offset, countBuffer->buffer, GetCountOffset(bucketIndex), bucket.commandCount, stride);
+		stats.drawCalls += 1;
+		return;
+	}
+
+	// GPU written buckets without the count path draw their whole capacity, unused commands need instanceCount = 0.
+	for (uint32_t first = 0; first < bucket.commandCount; first += m_MaxDrawCount)
+	{
+		uint32_t count = std::min(m_MaxDrawCount, bucket.commandCount - first);
+		vkCmdDrawIndexedIndirect(cmdBuffer, commandBuffer->buffer, offset + (VkDeviceSize)first * stride, count, stride);
+		stats.drawCalls += 1;
+	}
+}
+
+VkDeviceSize VKIndirectDrawBuffer::GetCommandOffset(int32_t bucket) const
+{
+	return ((VkDeviceSize)m_FrameIndex * maxCommands + buckets[bucket].firstCommand) * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+VkDeviceSize VKIndirectDrawBuffer::GetCountOffset(int32_t bucket) const
+{
+	return ((VkDeviceSize)m_FrameIndex * maxBuckets + bucket) * sizeof(uint32_t);
+}
+
+uint32_t VKIndirectDrawBuffer::GetDrawCallCount(int32_t bucketIndex) const
+{
+	const Bucket& bucket = buckets[bucketIndex];
+	if (bucket.commandCount == 0) {
+		return 0;
+	}
+
+	if (m_CmdDrawIndexedIndirectCount && bucket.gpuCount) {
+		return 1;
+	}
+
+	return (bucket.commandCount + m_MaxDrawCount - 1) / m_MaxDrawCount;
+}
+
+void VKIndirectDrawBuffer::ResetStats()
+{
+	stats = Stats();
+}
+
+void VKIndirectDrawBuffer::LogStats() const
+{
+	MLOG(
+		"Indirect: %lld draws in %lld draw calls (%.1fx fewer), multiDrawIndirect %d, drawIndirectCount %d",
+		stats.draws, stats.drawCalls,
+		stats.drawCalls > 0 ? (double)stats.draws / stats.drawCalls : 0.0,
+		m_MultiDraw ? 1 : 0, SupportsDrawCount() ? 1 : 0
+	);
+}
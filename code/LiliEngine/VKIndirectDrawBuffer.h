@@ -0,0 +1,102 @@
+#pragma once
+
+#include "DVKBuffer.h"
+#include "VKModel.h"
+
+// Per frame VkDrawIndexedIndirectCommand lists in persistently mapped memory, grouped in buckets
+// (one per pipeline/material). A bucket is recorded with vkCmdDrawIndexedIndirect calls of at most
+// maxDrawIndirectCount commands each. Buckets a compute shader fills use vkCmdDrawIndexedIndirectCount
+// when the device has it (RendererConfiguration::drawIndirectCount).
+// Commands address a VKGeometryArena, so the arena has to be bound before Draw.
+class VKIndirectDrawBuffer
+{
+public:
+	struct Bucket
+	{
+		uint32_t	firstCommand = 0;
+		uint32_t	commandCount = 0;
+		// commands written by a compute shader, the draw count then comes from the count buffer.
+		bool		gpuCount = false;
+	};
+
+	struct Stats
+	{
+		// indexed draws submitted, what the direct path records as vkCmdDrawIndexed calls.
+		int64_t		draws = 0;
+		// vkCmdDrawIndexedIndirect(Count) calls actually recorded.
+		int64_t		drawCalls = 0;
+	};
+
+private:
+	VKIndirectDrawBuffer()
+	{
+
+	}
+
+public:
+	~VKIndirectDrawBuffer();
+
+	// frameCount copies are kept so the CPU never writes commands a frame in flight still reads.
+	static VKIndirectDrawBuffer* Create(std::shared_ptr<VulkanDevice> vulkanDevice, uint32_t maxCommands, uint32_t maxBuckets = 64, int32_t frameCount = 3);
+
+	// resets the buckets of frameIndex % frameCount.
+	void Begin(int32_t frameIndex);
+
+	// following Add calls go to the returned bucket.
+	int32_t BeginBucket();
+
+	void EndBucket();
+
+	// reserves capacity commands for a compute shader, which also writes the draw count at GetCountOffset.
+	// With vkCmdDrawIndexedIndirectCount the capacity is clamped to maxDrawIndirectCount, see Bucket::commandCount.
+	int32_t ReserveBucket(uint32_t capacity);
+
+	bool Add(const VkDrawIndexedIndirectCommand& command);
+
+	// the current draw of an arena primitive, see VKPrimitive::GetDrawCommand.
+	bool Add(const VKPrimitive* primitive);
+
+	bool Add(const VKMesh* mesh);
+
+	// primitive local commands such as VKMeshletCuller output, moved to the primitive's arena range.
+	bool Add(const VKPrimitive* primitive, const std::vector<VkDrawIndexedIndirectCommand>& commands);
+
+	void Draw(VkCommandBuffer cmdBuffer, int32_t bucket);
+
+	VkDeviceSize GetCommandOffset(int32_t bucket) const;
+
+	VkDeviceSize GetCountOffset(int32_t bucket) const;
+
+	// vkCmdDrawIndexedIndirect(Count) calls Draw records for the bucket.
+	uint32_t GetDrawCallCount(int32_t bucket) const;
+
+	inline bool SupportsDrawCount() const
+	{
+		return m_CmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	void ResetStats();
+
+	void LogStats() const;
+
+public:
+	DVKBuffer*					commandBuffer = nullptr;
+	DVKBuffer*					countBuffer = nullptr;
+	std::vector<Bucket>			buckets;
+	Stats						stats;
+
+	uint32_t					maxCommands = 0;
+	uint32_t					maxBuckets = 0;
+	int32_t						frameCount = 0;
+
+private:
+	VkDrawIndexedIndirectCommand*	m_Commands = nullptr;
+	uint32_t*						m_Counts = nullptr;
+	uint32_t						m_CommandCount = 0;
+	int32_t							m_FrameIndex = 0;
+	int32_t							m_OpenBucket = -1;
+
+	bool							m_MultiDraw = false;
+	uint32_t						m_MaxDrawCount = 1;
+	PFN_vkCmdDrawIndexedIndirectCount	m_CmdDrawIndexedIndirectCount = nullptr;
+};
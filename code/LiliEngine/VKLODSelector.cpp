@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "VKLODSelector.h"
+
+VKLODSelector::VKLODSelector()
+{
+	screenSizes = { 0.5f, 0.25f, 0.1f };
+}
+
+float VKLODSelector::GetScreenSize(const VKBoundingBox& bounds, const Matrix4x4& world, VKCamera& camera)
+{
+	Vector3 center = world.TransformPosition((bounds.min + bounds.max) * 0.5f);
+	float radius = (bounds.max - bounds.min).Size() * 0.5f * world.GetMaximumAxisScale();
+
+	// projection m[1][1] = cot(fov / 2), it turns the distance into the visible half height.
+	Vector3 cameraPos = camera.GetTransform().GetOrigin();
+	float distance = std::max((center - cameraPos).Size(), camera.GetNear());
+	float projScale = camera.GetProjection().m[1][1];
+
+	return radius * projScale / distance;
+}
+
+int32_t VKLODSelector::Select(const VKBoundingBox& bounds, const Matrix4x4& world, VKCamera& camera, int32_t currentLOD, int32_t lodCount) const
+{
+	int32_t maxLOD = std::min<int32_t>(lodCount - 1, screenSizes.size());
+	if (maxLOD <= 0) {
+		return 0;
+	}
+
+	float size = GetScreenSize(bounds, world, camera);
+	int32_t lod = std::min(std::max(currentLOD, 0), maxLOD);
+
+	while (lod < maxLOD && size < screenSizes[lod] * (1.0f - hysteresis)) {
+		lod += 1;
+	}
+
+	while (lod > 0 && size > screenSizes[lod - 1] * (1.0f + hysteresis)) {
+		lod -= 1;
+	}
+
+	return lod;
+}
+
+int32_t VKLODSelector::Apply(VKMesh* mesh, const Matrix4x4& world, VKCamera& camera, int32_t instanceCount)
+{
+	int32_t currentLOD = mesh->primitives.size() > 0 ? mesh->primitives[0]->lodIndex : 0;
+	int32_t lod = Select(mesh->bounding, world, camera, currentLOD, mesh->GetLODCount());
+	mesh->SetLOD(lod);
+
+	trianglesSubmitted += (int64_t)mesh->GetTriangleCount(lod) * instanceCount;
+	trianglesFull += (int64_t)mesh->GetTriangleCount(0) * instanceCount;
+
+	return lod;
+}
+
+void VKLODSelector::ResetStats()
+{
+	trianglesSubmitted = 0;
+	trianglesFull = 0;
+}
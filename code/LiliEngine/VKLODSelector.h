@@ -0,0 +1,32 @@
+#pragma once
+
+#include "VKModel.h"
+#include "VKCamera.h"
+
+// Picks a VKPrimitive::lods level from the projected size of a mesh bounding box.
+// screenSizes[i] is the boundary between LOD i and i + 1, as a fraction of the screen height
+// covered by the bounding sphere. A switch only happens once the size crosses the boundary
+// by the hysteresis fraction, so objects near a boundary do not flicker between levels.
+class VKLODSelector
+{
+public:
+	VKLODSelector();
+
+	// bounding sphere diameter over the visible height at its distance, 1.0 fills the screen.
+	static float GetScreenSize(const VKBoundingBox& bounds, const Matrix4x4& world, VKCamera& camera);
+
+	int32_t Select(const VKBoundingBox& bounds, const Matrix4x4& world, VKCamera& camera, int32_t currentLOD, int32_t lodCount) const;
+
+	// selects through Select and applies the result to every primitive of the mesh.
+	int32_t Apply(VKMesh* mesh, const Matrix4x4& world, VKCamera& camera, int32_t instanceCount = 1);
+
+	void ResetStats();
+
+public:
+	std::vector<float>	screenSizes;
+	float				hysteresis = 0.1f;
+
+	// per frame counters filled by Apply, with LODs and as if every mesh used LOD 0.
+	int64_t				trianglesSubmitted = 0;
+	int64_t				trianglesFull = 0;
+};
@@ -39,14 +39,19 @@ VKMaterial::~VKMaterial()
 
 	textures.clear();
 	uniformBuffers.clear();
+	storageBuffers.clear();
+
+	textureHandles.clear();
+	uniformHandles.clear();
+	storageHandles.clear();
 
 	vulkanDevice = nullptr;
 
-	if (pipeline)
-	{
-		delete pipeline;
-		pipeline = nullptr;
+	for (auto it = pipelines.begin(); it != pipelines.end(); ++it) {
+		delete it->second;
 	}
+	pipelines.clear();
+	pipeline = nullptr;
 
 	ringBufferRefCount -= 1;
 	if (ringBufferRefCount == 0) {
@@ -68,7 +73,11 @@ VKMaterial* VKMaterial::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKRen
 	material->shader = shader;
 	material->renderPass = renderTarget->GetRenderPass();
 	material->pipelineCache = pipelineCache;
-	material->Prepare();
+	if (!material->Prepare())
+	{
+		delete material;
+		return nullptr;
+	}
 
 	return material;
 }
@@ -85,18 +94,23 @@ VKMaterial* VKMaterial::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VkRen
 	material->shader = shader;
 	material->renderPass = renderPass;
 	material->pipelineCache = pipelineCache;
-	material->Prepare();
+	if (!material->Prepare())
+	{
+		delete material;
+		return nullptr;
+	}
 
 	return material;
 }
 
-void VKMaterial::Prepare()
+bool VKMaterial::Prepare()
 {
 	descriptorSet = shader->AllocateDescriptorSet();
 
 	for (auto it = shader->bufferParams.begin(); it != shader->bufferParams.end(); ++it)
 	{
 		VKSimulateBuffer uboBuffer = {};
+		uboBuffer.name = it->first;
 		uboBuffer.binding = it->second.binding;
 		uboBuffer.descriptorType = it->second.descriptorType;
 		uboBuffer.set = it->second.set;
@@ -110,16 +124,27 @@ void VKMaterial::Prepare()
 		if (it->second.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
 			it->second.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
 		{
-			uniformBuffers.insert(std::make_pair(it->first, uboBuffer));
-			descriptorSet->WriteBuffer(it->first, &(uboBuffer.bufferInfo));
+			// uniforms live in the ring buffer, only a dynamic offset can point a draw at its data.
+			if (it->second.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+			{
+				MLOGE("Uniform %s is not dynamic, materials need shaders created with dynamicUBO.", it->first.c_str());
+				return false;
+			}
+			uboBuffer.dynamicIndex = MAX_uint32;
+			uniformHandles.insert(std::make_pair(it->first, (int32_t)uniformBuffers.size()));
+			uniformBuffers.push_back(uboBuffer);
+			descriptorSet->WriteBuffer(it->first, &(uniformBuffers.back().bufferInfo));
 		}
 		else if (it->second.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
 			it->second.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
 		{
-			storageBuffers.insert(std::make_pair(it->first, uboBuffer));
+			storageHandles.insert(std::make_pair(it->first, (int32_t)storageBuffers.size()));
+			storageBuffers.push_back(uboBuffer);
 		}
 	}
 
+	// dynamic offsets go in set then binding order, the layouts are sorted that way. Every dynamic
+	// binding needs exactly one uniform, anything left over would share slot 0 with another uniform.
 	dynamicOffsetCount = 0;
 	std::vector<VKDescriptorSetLayoutInfo>& setLayouts = shader->setLayoutsInfo.setLayouts;
 	for (int32_t i = 0; i < setLayouts.size(); ++i)
@@ -127,19 +152,41 @@ void VKMaterial::Prepare()
 		std::vector<VkDescriptorSetLayoutBinding>& bindings = setLayouts[i].bindings;
 		for (int32_t j = 0; j < bindings.size(); ++j)
 		{
-			for (auto it = uniformBuffers.begin(); it != uniformBuffers.end(); ++it)
+			if (bindings[j].descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+				continue;
+			}
+
+			int32_t found = -1;
+			for (int32_t k = 0; k < uniformBuffers.size(); ++k)
 			{
-				if (it->second.set == setLayouts[i].set &&
-					it->second.binding == bindings[j].binding &&
-					it->second.descriptorType == bindings[j].descriptorType &&
-					it->second.stageFlags == bindings[j].stageFlags
-					)
+				if (uniformBuffers[k].set != setLayouts[i].set || uniformBuffers[k].binding != bindings[j].binding) {
+					continue;
+				}
+				if (found >= 0)
 				{
-					it->second.dynamicIndex = dynamicOffsetCount;
-					dynamicOffsetCount += 1;
-					break;
+					MLOGE("Uniforms %s and %s share set=%d binding=%d.", uniformBuffers[found].name.c_str(), uniformBuffers[k].name.c_str(), setLayouts[i].set, bindings[j].binding);
+					return false;
 				}
+				found = k;
 			}
+
+			if (found < 0)
+			{
+				MLOGE("No uniform found for the dynamic binding set=%d binding=%d.", setLayouts[i].set, bindings[j].binding);
+				return false;
+			}
+
+			uniformBuffers[found].dynamicIndex = dynamicOffsetCount;
+			dynamicOffsetCount += 1;
+		}
+	}
+
+	for (int32_t i = 0; i < uniformBuffers.size(); ++i)
+	{
+		if (uniformBuffers[i].dynamicIndex == MAX_uint32)
+		{
+			MLOGE("Uniform %s has no binding in the layout, set=%d binding=%d.", uniformBuffers[i].name.c_str(), uniformBuffers[i].set, uniformBuffers[i].binding);
+			return false;
 		}
 	}
 	globalOffsets.resize(dynamicOffsetCount);
@@ -147,25 +194,47 @@ void VKMaterial::Prepare()
 	for (auto it = shader->imageParams.begin(); it != shader->imageParams.end(); ++it)
 	{
 		VKSimulateTexture texture = {};
+		texture.name = it->first;
 		texture.texture = nullptr;
 		texture.binding = it->second.binding;
 		texture.descriptorType = it->second.descriptorType;
 		texture.set = it->second.set;
 		texture.stageFlags = it->second.stageFlags;
-		textures.insert(std::make_pair(it->first, texture));
+		textureHandles.insert(std::make_pair(it->first, (int32_t)textures.size()));
+		textures.push_back(texture);
+	}
+
+	if (shader->pushConstantRanges.size() > 0)
+	{
+		const VkPushConstantRange& pushConstantRange = shader->pushConstantRanges[0];
+		pushConstantOffset = pushConstantRange.offset;
+		pushConstantSize = pushConstantRange.size;
+		pushConstantStages = pushConstantRange.stageFlags;
+
+		// the pipeline layout would be invalid.
+		if (pushConstantOffset + pushConstantSize > vulkanDevice->GetLimits().maxPushConstantsSize)
+		{
+			MLOGE("PushConstant size %u exceeds device limit %u.", pushConstantOffset + pushConstantSize, vulkanDevice->GetLimits().maxPushConstantsSize);
+			return false;
+		}
 	}
+
+	return true;
 }
 
 void VKMaterial::PreparePipeline()
 {
-	if (pipeline)
+	pipelineInfo.shader = shader;
+
+	VKGfxPipelineKey key = pipelineInfo.GetKey(renderPass);
+	auto it = pipelines.find(key);
+	if (it != pipelines.end())
 	{
-		delete pipeline;
-		pipeline = nullptr;
+		pipeline = it->second;
+		return;
 	}
 
 	// pipeline
-	pipelineInfo.shader = shader;
 	pipeline = VKGfxPipeline::Create(
 		vulkanDevice,
 		pipelineCache,
@@ -175,172 +244,374 @@ void VKMaterial::PreparePipeline()
 		shader->pipelineLayout,
 		renderPass
 	);
+	pipelines.insert(std::make_pair(key, pipeline));
 }
 
-void VKMaterial::BeginFrame()
+void VKMaterial::SetSpecialization(const std::string& name, const void* data, uint32_t size)
+{
+	auto it = shader->specConstantParams.find(name);
+	if (it == shader->specConstantParams.end())
+	{
+		MLOGE("SpecConstant %s not found.", name.c_str());
+		return;
+	}
+
+	if (it->second.size != size)
+	{
+		MLOGE("SpecConstant %s size not match, dst=%u src=%u", name.c_str(), it->second.size, size);
+		return;
+	}
+
+	pipelineInfo.SetSpecialization(it->second.constantID, data, size);
+}
+
+void VKMaterial::ReserveObjects(int32_t count)
+{
+	if (count <= objectCapacity) {
+		return;
+	}
+
+	objectCapacity = count;
+	dynamicOffsets.resize(objectCapacity * dynamicOffsetCount);
+	pushConstantDatas.resize(objectCapacity * pushConstantSize);
+}
+
+void VKMaterial::BeginFrame(int32_t expectedObjects)
 {
 	if (actived) {
 		return;
 	}
 	actived = true;
-	perObjectIndexes.clear();
+	objectCount = 0;
+
+	ReserveObjects(expectedObjects);
 
 	memset(globalOffsets.data(), MAX_uint32, sizeof(uint32_t) * globalOffsets.size());
 
-	for (auto it = uniformBuffers.begin(); it != uniformBuffers.end(); ++it)
+	for (int32_t i = 0; i < uniformBuffers.size(); ++i)
 	{
-		if (!it->second.global) {
+		VKSimulateBuffer& uboBuffer = uniformBuffers[i];
+		if (!uboBuffer.global) {
 			continue;
 		}
 		uint8_t* ringCPUData = (uint8_t*)(ringBuffer->GetMappedPointer());
-		uint64_t ringOffset = ringBuffer->AllocateMemory(it->second.dataSize);
-		uint64_t bufferSize = it->second.dataSize;
+		uint64_t ringOffset = ringBuffer->AllocateMemory(uboBuffer.dataSize);
+		uint64_t bufferSize = uboBuffer.dataSize;
 
-		memcpy(ringCPUData + ringOffset, it->second.dataContent.data(), bufferSize);
+		memcpy(ringCPUData + ringOffset, uboBuffer.dataContent.data(), bufferSize);
 
-		globalOffsets[it->second.dynamicIndex] = ringOffset;
+		globalOffsets[uboBuffer.dynamicIndex] = ringOffset;
 	}
 }
 
 void VKMaterial::EndFrame()
 {
 	actived = false;
+
+#ifdef _DEBUG
+	for (int32_t i = 0; i < objectCount * dynamicOffsetCount; ++i)
+	{
+		if (dynamicOffsets[i] == MAX_uint32) {
+			MLOGE("Uniform not set, object=%d\n", i / dynamicOffsetCount);
+		}
+	}
+
+	if (objectCount == 0)
+	{
+		for (int32_t i = 0; i < dynamicOffsetCount; ++i) {
+			if (globalOffsets[i] == MAX_uint32) {
+				MLOGE("Uniform not set\n");
+			}
+		}
+	}
+#endif
 }
 
 void VKMaterial::BeginObject()
 {
-	int32_t index = perObjectIndexes.size();
-	perObjectIndexes.push_back(index);
+	int32_t index = objectCount;
+	objectCount += 1;
 
-	int32_t offsetStart = index * dynamicOffsetCount;
-
-	if (offsetStart + dynamicOffsetCount > dynamicOffsets.size()) {
-		for (int32_t i = 0; i < dynamicOffsetCount; ++i) {
-			dynamicOffsets.push_back(0);
-		}
+	// only grows past the high watermark, steady state frames never allocate here.
+	if (objectCount > objectCapacity) {
+		ReserveObjects(math::Max(objectCount, objectCapacity * 2));
 	}
 
-	for (int32_t offsetIndex = offsetStart; offsetIndex < dynamicOffsetCount; ++offsetIndex) {
-		dynamicOffsets[offsetIndex] = globalOffsets[offsetIndex - offsetStart];
+	if (dynamicOffsetCount > 0) {
+		memcpy(dynamicOffsets.data() + index * dynamicOffsetCount, globalOffsets.data(), sizeof(uint32_t) * dynamicOffsetCount);
 	}
 }
 
 void VKMaterial::EndObject()
 {
-	for (int32_t i = 0; i < perObjectIndexes.size(); ++i)
+	// validation runs once per frame in EndFrame (debug only).
+}
+
+void VKMaterial::BindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, int32_t objIndex)
+{
+	uint32_t* dynOffsets = nullptr;
+	if (objIndex < objectCount)
 	{
-		int32_t offsetStart = i * dynamicOffsetCount;
-		for (int32_t offsetIndex = offsetStart; offsetIndex < dynamicOffsetCount; ++offsetIndex) {
-			if (dynamicOffsets[offsetIndex] == MAX_uint32) {
-				MLOGE("Uniform not set\n");
-			}
-		}
+		dynOffsets = dynamicOffsets.data() + objIndex * dynamicOffsetCount;
+	}
+	else if (globalOffsets.size() > 0)
+	{
+		dynOffsets = globalOffsets.data();
 	}
 
-	if (perObjectIndexes.size() == 0)
+	if (descriptorSet)
 	{
-		for (int32_t i = 0; i < dynamicOffsetCount; ++i) {
-			if (globalOffsets[i] == MAX_uint32) {
-				MLOGE("Uniform not set\n");
-			}
-		}
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			bindPoint,
+			GetPipelineLayout(),
+			0, GetDescriptorSets().size(), GetDescriptorSets().data(),
+			dynamicOffsetCount, dynOffsets
+		);
+	}
+
+	if (shader->bindlessSet >= 0) {
+		VKBindlessTable::Bind(commandBuffer, bindPoint, GetPipelineLayout(), shader->bindlessSet);
+	}
+
+	if (pushConstantSize > 0 && objIndex < objectCount)
+	{
+		vkCmdPushConstants(
+			commandBuffer,
+			GetPipelineLayout(),
+			pushConstantStages,
+			pushConstantOffset, pushConstantSize,
+			pushConstantDatas.data() + objIndex * pushConstantSize
+		);
 	}
 }
 
-void VKMaterial::BindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, int32_t objIndex)
+void VKMaterial::SetLocalPushConstant(const void* dataPtr, uint32_t size)
 {
-	uint32_t* dynOffsets = nullptr;
-	if (objIndex < perObjectIndexes.size())
+#ifdef _DEBUG
+	if (objectCount == 0)
 	{
-		dynOffsets = dynamicOffsets.data() + perObjectIndexes[objIndex] * dynamicOffsetCount;;;
+		MLOGE("SetLocalPushConstant must be called between BeginObject and EndObject.");
+		return;
 	}
-	else if (globalOffsets.size() > 0)
+
+	if (size > pushConstantSize)
 	{
-		dynOffsets = globalOffsets.data();
+		MLOGE("PushConstant size not match, dst=%u src=%u", pushConstantSize, size);
+		return;
 	}
+#endif
 
-	vkCmdBindDescriptorSets(
-		commandBuffer,
-		bindPoint,
-		GetPipelineLayout(),
-		0, GetDescriptorSets().size(), GetDescriptorSets().data(),
-		dynamicOffsetCount, dynOffsets
-	);
+	memcpy(pushConstantDatas.data() + (objectCount - 1) * pushConstantSize, dataPtr, size);
 }
 
-void VKMaterial::SetLocalUniform(const std::string& name, void* dataPtr, uint32_t size)
+void VKMaterial::PushConstants(VkCommandBuffer commandBuffer, const void* dataPtr, uint32_t size)
+{
+#ifdef _DEBUG
+	if (size > pushConstantSize)
+	{
+		MLOGE("PushConstant size not match, dst=%u src=%u", pushConstantSize, size);
+		return;
+	}
+#endif
+
+	vkCmdPushConstants(commandBuffer, GetPipelineLayout(), pushConstantStages, pushConstantOffset, size, dataPtr);
+}
+
+int32_t VKMaterial::FindUniform(const std::string& name) const
 {
-	auto it = uniformBuffers.find(name);
-	if (it == uniformBuffers.end())
+	auto it = uniformHandles.find(name);
+	if (it == uniformHandles.end())
 	{
 		MLOGE("Uniform %s not found.", name.c_str());
+		return -1;
+	}
+	return it->second;
+}
+
+int32_t VKMaterial::FindTexture(const std::string& name) const
+{
+	auto it = textureHandles.find(name);
+	if (it == textureHandles.end())
+	{
+		MLOGE("Texture %s not found.", name.c_str());
+		return -1;
+	}
+	return it->second;
+}
+
+int32_t VKMaterial::FindStorageBuffer(const std::string& name) const
+{
+	auto it = storageHandles.find(name);
+	if (it == storageHandles.end())
+	{
+		MLOGE("StorageBuffer %s not found.", name.c_str());
+		return -1;
+	}
+	return it->second;
+}
+
+void VKMaterial::SetLocalUniform(int32_t handle, void* dataPtr, uint32_t size)
+{
+#ifdef _DEBUG
+	if (handle < 0 || handle >= uniformBuffers.size())
+	{
+		MLOGE("Uniform handle %d invalid.", handle);
 		return;
 	}
 
-	if (it->second.dataSize != size)
+	if (size != 0 && uniformBuffers[handle].dataSize != size)
 	{
-		MLOGE("Uniform %s size not match, dst=%ud src=%ud", name.c_str(), it->second.dataSize, size);
+		MLOGE("Uniform %s size not match, dst=%ud src=%ud", uniformBuffers[handle].name.c_str(), uniformBuffers[handle].dataSize, size);
 		return;
 	}
+#endif
+
+	const VKSimulateBuffer& uboBuffer = uniformBuffers[handle];
 
-	int32_t objIndex = perObjectIndexes.back();
+	int32_t objIndex = objectCount - 1;
 	int32_t offsetStart = objIndex * dynamicOffsetCount;
 	uint32_t* dynOffsets = dynamicOffsets.data() + offsetStart;
 
 	uint8_t* ringCPUData = (uint8_t*)(ringBuffer->GetMappedPointer());
-	uint64_t ringOffset = ringBuffer->AllocateMemory(it->second.dataSize);
-	uint64_t bufferSize = it->second.dataSize;
+	uint64_t ringOffset = ringBuffer->AllocateMemory(uboBuffer.dataSize);
+	uint64_t bufferSize = uboBuffer.dataSize;
 
 	memcpy(ringCPUData + ringOffset, dataPtr, bufferSize);
 
-	dynOffsets[it->second.dynamicIndex] = ringOffset;
+	dynOffsets[uboBuffer.dynamicIndex] = ringOffset;
 }
 
-void VKMaterial::SetGlobalUniform(const std::string& name, void* dataPtr, uint32_t size)
+void VKMaterial::SetGlobalUniform(int32_t handle, void* dataPtr, uint32_t size)
 {
-	auto it = uniformBuffers.find(name);
-	if (it == uniformBuffers.end())
+#ifdef _DEBUG
+	if (handle < 0 || handle >= uniformBuffers.size())
 	{
-		MLOGE("Uniform %s not found.", name.c_str());
+		MLOGE("Uniform handle %d invalid.", handle);
 		return;
 	}
 
-	if (it->second.dataSize != size)
+	if (size != 0 && uniformBuffers[handle].dataSize != size)
 	{
-		MLOGE("Uniform %s size not match, dst=%ud src=%ud", name.c_str(), it->second.dataSize, size);
+		MLOGE("Uniform %s size not match, dst=%ud src=%ud", uniformBuffers[handle].name.c_str(), uniformBuffers[handle].dataSize, size);
 		return;
 	}
+#endif
+
+	VKSimulateBuffer& uboBuffer = uniformBuffers[handle];
 
-	if (it->second.dataContent.size() != size) {
-		it->second.dataContent.resize(size);
+	if (uboBuffer.dataContent.size() != uboBuffer.dataSize) {
+		uboBuffer.dataContent.resize(uboBuffer.dataSize);
 	}
 
-	it->second.global = true;
-	memcpy(it->second.dataContent.data(), dataPtr, size);
+	uboBuffer.global = true;
+	memcpy(uboBuffer.dataContent.data(), dataPtr, uboBuffer.dataSize);
 }
 
-void VKMaterial::SetTexture(const std::string& name, VKTexture* texture)
+void VKMaterial::SetTexture(int32_t handle, VKTexture* texture)
 {
-	auto it = textures.find(name);
-	if (it == textures.end())
+#ifdef _DEBUG
+	if (handle < 0 || handle >= textures.size())
 	{
-		MLOGE("Texture %s not found.", name.c_str());
+		MLOGE("Texture handle %d invalid.", handle);
 		return;
 	}
 
 	if (texture == nullptr)
 	{
-		MLOGE("Texture %s can't be null.", name.c_str());
+		MLOGE("Texture %s can't be null.", textures[handle].name.c_str());
 		return;
 	}
+#endif
 
-	if (it->second.texture != texture)
+	VKSimulateTexture& simTexture = textures[handle];
+	if (simTexture.texture != texture)
 	{
-		it->second.texture = texture;
-		descriptorSet->WriteImage(name, texture);
+		simTexture.texture = texture;
+		descriptorSet->WriteImage(simTexture.name, texture);
 	}
 }
 
+void VKMaterial::SetInputAttachment(int32_t handle, VKTexture* texture)
+{
+	SetTexture(handle, texture);
+}
+
+void VKMaterial::SetStorageBuffer(int32_t handle, DVKBuffer* buffer)
+{
+#ifdef _DEBUG
+	if (handle < 0 || handle >= storageBuffers.size())
+	{
+		MLOGE("StorageBuffer handle %d invalid.", handle);
+		return;
+	}
+
+	if (buffer == nullptr)
+	{
+		MLOGE("StorageBuffer %s can't be null.", storageBuffers[handle].name.c_str());
+		return;
+	}
+#endif
+
+	VKSimulateBuffer& ssboBuffer = storageBuffers[handle];
+	if (ssboBuffer.bufferInfo.buffer != buffer->buffer)
+	{
+		ssboBuffer.dataSize = buffer->size;
+		ssboBuffer.bufferInfo.buffer = buffer->buffer;
+		ssboBuffer.bufferInfo.offset = 0;
+		ssboBuffer.bufferInfo.range = buffer->size;
+		descriptorSet->WriteBuffer(ssboBuffer.name, buffer);
+	}
+}
+
+void VKMaterial::SetLocalUniform(const std::string& name, void* dataPtr, uint32_t size)
+{
+	int32_t handle = FindUniform(name);
+	if (handle == -1) {
+		return;
+	}
+
+	if (uniformBuffers[handle].dataSize != size)
+	{
+		MLOGE("Uniform %s size not match, dst=%ud src=%ud", name.c_str(), uniformBuffers[handle].dataSize, size);
+		return;
+	}
+
+	SetLocalUniform(handle, dataPtr, size);
+}
+
+void VKMaterial::SetGlobalUniform(const std::string& name, void* dataPtr, uint32_t size)
+{
+	int32_t handle = FindUniform(name);
+	if (handle == -1) {
+		return;
+	}
+
+	if (uniformBuffers[handle].dataSize != size)
+	{
+		MLOGE("Uniform %s size not match, dst=%ud src=%ud", name.c_str(), uniformBuffers[handle].dataSize, size);
+		return;
+	}
+
+	SetGlobalUniform(handle, dataPtr, size);
+}
+
+void VKMaterial::SetTexture(const std::string& name, VKTexture* texture)
+{
+	int32_t handle = FindTexture(name);
+	if (handle == -1) {
+		return;
+	}
+
+	if (texture == nullptr)
+	{
+		MLOGE("Texture %s can't be null.", name.c_str());
+		return;
+	}
+
+	SetTexture(handle, texture);
+}
+
 void VKMaterial::SetInputAttachment(const std::string& name, VKTexture* texture)
 {
 	SetTexture(name, texture);
@@ -348,10 +619,8 @@ void VKMaterial::SetInputAttachment(const std::string& name, VKTexture* texture)
 
 void VKMaterial::SetStorageBuffer(const std::string& name, DVKBuffer* buffer)
 {
-	auto it = storageBuffers.find(name);
-	if (it == storageBuffers.end())
-	{
-		MLOGE("StorageBuffer %s not found.", name.c_str());
+	int32_t handle = FindStorageBuffer(name);
+	if (handle == -1) {
 		return;
 	}
 
@@ -361,12 +630,5 @@ void VKMaterial::SetStorageBuffer(const std::string& name, DVKBuffer* buffer)
 		return;
 	}
 
-	if (it->second.bufferInfo.buffer != buffer->buffer)
-	{
-		it->second.dataSize = buffer->size;
-		it->second.bufferInfo.buffer = buffer->buffer;
-		it->second.bufferInfo.offset = 0;
-		it->second.bufferInfo.range = buffer->size;
-		descriptorSet->WriteBuffer(name, buffer);
-	}
+	SetStorageBuffer(handle, buffer);
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 struct VKSimulateBuffer
 {
+	std::string				name;
 	std::vector<uint8_t>		dataContent;
 	bool                    global = false;
 	uint32_t					dataSize = 0;
@@ -24,6 +25,7 @@ struct VKSimulateBuffer
 
 struct VKSimulateTexture
 {
+	std::string			name;
 	uint32_t              set = 0;
 	uint32_t              binding = 0;
 	VkDescriptorType    descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
@@ -77,8 +79,10 @@ class VKMaterial
 {
 private:
 
-	typedef std::unordered_map<std::string, VKSimulateBuffer>		BuffersMap;
-	typedef std::unordered_map<std::string, VKSimulateTexture>		TexturesMap;
+	typedef std::vector<VKSimulateBuffer>							BuffersArray;
+	typedef std::vector<VKSimulateTexture>							TexturesArray;
+	typedef std::unordered_map<std::string, int32_t>				HandlesMap;
+	typedef std::unordered_map<VKGfxPipelineKey, VKGfxPipeline*, VKGfxPipelineKeyHash>	PipelinesMap;
 	typedef std::shared_ptr<VulkanDevice>							VulkanDeviceRef;
 
 	VKMaterial()
@@ -93,18 +97,55 @@ public:
 
 	static VKMaterial* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKRenderTarget* renderTarget, VkPipelineCache pipelineCache, VKShader* shader);
 
+	// Picks the pipeline matching the current pipelineInfo and specialization values, variants are created once and kept.
 	void PreparePipeline();
 
+	// Sets a specialization constant by its name in the shader, takes effect on the next PreparePipeline.
+	// bool constants are VkBool32 (4 bytes).
+	void SetSpecialization(const std::string& name, const void* data, uint32_t size);
+
+	inline void SetSpecialization(const std::string& name, int32_t value)
+	{
+		SetSpecialization(name, &value, sizeof(int32_t));
+	}
+
 	void BeginObject();
 
 	void EndObject();
 
-	void BeginFrame();
+	// expectedObjects preallocates the per-object dynamic offsets, the high watermark of previous frames is kept.
+	void BeginFrame(int32_t expectedObjects = 0);
 
 	void EndFrame();
 
+	void ReserveObjects(int32_t count);
+
+	inline int32_t GetObjectCount() const
+	{
+		return objectCount;
+	}
+
 	void BindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, int32_t objIndex);
 
+	// Handles are resolved once (e.g. at load time) and stay valid for the lifetime of the material.
+	// -1 is returned when the shader has no parameter with that name.
+	int32_t FindUniform(const std::string& name) const;
+
+	int32_t FindTexture(const std::string& name) const;
+
+	int32_t FindStorageBuffer(const std::string& name) const;
+
+	// size is only validated in debug builds, pass 0 to skip the check.
+	void SetLocalUniform(int32_t handle, void* dataPtr, uint32_t size = 0);
+
+	void SetGlobalUniform(int32_t handle, void* dataPtr, uint32_t size = 0);
+
+	void SetTexture(int32_t handle, VKTexture* texture);
+
+	void SetStorageBuffer(int32_t handle, DVKBuffer* buffer);
+
+	void SetInputAttachment(int32_t handle, VKTexture* texture);
+
 	void SetLocalUniform(const std::string& name, void* dataPtr, uint32_t size);
 
 	void SetTexture(const std::string& name, VKTexture* texture);
@@ -115,6 +156,18 @@ public:
 
 	void SetInputAttachment(const std::string& name, VKTexture* texture);
 
+	// Per-object data for the shader's push_constant block (at most maxPushConstantsSize, 128 bytes is always safe).
+	// Stored with the current object and pushed by BindDescriptorSets, the ring buffer is not touched.
+	void SetLocalPushConstant(const void* dataPtr, uint32_t size);
+
+	// Records vkCmdPushConstants immediately, for draws that are not tracked as objects.
+	void PushConstants(VkCommandBuffer commandBuffer, const void* dataPtr, uint32_t size);
+
+	inline bool HasPushConstants() const
+	{
+		return pushConstantSize > 0;
+	}
+
 	inline VkPipeline GetPipeline() const
 	{
 		return pipeline->pipeline;
@@ -135,7 +188,7 @@ private:
 
 	static void DestroyRingBuffer();
 
-	void Prepare();
+	bool Prepare();
 
 private:
 
@@ -152,16 +205,27 @@ public:
 
 	VKGfxPipelineInfo      pipelineInfo;
 	VKGfxPipeline* pipeline = nullptr;
+	PipelinesMap			pipelines;
 	VKDescriptorSet* descriptorSet = nullptr;
 
 	uint32_t					dynamicOffsetCount;
 	std::vector<uint32_t>		globalOffsets;
 	std::vector<uint32_t>     dynamicOffsets;
-	std::vector<uint32_t>		perObjectIndexes;
+	int32_t					objectCount = 0;
+	int32_t					objectCapacity = 0;
+
+	uint32_t				pushConstantOffset = 0;
+	uint32_t				pushConstantSize = 0;
+	VkShaderStageFlags		pushConstantStages = 0;
+	std::vector<uint8_t>	pushConstantDatas;
+
+	BuffersArray			uniformBuffers;
+	BuffersArray			storageBuffers;
+	TexturesArray			textures;
 
-	BuffersMap				uniformBuffers;
-	BuffersMap				storageBuffers;
-	TexturesMap				textures;
+	HandlesMap				uniformHandles;
+	HandlesMap				storageHandles;
+	HandlesMap				textureHandles;
 
 	bool                    actived = false;
 };
\ No newline at end of file
@@ -0,0 +1,407 @@
+#include "stdafx.h"
+#include "VKMeshOptimizer.h"
+
+static inline uint32_t HashVertex(const float* vertex, int32_t stride)
+{
+	// FNV-1a over the raw bits, welding only merges bitwise identical vertices.
+	const uint32_t* words = (const uint32_t*)vertex;
+	uint32_t hash = 2166136261u;
+	for (int32_t i = 0; i < stride; ++i) {
+		hash = (hash ^ words[i]) * 16777619u;
+	}
+	return hash;
+}
+
+void VKMeshOptimizer::GenerateWeldRemap(const std::vector<float>& vertices, int32_t stride, std::vector<uint32_t>& outRemap)
+{
+	int32_t vertexCount = vertices.size() / stride;
+	outRemap.resize(vertexCount);
+	if (vertexCount == 0) {
+		return;
+	}
+
+	uint32_t tableSize = 1;
+	while (tableSize < vertexCount * 2) {
+		tableSize <<= 1;
+	}
+	uint32_t tableMask = tableSize - 1;
+
+	std::vector<int32_t> table(tableSize, -1);
+	int32_t vertexSize = stride * sizeof(float);
+
+	for (int32_t i = 0; i < vertexCount; ++i)
+	{
+		const float* vertex = vertices.data() + i * stride;
+		uint32_t bucket = HashVertex(vertex, stride) & tableMask;
+
+		while (true)
+		{
+			int32_t slot = table[bucket];
+			if (slot < 0)
+			{
+				table[bucket] = i;
+				outRemap[i] = i;
+				break;
+			}
+
+			if (memcmp(vertices.data() + slot * stride, vertex, vertexSize) == 0)
+			{
+				outRemap[i] = slot;
+				break;
+			}
+
+			bucket = (bucket + 1) & tableMask;
+		}
+	}
+}
+
+int32_t VKMeshOptimizer::WeldVertices(std::vector<float>& vertices, std::vector<uint32_t>& indices, int32_t stride)
+{
+	std::vector<uint32_t> remap;
+	GenerateWeldRemap(vertices, stride, remap);
+
+	int32_t vertexCount = remap.size();
+	int32_t uniqueCount = 0;
+	int32_t vertexSize = stride * sizeof(float);
+
+	// unique vertices are compacted in place, the write position never passes the read position.
+	for (int32_t i = 0; i < vertexCount; ++i)
+	{
+		if (remap[i] != i)
+		{
+			remap[i] = remap[remap[i]];
+			continue;
+		}
+
+		if (uniqueCount != i) {
+			memcpy(vertices.data() + uniqueCount * stride, vertices.data() + i * stride, vertexSize);
+		}
+		remap[i] = uniqueCount;
+		uniqueCount += 1;
+	}
+
+	vertices.resize(uniqueCount * stride);
+	for (int32_t i = 0; i < indices.size(); ++i) {
+		indices[i] = remap[indices[i]];
+	}
+
+	return uniqueCount;
+}
+
+void VKMeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, int32_t vertexCount, std::vector<uint32_t>* clusters, int32_t cacheSize)
+{
+	int32_t triangleCount = indices.size() / 3;
+	if (clusters) {
+		clusters->clear();
+		clusters->push_back(0);
+	}
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// vertex -> triangles adjacency, live counts the triangles not emitted yet.
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (int32_t i = 0; i < triangleCount * 3; ++i) {
+		live[indices[i]] += 1;
+	}
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (int32_t i = 0; i < vertexCount; ++i) {
+		offsets[i + 1] = offsets[i] + live[i];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (int32_t i = 0; i < triangleCount * 3; ++i) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	deadEnd.reserve(triangleCount * 3);
+	output.reserve(triangleCount * 3);
+
+	int32_t time = cacheSize + 1;
+	int32_t cursor = 0;
+	int32_t fanning = 0;
+	while (fanning < vertexCount && live[fanning] == 0) {
+		fanning += 1;
+	}
+
+	while (fanning >= 0 && fanning < vertexCount)
+	{
+		candidates.clear();
+
+		for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; ++i)
+		{
+			uint32_t triangle = adjacency[i];
+			if (emitted[triangle]) {
+				continue;
+			}
+
+			for (int32_t j = 0; j < 3; ++j)
+			{
+				uint32_t v = indices[triangle * 3 + j];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v] -= 1;
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time;
+					time += 1;
+				}
+			}
+			emitted[triangle] = 1;
+		}
+
+		// prefer the oldest candidate that will still be cached after fanning its remaining triangles.
+		int32_t next = -1;
+		int32_t bestPriority = -1;
+		for (int32_t i = 0; i < candidates.size(); ++i)
+		{
+			uint32_t v = candidates[i];
+			if (live[v] == 0) {
+				continue;
+			}
+
+			int32_t priority = 0;
+			if (time - cacheTime[v] + 2 * (int32_t)live[v] <= cacheSize) {
+				priority = time - cacheTime[v];
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		if (next < 0)
+		{
+			while (deadEnd.size() > 0)
+			{
+				uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+				{
+					next = v;
+					break;
+				}
+			}
+
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0) {
+					next = cursor;
+				}
+				cursor += 1;
+			}
+
+			if (next >= 0 && clusters) {
+				clusters->push_back(output.size() / 3);
+			}
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+void VKMeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& vertices, int32_t stride, int32_t positionOffset, const std::vector<uint32_t>& clusters, float threshold, int32_t cacheSize)
+{
+	int32_t triangleCount = indices.size() / 3;
+	int32_t vertexCount = vertices.size() / stride;
+	if (triangleCount == 0 || positionOffset < 0 || clusters.size() == 0) {
+		return;
+	}
+
+	// soft boundaries: split a cluster as soon as its own ACMR (from a cold cache) is good enough.
+	float targetACMR = AnalyzeVertexCache(indices, vertexCount, cacheSize).ACMR() * threshold;
+
+	std::vector<uint32_t> splits;
+	std::vector<int32_t> cacheTime(vertexCount, 0);
+	int32_t time = cacheSize + 1;
+
+	for (int32_t i = 0; i < clusters.size(); ++i)
+	{
+		int32_t start = clusters[i];
+		int32_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+		splits.push_back(start);
+		time += cacheSize + 1;
+
+		int32_t runStart = start;
+		int32_t misses = 0;
+		for (int32_t t = start; t < end; ++t)
+		{
+			for (int32_t j = 0; j < 3; ++j)
+			{
+				uint32_t v = indices[t * 3 + j];
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time;
+					time += 1;
+					misses += 1;
+				}
+			}
+
+			if (t + 1 < end && misses <= targetACMR * (t - runStart + 1))
+			{
+				splits.push_back(t + 1);
+				runStart = t + 1;
+				misses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	// sort key: how far a cluster faces away from the mesh center.
+	struct ClusterSortData
+	{
+		int32_t start;
+		int32_t end;
+		float	centroid[3];
+		float	normal[3];
+		float	area;
+		float	key;
+	};
+
+	std::vector<ClusterSortData> sortDatas(splits.size());
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for (int32_t i = 0; i < splits.size(); ++i)
+	{
+		ClusterSortData& data = sortDatas[i];
+		data.start = splits[i];
+		data.end = i + 1 < splits.size() ? splits[i + 1] : triangleCount;
+		data.centroid[0] = data.centroid[1] = data.centroid[2] = 0.0f;
+		data.normal[0] = data.normal[1] = data.normal[2] = 0.0f;
+		data.area = 0.0f;
+
+		for (int32_t t = data.start; t < data.end; ++t)
+		{
+			const float* p0 = vertices.data() + indices[t * 3 + 0] * stride + positionOffset;
+			const float* p1 = vertices.data() + indices[t * 3 + 1] * stride + positionOffset;
+			const float* p2 = vertices.data() + indices[t * 3 + 2] * stride + positionOffset;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				data.centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+				data.normal[k] += n[k];
+			}
+			data.area += area;
+		}
+
+		for (int32_t k = 0; k < 3; ++k) {
+			meshCentroid[k] += data.centroid[k];
+		}
+		meshArea += data.area;
+
+		if (data.area > 0.0f)
+		{
+			float invArea = 1.0f / data.area;
+			data.centroid[0] *= invArea;
+			data.centroid[1] *= invArea;
+			data.centroid[2] *= invArea;
+		}
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid[0] /= meshArea;
+		meshCentroid[1] /= meshArea;
+		meshCentroid[2] /= meshArea;
+	}
+
+	for (int32_t i = 0; i < sortDatas.size(); ++i)
+	{
+		ClusterSortData& data = sortDatas[i];
+		float length = sqrtf(data.normal[0] * data.normal[0] + data.normal[1] * data.normal[1] + data.normal[2] * data.normal[2]);
+		float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+		data.key =
+			(data.centroid[0] - meshCentroid[0]) * data.normal[0] * invLength +
+			(data.centroid[1] - meshCentroid[1]) * data.normal[1] * invLength +
+			(data.centroid[2] - meshCentroid[2]) * data.normal[2] * invLength;
+	}
+
+	std::stable_sort(sortDatas.begin(), sortDatas.end(), [](const ClusterSortData& a, const ClusterSortData& b) {
+		return a.key > b.key;
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (int32_t i = 0; i < sortDatas.size(); ++i) {
+		output.insert(output.end(), indices.begin() + sortDatas[i].start * 3, indices.begin() + sortDatas[i].end * 3);
+	}
+	indices.swap(output);
+}
+
+void VKMeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, std::vector<uint32_t>& indices, int32_t stride)
+{
+	int32_t vertexCount = vertices.size() / stride;
+	std::vector<int32_t> remap(vertexCount, -1);
+	int32_t newCount = 0;
+
+	for (int32_t i = 0; i < indices.size(); ++i)
+	{
+		uint32_t v = indices[i];
+		if (remap[v] < 0) {
+			remap[v] = newCount++;
+		}
+		indices[i] = remap[v];
+	}
+
+	// unreferenced vertices are dropped.
+	std::vector<float> output(newCount * stride);
+	for (int32_t i = 0; i < vertexCount; ++i)
+	{
+		if (remap[i] >= 0) {
+			memcpy(output.data() + remap[i] * stride, vertices.data() + i * stride, stride * sizeof(float));
+		}
+	}
+	vertices.swap(output);
+}
+
+VKVertexCacheStats VKMeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, int32_t vertexCount, int32_t cacheSize)
+{
+	VKVertexCacheStats stats;
+	stats.triangleCount = indices.size() / 3;
+
+	std::vector<int32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	int32_t time = cacheSize + 1;
+
+	for (int32_t i = 0; i < stats.triangleCount * 3; ++i)
+	{
+		uint32_t v = indices[i];
+		if (time - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = time;
+			time += 1;
+			stats.transformCount += 1;
+		}
+
+		if (used[v] == 0)
+		{
+			used[v] = 1;
+			stats.vertexCount += 1;
+		}
+	}
+
+	return stats;
+}
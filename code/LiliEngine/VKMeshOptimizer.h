@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Post-transform cache statistics measured with a FIFO cache simulation.
+// ACMR = transformed vertices per triangle (0.5 is ideal for big regular meshes).
+// ATVR = transformed vertices per unique vertex (1.0 is ideal).
+struct VKVertexCacheStats
+{
+	int32_t triangleCount = 0;
+	int32_t vertexCount = 0;
+	int32_t transformCount = 0;
+
+	inline float ACMR() const
+	{
+		return triangleCount > 0 ? (float)transformCount / triangleCount : 0.0f;
+	}
+
+	inline float ATVR() const
+	{
+		return vertexCount > 0 ? (float)transformCount / vertexCount : 0.0f;
+	}
+
+	inline void Append(const VKVertexCacheStats& other)
+	{
+		triangleCount += other.triangleCount;
+		vertexCount += other.vertexCount;
+		transformCount += other.transformCount;
+	}
+};
+
+// Import-time mesh optimization on packed vertex streams (stride in floats) and triangle lists.
+// The usual order is WeldVertices, OptimizeVertexCache, OptimizeOverdraw, OptimizeVertexFetch.
+class VKMeshOptimizer
+{
+public:
+	static const int32_t DEFAULT_CACHE_SIZE = 16;
+
+	// outRemap[i] is the first vertex bitwise identical to vertex i, the vertices stay untouched.
+	static void GenerateWeldRemap(const std::vector<float>& vertices, int32_t stride, std::vector<uint32_t>& outRemap);
+
+	// merges bitwise identical vertices and rewrites indices, returns the new vertex count.
+	static int32_t WeldVertices(std::vector<float>& vertices, std::vector<uint32_t>& indices, int32_t stride);
+
+	// Tipsify triangle reordering (Sander et al. 2007). clusters receives the first triangle of every
+	// run that had to restart from a dead end, OptimizeOverdraw uses them as hard boundaries.
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, int32_t vertexCount, std::vector<uint32_t>* clusters = nullptr, int32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// splits clusters further while their ACMR stays below threshold * ACMR of the whole mesh,
+	// then orders them outside-in so front-most surfaces tend to be drawn first.
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& vertices, int32_t stride, int32_t positionOffset, const std::vector<uint32_t>& clusters, float threshold = 1.05f, int32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// reorders vertices by first use so fetches walk the vertex buffer linearly.
+	static void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<uint32_t>& indices, int32_t stride);
+
+	static VKVertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, int32_t vertexCount, int32_t cacheSize = DEFAULT_CACHE_SIZE);
+};
@@ -0,0 +1,383 @@
+#include "stdafx.h"
+#include "VKMeshSimplifier.h"
+
+#include <queue>
+
+// symmetric 4x4 matrix, upper triangle
+struct VKQuadric
+{
+	double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+	double a11 = 0, a12 = 0, a13 = 0;
+	double a22 = 0, a23 = 0;
+	double a33 = 0;
+
+	void AddPlane(double a, double b, double c, double d, double weight)
+	{
+		a00 += weight * a * a; a01 += weight * a * b; a02 += weight * a * c; a03 += weight * a * d;
+		a11 += weight * b * b; a12 += weight * b * c; a13 += weight * b * d;
+		a22 += weight * c * c; a23 += weight * c * d;
+		a33 += weight * d * d;
+	}
+
+	void Add(const VKQuadric& q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23;
+		a33 += q.a33;
+	}
+
+	double Evaluate(const float* p) const
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double result =
+			a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+			a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+			a22 * z * z + 2 * a23 * z +
+			a33;
+		return result > 0.0 ? result : 0.0;
+	}
+};
+
+struct VKCollapse
+{
+	double		cost;
+	uint32_t	from;
+	uint32_t	to;
+	uint32_t	fromStamp;
+	uint32_t	toStamp;
+
+	bool operator<(const VKCollapse& other) const
+	{
+		// std::priority_queue pops the largest, invert for the cheapest collapse first.
+		return cost > other.cost;
+	}
+};
+
+static void TriangleNormal(const float* p0, const float* p1, const float* p2, float* outNormal)
+{
+	float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	outNormal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	outNormal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	outNormal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// the vertex of `to` every vertex of `from` continues into. A vertex on the other side of an attribute
+// seam has its own partner, a vertex without one (the seam does not run along the edge) blocks the collapse.
+static bool MapCollapse(const std::vector<uint32_t>& triangles, const std::vector<uint8_t>& triangleAlive, const std::vector<uint32_t>& adjacency, const std::vector<uint32_t>& positionRep, uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>>& outMapping)
+{
+	outMapping.clear();
+
+	for (int32_t i = 0; i < adjacency.size(); ++i)
+	{
+		uint32_t triangle = adjacency[i];
+		if (!triangleAlive[triangle]) {
+			continue;
+		}
+
+		const uint32_t* tri = triangles.data() + triangle * 3;
+		uint32_t a = UINT32_MAX;
+		uint32_t b = UINT32_MAX;
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			if (positionRep[tri[k]] == from) {
+				a = tri[k];
+			}
+			else if (positionRep[tri[k]] == to) {
+				b = tri[k];
+			}
+		}
+
+		int32_t slot = 0;
+		while (slot < outMapping.size() && outMapping[slot].first != a) {
+			slot += 1;
+		}
+		if (slot == outMapping.size()) {
+			outMapping.push_back(std::make_pair(a, UINT32_MAX));
+		}
+
+		if (b == UINT32_MAX) {
+			continue;
+		}
+		if (outMapping[slot].second != UINT32_MAX && outMapping[slot].second != b) {
+			return false;
+		}
+		outMapping[slot].second = b;
+	}
+
+	for (int32_t i = 0; i < outMapping.size(); ++i) {
+		if (outMapping[i].second == UINT32_MAX) {
+			return false;
+		}
+	}
+
+	return outMapping.size() > 0;
+}
+
+float VKMeshSimplifier::Simplify(const std::vector<uint32_t>& indices, const std::vector<float>& positions, const std::vector<int32_t>* boneKeys, int32_t targetTriangleCount, std::vector<uint32_t>& outIndices)
+{
+	int32_t vertexCount = positions.size() / 3;
+	int32_t triangleCount = indices.size() / 3;
+
+	outIndices.clear();
+	if (triangleCount <= targetTriangleCount || vertexCount == 0)
+	{
+		outIndices = indices;
+		return 0.0f;
+	}
+
+	// collapses work on positions: vertices sharing one are the same point, the first of them represents it.
+	std::vector<uint32_t> positionRep(vertexCount);
+	{
+		std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+		for (int32_t i = 0; i < vertexCount; ++i)
+		{
+			const uint32_t* bits = (const uint32_t*)(positions.data() + i * 3);
+			uint64_t hash = ((uint64_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u) << 32) | bits[0];
+
+			positionRep[i] = i;
+			std::vector<uint32_t>& bucket = buckets[hash];
+			for (int32_t j = 0; j < bucket.size(); ++j)
+			{
+				if (memcmp(positions.data() + bucket[j] * 3, positions.data() + i * 3, sizeof(float) * 3) == 0)
+				{
+					positionRep[i] = positionRep[bucket[j]];
+					break;
+				}
+			}
+			bucket.push_back(i);
+		}
+	}
+
+	// border and non-manifold edges of the position mesh lock their points.
+	std::vector<uint8_t> locked(vertexCount, 0);
+	{
+		std::unordered_map<uint64_t, int32_t> edgeCounts;
+		edgeCounts.reserve(triangleCount * 3);
+		for (int32_t i = 0; i < triangleCount; ++i)
+		{
+			for (int32_t j = 0; j < 3; ++j)
+			{
+				uint32_t a = positionRep[indices[i * 3 + j]];
+				uint32_t b = positionRep[indices[i * 3 + (j + 1) % 3]];
+				uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+				edgeCounts[key] += 1;
+			}
+		}
+
+		for (auto it = edgeCounts.begin(); it != edgeCounts.end(); ++it)
+		{
+			if (it->second != 2)
+			{
+				locked[it->first >> 32] = 1;
+				locked[it->first & 0xFFFFFFFF] = 1;
+			}
+		}
+	}
+
+	// area weighted plane quadrics per point
+	std::vector<VKQuadric> quadrics(vertexCount);
+	float boundsMin[3] = { positions[0], positions[1], positions[2] };
+	float boundsMax[3] = { positions[0], positions[1], positions[2] };
+	for (int32_t i = 0; i < vertexCount; ++i)
+	{
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			boundsMin[k] = std::min(boundsMin[k], positions[i * 3 + k]);
+			boundsMax[k] = std::max(boundsMax[k], positions[i * 3 + k]);
+		}
+	}
+
+	for (int32_t i = 0; i < triangleCount; ++i)
+	{
+		const float* p0 = positions.data() + indices[i * 3 + 0] * 3;
+		const float* p1 = positions.data() + indices[i * 3 + 1] * 3;
+		const float* p2 = positions.data() + indices[i * 3 + 2] * 3;
+
+		float n[3];
+		TriangleNormal(p0, p1, p2, n);
+		double length = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+		if (length <= 0.0) {
+			continue;
+		}
+
+		double a = n[0] / length;
+		double b = n[1] / length;
+		double c = n[2] / length;
+		double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+		double area = length * 0.5;
+
+		for (int32_t k = 0; k < 3; ++k) {
+			quadrics[positionRep[indices[i * 3 + k]]].AddPlane(a, b, c, d, area);
+		}
+	}
+
+	double diagonal2 =
+		(boundsMax[0] - boundsMin[0]) * (boundsMax[0] - boundsMin[0]) +
+		(boundsMax[1] - boundsMin[1]) * (boundsMax[1] - boundsMin[1]) +
+		(boundsMax[2] - boundsMin[2]) * (boundsMax[2] - boundsMin[2]);
+	double bonePenalty = diagonal2 * 0.01;
+
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+	std::vector<uint8_t> triangleAlive(triangleCount, 1);
+	std::vector<std::vector<uint32_t>> adjacency(vertexCount);
+	for (int32_t i = 0; i < triangleCount * 3; ++i) {
+		adjacency[positionRep[triangles[i]]].push_back(i / 3);
+	}
+
+	std::vector<uint8_t> removed(vertexCount, 0);
+	std::vector<uint32_t> stamps(vertexCount, 0);
+	std::priority_queue<VKCollapse> queue;
+
+	auto pushCollapse = [&](uint32_t from, uint32_t to) {
+		if (locked[from] || from == to) {
+			return;
+		}
+
+		VKQuadric quadric = quadrics[from];
+		quadric.Add(quadrics[to]);
+
+		VKCollapse collapse;
+		collapse.cost = quadric.Evaluate(positions.data() + to * 3);
+		if (boneKeys && (*boneKeys)[from] != (*boneKeys)[to]) {
+			collapse.cost += bonePenalty;
+		}
+		collapse.from = from;
+		collapse.to = to;
+		collapse.fromStamp = stamps[from];
+		collapse.toStamp = stamps[to];
+		queue.push(collapse);
+	};
+
+	for (int32_t i = 0; i < triangleCount; ++i)
+	{
+		for (int32_t j = 0; j < 3; ++j)
+		{
+			uint32_t a = positionRep[triangles[i * 3 + j]];
+			uint32_t b = positionRep[triangles[i * 3 + (j + 1) % 3]];
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	int32_t aliveCount = triangleCount;
+	double maxCost = 0.0;
+	std::vector<std::pair<uint32_t, uint32_t>> mapping;
+
+	while (aliveCount > targetTriangleCount && !queue.empty())
+	{
+		VKCollapse collapse = queue.top();
+		queue.pop();
+
+		uint32_t from = collapse.from;
+		uint32_t to = collapse.to;
+		if (removed[from] || removed[to] || stamps[from] != collapse.fromStamp || stamps[to] != collapse.toStamp) {
+			continue;
+		}
+
+		// attribute seams may only collapse along themselves.
+		if (!MapCollapse(triangles, triangleAlive, adjacency[from], positionRep, from, to, mapping)) {
+			continue;
+		}
+
+		// reject collapses that flip a remaining triangle.
+		bool flipped = false;
+		for (int32_t i = 0; i < adjacency[from].size() && !flipped; ++i)
+		{
+			uint32_t triangle = adjacency[from][i];
+			uint32_t* tri = triangles.data() + triangle * 3;
+			if (!triangleAlive[triangle] || positionRep[tri[0]] == to || positionRep[tri[1]] == to || positionRep[tri[2]] == to) {
+				continue;
+			}
+
+			float before[3];
+			float after[3];
+			TriangleNormal(positions.data() + tri[0] * 3, positions.data() + tri[1] * 3, positions.data() + tri[2] * 3, before);
+			const float* p[3];
+			for (int32_t k = 0; k < 3; ++k) {
+				p[k] = positions.data() + (positionRep[tri[k]] == from ? to : tri[k]) * 3;
+			}
+			TriangleNormal(p[0], p[1], p[2], after);
+
+			flipped = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f;
+		}
+
+		if (flipped) {
+			continue;
+		}
+
+		for (int32_t i = 0; i < adjacency[from].size(); ++i)
+		{
+			uint32_t triangle = adjacency[from][i];
+			if (!triangleAlive[triangle]) {
+				continue;
+			}
+
+			uint32_t* tri = triangles.data() + triangle * 3;
+			if (positionRep[tri[0]] == to || positionRep[tri[1]] == to || positionRep[tri[2]] == to)
+			{
+				triangleAlive[triangle] = 0;
+				aliveCount -= 1;
+				continue;
+			}
+
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				if (positionRep[tri[k]] != from) {
+					continue;
+				}
+				for (int32_t m = 0; m < mapping.size(); ++m)
+				{
+					if (mapping[m].first == tri[k])
+					{
+						tri[k] = mapping[m].second;
+						break;
+					}
+				}
+			}
+			adjacency[to].push_back(triangle);
+		}
+
+		quadrics[to].Add(quadrics[from]);
+		removed[from] = 1;
+		adjacency[from].clear();
+		maxCost = std::max(maxCost, collapse.cost);
+
+		// the quadric of `to` changed, invalidate and requeue every edge touching it.
+		std::vector<uint32_t>& toTriangles = adjacency[to];
+		int32_t aliveTriangles = 0;
+		for (int32_t i = 0; i < toTriangles.size(); ++i)
+		{
+			if (triangleAlive[toTriangles[i]]) {
+				toTriangles[aliveTriangles++] = toTriangles[i];
+			}
+		}
+		toTriangles.resize(aliveTriangles);
+
+		stamps[to] += 1;
+		for (int32_t i = 0; i < toTriangles.size(); ++i)
+		{
+			uint32_t* tri = triangles.data() + toTriangles[i] * 3;
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				uint32_t other = positionRep[tri[k]];
+				if (other != to)
+				{
+					pushCollapse(to, other);
+					pushCollapse(other, to);
+				}
+			}
+		}
+	}
+
+	outIndices.reserve(aliveCount * 3);
+	for (int32_t i = 0; i < triangleCount; ++i)
+	{
+		if (triangleAlive[i]) {
+			outIndices.insert(outIndices.end(), triangles.begin() + i * 3, triangles.begin() + i * 3 + 3);
+		}
+	}
+
+	return (float)sqrt(maxCost);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Quadric error metric simplification (Garland-Heckbert) by half-edge collapses, so the result
+// only references existing vertices and every LOD can share the original vertex buffer.
+// Collapses run on positions, vertices sharing one move together. Attribute seams (same position,
+// different vertices) only collapse along the seam, border points are never moved. Weld identical
+// vertices first (VKMeshOptimizer::GenerateWeldRemap), duplicates count as seams.
+class VKMeshSimplifier
+{
+public:
+	// positions holds 3 floats per vertex. boneKeys (optional, one per vertex) is the dominant bone,
+	// collapses across different bones are penalized so skinned regions do not bleed into each other.
+	// returns the largest collapse error as a distance in model units.
+	static float Simplify(const std::vector<uint32_t>& indices, const std::vector<float>& positions, const std::vector<int32_t>* boneKeys, int32_t targetTriangleCount, std::vector<uint32_t>& outIndices);
+};
@@ -0,0 +1,306 @@
+#include "stdafx.h"
+#include "VKMeshlet.h"
+#include "VKCamera.h"
+#include "Plane.h"
+#include "Time.h"
+
+static void FinalizeMeshlet(VKMeshlet& meshlet, const std::vector<uint32_t>& meshletVertices, const std::vector<uint32_t>& meshletTriangles, const std::vector<uint32_t>& indices, const std::vector<float>& positions)
+{
+	meshlet.vertexCount = meshletVertices.size();
+
+	// sphere around the box center
+	Vector3 bmin(positions[meshletVertices[0] * 3 + 0], positions[meshletVertices[0] * 3 + 1], positions[meshletVertices[0] * 3 + 2]);
+	Vector3 bmax = bmin;
+	for (int32_t i = 1; i < meshletVertices.size(); ++i)
+	{
+		const float* p = positions.data() + meshletVertices[i] * 3;
+		bmin.Set(std::min(bmin.x, p[0]), std::min(bmin.y, p[1]), std::min(bmin.z, p[2]));
+		bmax.Set(std::max(bmax.x, p[0]), std::max(bmax.y, p[1]), std::max(bmax.z, p[2]));
+	}
+
+	meshlet.center = (bmin + bmax) * 0.5f;
+	float radius2 = 0.0f;
+	for (int32_t i = 0; i < meshletVertices.size(); ++i)
+	{
+		const float* p = positions.data() + meshletVertices[i] * 3;
+		Vector3 delta(p[0] - meshlet.center.x, p[1] - meshlet.center.y, p[2] - meshlet.center.z);
+		radius2 = std::max(radius2, delta.SizeSquared());
+	}
+	meshlet.radius = sqrtf(radius2);
+
+	// normal cone
+	std::vector<Vector3> normals;
+	normals.reserve(meshletTriangles.size());
+	Vector3 axis(0.0f, 0.0f, 0.0f);
+	for (int32_t i = 0; i < meshletTriangles.size(); ++i)
+	{
+		const float* p0 = positions.data() + indices[meshletTriangles[i] * 3 + 0] * 3;
+		const float* p1 = positions.data() + indices[meshletTriangles[i] * 3 + 1] * 3;
+		const float* p2 = positions.data() + indices[meshletTriangles[i] * 3 + 2] * 3;
+		Vector3 e1(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+		Vector3 e2(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+		Vector3 normal = e1 ^ e2;
+		float length = normal.Size();
+		if (length <= 0.0f) {
+			continue;
+		}
+		normal = normal / length;
+		normals.push_back(normal);
+		axis += normal;
+	}
+
+	meshlet.coneCutoff = 1.0f;
+	meshlet.coneAxis.Set(0.0f, 0.0f, 1.0f);
+
+	float axisLength = axis.Size();
+	if (axisLength <= 0.0f || normals.size() == 0) {
+		return;
+	}
+	axis = axis / axisLength;
+
+	float minDot = 1.0f;
+	for (int32_t i = 0; i < normals.size(); ++i) {
+		minDot = std::min(minDot, normals[i] | axis);
+	}
+
+	// wider than ~84 degrees never culls enough to pay for the test.
+	meshlet.coneAxis = axis;
+	if (minDot > 0.1f) {
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+void VKMeshletBuilder::Build(std::vector<uint32_t>& indices, const std::vector<float>& positions, std::vector<VKMeshlet>& outMeshlets, int32_t maxVertices, int32_t maxTriangles)
+{
+	outMeshlets.clear();
+
+	int32_t triangleCount = indices.size() / 3;
+	int32_t vertexCount = positions.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (int32_t i = 0; i < triangleCount * 3; ++i) {
+		offsets[indices[i] + 1] += 1;
+	}
+	for (int32_t i = 0; i < vertexCount; ++i) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (int32_t i = 0; i < triangleCount * 3; ++i) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<uint8_t> used(triangleCount, 0);
+	std::vector<int32_t> vertexOwner(vertexCount, -1);
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	int32_t cursor = 0;
+	while (true)
+	{
+		while (cursor < triangleCount && used[cursor]) {
+			cursor += 1;
+		}
+		if (cursor == triangleCount) {
+			break;
+		}
+
+		int32_t meshletIndex = outMeshlets.size();
+		meshletVertices.clear();
+		meshletTriangles.clear();
+
+		int32_t next = cursor;
+		while (next >= 0)
+		{
+			used[next] = 1;
+			meshletTriangles.push_back(next);
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[next * 3 + k];
+				if (vertexOwner[v] != meshletIndex)
+				{
+					vertexOwner[v] = meshletIndex;
+					meshletVertices.push_back(v);
+				}
+			}
+
+			if (meshletTriangles.size() >= maxTriangles) {
+				break;
+			}
+
+			// grow over the neighbour that adds the fewest new vertices.
+			next = -1;
+			int32_t bestNew = 4;
+			for (int32_t i = 0; i < meshletVertices.size() && bestNew > 0; ++i)
+			{
+				uint32_t v = meshletVertices[i];
+				for (uint32_t j = offsets[v]; j < offsets[v + 1]; ++j)
+				{
+					uint32_t triangle = adjacency[j];
+					if (used[triangle]) {
+						continue;
+					}
+
+					int32_t newCount = 0;
+					for (int32_t k = 0; k < 3; ++k) {
+						newCount += vertexOwner[indices[triangle * 3 + k]] != meshletIndex ? 1 : 0;
+					}
+
+					if (meshletVertices.size() + newCount <= maxVertices && newCount < bestNew)
+					{
+						bestNew = newCount;
+						next = triangle;
+						if (newCount == 0) {
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		VKMeshlet meshlet;
+		meshlet.firstIndex = output.size();
+		meshlet.indexCount = meshletTriangles.size() * 3;
+		FinalizeMeshlet(meshlet, meshletVertices, meshletTriangles, indices, positions);
+		outMeshlets.push_back(meshlet);
+
+		for (int32_t i = 0; i < meshletTriangles.size(); ++i) {
+			output.insert(output.end(), indices.begin() + meshletTriangles[i] * 3, indices.begin() + meshletTriangles[i] * 3 + 3);
+		}
+	}
+
+	indices.swap(output);
+}
+
+void VKMeshletCuller::Setup(const Matrix4x4& world, VKCamera& camera)
+{
+	// planes of the model-view-projection are already in model space.
+	Matrix4x4 mvp = world;
+	mvp.Append(camera.GetViewProjection());
+
+	Plane planes[6];
+	mvp.GetFrustumNearPlane(planes[0]);
+	mvp.GetFrustumFarPlane(planes[1]);
+	mvp.GetFrustumLeftPlane(planes[2]);
+	mvp.GetFrustumRightPlane(planes[3]);
+	mvp.GetFrustumTopPlane(planes[4]);
+	mvp.GetFrustumBottomPlane(planes[5]);
+
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		m_Planes[i][0] = planes[i].x;
+		m_Planes[i][1] = planes[i].y;
+		m_Planes[i][2] = planes[i].z;
+		m_Planes[i][3] = planes[i].w;
+	}
+
+	m_Eye = world.InverseTransformPosition(camera.GetTransform().GetOrigin());
+}
+
+bool VKMeshletCuller::IsVisible(const VKMeshlet& meshlet) const
+{
+	const Vector3& center = meshlet.center;
+
+	if (frustumCulling)
+	{
+		// outward normals, PlaneDot > radius is fully outside.
+		for (int32_t i = 0; i < 6; ++i)
+		{
+			float dist = m_Planes[i][0] * center.x + m_Planes[i][1] * center.y + m_Planes[i][2] * center.z - m_Planes[i][3];
+			if (dist > meshlet.radius) {
+				return false;
+			}
+		}
+	}
+
+	if (coneCulling && meshlet.coneCutoff < 1.0f)
+	{
+		Vector3 view = center - m_Eye;
+		if ((view | meshlet.coneAxis) >= meshlet.coneCutoff * view.Size() + meshlet.radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void VKMeshletCuller::Cull(const std::vector<VKMeshlet>& meshlets, std::vector<VkDrawIndexedIndirectCommand>& outCommands, uint32_t instanceCount)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	outCommands.clear();
+	for (int32_t i = 0; i < meshlets.size(); ++i)
+	{
+		const VKMeshlet& meshlet = meshlets[i];
+		stats.trianglesTested += meshlet.indexCount / 3;
+
+		if (!IsVisible(meshlet)) {
+			continue;
+		}
+
+		stats.clustersVisible += 1;
+		stats.trianglesVisible += meshlet.indexCount / 3;
+
+		if (outCommands.size() > 0 && outCommands.back().firstIndex + outCommands.back().indexCount == meshlet.firstIndex)
+		{
+			outCommands.back().indexCount += meshlet.indexCount;
+			continue;
+		}
+
+		VkDrawIndexedIndirectCommand command;
+		command.indexCount = meshlet.indexCount;
+		command.instanceCount = instanceCount;
+		command.firstIndex = meshlet.firstIndex;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+		outCommands.push_back(command);
+	}
+
+	stats.clustersTested += meshlets.size();
+	stats.cullTime += GenericPlatformTime::Seconds() - startTime;
+}
+
+void VKMeshletCuller::Cull(const std::vector<VKMeshlet>& meshlets, const uint32_t* indices, std::vector<uint32_t>& outIndices)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	outIndices.clear();
+	for (int32_t i = 0; i < meshlets.size(); ++i)
+	{
+		const VKMeshlet& meshlet = meshlets[i];
+		stats.trianglesTested += meshlet.indexCount / 3;
+
+		if (!IsVisible(meshlet)) {
+			continue;
+		}
+
+		stats.clustersVisible += 1;
+		stats.trianglesVisible += meshlet.indexCount / 3;
+		outIndices.insert(outIndices.end(), indices + meshlet.firstIndex, indices + meshlet.firstIndex + meshlet.indexCount);
+	}
+
+	stats.clustersTested += meshlets.size();
+	stats.cullTime += GenericPlatformTime::Seconds() - startTime;
+}
+
+void VKMeshletCuller::ResetStats()
+{
+	stats = Stats();
+}
+
+void VKMeshletCuller::LogStats() const
+{
+	MLOG(
+		"Meshlet cull: %lld/%lld clusters, %lld/%lld triangles (%.1f%% removed), %.0f clusters/ms",
+		stats.clustersVisible, stats.clustersTested,
+		stats.trianglesVisible, stats.trianglesTested,
+		stats.trianglesTested > 0 ? 100.0 * (stats.trianglesTested - stats.trianglesVisible) / stats.trianglesTested : 0.0,
+		stats.ClustersPerMS()
+	);
+}
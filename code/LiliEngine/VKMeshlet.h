@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "VulkanGlobals.h"
+
+class VKCamera;
+
+// A cluster of triangles stored as a contiguous range of its primitive's index buffer,
+// with a bounding sphere and a normal cone for culling, all in model space.
+struct VKMeshlet
+{
+	uint32_t	firstIndex = 0;
+	uint32_t	indexCount = 0;
+	uint32_t	vertexCount = 0;
+	float		radius = 0.0f;
+	Vector3		center;
+	// back facing from positions where dot(center - eye, coneAxis) >= coneCutoff * |center - eye| + radius.
+	// coneCutoff = 1 disables the test for clusters whose normals spread too far.
+	Vector3		coneAxis;
+	float		coneCutoff = 1.0f;
+};
+
+class VKMeshletBuilder
+{
+public:
+	static const int32_t MAX_VERTICES = 64;
+	static const int32_t MAX_TRIANGLES = 124;
+
+	// grows clusters over shared vertices and reorders indices so every meshlet is a contiguous range.
+	// positions holds 3 floats per vertex.
+	static void Build(std::vector<uint32_t>& indices, const std::vector<float>& positions, std::vector<VKMeshlet>& outMeshlets, int32_t maxVertices = MAX_VERTICES, int32_t maxTriangles = MAX_TRIANGLES);
+};
+
+// Frustum and backface cone culling of meshlets on the CPU.
+class VKMeshletCuller
+{
+public:
+	struct Stats
+	{
+		int64_t		clustersTested = 0;
+		int64_t		clustersVisible = 0;
+		int64_t		trianglesTested = 0;
+		int64_t		trianglesVisible = 0;
+		double		cullTime = 0.0;
+
+		inline double ClustersPerMS() const
+		{
+			return cullTime > 0.0 ? clustersTested / (cullTime * 1000.0) : 0.0;
+		}
+	};
+
+	// prepares model space planes and eye position for the following Cull calls.
+	void Setup(const Matrix4x4& world, VKCamera& camera);
+
+	bool IsVisible(const VKMeshlet& meshlet) const;
+
+	// visible meshlets as indexed indirect commands, neighbouring ranges are merged.
+	void Cull(const std::vector<VKMeshlet>& meshlets, std::vector<VkDrawIndexedIndirectCommand>& outCommands, uint32_t instanceCount = 1);
+
+	// visible meshlets as a compact index list.
+	void Cull(const std::vector<VKMeshlet>& meshlets, const uint32_t* indices, std::vector<uint32_t>& outIndices);
+
+	void ResetStats();
+
+	void LogStats() const;
+
+public:
+	Stats		stats;
+	bool		frustumCulling = true;
+	bool		coneCulling = true;
+
+private:
+	float		m_Planes[6][4];
+	Vector3		m_Eye;
+};
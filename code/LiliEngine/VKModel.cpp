@@ -2,6 +2,12 @@
 #include "VKModel.h"
 #include "FileManager.h"
 #include "Matrix4x4.h"
+#include "VKModelCooker.h"
+#include "Time.h"
+#include "VertexPacking.h"
+#include "VKMeshSimplifier.h"
+#include "ThreadPool.h"
+#include "VKGLTFLoader.h"
 
 void SimplifyTexturePath(std::string& path)
 {
@@ -64,12 +70,39 @@ void FillMatrixWithAiMatrix(Matrix4x4& matrix, const aiMatrix4x4& aiMatrix)
     matrix.SetTransposed();
 }
 
-VKModel* VKModel::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<float>& vertices, const std::vector<uint16_t>& indices, const std::vector<VertexAttribute>& attributes)
+static bool IsSkinAttribute(VertexAttribute attribute)
 {
+    return attribute == VertexAttribute::VA_SkinIndex ||
+        attribute == VertexAttribute::VA_SkinWeight ||
+        attribute == VertexAttribute::VA_SkinPack ||
+        attribute == VertexAttribute::VA_SkinIndexUInt8 ||
+        attribute == VertexAttribute::VA_SkinWeightUNorm8 ||
+        attribute == VertexAttribute::VA_SkinWeightUNorm16 ||
+        attribute == VertexAttribute::VA_SkinIndex8 ||
+        attribute == VertexAttribute::VA_SkinWeight8;
+}
+
+static int32_t GetSkinInfluences(const std::vector<VertexAttribute>& attributes)
+{
+    for (int32_t i = 0; i < attributes.size(); ++i) {
+        if (attributes[i] == VertexAttribute::VA_SkinIndex8 || attributes[i] == VertexAttribute::VA_SkinWeight8) {
+            return 8;
+        }
+    }
+    return 4;
+}
+
+VKModel* VKModel::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const float> vertices, Span<const uint16_t> indices, const std::vector<VertexAttribute>& attributes, VKModelResidency residency)
+{
+    if (residency == VKModelResidency_CPUOnly) {
+        cmdBuffer = nullptr;
+    }
+
     VKModel* model = new VKModel();
     model->device = vulkanDevice;
     model->attributes = attributes;
     model->cmdBuffer = cmdBuffer;
+    model->residency = residency;
 
     int32_t stride = 0;
     for (int32_t i = 0; i < attributes.size(); ++i) {
@@ -77,17 +110,21 @@ VKModel* VKModel::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBu
     }
 
     VKPrimitive* primitive = new VKPrimitive();
-    primitive->vertices = vertices;
-    primitive->indices = indices;
-    primitive->vertexCount = vertices.size() / stride * 4;
+    primitive->vertexCount = vertices.length() / stride * 4;
+
+    if (residency != VKModelResidency_GPUOnly || cmdBuffer == nullptr)
+    {
+        primitive->vertices.assign(vertices.begin, vertices.end);
+        primitive->indices.assign(indices.begin, indices.end);
+    }
 
     if (cmdBuffer)
     {
-        if (vertices.size() > 0) {
-            primitive->vertexBuffer = VKVertexBuffer::Create(vulkanDevice, cmdBuffer, primitive->vertices, attributes);
+        if (vertices.length() > 0) {
+            primitive->vertexBuffer = VKVertexBuffer::Create(vulkanDevice, cmdBuffer, vertices, attributes);
         }
-        if (indices.size() > 0) {
-            primitive->indexBuffer = VKIndexBuffer::Create(vulkanDevice, cmdBuffer, primitive->indices);
+        if (indices.length() > 0) {
+            primitive->indexBuffer = VKIndexBuffer::Create(vulkanDevice, cmdBuffer, indices);
         }
     }
 
@@ -95,25 +132,34 @@ VKModel* VKModel::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBu
     mesh->primitives.push_back(primitive);
     mesh->bounding.min = Vector3(-1.0f, -1.0f, 0.0f);
     mesh->bounding.max = Vector3(1.0f, 1.0f, 0.0f);
+    mesh->bounding.UpdateCorners();
+    mesh->sphere.center = mesh->bounding.GetCenter();
+    mesh->sphere.radius = mesh->bounding.GetExtent().Size();
+    mesh->orientedBox = VKBounds::ToOrientedBox(mesh->bounding);
 
     VKNode* rootNode = new VKNode();
     rootNode->name = "RootNode";
     rootNode->meshes.push_back(mesh);
-    rootNode->localMatrix.SetIdentity();
     mesh->linkNode = rootNode;
 
-    model->rootNode = rootNode;
+    model->AddNode(rootNode, nullptr, Matrix4x4());
     model->meshes.push_back(mesh);
 
     return model;
 }
 
-VKModel* VKModel::LoadFromFile(const std::string& filename, std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes)
+VKModel* VKModel::LoadFromFile(const std::string& filename, std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency)
 {
+    if (residency == VKModelResidency_CPUOnly) {
+        cmdBuffer = nullptr;
+    }
+
     VKModel* model = new VKModel();
     model->device = vulkanDevice;
     model->attributes = attributes;
     model->cmdBuffer = cmdBuffer;
+    model->importFlags = importFlags;
+    model->residency = residency;
 
     int assimpFlags = aiProcess_Triangulate | aiProcess_FlipUVs;
 
@@ -127,35 +173,136 @@ VKModel* VKModel::LoadFromFile(const std::string& filename, std::shared_ptr<Vulk
         else if (attributes[i] == VertexAttribute::VA_Normal) {
             assimpFlags = assimpFlags | aiProcess_GenSmoothNormals;
         }
-        else if (attributes[i] == VertexAttribute::VA_SkinIndex) {
-            model->loadSkin = true;
+        else if (attributes[i] == VertexAttribute::VA_TangentOct) {
+            assimpFlags = assimpFlags | aiProcess_CalcTangentSpace;
         }
-        else if (attributes[i] == VertexAttribute::VA_SkinWeight) {
-            model->loadSkin = true;
+        else if (attributes[i] == VertexAttribute::VA_UV0UNorm16) {
+            assimpFlags = assimpFlags | aiProcess_GenUVCoords;
+        }
+        else if (attributes[i] == VertexAttribute::VA_NormalOct) {
+            assimpFlags = assimpFlags | aiProcess_GenSmoothNormals;
         }
-        else if (attributes[i] == VertexAttribute::VA_SkinPack) {
+        else if (IsSkinAttribute(attributes[i])) {
             model->loadSkin = true;
         }
     }
 
-    uint32_t dataSize = 0;
-    uint8_t* dataPtr = nullptr;
-    if (!FileManager::ReadFile(filename, dataPtr, dataSize)) {
+    double startTime = GenericPlatformTime::Seconds();
+
+    std::string cookedPath = VKModelCooker::GetCookedPath(filename, attributes, importFlags);
+    if (VKModelCooker::Load(model, filename, cookedPath))
+    {
+        if (residency == VKModelResidency_GPUOnly) {
+            model->ReleaseCPUData();
+        }
+        MLOG("Model %s loaded from cooked data in %.2fms, %d draws, %.2fMB CPU data", filename.c_str(), (GenericPlatformTime::Seconds() - startTime) * 1000.0, model->GetPrimitiveCount(), model->GetCPUBytes() / (1024.0 * 1024.0));
         return model;
     }
 
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFileFromMemory(dataPtr, dataSize, assimpFlags);
+    // partially loaded cooked data is thrown away.
+    model->ClearContents();
+
+    bool loaded = false;
+    if (!(importFlags & VKModelImport_AssimpOnly) && VKGLTFLoader::IsGLBFile(filename))
+    {
+        loaded = VKGLTFLoader::Load(model, filename);
+        if (loaded) {
+            MLOG("Model %s loaded natively in %.2fms, %d draws", filename.c_str(), (GenericPlatformTime::Seconds() - startTime) * 1000.0, model->GetPrimitiveCount());
+        }
+        else {
+            MLOG("Model %s falls back to Assimp.", filename.c_str());
+            model->ClearContents();
+        }
+    }
+
+    if (!loaded)
+    {
+        uint32_t dataSize = 0;
+        uint8_t* dataPtr = nullptr;
+        if (!FileManager::ReadFile(filename, dataPtr, dataSize)) {
+            return model;
+        }
+
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFileFromMemory(dataPtr, dataSize, assimpFlags);
+
+        std::vector<MeshJob> meshJobs;
+        model->LoadBones(scene);
+        model->LoadNode(scene->mRootNode, nullptr, scene, meshJobs);
+        model->LoadMeshes(meshJobs, scene);
+        model->LoadAnim(scene);
+
+        delete[] dataPtr;
+
+        MLOG("Model %s imported in %.2fms, %d draws", filename.c_str(), (GenericPlatformTime::Seconds() - startTime) * 1000.0, model->GetPrimitiveCount());
+    }
+
+    if (importFlags & VKModelImport_Optimize)
+    {
+        MLOG("Model %s vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, vertices %d -> %d",
+            filename.c_str(),
+            model->cacheStatsBefore.ACMR(), model->cacheStatsAfter.ACMR(),
+            model->cacheStatsBefore.ATVR(), model->cacheStatsAfter.ATVR(),
+            model->cacheStatsBefore.vertexCount, model->cacheStatsAfter.vertexCount
+        );
+    }
 
-    model->LoadBones(scene);
-    model->LoadNode(scene->mRootNode, scene);
-    model->LoadAnim(scene);
+    VKModelCooker::Save(model, filename, cookedPath);
 
-    delete[] dataPtr;
+    // released only after saving, the cooker writes the CPU copies.
+    if (residency == VKModelResidency_GPUOnly) {
+        model->ReleaseCPUData();
+    }
+    MLOG("Model %s keeps %.2fMB CPU data", filename.c_str(), model->GetCPUBytes() / (1024.0 * 1024.0));
 
     return model;
 }
 
+void VKModel::ClearContents()
+{
+    delete rootNode;
+    rootNode = nullptr;
+
+    meshes.clear();
+    linearNodes.clear();
+    nodesMap.clear();
+    transforms.Clear();
+
+    for (int32_t i = 0; i < bones.size(); ++i) {
+        delete bones[i];
+    }
+    bones.clear();
+    bonesMap.clear();
+
+    animations.clear();
+    animIndex = -1;
+
+    cacheStatsBefore = VKVertexCacheStats();
+    cacheStatsAfter = VKVertexCacheStats();
+}
+
+int32_t VKModel::GetMaxSkinInfluences() const
+{
+    return GetSkinInfluences(attributes);
+}
+
+void VKModel::AddNode(VKNode* node, VKNode* parent, const Matrix4x4& localMatrix)
+{
+    node->parent = parent;
+    node->transforms = &transforms;
+    node->transformIndex = transforms.Add(parent ? parent->transformIndex : -1, localMatrix);
+
+    if (parent) {
+        parent->children.push_back(node);
+    }
+    else if (rootNode == nullptr) {
+        rootNode = node;
+    }
+
+    nodesMap.insert(std::make_pair(node->name, node));
+    linearNodes.push_back(node);
+}
+
 void VKModel::LoadBones(const aiScene* aiScene)
 {
     std::unordered_map<std::string, int32_t> boneIndexMap;
@@ -187,15 +334,22 @@ void VKModel::LoadBones(const aiScene* aiScene)
     }
 }
 
-void VKModel::LoadSkin(std::unordered_map<uint32_t, VKVertexSkin>& skinInfoMap, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene)
+void VKModel::LoadSkin(std::vector<VKVertexSkin>& outSkins, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene)
 {
+    const int32_t count = aiMesh->mNumVertices;
+    const int32_t maxInfluences = GetSkinInfluences(attributes);
+
+    outSkins.clear();
+    outSkins.resize(count);
+
     std::unordered_map<int32_t, int32_t> boneIndexMap;
 
     for (int32_t i = 0; i < aiMesh->mNumBones; ++i)
     {
         aiBone* boneInfo = aiMesh->mBones[i];
         std::string boneName(boneInfo->mName.C_Str());
-        int32_t boneIndex = bonesMap[boneName]->index;
+        // find instead of operator[], meshes are loaded concurrently.
+        int32_t boneIndex = bonesMap.find(boneName)->second->index;
 
         // bone在mesh中的索引
         int32_t meshBoneIndex = 0;
@@ -215,36 +369,458 @@ void VKModel::LoadSkin(std::unordered_map<uint32_t, VKVertexSkin>& skinInfoMap,
         {
             uint32_t vertexID = boneInfo->mWeights[j].mVertexId;
             float  weight = boneInfo->mWeights[j].mWeight;
-            // 顶点->Bone
-            if (skinInfoMap.find(vertexID) == skinInfoMap.end()) {
-                skinInfoMap.insert(std::make_pair(vertexID, VKVertexSkin()));
-            }
-            VKVertexSkin* info = &(skinInfoMap[vertexID]);
-            info->indices[info->used] = meshBoneIndex;
-            info->weights[info->used] = weight;
-            info->used += 1;
-            // 只允许最多四个骨骼影响顶点
-            if (info->used >= 4) {
+            if (vertexID < count && weight > 0.0f) {
+                outSkins[vertexID].Add(meshBoneIndex, weight, maxInfluences);
+            }
+        }
+    }
+
+    mesh->isSkin = true;
+}
+
+// writes every skin attribute of the layout in one pass over the vertices, skins == nullptr writes bone 0 with full weight.
+static void PackSkinStreams(float* vertices, int32_t stride, const std::vector<VertexAttribute>& attributes, const VKVertexSkin* skins, int32_t count)
+{
+    std::vector<VertexAttribute> streams;
+    std::vector<int32_t> offsets;
+    bool needs8 = false;
+
+    int32_t offset = 0;
+    for (int32_t i = 0; i < attributes.size(); ++i)
+    {
+        if (IsSkinAttribute(attributes[i]))
+        {
+            streams.push_back(attributes[i]);
+            offsets.push_back(offset);
+            needs8 = needs8 || attributes[i] == VertexAttribute::VA_SkinIndex8 || attributes[i] == VertexAttribute::VA_SkinWeight8;
+        }
+        offset += VertexAttributeToSize(attributes[i]) / sizeof(float);
+    }
+
+    if (streams.size() == 0) {
+        return;
+    }
+
+    VKVertexSkin defaultSkin;
+    int32_t indices4[4];
+    float weights4[4];
+    int32_t indices8[8];
+    float weights8[8];
+
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const VKVertexSkin& skin = skins ? skins[i] : defaultSkin;
+        skin.GetNormalized(4, indices4, weights4);
+        if (needs8) {
+            skin.GetNormalized(8, indices8, weights8);
+        }
+
+        float* vertex = vertices + i * stride;
+        for (int32_t j = 0; j < streams.size(); ++j)
+        {
+            float* dst = vertex + offsets[j];
+            switch (streams[j])
+            {
+            case VertexAttribute::VA_SkinIndex:
+            {
+                for (int32_t k = 0; k < 4; ++k) {
+                    dst[k] = indices4[k];
+                }
+                break;
+            }
+            case VertexAttribute::VA_SkinWeight:
+            {
+                memcpy(dst, weights4, sizeof(weights4));
+                break;
+            }
+            case VertexAttribute::VA_SkinPack:
+            {
+                uint32_t packIndex = (indices4[0] << 24) + (indices4[1] << 16) + (indices4[2] << 8) + indices4[3];
+
+                uint16_t weight0 = weights4[0] * 65535;
+                uint16_t weight1 = weights4[1] * 65535;
+                uint16_t weight2 = weights4[2] * 65535;
+                uint16_t weight3 = weights4[3] * 65535;
+                uint32_t packWeight0 = (weight0 << 16) + weight1;
+                uint32_t packWeight1 = (weight2 << 16) + weight3;
+
+                dst[0] = packIndex;
+                dst[1] = packWeight0;
+                dst[2] = packWeight1;
                 break;
             }
+            case VertexAttribute::VA_SkinIndexUInt8:
+            {
+                uint8_t packed[4] = { (uint8_t)indices4[0], (uint8_t)indices4[1], (uint8_t)indices4[2], (uint8_t)indices4[3] };
+                memcpy(dst, packed, sizeof(packed));
+                break;
+            }
+            case VertexAttribute::VA_SkinWeightUNorm8:
+            {
+                uint32_t quantized[4];
+                QuantizeWeights(weights4, 255, quantized);
+                uint8_t packed[4] = { (uint8_t)quantized[0], (uint8_t)quantized[1], (uint8_t)quantized[2], (uint8_t)quantized[3] };
+                memcpy(dst, packed, sizeof(packed));
+                break;
+            }
+            case VertexAttribute::VA_SkinWeightUNorm16:
+            {
+                uint32_t quantized[4];
+                QuantizeWeights(weights4, 65535, quantized);
+                uint16_t packed[4] = { (uint16_t)quantized[0], (uint16_t)quantized[1], (uint16_t)quantized[2], (uint16_t)quantized[3] };
+                memcpy(dst, packed, sizeof(packed));
+                break;
+            }
+            case VertexAttribute::VA_SkinIndex8:
+            {
+                uint8_t packed[8];
+                for (int32_t k = 0; k < 8; ++k) {
+                    packed[k] = indices8[k];
+                }
+                memcpy(dst, packed, sizeof(packed));
+                break;
+            }
+            case VertexAttribute::VA_SkinWeight8:
+            {
+                uint32_t quantized[8];
+                QuantizeWeights(weights8, 8, 255, quantized);
+                uint8_t packed[8];
+                for (int32_t k = 0; k < 8; ++k) {
+                    packed[k] = quantized[k];
+                }
+                memcpy(dst, packed, sizeof(packed));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+}
+
+// stream kernels, each one writes a single attribute for every vertex into the presized interleaved buffer.
+static void CopyPositionStream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count, Vector3& outMin, Vector3& outMax)
+{
+    __m128 vmin = _mm_set_ps(0.0f, outMin.z, outMin.y, outMin.x);
+    __m128 vmax = _mm_set_ps(0.0f, outMax.z, outMax.y, outMax.x);
+
+    for (int32_t i = 0; i < count; ++i)
+    {
+        // the 4th lane reads into the next element (stride >= 12) and is never stored.
+        const float* p = src.Get(i);
+        __m128 pos = i + 1 < count ? _mm_loadu_ps(p) : _mm_set_ps(0.0f, p[2], p[1], p[0]);
+        vmin = _mm_min_ps(vmin, pos);
+        vmax = _mm_max_ps(vmax, pos);
+
+        _mm_storel_pi((__m64*)dst, pos);
+        _mm_store_ss(dst + 2, _mm_movehl_ps(pos, pos));
+        dst += stride;
+    }
+
+    float result[4];
+    _mm_storeu_ps(result, vmin);
+    outMin.Set(result[0], result[1], result[2]);
+    _mm_storeu_ps(result, vmax);
+    outMax.Set(result[0], result[1], result[2]);
+}
+
+static void CopyStream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count, int32_t components)
+{
+    if (components == 4)
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            _mm_storeu_ps(dst, _mm_loadu_ps(src.Get(i)));
+            dst += stride;
         }
+        return;
     }
 
-    // 再次处理一遍skinInfoMap，把未使用的补齐
-    for (auto it = skinInfoMap.begin(); it != skinInfoMap.end(); ++it)
+    // same 4th lane read as CopyPositionStream, only xyz are stored.
+    if (components == 3)
     {
-        VKVertexSkin& info = it->second;
-        for (int32_t i = info.used; i < 4; ++i)
+        for (int32_t i = 0; i < count; ++i)
         {
-            info.indices[i] = 0;
-            info.weights[i] = 0.0f;
+            const float* p = src.Get(i);
+            __m128 value = i + 1 < count ? _mm_loadu_ps(p) : _mm_set_ps(0.0f, p[2], p[1], p[0]);
+            _mm_storel_pi((__m64*)dst, value);
+            _mm_store_ss(dst + 2, _mm_movehl_ps(value, value));
+            dst += stride;
         }
+        return;
     }
 
-    mesh->isSkin = true;
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        for (int32_t j = 0; j < components; ++j) {
+            dst[j] = p[j];
+        }
+        dst += stride;
+    }
+}
+
+static void FillStream(float* dst, int32_t stride, const float* value, int32_t components, int32_t count)
+{
+    for (int32_t i = 0; i < count; ++i)
+    {
+        for (int32_t j = 0; j < components; ++j) {
+            dst[j] = value[j];
+        }
+        dst += stride;
+    }
+}
+
+static void FillBytesStream(float* dst, int32_t stride, const void* value, int32_t size, int32_t count)
+{
+    for (int32_t i = 0; i < count; ++i)
+    {
+        memcpy(dst, value, size);
+        dst += stride;
+    }
+}
+
+static void CalcPositionBounds(const VKVertexStream& src, int32_t count, Vector3& outMin, Vector3& outMax)
+{
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        outMin.Set(std::min(outMin.x, p[0]), std::min(outMin.y, p[1]), std::min(outMin.z, p[2]));
+        outMax.Set(std::max(outMax.x, p[0]), std::max(outMax.y, p[1]), std::max(outMax.z, p[2]));
+    }
+}
+
+// the packed positions below load like CopyPositionStream, w is set after packing.
+static void PackPositionSNorm16Stream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count, const Vector3& offset, const Vector3& scale)
+{
+    const __m128 vOffset = _mm_set_ps(0.0f, offset.z, offset.y, offset.x);
+    const __m128 vInvScale = _mm_set_ps(0.0f, 1.0f / scale.z, 1.0f / scale.y, 1.0f / scale.x);
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        __m128 pos = i + 1 < count ? _mm_loadu_ps(p) : _mm_set_ps(0.0f, p[2], p[1], p[0]);
+        __m128i quantized = QuantizeSNorm4(_mm_mul_ps(_mm_sub_ps(pos, vOffset), vInvScale), 32767.0f);
+
+        int16_t packed[8];
+        _mm_storeu_si128((__m128i*)packed, _mm_packs_epi32(quantized, quantized));
+        packed[3] = 32767;
+        memcpy(dst, packed, sizeof(int16_t) * 4);
+        dst += stride;
+    }
+}
+
+static void PackPositionHalfStream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count)
+{
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        __m128 pos = i + 1 < count ? _mm_loadu_ps(p) : _mm_set_ps(0.0f, p[2], p[1], p[0]);
+        __m128i half = FloatToHalf4(pos);
+
+        uint16_t packed[8];
+        _mm_storeu_si128((__m128i*)packed, _mm_packs_epi32(half, half));
+        packed[3] = 0x3C00;
+        memcpy(dst, packed, sizeof(uint16_t) * 4);
+        dst += stride;
+    }
+}
+
+// 4 vectors per pass as x/y/z lanes. The 4th lane of the last load reads into element i + 4, the rest
+// of the stream goes through the scalar encoder.
+static void LoadVectors4(const VKVertexStream& src, int32_t first, __m128& outX, __m128& outY, __m128& outZ)
+{
+    __m128 v0 = _mm_loadu_ps(src.Get(first + 0));
+    __m128 v1 = _mm_loadu_ps(src.Get(first + 1));
+    __m128 v2 = _mm_loadu_ps(src.Get(first + 2));
+    __m128 v3 = _mm_loadu_ps(src.Get(first + 3));
+    _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+    outX = v0;
+    outY = v1;
+    outZ = v2;
+}
+
+static void PackNormalOctStream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count)
+{
+    int32_t i = 0;
+    for (; i + 4 < count; i += 4)
+    {
+        __m128 x, y, z, u, v;
+        LoadVectors4(src, i, x, y, z);
+        OctEncode4(x, y, z, u, v);
+
+        // u0 v0 u1 v1 ... as int16 pairs, one 32-bit word per vertex.
+        __m128i qu = QuantizeSNorm4(u, 32767.0f);
+        __m128i qv = QuantizeSNorm4(v, 32767.0f);
+        uint32_t words[4];
+        _mm_storeu_si128((__m128i*)words, _mm_packs_epi32(_mm_unpacklo_epi32(qu, qv), _mm_unpackhi_epi32(qu, qv)));
+        for (int32_t k = 0; k < 4; ++k)
+        {
+            memcpy(dst, &words[k], sizeof(uint32_t));
+            dst += stride;
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        float u, v;
+        OctEncode(p[0], p[1], p[2], u, v);
+        int16_t packed[2] = { QuantizeSNorm16(u), QuantizeSNorm16(v) };
+        memcpy(dst, packed, sizeof(packed));
+        dst += stride;
+    }
+}
+
+// tangent w is the handedness, taken from the stream or from normal and bitangent.
+static float GetTangentHandedness(const VKVertexStreams& streams, int32_t index)
+{
+    const float* t = streams.tangents.Get(index);
+    if (streams.tangentW) {
+        return t[3] < 0.0f ? -1.0f : 1.0f;
+    }
+
+    if (streams.normals.IsValid() && streams.bitangents.IsValid())
+    {
+        const float* n = streams.normals.Get(index);
+        const float* b = streams.bitangents.Get(index);
+        float c[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+        return c[0] * b[0] + c[1] * b[1] + c[2] * b[2] < 0.0f ? -1.0f : 1.0f;
+    }
+
+    return 1.0f;
+}
+
+static void PackTangentOctStream(float* dst, int32_t stride, const VKVertexStreams& streams, int32_t count)
+{
+    int32_t i = 0;
+    for (; i + 4 < count; i += 4)
+    {
+        __m128 x, y, z, u, v;
+        LoadVectors4(streams.tangents, i, x, y, z);
+        OctEncode4(x, y, z, u, v);
+
+        int32_t qu[4];
+        int32_t qv[4];
+        _mm_storeu_si128((__m128i*)qu, QuantizeSNorm4(u, 127.0f));
+        _mm_storeu_si128((__m128i*)qv, QuantizeSNorm4(v, 127.0f));
+        for (int32_t k = 0; k < 4; ++k)
+        {
+            int8_t packed[4] = { (int8_t)qu[k], (int8_t)qv[k], 0, QuantizeSNorm8(GetTangentHandedness(streams, i + k)) };
+            memcpy(dst, packed, sizeof(packed));
+            dst += stride;
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        const float* t = streams.tangents.Get(i);
+        float handedness = GetTangentHandedness(streams, i);
+
+        float u, v;
+        OctEncode(t[0], t[1], t[2], u, v);
+        int8_t packed[4] = { QuantizeSNorm8(u), QuantizeSNorm8(v), 0, QuantizeSNorm8(handedness) };
+        memcpy(dst, packed, sizeof(packed));
+        dst += stride;
+    }
 }
 
-void VKModel::LoadVertexDatas(std::unordered_map<uint32_t, VKVertexSkin>& skinInfoMap, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene)
+// UVs inside [0, 1] are stored as is, tiled or offset UVs are remapped from their range and the
+// returned (scale, offset) undoes it.
+static Vector4 PackUVUNorm16Stream(float* dst, int32_t stride, const VKVertexStream& src, int32_t count)
+{
+    float uvMin[2] = { MAX_flt, MAX_flt };
+    float uvMax[2] = { -MAX_flt, -MAX_flt };
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        for (int32_t k = 0; k < 2; ++k)
+        {
+            uvMin[k] = std::min(uvMin[k], p[k]);
+            uvMax[k] = std::max(uvMax[k], p[k]);
+        }
+    }
+
+    Vector4 dequantize(1.0f, 1.0f, 0.0f, 0.0f);
+    if (count > 0 && (uvMin[0] < 0.0f || uvMin[1] < 0.0f || uvMax[0] > 1.0f || uvMax[1] > 1.0f))
+    {
+        dequantize.Set(
+            uvMax[0] > uvMin[0] ? uvMax[0] - uvMin[0] : 1.0f,
+            uvMax[1] > uvMin[1] ? uvMax[1] - uvMin[1] : 1.0f,
+            uvMin[0],
+            uvMin[1]
+        );
+    }
+
+    const float invScale[2] = { 1.0f / dequantize.x, 1.0f / dequantize.y };
+    const __m128 vOffset = _mm_set_ps(dequantize.w, dequantize.z, dequantize.w, dequantize.z);
+    const __m128 vInvScale = _mm_set_ps(invScale[1], invScale[0], invScale[1], invScale[0]);
+
+    // two UVs per register, 4 vertices per pass.
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 uv01 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)src.Get(i + 0)), (const __m64*)src.Get(i + 1));
+        __m128 uv23 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)src.Get(i + 2)), (const __m64*)src.Get(i + 3));
+        uv01 = _mm_mul_ps(_mm_sub_ps(uv01, vOffset), vInvScale);
+        uv23 = _mm_mul_ps(_mm_sub_ps(uv23, vOffset), vInvScale);
+
+        uint32_t words[4];
+        _mm_storeu_si128((__m128i*)words, QuantizeUNorm16x8(uv01, uv23));
+        for (int32_t k = 0; k < 4; ++k)
+        {
+            memcpy(dst, &words[k], sizeof(uint32_t));
+            dst += stride;
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        const float* p = src.Get(i);
+        uint16_t packed[2] = {
+            QuantizeUNorm16((p[0] - dequantize.z) * invScale[0]),
+            QuantizeUNorm16((p[1] - dequantize.w) * invScale[1])
+        };
+        memcpy(dst, packed, sizeof(packed));
+        dst += stride;
+    }
+    return dequantize;
+}
+
+static VKVertexStreams GetVertexStreams(const aiMesh* aiMesh)
+{
+    VKVertexStreams streams;
+    streams.count = aiMesh->mNumVertices;
+    streams.positions = VKVertexStream(aiMesh->mVertices, sizeof(aiVector3D));
+
+    if (aiMesh->HasNormals()) {
+        streams.normals = VKVertexStream(aiMesh->mNormals, sizeof(aiVector3D));
+    }
+
+    if (aiMesh->HasTangentsAndBitangents())
+    {
+        streams.tangents = VKVertexStream(aiMesh->mTangents, sizeof(aiVector3D));
+        streams.bitangents = VKVertexStream(aiMesh->mBitangents, sizeof(aiVector3D));
+    }
+
+    for (int32_t i = 0; i < 2; ++i) {
+        if (aiMesh->HasTextureCoords(i)) {
+            streams.uvs[i] = VKVertexStream(aiMesh->mTextureCoords[i], sizeof(aiVector3D));
+        }
+    }
+
+    if (aiMesh->HasVertexColors(0)) {
+        streams.colors = VKVertexStream(aiMesh->mColors[0], sizeof(aiColor4D));
+    }
+
+    return streams;
+}
+
+void VKModel::LoadVertexDatas(const std::vector<VKVertexSkin>& skins, const VKVertexStreams& streams, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh)
+{
+    PackVertexStreams(attributes, skins, streams, vertices, mmax, mmin, mesh);
+}
+
+void VKModel::PackVertexStreams(const std::vector<VertexAttribute>& attributes, const std::vector<VKVertexSkin>& skins, const VKVertexStreams& streams, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh)
 {
     Vector3 defaultColor(
         math::RandRange(0.0f, 1.0f),
@@ -252,251 +828,529 @@ void VKModel::LoadVertexDatas(std::unordered_map<uint32_t, VKVertexSkin>& skinIn
         math::RandRange(0.0f, 1.0f)
     );
 
-    for (int32_t i = 0; i < aiMesh->mNumVertices; ++i)
+    const int32_t count = streams.count;
+
+    int32_t stride = 0;
+    for (int32_t i = 0; i < attributes.size(); ++i) {
+        stride += VertexAttributeToSize(attributes[i]) / sizeof(float);
+    }
+
+    vertices.resize(count * stride);
+
+    int32_t offset = 0;
+    for (int32_t j = 0; j < attributes.size(); ++j)
+    {
+        float* dst = vertices.data() + offset;
+        offset += VertexAttributeToSize(attributes[j]) / sizeof(float);
+
+        if (attributes[j] == VertexAttribute::VA_Position)
+        {
+            CopyPositionStream(dst, stride, streams.positions, count, mmin, mmax);
+        }
+        else if (attributes[j] == VertexAttribute::VA_UV0 || attributes[j] == VertexAttribute::VA_UV1)
+        {
+            int32_t channel = attributes[j] == VertexAttribute::VA_UV0 ? 0 : 1;
+            if (streams.uvs[channel].IsValid())
+            {
+                CopyStream(dst, stride, streams.uvs[channel], count, 2);
+            }
+            else
+            {
+                const float zero[2] = { 0.0f, 0.0f };
+                FillStream(dst, stride, zero, 2, count);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_Normal)
+        {
+            if (streams.normals.IsValid())
+            {
+                CopyStream(dst, stride, streams.normals, count, 3);
+            }
+            else
+            {
+                const float up[3] = { 0.0f, 1.0f, 0.0f };
+                FillStream(dst, stride, up, 3, count);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_Tangent)
+        {
+            const float tangentW[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+            FillStream(dst, stride, tangentW, 4, count);
+            if (streams.tangents.IsValid()) {
+                CopyStream(dst, stride, streams.tangents, count, streams.tangentW ? 4 : 3);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_Color)
+        {
+            if (streams.colors.IsValid())
+            {
+                CopyStream(dst, stride, streams.colors, count, 3);
+            }
+            else
+            {
+                const float color[3] = { defaultColor.x, defaultColor.y, defaultColor.z };
+                FillStream(dst, stride, color, 3, count);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_Custom0 ||
+            attributes[j] == VertexAttribute::VA_Custom1 ||
+            attributes[j] == VertexAttribute::VA_Custom2 ||
+            attributes[j] == VertexAttribute::VA_Custom3
+            )
+        {
+            const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            FillStream(dst, stride, zero, 4, count);
+        }
+        else if (attributes[j] == VertexAttribute::VA_PositionSNorm16)
+        {
+            CalcPositionBounds(streams.positions, count, mmin, mmax);
+
+            Vector3 extent = (mmax - mmin) * 0.5f;
+            mesh->positionOffset = (mmax + mmin) * 0.5f;
+            mesh->positionScale.Set(
+                extent.x > 0.0f ? extent.x : 1.0f,
+                extent.y > 0.0f ? extent.y : 1.0f,
+                extent.z > 0.0f ? extent.z : 1.0f
+            );
+
+            PackPositionSNorm16Stream(dst, stride, streams.positions, count, mesh->positionOffset, mesh->positionScale);
+        }
+        else if (attributes[j] == VertexAttribute::VA_PositionHalf)
+        {
+            CalcPositionBounds(streams.positions, count, mmin, mmax);
+            PackPositionHalfStream(dst, stride, streams.positions, count);
+        }
+        else if (attributes[j] == VertexAttribute::VA_NormalOct)
+        {
+            if (streams.normals.IsValid())
+            {
+                PackNormalOctStream(dst, stride, streams.normals, count);
+            }
+            else
+            {
+                // (0, 1, 0)
+                const int16_t up[2] = { 0, 32767 };
+                FillBytesStream(dst, stride, up, sizeof(up), count);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_TangentOct)
+        {
+            if (streams.tangents.IsValid())
+            {
+                PackTangentOctStream(dst, stride, streams, count);
+            }
+            else
+            {
+                // (1, 0, 0), w = 1
+                const int8_t tangent[4] = { 127, 0, 0, 127 };
+                FillBytesStream(dst, stride, tangent, sizeof(tangent), count);
+            }
+        }
+        else if (attributes[j] == VertexAttribute::VA_UV0UNorm16 || attributes[j] == VertexAttribute::VA_UV1UNorm16)
+        {
+            int32_t channel = attributes[j] == VertexAttribute::VA_UV0UNorm16 ? 0 : 1;
+            if (streams.uvs[channel].IsValid()) {
+                mesh->uvDequantize[channel] = PackUVUNorm16Stream(dst, stride, streams.uvs[channel], count);
+            }
+            else
+            {
+                const uint16_t zero[2] = { 0, 0 };
+                FillBytesStream(dst, stride, zero, sizeof(zero), count);
+            }
+        }
+    }
+
+    if (mesh->bones.size() > 256 && (std::find(attributes.begin(), attributes.end(), VertexAttribute::VA_SkinIndexUInt8) != attributes.end() || GetSkinInfluences(attributes) == 8)) {
+        MLOGE("Mesh uses %d bones, 8-bit skin indices can address 256.", (int32_t)mesh->bones.size());
+    }
+
+    PackSkinStreams(vertices.data(), stride, attributes, mesh->isSkin && skins.size() == count ? skins.data() : nullptr, count);
+}
+
+void VKModel::LoadBoundingVolumes(const VKVertexStreams& streams, const Vector3& mmin, const Vector3& mmax, VKMesh* mesh)
+{
+    mesh->bounding.min = mmin;
+    mesh->bounding.max = mmax;
+    mesh->bounding.UpdateCorners();
+
+    const float* positions = streams.positions.Get(0);
+    mesh->sphere = VKBounds::ComputeSphere(positions, streams.positions.stride, streams.count);
+
+    if (importFlags & VKModelImport_OrientedBounds) {
+        mesh->orientedBox = VKBounds::ComputeOrientedBox(positions, streams.positions.stride, streams.count);
+    }
+    else {
+        mesh->orientedBox = VKBounds::ToOrientedBox(mesh->bounding);
+    }
+}
+
+void VKModel::LoadTriangleBVH(const VKVertexStreams& streams, const std::vector<uint32_t>& indices, VKMesh* mesh)
+{
+    if ((importFlags & VKModelImport_TriangleBVH) == 0) {
+        return;
+    }
+
+    // triangle ids of hits are source faces, the optimizer has not reordered them yet.
+    VKTriangleBVH* triangleBVH = VKTriangleBVH::Create((const float*)streams.positions.data, streams.positions.stride, streams.count, indices.data(), indices.size());
+    mesh->triangleBVH.reset(triangleBVH);
+}
+
+void VKModel::LoadIndices(std::vector<uint32_t>& indices, const aiMesh* aiMesh, const aiScene* aiScene)
+{
+    for (int32_t i = 0; i < aiMesh->mNumFaces; ++i)
+    {
+        indices.push_back(aiMesh->mFaces[i].mIndices[0]);
+        indices.push_back(aiMesh->mFaces[i].mIndices[1]);
+        indices.push_back(aiMesh->mFaces[i].mIndices[2]);
+    }
+}
+
+void VKModel::LoadPrimitives(std::vector<float>& vertices, std::vector<uint32_t>& indices, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene)
+{
+    int32_t stride = GetInputBinding().stride / sizeof(float);
+    int32_t vertexCount = vertices.size() / stride;
+
+    if (vertexCount > 65535 && (importFlags & VKModelImport_Split16BitPrimitives))
     {
-        for (int32_t j = 0; j < attributes.size(); ++j)
+        // remapOwner marks which primitive a source vertex was last copied into.
+        std::vector<int32_t> remapOwner(vertexCount, -1);
+        std::vector<uint16_t> remapIndex(vertexCount, 0);
+        VKPrimitive* primitive = nullptr;
+        int32_t primitiveIndex = -1;
+
+        for (int32_t i = 0; i < indices.size(); i += 3)
         {
-            if (attributes[j] == VertexAttribute::VA_Position)
+            // a triangle adds at most 3 vertices, start a new primitive before the 16-bit range overflows.
+            if (primitive == nullptr || primitive->vertices.size() / stride + 3 > 65535)
+            {
+                primitive = new VKPrimitive();
+                primitiveIndex += 1;
+                mesh->primitives.push_back(primitive);
+            }
+
+            for (int32_t j = 0; j < 3; ++j)
             {
-                float v0 = aiMesh->mVertices[i].x;
-                float v1 = aiMesh->mVertices[i].y;
-                float v2 = aiMesh->mVertices[i].z;
-
-                vertices.push_back(v0);
-                vertices.push_back(v1);
-                vertices.push_back(v2);
-
-                mmin.x = math::Min(v0, mmin.x);
-                mmin.y = math::Min(v1, mmin.y);
-                mmin.z = math::Min(v2, mmin.z);
-                mmax.x = math::Max(v0, mmax.x);
-                mmax.y = math::Max(v1, mmax.y);
-                mmax.z = math::Max(v2, mmax.z);
-            }
-            else if (attributes[j] == VertexAttribute::VA_UV0)
+                uint32_t idx = indices[i + j];
+                if (remapOwner[idx] != primitiveIndex)
+                {
+                    uint32_t start = idx * stride;
+                    remapOwner[idx] = primitiveIndex;
+                    remapIndex[idx] = primitive->vertices.size() / stride;
+                    primitive->vertices.insert(primitive->vertices.end(), vertices.begin() + start, vertices.begin() + start + stride);
+                }
+                primitive->indices.push_back(remapIndex[idx]);
+            }
+        }
+    }
+    else
+    {
+        VKPrimitive* primitive = new VKPrimitive();
+        primitive->vertices = std::move(vertices);
+        if (vertexCount <= 65535) {
+            primitive->indices.assign(indices.begin(), indices.end());
+        }
+        else {
+            primitive->indices32 = std::move(indices);
+        }
+        mesh->primitives.push_back(primitive);
+    }
+
+    for (int32_t i = 0; i < mesh->primitives.size(); ++i)
+    {
+        VKPrimitive* primitive = mesh->primitives[i];
+        primitive->vertexCount = primitive->vertices.size() / stride;
+        primitive->triangleNum = primitive->GetIndexCount() / 3;
+
+        mesh->vertexCount += primitive->vertexCount;
+        mesh->triangleCount += primitive->triangleNum;
+
+        if (importFlags & VKModelImport_BuildMeshlets) {
+            BuildMeshlets(primitive, mesh);
+        }
+
+        if (importFlags & VKModelImport_GenerateLODs) {
+            GenerateLODs(primitive, mesh);
+        }
+    }
+}
+
+void VKModel::OptimizeMesh(std::vector<float>& vertices, std::vector<uint32_t>& indices, VKVertexCacheStats& outCacheBefore, VKVertexCacheStats& outCacheAfter)
+{
+    int32_t stride = GetInputBinding().stride / sizeof(float);
+
+    int32_t positionOffset = -1;
+    int32_t offset = 0;
+    for (int32_t i = 0; i < attributes.size(); ++i)
+    {
+        if (attributes[i] == VertexAttribute::VA_Position) {
+            positionOffset = offset / sizeof(float);
+        }
+        offset += VertexAttributeToSize(attributes[i]);
+    }
+
+    outCacheBefore.Append(VKMeshOptimizer::AnalyzeVertexCache(indices, vertices.size() / stride));
+
+    int32_t vertexCount = VKMeshOptimizer::WeldVertices(vertices, indices, stride);
+
+    std::vector<uint32_t> clusters;
+    VKMeshOptimizer::OptimizeVertexCache(indices, vertexCount, &clusters);
+    VKMeshOptimizer::OptimizeOverdraw(indices, vertices, stride, positionOffset, clusters);
+    VKMeshOptimizer::OptimizeVertexFetch(vertices, indices, stride);
+
+    outCacheAfter.Append(VKMeshOptimizer::AnalyzeVertexCache(indices, vertices.size() / stride));
+}
+
+// positions and dominant bones read back from a packed stream for the simplifier and the meshlet builder.
+static bool DecodeVertexDatas(const std::vector<float>& vertices, const std::vector<VertexAttribute>& attributes, const VKMesh* mesh, std::vector<float>& outPositions, std::vector<int32_t>& outBoneKeys)
+{
+    int32_t stride = 0;
+    for (int32_t i = 0; i < attributes.size(); ++i) {
+        stride += VertexAttributeToSize(attributes[i]) / sizeof(float);
+    }
+
+    int32_t count = vertices.size() / stride;
+    bool hasPosition = false;
+    std::vector<float> weights;
+
+    outPositions.resize(count * 3);
+
+    int32_t offset = 0;
+    for (int32_t j = 0; j < attributes.size(); ++j)
+    {
+        const float* src = vertices.data() + offset;
+        VertexAttribute attribute = attributes[j];
+        offset += VertexAttributeToSize(attribute) / sizeof(float);
+
+        if (attribute == VertexAttribute::VA_Position || attribute == VertexAttribute::VA_PositionHalf || attribute == VertexAttribute::VA_PositionSNorm16)
+        {
+            hasPosition = true;
+            for (int32_t i = 0; i < count; ++i, src += stride)
             {
-                if (aiMesh->HasTextureCoords(0))
+                float* position = outPositions.data() + i * 3;
+                if (attribute == VertexAttribute::VA_Position)
                 {
-                    vertices.push_back(aiMesh->mTextureCoords[0][i].x);
-                    vertices.push_back(aiMesh->mTextureCoords[0][i].y);
+                    memcpy(position, src, sizeof(float) * 3);
                 }
-                else
-                {
-                    vertices.push_back(0);
-                    vertices.push_back(0);
-                }
-            }
-            else if (attributes[j] == VertexAttribute::VA_UV1)
-            {
-                if (aiMesh->HasTextureCoords(1))
+                else if (attribute == VertexAttribute::VA_PositionHalf)
                 {
-                    vertices.push_back(aiMesh->mTextureCoords[1][i].x);
-                    vertices.push_back(aiMesh->mTextureCoords[1][i].y);
+                    uint16_t packed[4];
+                    memcpy(packed, src, sizeof(packed));
+                    for (int32_t k = 0; k < 3; ++k) {
+                        position[k] = HalfToFloat(packed[k]);
+                    }
                 }
                 else
                 {
-                    vertices.push_back(0);
-                    vertices.push_back(0);
+                    int16_t packed[4];
+                    memcpy(packed, src, sizeof(packed));
+                    position[0] = packed[0] / 32767.0f * mesh->positionScale.x + mesh->positionOffset.x;
+                    position[1] = packed[1] / 32767.0f * mesh->positionScale.y + mesh->positionOffset.y;
+                    position[2] = packed[2] / 32767.0f * mesh->positionScale.z + mesh->positionOffset.z;
                 }
             }
-            else if (attributes[j] == VertexAttribute::VA_Normal)
-            {
-                vertices.push_back(aiMesh->mNormals[i].x);
-                vertices.push_back(aiMesh->mNormals[i].y);
-                vertices.push_back(aiMesh->mNormals[i].z);
-            }
-            else if (attributes[j] == VertexAttribute::VA_Tangent)
-            {
-                vertices.push_back(aiMesh->mTangents[i].x);
-                vertices.push_back(aiMesh->mTangents[i].y);
-                vertices.push_back(aiMesh->mTangents[i].z);
-                vertices.push_back(1);
+        }
+
+        if (!mesh->isSkin) {
+            continue;
+        }
+
+        // bone indices first, weights pick the dominant one afterwards.
+        if (attribute == VertexAttribute::VA_SkinIndex || attribute == VertexAttribute::VA_SkinIndexUInt8 || attribute == VertexAttribute::VA_SkinIndex8 || attribute == VertexAttribute::VA_SkinPack)
+        {
+            outBoneKeys.resize(count * 4);
+            if (attribute == VertexAttribute::VA_SkinPack) {
+                weights.resize(count * 4);
             }
-            else if (attributes[j] == VertexAttribute::VA_Color)
+
+            for (int32_t i = 0; i < count; ++i, src += stride)
             {
-                if (aiMesh->HasVertexColors(i))
-                {
-                    vertices.push_back(aiMesh->mColors[0][i].r);
-                    vertices.push_back(aiMesh->mColors[0][i].g);
-                    vertices.push_back(aiMesh->mColors[0][i].b);
-                }
-                else
+                int32_t* keys = outBoneKeys.data() + i * 4;
+                if (attribute == VertexAttribute::VA_SkinIndex)
                 {
-                    vertices.push_back(defaultColor.x);
-                    vertices.push_back(defaultColor.y);
-                    vertices.push_back(defaultColor.z);
+                    for (int32_t k = 0; k < 4; ++k) {
+                        keys[k] = src[k];
+                    }
                 }
-            }
-            else if (attributes[j] == VertexAttribute::VA_SkinPack)
-            {
-                if (mesh->isSkin)
+                else if (attribute == VertexAttribute::VA_SkinIndexUInt8 || attribute == VertexAttribute::VA_SkinIndex8)
                 {
-                    VKVertexSkin& skin = skinInfoMap[i];
-
-                    int32_t idx0 = skin.indices[0];
-                    int32_t idx1 = skin.indices[1];
-                    int32_t idx2 = skin.indices[2];
-                    int32_t idx3 = skin.indices[3];
-                    uint32_t packIndex = (idx0 << 24) + (idx1 << 16) + (idx2 << 8) + idx3;
-
-                    uint16_t weight0 = skin.weights[0] * 65535;
-                    uint16_t weight1 = skin.weights[1] * 65535;
-                    uint16_t weight2 = skin.weights[2] * 65535;
-                    uint16_t weight3 = skin.weights[3] * 65535;
-                    uint32_t packWeight0 = (weight0 << 16) + weight1;
-                    uint32_t packWeight1 = (weight2 << 16) + weight3;
-
-                    vertices.push_back(packIndex);
-                    vertices.push_back(packWeight0);
-                    vertices.push_back(packWeight1);
+                    uint8_t packed[4];
+                    memcpy(packed, src, sizeof(packed));
+                    for (int32_t k = 0; k < 4; ++k) {
+                        keys[k] = packed[k];
+                    }
                 }
                 else
                 {
-                    vertices.push_back(0);
-                    vertices.push_back(65535);
-                    vertices.push_back(0);
+                    uint32_t packIndex = src[0];
+                    keys[0] = (packIndex >> 24) & 0xFF;
+                    keys[1] = (packIndex >> 16) & 0xFF;
+                    keys[2] = (packIndex >> 8) & 0xFF;
+                    keys[3] = (packIndex >> 0) & 0xFF;
+
+                    uint32_t packWeight0 = src[1];
+                    uint32_t packWeight1 = src[2];
+                    weights[i * 4 + 0] = (packWeight0 >> 16) & 0xFFFF;
+                    weights[i * 4 + 1] = (packWeight0 >> 0) & 0xFFFF;
+                    weights[i * 4 + 2] = (packWeight1 >> 16) & 0xFFFF;
+                    weights[i * 4 + 3] = (packWeight1 >> 0) & 0xFFFF;
                 }
             }
-            else if (attributes[j] == VertexAttribute::VA_SkinIndex)
+        }
+        else if (attribute == VertexAttribute::VA_SkinWeight || attribute == VertexAttribute::VA_SkinWeightUNorm8 || attribute == VertexAttribute::VA_SkinWeightUNorm16 || attribute == VertexAttribute::VA_SkinWeight8)
+        {
+            weights.resize(count * 4);
+            for (int32_t i = 0; i < count; ++i, src += stride)
             {
-                if (mesh->isSkin)
-                {
-                    VKVertexSkin& skin = skinInfoMap[i];
-                    vertices.push_back(skin.indices[0]);
-                    vertices.push_back(skin.indices[1]);
-                    vertices.push_back(skin.indices[2]);
-                    vertices.push_back(skin.indices[3]);
-                }
-                else
+                float* weight = weights.data() + i * 4;
+                if (attribute == VertexAttribute::VA_SkinWeight)
                 {
-                    vertices.push_back(0);
-                    vertices.push_back(0);
-                    vertices.push_back(0);
-                    vertices.push_back(0);
+                    memcpy(weight, src, sizeof(float) * 4);
                 }
-            }
-            else if (attributes[j] == VertexAttribute::VA_SkinWeight)
-            {
-                if (mesh->isSkin)
+                else if (attribute == VertexAttribute::VA_SkinWeightUNorm8 || attribute == VertexAttribute::VA_SkinWeight8)
                 {
-                    VKVertexSkin& skin = skinInfoMap[i];
-                    vertices.push_back(skin.weights[0]);
-                    vertices.push_back(skin.weights[1]);
-                    vertices.push_back(skin.weights[2]);
-                    vertices.push_back(skin.weights[3]);
+                    uint8_t packed[4];
+                    memcpy(packed, src, sizeof(packed));
+                    for (int32_t k = 0; k < 4; ++k) {
+                        weight[k] = packed[k];
+                    }
                 }
                 else
                 {
-                    vertices.push_back(1.0f);
-                    vertices.push_back(0.0f);
-                    vertices.push_back(0.0f);
-                    vertices.push_back(0.0f);
+                    uint16_t packed[4];
+                    memcpy(packed, src, sizeof(packed));
+                    for (int32_t k = 0; k < 4; ++k) {
+                        weight[k] = packed[k];
+                    }
                 }
             }
-            else if (attributes[j] == VertexAttribute::VA_Custom0 ||
-                attributes[j] == VertexAttribute::VA_Custom1 ||
-                attributes[j] == VertexAttribute::VA_Custom2 ||
-                attributes[j] == VertexAttribute::VA_Custom3
-                )
+        }
+    }
+
+    // one key per vertex: the bone with the largest weight.
+    if (outBoneKeys.size() > 0)
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            int32_t dominant = 0;
+            for (int32_t k = 1; k < 4 && weights.size() > 0; ++k)
             {
-                vertices.push_back(0.0f);
-                vertices.push_back(0.0f);
-                vertices.push_back(0.0f);
-                vertices.push_back(0.0f);
+                if (weights[i * 4 + k] > weights[i * 4 + dominant]) {
+                    dominant = k;
+                }
             }
+            outBoneKeys[i] = outBoneKeys[i * 4 + dominant];
         }
+        outBoneKeys.resize(count);
     }
+
+    return hasPosition;
 }
 
-void VKModel::LoadIndices(std::vector<uint32_t>& indices, const aiMesh* aiMesh, const aiScene* aiScene)
+void VKModel::GenerateLODs(VKPrimitive* primitive, VKMesh* mesh)
 {
-    for (int32_t i = 0; i < aiMesh->mNumFaces; ++i)
+    std::vector<float> positions;
+    std::vector<int32_t> boneKeys;
+    if (!DecodeVertexDatas(primitive->vertices, attributes, mesh, positions, boneKeys))
     {
-        indices.push_back(aiMesh->mFaces[i].mIndices[0]);
-        indices.push_back(aiMesh->mFaces[i].mIndices[1]);
-        indices.push_back(aiMesh->mFaces[i].mIndices[2]);
+        MLOGE("LOD generation needs a position attribute.");
+        return;
     }
-}
 
-void VKModel::LoadPrimitives(std::vector<float>& vertices, std::vector<uint32_t>& indices, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene)
-{
-    int32_t stride = vertices.size() / aiMesh->mNumVertices;
+    std::vector<uint32_t> current;
+    if (primitive->indices32.size() > 0) {
+        current = primitive->indices32;
+    }
+    else {
+        current.assign(primitive->indices.begin(), primitive->indices.end());
+    }
 
-    if (indices.size() > 65535)
+    VKPrimitiveLOD lod0;
+    lod0.indexCount = current.size();
+
+    // imports are not welded unless VKModelImport_Optimize is set. The levels index the first of every
+    // run of identical vertices, so only real attribute seams are left for the simplifier to respect.
+    if (primitive->vertexCount > 0)
     {
-        std::unordered_map<uint32_t, uint32_t> indicesMap;
-        VKPrimitive* primitive = nullptr;
+        std::vector<uint32_t> remap;
+        VKMeshOptimizer::GenerateWeldRemap(primitive->vertices, primitive->vertices.size() / primitive->vertexCount, remap);
+        for (int32_t i = 0; i < current.size(); ++i) {
+            current[i] = remap[current[i]];
+        }
+    }
 
-        for (int32_t i = 0; i < indices.size(); ++i) {
-            uint32_t idx = indices[i];
-            if (primitive == nullptr)
-            {
-                primitive = new VKPrimitive();
-                indicesMap.clear();
-                mesh->primitives.push_back(primitive);
-            }
+    primitive->lods.push_back(lod0);
 
-            uint32_t newIdx = 0;
-            auto it = indicesMap.find(idx);
-            if (it == indicesMap.end())
-            {
-                uint32_t start = idx * stride;
-                newIdx = primitive->vertices.size() / stride;
-                primitive->vertices.insert(primitive->vertices.end(), vertices.begin() + start, vertices.begin() + start + stride);
-                indicesMap.insert(std::make_pair(idx, newIdx));
-            }
-            else
-            {
-                newIdx = it->second;
-            }
+    const float ratios[3] = { 0.5f, 0.25f, 0.125f };
+    int32_t fullTriangles = current.size() / 3;
 
-            primitive->indices.push_back(newIdx);
+    for (int32_t i = 0; i < 3; ++i)
+    {
+        std::vector<uint32_t> simplified;
+        float error = VKMeshSimplifier::Simplify(current, positions, boneKeys.size() > 0 ? &boneKeys : nullptr, fullTriangles * ratios[i], simplified);
 
-            if (primitive->indices.size() == 65535) {
-                primitive = nullptr;
-            }
+        // locked borders and attribute seams can stop the simplifier early, a level that saves little is not worth a switch.
+        if (simplified.size() == 0 || simplified.size() > current.size() * 0.8f) {
+            break;
         }
 
-        if (cmdBuffer)
-        {
-            for (int32_t i = 0; i < mesh->primitives.size(); ++i)
-            {
-                primitive = mesh->primitives[i];
-                primitive->vertexBuffer = VKVertexBuffer::Create(device, cmdBuffer, primitive->vertices, attributes);
-                primitive->indexBuffer = VKIndexBuffer::Create(device, cmdBuffer, primitive->indices);
-            }
-        }
-    }
-    else
-    {
-        VKPrimitive* primitive = new VKPrimitive();
-        primitive->vertices = vertices;
-        for (uint16_t i = 0; i < indices.size(); ++i) {
-            primitive->indices.push_back(indices[i]);
+        if (importFlags & VKModelImport_Optimize) {
+            VKMeshOptimizer::OptimizeVertexCache(simplified, positions.size() / 3);
         }
-        mesh->primitives.push_back(primitive);
 
-        if (cmdBuffer)
-        {
-            primitive->vertexBuffer = VKVertexBuffer::Create(device, cmdBuffer, primitive->vertices, attributes);
-            primitive->indexBuffer = VKIndexBuffer::Create(device, cmdBuffer, primitive->indices);
+        VKPrimitiveLOD lod;
+        lod.firstIndex = primitive->GetIndexCount();
+        lod.indexCount = simplified.size();
+        lod.error = error;
+        primitive->lods.push_back(lod);
+
+        if (primitive->indices32.size() > 0) {
+            primitive->indices32.insert(primitive->indices32.end(), simplified.begin(), simplified.end());
         }
+        else {
+            primitive->indices.insert(primitive->indices.end(), simplified.begin(), simplified.end());
+        }
+
+        current.swap(simplified);
     }
 
-    for (int32_t i = 0; i < mesh->primitives.size(); ++i)
+    if (primitive->lods.size() == 1) {
+        primitive->lods.clear();
+    }
+}
+
+void VKModel::BuildMeshlets(VKPrimitive* primitive, VKMesh* mesh)
+{
+    std::vector<float> positions;
+    std::vector<int32_t> boneKeys;
+    if (!DecodeVertexDatas(primitive->vertices, attributes, mesh, positions, boneKeys))
     {
-        VKPrimitive* primitive = mesh->primitives[i];
-        primitive->vertexCount = primitive->vertices.size() / stride;
-        primitive->triangleNum = primitive->indices.size() / 3;
+        MLOGE("Meshlets need a position attribute.");
+        return;
+    }
 
-        mesh->vertexCount += primitive->vertexCount;
-        mesh->triangleCount += primitive->triangleNum;
+    std::vector<uint32_t> indices;
+    if (primitive->indices32.size() > 0) {
+        indices.swap(primitive->indices32);
+    }
+    else {
+        indices.assign(primitive->indices.begin(), primitive->indices.end());
+    }
+
+    VKMeshletBuilder::Build(indices, positions, primitive->meshlets);
+
+    if (primitive->indices.size() > 0) {
+        primitive->indices.assign(indices.begin(), indices.end());
+    }
+    else {
+        primitive->indices32.swap(indices);
     }
 }
 
-VKMesh* VKModel::LoadMesh(const aiMesh* aiMesh, const aiScene* aiScene)
+void VKModel::LoadMesh(MeshJob& job, const aiScene* aiScene)
 {
+    const aiMesh* aiMesh = job.source;
     VKMesh* mesh = new VKMesh();
+    job.mesh = mesh;
 
     // load material
     aiMaterial* material = aiScene->mMaterials[aiMesh->mMaterialIndex];
@@ -505,58 +1359,199 @@ VKMesh* VKModel::LoadMesh(const aiMesh* aiMesh, const aiScene* aiScene)
     }
 
     // load bones
-    std::unordered_map<uint32_t, VKVertexSkin> skinInfoMap;
+    std::vector<VKVertexSkin> skins;
     if (aiMesh->mNumBones > 0 && loadSkin) {
-        LoadSkin(skinInfoMap, mesh, aiMesh, aiScene);
+        LoadSkin(skins, mesh, aiMesh, aiScene);
     }
 
     // load vertex data
     std::vector<float> vertices;
     Vector3 mmin(MAX_int32, MAX_int32, MAX_int32);
     Vector3 mmax(-MAX_int32, -MAX_int32, -MAX_int32);
-    LoadVertexDatas(skinInfoMap, vertices, mmax, mmin, mesh, aiMesh, aiScene);
+    VKVertexStreams streams = GetVertexStreams(aiMesh);
+    LoadVertexDatas(skins, streams, vertices, mmax, mmin, mesh);
 
     // load indices
     std::vector<uint32_t> indices;
     LoadIndices(indices, aiMesh, aiScene);
 
+    LoadTriangleBVH(streams, indices, mesh);
+
+    if (importFlags & VKModelImport_Optimize) {
+        OptimizeMesh(vertices, indices, job.cacheBefore, job.cacheAfter);
+    }
+
     // load primitives
     LoadPrimitives(vertices, indices, mesh, aiMesh, aiScene);
 
-    mesh->bounding.min = mmin;
-    mesh->bounding.max = mmax;
-    mesh->bounding.UpdateCorners();
+    LoadBoundingVolumes(streams, mmin, mmax, mesh);
+}
 
-    return mesh;
+void VKModel::LoadMeshes(std::vector<MeshJob>& meshJobs, const aiScene* aiScene)
+{
+    double startTime = GenericPlatformTime::Seconds();
+
+    ThreadPool& threadPool = ThreadPool::Get();
+    threadPool.ParallelFor(meshJobs.size(), [&](int32_t index) {
+        LoadMesh(meshJobs[index], aiScene);
+    });
+
+    for (int32_t i = 0; i < meshJobs.size(); ++i)
+    {
+        MeshJob& job = meshJobs[i];
+        job.mesh->linkNode = job.node;
+        job.node->meshes.push_back(job.mesh);
+        meshes.push_back(job.mesh);
+
+        cacheStatsBefore.Append(job.cacheBefore);
+        cacheStatsAfter.Append(job.cacheAfter);
+    }
+
+    double meshTime = GenericPlatformTime::Seconds();
+
+    UploadPrimitives();
+
+    MLOG("%d meshes processed in %.2fms on %d threads, uploaded in %.2fms", (int32_t)meshJobs.size(), (meshTime - startTime) * 1000.0, threadPool.GetThreadCount() + 1, (GenericPlatformTime::Seconds() - meshTime) * 1000.0);
 }
 
-VKNode* VKModel::LoadNode(const aiNode* aiNode, const aiScene* aiScene)
+void VKModel::UploadPrimitives()
 {
-    VKNode* vkNode = new VKNode();
-    vkNode->name = aiNode->mName.C_Str();
+    std::vector<PrimitiveUpload> uploads;
+    GatherUploads(uploads);
+    UploadPrimitives(uploads);
+}
+
+void VKModel::UploadPrimitives(const std::vector<PrimitiveUpload>& uploads)
+{
+    if (cmdBuffer == nullptr) {
+        return;
+    }
+
+    VkDeviceSize totalSize = GetUploadSize(uploads);
+    if (totalSize == 0) {
+        return;
+    }
+
+    DVKBuffer* staging = DVKBuffer::CreateBuffer(
+        device,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        totalSize
+    );
+    staging->Map();
+
+    cmdBuffer->Begin();
+
+    VkDeviceSize offset = 0;
+    RecordUpload(cmdBuffer->cmdBuffer, staging, offset, uploads);
+
+    cmdBuffer->End();
+    cmdBuffer->Submit();
+
+    staging->UnMap();
+    delete staging;
+}
+
+void VKModel::GatherUploads(std::vector<PrimitiveUpload>& outUploads) const
+{
+    for (int32_t i = 0; i < meshes.size(); ++i)
+    {
+        for (int32_t j = 0; j < meshes[i]->primitives.size(); ++j)
+        {
+            VKPrimitive* primitive = meshes[i]->primitives[j];
+            if (primitive->vertexBuffer || primitive->arena || primitive->vertices.size() == 0) {
+                continue;
+            }
+
+            PrimitiveUpload upload;
+            upload.primitive = primitive;
+            upload.vertices = Span<const float>(primitive->vertices);
+            upload.index32 = primitive->indices32.size() > 0;
+            upload.indices = upload.index32 ? (const void*)primitive->indices32.data() : (const void*)primitive->indices.data();
+            upload.indexCount = primitive->GetIndexCount();
+            outUploads.push_back(upload);
+        }
+    }
+}
+
+VkDeviceSize VKModel::GetUploadSize(const std::vector<PrimitiveUpload>& uploads)
+{
+    VkDeviceSize totalSize = 0;
+    for (int32_t i = 0; i < uploads.size(); ++i)
+    {
+        totalSize += uploads[i].vertices.length() * sizeof(float);
+        totalSize += uploads[i].indexCount * (uploads[i].index32 ? sizeof(uint32_t) : sizeof(uint16_t));
+    }
+    return totalSize;
+}
+
+VkDeviceSize VKModel::GetUploadSize() const
+{
+    std::vector<PrimitiveUpload> uploads;
+    GatherUploads(uploads);
+    return GetUploadSize(uploads);
+}
+
+void VKModel::RecordUpload(VkCommandBuffer uploadCmdBuffer, DVKBuffer* staging, VkDeviceSize& offset)
+{
+    std::vector<PrimitiveUpload> uploads;
+    GatherUploads(uploads);
+    RecordUpload(uploadCmdBuffer, staging, offset, uploads);
+}
+
+void VKModel::RecordUpload(VkCommandBuffer uploadCmdBuffer, DVKBuffer* staging, VkDeviceSize& offset, const std::vector<PrimitiveUpload>& uploads)
+{
+    uint8_t* dataPtr = (uint8_t*)staging->mapped;
 
-    if (rootNode == nullptr) {
-        rootNode = vkNode;
+    for (int32_t i = 0; i < uploads.size(); ++i)
+    {
+        const PrimitiveUpload& upload = uploads[i];
+        VKPrimitive* primitive = upload.primitive;
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = offset;
+        copyRegion.size = upload.vertices.length() * sizeof(float);
+        memcpy(dataPtr + offset, upload.vertices.begin, copyRegion.size);
+        offset += copyRegion.size;
+
+        primitive->vertexBuffer = VKVertexBuffer::Create(device, copyRegion.size, attributes);
+        vkCmdCopyBuffer(uploadCmdBuffer, staging->buffer, primitive->vertexBuffer->dvkBuffer->buffer, 1, &copyRegion);
+
+        if (upload.indexCount == 0) {
+            continue;
+        }
+
+        copyRegion.srcOffset = offset;
+        copyRegion.size = upload.indexCount * (upload.index32 ? sizeof(uint32_t) : sizeof(uint16_t));
+        memcpy(dataPtr + offset, upload.indices, copyRegion.size);
+        offset += copyRegion.size;
+
+        primitive->indexBuffer = VKIndexBuffer::Create(device, upload.indexCount, upload.index32 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16);
+        vkCmdCopyBuffer(uploadCmdBuffer, staging->buffer, primitive->indexBuffer->dvkBuffer->buffer, 1, &copyRegion);
     }
+}
 
-    // local matrix
-    FillMatrixWithAiMatrix(vkNode->localMatrix, aiNode->mTransformation);
+VKNode* VKModel::LoadNode(const aiNode* aiNode, VKNode* parent, const aiScene* aiScene, std::vector<MeshJob>& outMeshJobs)
+{
+    VKNode* vkNode = new VKNode();
+    vkNode->name = aiNode->mName.C_Str();
+
+    // local matrix, nodes map and transforms
+    Matrix4x4 localMatrix;
+    FillMatrixWithAiMatrix(localMatrix, aiNode->mTransformation);
+    AddNode(vkNode, parent, localMatrix);
 
     // mesh
     if (aiNode->mNumMeshes > 0) {
         for (int i = 0; i < aiNode->mNumMeshes; ++i)
         {
-            VKMesh* vkMesh = LoadMesh(aiScene->mMeshes[aiNode->mMeshes[i]], aiScene);
-            vkMesh->linkNode = vkNode;
-            vkNode->meshes.push_back(vkMesh);
-            meshes.push_back(vkMesh);
+            MeshJob job;
+            job.source = aiScene->mMeshes[aiNode->mMeshes[i]];
+            job.node = vkNode;
+            outMeshJobs.push_back(job);
         }
     }
 
-    // nodes map
-    nodesMap.insert(std::make_pair(vkNode->name, vkNode));
-    linearNodes.push_back(vkNode);
-
     // bones parent
     int32_t boneParentIndex = -1;
     {
@@ -569,9 +1564,7 @@ VKNode* VKModel::LoadNode(const aiNode* aiNode, const aiScene* aiScene)
     // children node
     for (int32_t i = 0; i < aiNode->mNumChildren; ++i)
     {
-        VKNode* childNode = LoadNode(aiNode->mChildren[i], aiScene);
-        childNode->parent = vkNode;
-        vkNode->children.push_back(childNode);
+        VKNode* childNode = LoadNode(aiNode->mChildren[i], vkNode, aiScene, outMeshJobs);
 
         // bones relationship
         {
@@ -594,15 +1587,16 @@ void VKModel::LoadAnim(const aiScene* aiScene)
 
         animations.push_back(VKAnimation());
         VKAnimation& dvkAnimation = animations.back();
+        std::shared_ptr<VKAnimation::ClipsMap> clips = std::make_shared<VKAnimation::ClipsMap>();
 
         for (int32_t j = 0; j < aianimation->mNumChannels; ++j)
         {
             aiNodeAnim* nodeAnim = aianimation->mChannels[j];
             std::string nodeName = nodeAnim->mNodeName.C_Str();
 
-            dvkAnimation.clips.insert(std::make_pair(nodeName, VKAnimationClip()));
+            clips->insert(std::make_pair(nodeName, VKAnimationClip()));
 
-            VKAnimationClip& animClip = dvkAnimation.clips[nodeName];
+            VKAnimationClip& animClip = (*clips)[nodeName];
             animClip.nodeName = nodeName;
             animClip.duration = 0.0f;
 
@@ -635,6 +1629,8 @@ void VKModel::LoadAnim(const aiScene* aiScene)
 
             dvkAnimation.duration = math::Max(animClip.duration, dvkAnimation.duration);
         }
+
+        dvkAnimation.clips = clips;
     }
 }
 
@@ -648,9 +1644,9 @@ void VKModel::GotoAnimation(float time)
     animation.time = math::Clamp(time, 0.0f, animation.duration);
 
     // update nodes animation
-    for (auto it = animation.clips.begin(); it != animation.clips.end(); ++it)
+    for (auto it = animation.clips->begin(); it != animation.clips->end(); ++it)
     {
-        VKAnimationClip& clip = it->second;
+        const VKAnimationClip& clip = it->second;
         VKNode* node = nodesMap[clip.nodeName];
 
         float alpha = 0.0f;
@@ -673,12 +1669,16 @@ void VKModel::GotoAnimation(float time)
         clip.scales.GetValue(animation.time, prevScale, nextScale, alpha);
         Vector3 retScale = math::Lerp(prevScale, nextScale, alpha);
 
-        node->localMatrix.SetIdentity();
-        node->localMatrix.AppendScale(retScale);
-        node->localMatrix.Append(retRot.ToMatrix());
-        node->localMatrix.AppendTranslation(retPos);
+        Matrix4x4 localMatrix;
+        localMatrix.AppendScale(retScale);
+        localMatrix.Append(retRot.ToMatrix());
+        localMatrix.AppendTranslation(retPos);
+        node->SetLocalMatrix(localMatrix);
     }
 
+    // one pass over the animated subtrees, the bones below read cached world matrices.
+    transforms.Update();
+
     // update bones
     for (int32_t i = 0; i < bones.size(); ++i)
     {
@@ -740,6 +1740,228 @@ VkVertexInputBindingDescription VKModel::GetInputBinding()
     return vertexInputBinding;
 }
 
+int32_t VKModel::GetPrimitiveCount() const
+{
+    int32_t count = 0;
+    for (int32_t i = 0; i < meshes.size(); ++i) {
+        count += meshes[i]->primitives.size();
+    }
+    return count;
+}
+
+bool VKModel::MoveToArena(VKGeometryArena* arena, VKCommandBuffer* uploadCmdBuffer)
+{
+    if (core)
+    {
+        MLOGE("Model instances share their geometry, move the core model instead.");
+        return false;
+    }
+
+    if (arena->attributes != attributes)
+    {
+        MLOGE("Model vertex layout differs from the geometry arena.");
+        return false;
+    }
+
+    std::vector<VKPrimitive*> primitives;
+    for (int32_t i = 0; i < meshes.size(); ++i) {
+        for (int32_t j = 0; j < meshes[i]->primitives.size(); ++j) {
+            if (meshes[i]->primitives[j]->arena == nullptr) {
+                primitives.push_back(meshes[i]->primitives[j]);
+            }
+        }
+    }
+
+    int32_t stride = GetInputBinding().stride / sizeof(float);
+
+    std::vector<VKGeometryUpload> uploads(primitives.size());
+    for (int32_t i = 0; i < primitives.size(); ++i)
+    {
+        VKPrimitive* primitive = primitives[i];
+        VKGeometryUpload& upload = uploads[i];
+
+        uint32_t vertexCount = primitive->vertices.size() / stride;
+        uint32_t indexCount = primitive->GetIndexCount();
+        bool hasData = vertexCount == primitive->vertexCount && (indexCount > 0 || primitive->indexBuffer == nullptr);
+
+        if (!hasData || !arena->Allocate(vertexCount, indexCount, upload.allocation))
+        {
+            if (!hasData) {
+                MLOGE("Primitive has no CPU copy to move into the geometry arena.");
+            }
+            for (int32_t j = 0; j < i; ++j) {
+                arena->Free(uploads[j].allocation);
+            }
+            return false;
+        }
+
+        upload.vertexData = primitive->vertices.data();
+        upload.indexData = primitive->indices32.size() > 0 ? (const void*)primitive->indices32.data() : (const void*)primitive->indices.data();
+        upload.indexType = primitive->indices32.size() > 0 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    }
+
+    arena->Upload(uploadCmdBuffer, uploads);
+
+    for (int32_t i = 0; i < primitives.size(); ++i)
+    {
+        VKPrimitive* primitive = primitives[i];
+        if (primitive->indexBuffer) {
+            primitive->instanceCount = primitive->indexBuffer->instanceCount;
+        }
+
+        delete primitive->vertexBuffer;
+        delete primitive->indexBuffer;
+        primitive->vertexBuffer = nullptr;
+        primitive->indexBuffer = nullptr;
+
+        primitive->arena = arena;
+        primitive->arenaAllocation = uploads[i].allocation;
+    }
+
+    if (residency == VKModelResidency_GPUOnly) {
+        ReleaseCPUData();
+    }
+
+    return true;
+}
+
+void VKModel::ReleaseCPUData()
+{
+    if (core)
+    {
+        MLOGE("Model instances cannot release the geometry of their core.");
+        return;
+    }
+
+    residency = VKModelResidency_GPUOnly;
+
+    for (int32_t i = 0; i < meshes.size(); ++i)
+    {
+        for (int32_t j = 0; j < meshes[i]->primitives.size(); ++j)
+        {
+            // primitives still waiting for MoveToArena keep their data.
+            VKPrimitive* primitive = meshes[i]->primitives[j];
+            if (primitive->HasGPUData()) {
+                primitive->ReleaseCPUData();
+            }
+        }
+    }
+}
+
+int64_t VKModel::GetCPUBytes() const
+{
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < meshes.size(); ++i) {
+        for (int32_t j = 0; j < meshes[i]->primitives.size(); ++j) {
+            bytes += meshes[i]->primitives[j]->GetCPUBytes();
+        }
+    }
+    return bytes;
+}
+
+int64_t VKModel::GetGPUBytes() const
+{
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < meshes.size(); ++i)
+    {
+        for (int32_t j = 0; j < meshes[i]->primitives.size(); ++j)
+        {
+            const VKPrimitive* primitive = meshes[i]->primitives[j];
+            if (primitive->instanceBuffer) {
+                bytes += primitive->instanceBuffer->dvkBuffer->size;
+            }
+            // instances only own their instance buffers.
+            if (primitive->IsInstance()) {
+                continue;
+            }
+            if (primitive->vertexBuffer) {
+                bytes += primitive->vertexBuffer->dvkBuffer->size;
+            }
+            if (primitive->indexBuffer) {
+                bytes += primitive->indexBuffer->dvkBuffer->size;
+            }
+            if (primitive->arena)
+            {
+                uint32_t indexSize = primitive->arena->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+                bytes += (int64_t)primitive->arenaAllocation.vertexCount * primitive->arena->stride;
+                bytes += (int64_t)primitive->arenaAllocation.indexCount * indexSize;
+            }
+        }
+    }
+    return bytes;
+}
+
+VKNode* VKModel::CloneNode(const VKNode* source, VKNode* parent, std::unordered_map<const VKMesh*, VKMesh*>& outMeshMap)
+{
+    VKNode* node = new VKNode();
+    node->name = source->name;
+    AddNode(node, parent, source->GetLocalMatrix());
+
+    // the clone gets instance primitives, the mesh copy must not keep the primitives of the core.
+    for (int32_t i = 0; i < source->meshes.size(); ++i)
+    {
+        VKMesh* mesh = new VKMesh(*source->meshes[i]);
+        for (int32_t j = 0; j < mesh->primitives.size(); ++j) {
+            mesh->primitives[j] = VKPrimitive::CreateInstance(mesh->primitives[j]);
+        }
+        mesh->linkNode = node;
+        node->meshes.push_back(mesh);
+        outMeshMap.insert(std::make_pair(source->meshes[i], mesh));
+    }
+
+    for (int32_t i = 0; i < source->children.size(); ++i) {
+        CloneNode(source->children[i], node, outMeshMap);
+    }
+
+    return node;
+}
+
+VKModel* VKModel::CreateInstance(std::shared_ptr<VKModel> core)
+{
+    if (core->core) {
+        core = core->core;
+    }
+
+    VKModel* model = new VKModel();
+    model->device = core->device;
+    model->attributes = core->attributes;
+    model->importFlags = core->importFlags;
+    model->residency = core->residency;
+    model->loadSkin = core->loadSkin;
+    model->core = core;
+
+    for (int32_t i = 0; i < core->bones.size(); ++i)
+    {
+        VKBone* bone = new VKBone(*core->bones[i]);
+        model->bones.push_back(bone);
+        model->bonesMap.insert(std::make_pair(bone->name, bone));
+    }
+
+    std::unordered_map<const VKMesh*, VKMesh*> meshMap;
+    if (core->rootNode) {
+        model->CloneNode(core->rootNode, nullptr, meshMap);
+    }
+
+    for (int32_t i = 0; i < core->meshes.size(); ++i)
+    {
+        auto it = meshMap.find(core->meshes[i]);
+        if (it != meshMap.end()) {
+            model->meshes.push_back(it->second);
+        }
+    }
+
+    // clips are shared, only the playback state is per instance.
+    model->animations = core->animations;
+    for (int32_t i = 0; i < model->animations.size(); ++i)
+    {
+        model->animations[i].time = 0.0f;
+        model->animations[i].speed = 1.0f;
+    }
+    model->animIndex = core->animIndex;
+
+    return model;
+}
+
 std::vector<VkVertexInputAttributeDescription> VKModel::GetInputAttributes()
 {
     std::vector<VkVertexInputAttributeDescription> vertexInputAttributs;
@@ -4,6 +4,12 @@
 #include "VKIndexBuffer.h"
 #include "VKVertexBuffer.h"
 #include "RHIDefinitions.h"
+#include "VKMeshOptimizer.h"
+#include "VKMeshlet.h"
+#include "VKGeometryArena.h"
+#include "VKTransformHierarchy.h"
+#include "VKBounds.h"
+#include "VKTriangleBVH.h"
 
 #include "CoreMath2.h"
 #include "Vector3.h"
@@ -14,42 +20,67 @@ struct aiMesh;
 struct aiScene;
 struct aiNode;
 
+// strips directory and extension, materials only keep the texture name.
+void SimplifyTexturePath(std::string& path);
+
 struct VKNode;
 
-struct VKBoundingBox
+// strided view of one source vertex attribute, element i starts at data + i * stride.
+struct VKVertexStream
 {
-	Vector3 min;
-	Vector3 max;
-	Vector3 corners[8];
+	const uint8_t*	data = nullptr;
+	int32_t			stride = 0;
 
-	VKBoundingBox()
-		: min(MAX_flt, MAX_flt, MAX_flt)
-		, max(MIN_flt, MIN_flt, MIN_flt)
+	VKVertexStream()
 	{
 
 	}
 
-	VKBoundingBox(const Vector3& inMin, const Vector3& inMax)
-		: min(inMin)
-		, max(inMax)
+	VKVertexStream(const void* inData, int32_t inStride)
+		: data((const uint8_t*)inData)
+		, stride(inStride)
 	{
 
 	}
 
-	void UpdateCorners()
+	inline bool IsValid() const
 	{
-		corners[0].Set(min.x, min.y, min.z);
-		corners[1].Set(max.x, min.y, min.z);
-		corners[2].Set(min.x, max.y, min.z);
-		corners[3].Set(max.x, max.y, min.z);
+		return data != nullptr;
+	}
 
-		corners[4].Set(min.x, min.y, max.z);
-		corners[5].Set(max.x, min.y, max.z);
-		corners[6].Set(min.x, max.y, max.z);
-		corners[7].Set(max.x, max.y, max.z);
+	inline const float* Get(int32_t index) const
+	{
+		return (const float*)(data + (size_t)index * stride);
 	}
 };
 
+// source attributes of one mesh as float streams, views into an aiMesh or straight into glTF buffers.
+struct VKVertexStreams
+{
+	int32_t			count = 0;
+	// 3 floats each.
+	VKVertexStream	positions;
+	VKVertexStream	normals;
+	VKVertexStream	tangents;
+	// only read for the tangent handedness when tangentW is false.
+	VKVertexStream	bitangents;
+	// 2 floats.
+	VKVertexStream	uvs[2];
+	// 3 floats.
+	VKVertexStream	colors;
+	// tangents have a 4th float with the handedness.
+	bool			tangentW = false;
+};
+
+// index range of one level of detail, every level shares the primitive's vertex buffer.
+struct VKPrimitiveLOD
+{
+	uint32_t	firstIndex = 0;
+	uint32_t	indexCount = 0;
+	// largest collapse error in model units.
+	float		error = 0.0f;
+};
+
 struct VKPrimitive
 {
 	VKIndexBuffer* indexBuffer = nullptr;
@@ -59,10 +90,29 @@ struct VKPrimitive
 	std::vector<float>	vertices;
 	std::vector<float>  instanceDatas;
 	std::vector<uint16_t>	indices;
+	// used instead of indices when the primitive references more than 65535 vertices.
+	std::vector<uint32_t>	indices32;
 
 	int32_t               vertexCount = 0;
 	int32_t               triangleNum = 0;
 
+	// empty when no LODs were generated, otherwise lods[0] is the full mesh and indices holds all levels back to back.
+	std::vector<VKPrimitiveLOD>	lods;
+	int32_t						lodIndex = 0;
+
+	// clusters of the LOD 0 index range, see VKMeshletCuller.
+	std::vector<VKMeshlet>		meshlets;
+
+	// set by VKModel::MoveToArena, the primitive then has no buffers of its own and draws at arenaAllocation.
+	VKGeometryArena*			arena = nullptr;
+	VKGeometryAllocation		arenaAllocation;
+	// instance count of arena and instance primitive draws, indexBuffer->instanceCount is used otherwise.
+	int32_t						instanceCount = 1;
+
+	// set on the primitives of model instances. Buffers, arena range and meshlets belong to source in the
+	// core and are only borrowed, lodIndex and the instance data are the instance's own.
+	const VKPrimitive*			source = nullptr;
+
 	VKPrimitive()
 	{
 
@@ -70,11 +120,11 @@ struct VKPrimitive
 
 	~VKPrimitive()
 	{
-		if (indexBuffer) {
+		if (indexBuffer && !source) {
 			delete indexBuffer;
 		}
 
-		if (vertexBuffer) {
+		if (vertexBuffer && !source) {
 			delete vertexBuffer;
 		}
 
@@ -82,36 +132,157 @@ struct VKPrimitive
 			delete instanceBuffer;
 		}
 
+		if (arena && !source) {
+			arena->Free(arenaAllocation);
+		}
+
 		indexBuffer = nullptr;
 		vertexBuffer = nullptr;
+		instanceBuffer = nullptr;
+		arena = nullptr;
+		source = nullptr;
 	}
 
-	void DrawOnly(VkCommandBuffer cmdBuffer)
+	// a primitive drawing the GPU data of source with its own per draw state. source must stay alive and
+	// keep its buffers, see VKModel::CreateInstance.
+	static VKPrimitive* CreateInstance(const VKPrimitive* source)
 	{
-		if (vertexBuffer && !indexBuffer) {
-			vkCmdDraw(cmdBuffer, vertexCount, 1, 0, 0);
+		VKPrimitive* primitive = new VKPrimitive();
+		primitive->source = source->source ? source->source : source;
+		primitive->indexBuffer = source->indexBuffer;
+		primitive->vertexBuffer = source->vertexBuffer;
+		primitive->arena = source->arena;
+		primitive->arenaAllocation = source->arenaAllocation;
+		primitive->vertexCount = source->vertexCount;
+		primitive->triangleNum = source->triangleNum;
+		primitive->lods = source->lods;
+		primitive->lodIndex = source->lodIndex;
+		return primitive;
+	}
+
+	inline bool IsInstance() const
+	{
+		return source != nullptr;
+	}
+
+	// instance primitives read the clusters of their source instead of copying them.
+	inline const std::vector<VKMeshlet>& GetMeshlets() const
+	{
+		return source ? source->meshlets : meshlets;
+	}
+
+	// falls back to the GPU side once the CPU copies were released.
+	inline int32_t GetIndexCount() const
+	{
+		if (indices32.size() > 0 || indices.size() > 0) {
+			return indices32.size() > 0 ? (int32_t)indices32.size() : (int32_t)indices.size();
 		}
-		else {
-			vkCmdDrawIndexed(cmdBuffer, indexBuffer->indexCount, indexBuffer->instanceCount, 0, 0, 0);
+		if (indexBuffer) {
+			return indexBuffer->indexCount;
 		}
+		return arena ? arenaAllocation.indexCount : 0;
 	}
 
-	void BindOnly(VkCommandBuffer cmdBuffer)
+	inline bool HasGPUData() const
 	{
-		if (vertexBuffer) {
-			vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &(vertexBuffer->dvkBuffer->buffer), &(vertexBuffer->offset));
+		return vertexBuffer != nullptr || arena != nullptr;
+	}
+
+	inline int64_t GetCPUBytes() const
+	{
+		return vertices.capacity() * sizeof(float) + instanceDatas.capacity() * sizeof(float) + indices.capacity() * sizeof(uint16_t) + indices32.capacity() * sizeof(uint32_t);
+	}
+
+	// swaps with empty vectors so the memory is returned, not only cleared.
+	void ReleaseCPUData()
+	{
+		std::vector<float>().swap(vertices);
+		std::vector<float>().swap(instanceDatas);
+		std::vector<uint16_t>().swap(indices);
+		std::vector<uint32_t>().swap(indices32);
+	}
+
+	// uploads whichever of indices/indices32 is in use.
+	VKIndexBuffer* CreateIndexBuffer(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer)
+	{
+		if (indices32.size() > 0) {
+			return VKIndexBuffer::Create(vulkanDevice, cmdBuffer, indices32.data(), (uint32_t)indices32.size(), VK_INDEX_TYPE_UINT32);
 		}
+		return VKIndexBuffer::Create(vulkanDevice, cmdBuffer, indices.data(), (uint32_t)indices.size(), VK_INDEX_TYPE_UINT16);
+	}
 
-		if (instanceBuffer) {
-			vkCmdBindVertexBuffers(cmdBuffer, 1, 1, &(instanceBuffer->dvkBuffer->buffer), &(instanceBuffer->offset));
+	inline int32_t GetTriangleCount(int32_t lod) const
+	{
+		if (lods.size() == 0) {
+			return triangleNum;
 		}
+		return lods[lod < lods.size() ? lod : lods.size() - 1].indexCount / 3;
+	}
 
-		if (indexBuffer) {
-			vkCmdBindIndexBuffer(cmdBuffer, indexBuffer->dvkBuffer->buffer, 0, indexBuffer->indexType);
+	inline int32_t GetInstanceCount() const
+	{
+		return indexBuffer && !source ? indexBuffer->instanceCount : instanceCount;
+	}
+
+	// false for primitives drawn with vkCmdDraw, they have no indexed draw command.
+	inline bool IsIndexed() const
+	{
+		return arena ? arenaAllocation.indexCount > 0 : indexBuffer != nullptr;
+	}
+
+	// the draw recorded by DrawIndexed, offsets only mean something for arena primitives.
+	// Only valid for IsIndexed() primitives.
+	VkDrawIndexedIndirectCommand GetDrawCommand() const
+	{
+		assert(IsIndexed());
+
+		VkDrawIndexedIndirectCommand command;
+		command.instanceCount = GetInstanceCount();
+		command.firstIndex = arena ? arenaAllocation.firstIndex : 0;
+		command.vertexOffset = arena ? arenaAllocation.vertexOffset : 0;
+		command.firstInstance = 0;
+
+		if (lods.size() > 0)
+		{
+			const VKPrimitiveLOD& lod = lods[lodIndex < lods.size() ? lodIndex : lods.size() - 1];
+			command.indexCount = lod.indexCount;
+			command.firstIndex += lod.firstIndex;
 		}
+		else if (arena)
+		{
+			command.indexCount = arenaAllocation.indexCount;
+		}
+		else
+		{
+			command.indexCount = indexBuffer ? indexBuffer->indexCount : 0;
+		}
+
+		return command;
 	}
 
-	void BindDrawCmd(VkCommandBuffer cmdBuffer)
+	void DrawIndexed(VkCommandBuffer cmdBuffer)
+	{
+		VkDrawIndexedIndirectCommand command = GetDrawCommand();
+		vkCmdDrawIndexed(cmdBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+	}
+
+	// with an arena this is the whole draw once VKGeometryArena::Bind was recorded.
+	void DrawOnly(VkCommandBuffer cmdBuffer)
+	{
+		if (IsIndexed()) {
+			DrawIndexed(cmdBuffer);
+		}
+		else if (arena) {
+			vkCmdDraw(cmdBuffer, vertexCount, 1, arenaAllocation.vertexOffset, 0);
+		}
+		else if (vertexBuffer) {
+			vkCmdDraw(cmdBuffer, vertexCount, 1, 0, 0);
+		}
+	}
+
+	// the primitive's own buffers. Arena primitives only have an instance buffer here, the arena is bound
+	// once per mesh or draw list and they draw at their offsets.
+	void BindOnly(VkCommandBuffer cmdBuffer)
 	{
 		if (vertexBuffer) {
 			vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &(vertexBuffer->dvkBuffer->buffer), &(vertexBuffer->offset));
@@ -124,13 +295,16 @@ struct VKPrimitive
 		if (indexBuffer) {
 			vkCmdBindIndexBuffer(cmdBuffer, indexBuffer->dvkBuffer->buffer, 0, indexBuffer->indexType);
 		}
+	}
 
-		if (vertexBuffer && !indexBuffer) {
-			vkCmdDraw(cmdBuffer, vertexCount, 1, 0, 0);
-		}
-		else {
-			vkCmdDrawIndexed(cmdBuffer, indexBuffer->indexCount, indexBuffer->instanceCount, 0, 0, 0);
+	void BindDrawCmd(VkCommandBuffer cmdBuffer)
+	{
+		if (arena) {
+			arena->Bind(cmdBuffer);
 		}
+
+		BindOnly(cmdBuffer);
+		DrawOnly(cmdBuffer);
 	}
 };
 
@@ -150,11 +324,63 @@ struct VKBone
 	Matrix4x4		finalTransform;
 };
 
+// influences of one vertex, sorted by weight with the strongest first.
 struct VKVertexSkin
 {
+	static const int32_t MAX_INFLUENCES = 8;
+
 	int32_t  used = 0;
-	int32_t  indices[4];
-	float  weights[4];
+	int32_t  indices[MAX_INFLUENCES];
+	float  weights[MAX_INFLUENCES];
+
+	// once maxInfluences are used the weakest influence is replaced, never the last one added.
+	inline void Add(int32_t index, float weight, int32_t maxInfluences)
+	{
+		int32_t slot = used;
+		if (used >= maxInfluences)
+		{
+			if (weight <= weights[maxInfluences - 1]) {
+				return;
+			}
+			slot = maxInfluences - 1;
+		}
+		else
+		{
+			used += 1;
+		}
+
+		while (slot > 0 && weights[slot - 1] < weight)
+		{
+			indices[slot] = indices[slot - 1];
+			weights[slot] = weights[slot - 1];
+			slot -= 1;
+		}
+
+		indices[slot] = index;
+		weights[slot] = weight;
+	}
+
+	// the strongest count influences with weights summing to 1, vertices without influences get bone 0.
+	inline void GetNormalized(int32_t count, int32_t* outIndices, float* outWeights) const
+	{
+		float sum = 0.0f;
+		for (int32_t i = 0; i < count; ++i)
+		{
+			outIndices[i] = i < used ? indices[i] : 0;
+			outWeights[i] = i < used ? weights[i] : 0.0f;
+			sum += outWeights[i];
+		}
+
+		if (sum <= 0.0f)
+		{
+			outWeights[0] = 1.0f;
+			return;
+		}
+
+		for (int32_t i = 0; i < count; ++i) {
+			outWeights[i] /= sum;
+		}
+	}
 };
 
 template<class ValueType>
@@ -163,7 +389,7 @@ struct VKAnimChannel
 	std::vector<float>	   keys;
 	std::vector<ValueType> values;
 
-	void GetValue(float key, ValueType& outPrevValue, ValueType& outNextValue, float& outAlpha)
+	void GetValue(float key, ValueType& outPrevValue, ValueType& outNextValue, float& outAlpha) const
 	{
 		outAlpha = 0.0f;
 
@@ -216,11 +442,14 @@ struct VKAnimationClip
 
 struct VKAnimation
 {
+	typedef std::unordered_map<std::string, VKAnimationClip> ClipsMap;
+
 	std::string name;
 	float		time = 0.0f;
 	float       duration = 0.0f;
 	float		speed = 1.0f;
-	std::unordered_map<std::string, VKAnimationClip> clips;
+	// immutable once loaded, copies of the animation (e.g. model instances) share the keys.
+	std::shared_ptr<const ClipsMap> clips = std::make_shared<ClipsMap>();
 };
 
 struct VKMesh
@@ -229,6 +458,11 @@ struct VKMesh
 
 	VKPrimitives		primitives;
 	VKBoundingBox		bounding;
+	VKBoundingSphere	sphere;
+	// only with VKModelImport_OrientedBounds, bounding as a box otherwise.
+	VKOrientedBox		orientedBox;
+	// only with VKModelImport_TriangleBVH, shared with instances of the model.
+	std::shared_ptr<VKTriangleBVH>	triangleBVH;
 	VKNode* linkNode;
 
 	std::vector<int32_t>	bones;
@@ -239,6 +473,14 @@ struct VKMesh
 	int32_t				vertexCount;
 	int32_t				triangleCount;
 
+	// VA_PositionSNorm16 streams store (position - positionOffset) / positionScale.
+	Vector3				positionScale = Vector3(1.0f, 1.0f, 1.0f);
+	Vector3				positionOffset = Vector3(0.0f, 0.0f, 0.0f);
+
+	// VA_UV0/1UNorm16 streams store (uv - offset) / scale, per channel as (scale.x, scale.y, offset.x, offset.y).
+	// Identity when the UVs already lie in [0, 1], otherwise shaders rescale with inUV0UNorm * xy + zw.
+	Vector4				uvDequantize[2] = { Vector4(1.0f, 1.0f, 0.0f, 0.0f), Vector4(1.0f, 1.0f, 0.0f, 0.0f) };
+
 	VKMesh()
 		: linkNode(nullptr)
 		, vertexCount(0)
@@ -247,9 +489,59 @@ struct VKMesh
 
 	}
 
+	int32_t GetLODCount() const
+	{
+		int32_t count = 1;
+		for (int32_t i = 0; i < primitives.size(); ++i) {
+			count = std::max(count, (int32_t)primitives[i]->lods.size());
+		}
+		return count;
+	}
+
+	void SetLOD(int32_t lod)
+	{
+		for (int32_t i = 0; i < primitives.size(); ++i) {
+			primitives[i]->lodIndex = lod;
+		}
+	}
+
+	int32_t GetTriangleCount(int32_t lod) const
+	{
+		int32_t count = 0;
+		for (int32_t i = 0; i < primitives.size(); ++i) {
+			count += primitives[i]->GetTriangleCount(lod);
+		}
+		return count;
+	}
+
+	// prepend to the model matrix so quantized positions need no extra shader math.
+	Matrix4x4 GetPositionDequantizeMatrix() const
+	{
+		Matrix4x4 matrix;
+		matrix.SetIdentity();
+		matrix.AppendScale(positionScale);
+		matrix.AppendTranslation(positionOffset);
+		return matrix;
+	}
+
+	// records VKGeometryArena::Bind only when the arena changes, primitives with own vertex buffers replace it.
+	static VKGeometryArena* BindArena(VkCommandBuffer cmdBuffer, const VKPrimitive* primitive, VKGeometryArena* boundArena)
+	{
+		if (primitive->arena == nullptr) {
+			return primitive->vertexBuffer ? nullptr : boundArena;
+		}
+
+		if (primitive->arena != boundArena) {
+			primitive->arena->Bind(cmdBuffer);
+		}
+		return primitive->arena;
+	}
+
 	void BindOnly(VkCommandBuffer cmdBuffer)
 	{
+		VKGeometryArena* boundArena = nullptr;
 		for (int i = 0; i < primitives.size(); ++i) {
+			boundArena = BindArena(cmdBuffer, primitives[i], boundArena);
 			primitives[i]->BindOnly(cmdBuffer);
 		}
 	}
@@ -263,8 +555,12 @@ struct VKMesh
 
 	void BindDrawCmd(VkCommandBuffer cmdBuffer)
 	{
-		for (int i = 0; i < primitives.size(); ++i) {
-			primitives[i]->BindDrawCmd(cmdBuffer);
+		VKGeometryArena* boundArena = nullptr;
+		for (int i = 0; i < primitives.size(); ++i)
+		{
+			boundArena = BindArena(cmdBuffer, primitives[i], boundArena);
+			primitives[i]->BindOnly(cmdBuffer);
+			primitives[i]->DrawOnly(cmdBuffer);
 		}
 	}
 
@@ -287,30 +583,39 @@ struct VKNode
 	VKNode* parent;
 	std::vector<VKNode*>		children;
 
-	Matrix4x4					localMatrix;
-	Matrix4x4					globalMatrix;
+	// local and world matrix live in the model's VKTransformHierarchy, see VKModel::AddNode.
+	VKTransformHierarchy*		transforms;
+	int32_t						transformIndex;
 
 	VKNode()
 		: name("None")
 		, parent(nullptr)
+		, transforms(nullptr)
+		, transformIndex(-1)
 	{
 
 	}
 
-	const Matrix4x4& GetLocalMatrix()
+	const Matrix4x4& GetLocalMatrix() const
 	{
-		return localMatrix;
+		return transforms->GetLocal(transformIndex);
 	}
 
-	Matrix4x4& GetGlobalMatrix()
+	void SetLocalMatrix(const Matrix4x4& localMatrix)
 	{
-		globalMatrix = localMatrix;
+		transforms->SetLocal(transformIndex, localMatrix);
+	}
 
-		if (parent) {
-			globalMatrix.Append(parent->GetGlobalMatrix());
-		}
+	// marks the node dirty, e.g. EditLocalMatrix().AppendRotation(...).
+	Matrix4x4& EditLocalMatrix()
+	{
+		return transforms->EditLocal(transformIndex);
+	}
 
-		return globalMatrix;
+	// cached world matrix, the hierarchy is updated first if any local changed.
+	const Matrix4x4& GetGlobalMatrix() const
+	{
+		return transforms->GetWorld(transformIndex);
 	}
 
 	void CalcBounds(VKBoundingBox& outBounds)
@@ -318,14 +623,8 @@ struct VKNode
 		if (meshes.size() > 0)
 		{
 			const Matrix4x4& matrix = GetGlobalMatrix();
-			for (int32_t i = 0; i < meshes.size(); ++i)
-			{
-				Vector3 mmin = matrix.TransformPosition(meshes[i]->bounding.min);
-				Vector3 mmax = matrix.TransformPosition(meshes[i]->bounding.max);
-				outBounds.min = Vector3::Min(outBounds.min, mmin);
-				outBounds.min = Vector3::Min(outBounds.min, mmax);
-				outBounds.max = Vector3::Max(outBounds.max, mmin);
-				outBounds.max = Vector3::Max(outBounds.max, mmax);
+			for (int32_t i = 0; i < meshes.size(); ++i) {
+				outBounds.Merge(VKBounds::TransformBox(meshes[i]->bounding, matrix));
 			}
 		}
 
@@ -358,8 +657,41 @@ struct VKNode
 	}
 };
 
+// where the geometry of a model lives after loading.
+enum VKModelResidency
+{
+	// CPU copies stay next to the GPU buffers, for models whose vertices are edited and uploaded again.
+	VKModelResidency_CPUAndGPU = 0,
+	// CPU copies are released once the GPU buffers exist.
+	VKModelResidency_GPUOnly,
+	// no GPU buffers at all, e.g. collision meshes.
+	VKModelResidency_CPUOnly,
+};
+
+enum VKModelImportFlags
+{
+	VKModelImport_None = 0,
+	// splits meshes with more than 65535 vertices into several 16-bit index primitives instead of one 32-bit primitive.
+	VKModelImport_Split16BitPrimitives = 1 << 0,
+	// welds identical vertices and reorders triangles/vertices for the post-transform cache, overdraw and vertex fetch.
+	VKModelImport_Optimize = 1 << 1,
+	// appends up to 3 simplified index ranges (1/2, 1/4, 1/8 triangles) to every primitive, see VKPrimitive::lods.
+	VKModelImport_GenerateLODs = 1 << 2,
+	// splits the LOD 0 indices of every primitive into VKMeshlet clusters for CPU culling.
+	VKModelImport_BuildMeshlets = 1 << 3,
+	// fits a principal axis VKOrientedBox to every mesh besides its box and sphere.
+	VKModelImport_OrientedBounds = 1 << 4,
+	// builds a VKTriangleBVH of the source triangles of every mesh for ray casts, see VKRayCaster.
+	VKModelImport_TriangleBVH = 1 << 5,
+	// imports .glb files through Assimp as well instead of VKGLTFLoader, to compare the two.
+	VKModelImport_AssimpOnly = 1 << 6,
+};
+
 class VKModel
 {
+	friend class VKModelCooker;
+	friend class VKGLTFLoader;
+
 private:
 	VKModel()
 		: device(nullptr)
@@ -371,6 +703,7 @@ private:
 public:
 	~VKModel()
 	{
+		// instance primitives are deleted before core, whose buffers they borrow.
 		delete rootNode;
 		rootNode = nullptr;
 		device = nullptr;
@@ -396,28 +729,142 @@ public:
 
 	std::vector<VkVertexInputAttributeDescription> GetInputAttributes();
 
-	static VKModel* LoadFromFile(const std::string& filename, std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes);
+	// number of indexed draws needed to render every mesh once.
+	int32_t GetPrimitiveCount() const;
+
+	// moves the geometry of every primitive into the arena with one staging upload and releases the own buffers.
+	// needs the CPU copies of vertices/indices and an arena with the same attributes. Nothing changes on failure.
+	// load with a null cmdBuffer to skip the per primitive buffers entirely.
+	bool MoveToArena(VKGeometryArena* arena, VKCommandBuffer* uploadCmdBuffer);
+
+	// a cooked copy next to the source (see VKModelCooker) is used when it is up to date, otherwise Assimp imports it and the cache is written.
+	// importFlags is a combination of VKModelImportFlags.
+	static VKModel* LoadFromFile(const std::string& filename, std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes, uint32_t importFlags = VKModelImport_None, VKModelResidency residency = VKModelResidency_CPUAndGPU);
+
+	// interleaves streams into vertices in the attributes layout with one strided kernel per attribute.
+	// mmin/mmax receive the position bounds, mesh its dequantization values. skins is read for skinned meshes.
+	static void PackVertexStreams(const std::vector<VertexAttribute>& attributes, const std::vector<VKVertexSkin>& skins, const VKVertexStreams& streams, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh);
+
+	// GPU only models upload straight from the given data without keeping a copy.
+	static VKModel* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const float> vertices, Span<const uint16_t> indices, const std::vector<VertexAttribute>& attributes, VKModelResidency residency = VKModelResidency_CPUAndGPU);
+
+	// drops the CPU copies of every primitive with GPU data and switches the model to VKModelResidency_GPUOnly.
+	void ReleaseCPUData();
+
+	// vertex, instance and index bytes retained on the CPU.
+	int64_t GetCPUBytes() const;
+
+	// vertex, instance and index buffer bytes, arena primitives count their allocation. Instances only count their instance buffers.
+	int64_t GetGPUBytes() const;
+
+	// a model with its own nodes, bones, meshes and animation time drawing the GPU data of core through
+	// instance primitives, so LOD choice and instance buffers stay per instance. core is treated as
+	// immutable: instances cannot release or move its geometry. See VKModelCache.
+	static VKModel* CreateInstance(std::shared_ptr<VKModel> core);
+
+	inline bool IsInstance() const
+	{
+		return core != nullptr;
+	}
+
+	// post-transform cache statistics of all meshes before and after VKModelImport_Optimize.
+	inline const VKVertexCacheStats& GetCacheStatsBefore() const
+	{
+		return cacheStatsBefore;
+	}
+
+	inline const VKVertexCacheStats& GetCacheStatsAfter() const
+	{
+		return cacheStatsAfter;
+	}
+
+	// staging bytes needed for the primitives that have no GPU data yet.
+	VkDeviceSize GetUploadSize() const;
 
-	static VKModel* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const std::vector<float>& vertices, const std::vector<uint16_t>& indices, const std::vector<VertexAttribute>& attributes);
+	// creates the buffers of those primitives and records their copies from staging at offset, which is advanced.
+	// staging has to be mapped and hold GetUploadSize() bytes from offset on.
+	void RecordUpload(VkCommandBuffer uploadCmdBuffer, DVKBuffer* staging, VkDeviceSize& offset);
 
 protected:
 
-	VKNode* LoadNode(const aiNode* node, const aiScene* scene);
+	// one LoadMesh call, filled on a worker thread and linked to its node afterwards.
+	struct MeshJob
+	{
+		const aiMesh*		source = nullptr;
+		VKNode*				node = nullptr;
+		VKMesh*				mesh = nullptr;
+		VKVertexCacheStats	cacheBefore;
+		VKVertexCacheStats	cacheAfter;
+	};
+
+	// drops nodes, meshes, bones and animations, keeps device, layout and flags for another load.
+	void ClearContents();
+
+	// 8 when the layout has VA_SkinIndex8/VA_SkinWeight8 streams, 4 otherwise.
+	int32_t GetMaxSkinInfluences() const;
+
+	// links node below parent (or makes it the root) and appends it to linearNodes, nodesMap and
+	// transforms. Parents have to be added before their children.
+	void AddNode(VKNode* node, VKNode* parent, const Matrix4x4& localMatrix);
+
+	// builds the node tree and collects the meshes it references, in the order they are linked.
+	VKNode* LoadNode(const aiNode* node, VKNode* parent, const aiScene* scene, std::vector<MeshJob>& outMeshJobs);
+
+	// runs LoadMesh for every job on the thread pool, then links meshes to nodes and uploads.
+	void LoadMeshes(std::vector<MeshJob>& meshJobs, const aiScene* scene);
+
+	// only touches job and its mesh, safe to run for several jobs at once.
+	void LoadMesh(MeshJob& job, const aiScene* scene);
+
+	// GPU data of one primitive, read from its CPU copies or straight from e.g. a mapped cooked file.
+	struct PrimitiveUpload
+	{
+		VKPrimitive*		primitive = nullptr;
+		Span<const float>	vertices;
+		const void*			indices = nullptr;
+		uint32_t			indexCount = 0;
+		bool				index32 = false;
+	};
+
+	// the CPU copies of the primitives that have no GPU data yet.
+	void GatherUploads(std::vector<PrimitiveUpload>& outUploads) const;
 
-	VKMesh* LoadMesh(const aiMesh* mesh, const aiScene* scene);
+	static VkDeviceSize GetUploadSize(const std::vector<PrimitiveUpload>& uploads);
+
+	void RecordUpload(VkCommandBuffer uploadCmdBuffer, DVKBuffer* staging, VkDeviceSize& offset, const std::vector<PrimitiveUpload>& uploads);
+
+	// creates the vertex/index buffers of every primitive with a single staging buffer and submit.
+	void UploadPrimitives();
+
+	void UploadPrimitives(const std::vector<PrimitiveUpload>& uploads);
 
 	void LoadBones(const aiScene* aiScene);
 
-	void LoadSkin(std::unordered_map<uint32_t, VKVertexSkin>& skinInfoMap, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene);
+	// one VKVertexSkin per vertex, keeping the strongest 4 influences or 8 for VA_SkinIndex8/VA_SkinWeight8 layouts.
+	void LoadSkin(std::vector<VKVertexSkin>& outSkins, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene);
 
-	void LoadVertexDatas(std::unordered_map<uint32_t, VKVertexSkin>& skinInfoMap, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene);
+	void LoadVertexDatas(const std::vector<VKVertexSkin>& skins, const VKVertexStreams& streams, std::vector<float>& vertices, Vector3& mmax, Vector3& mmin, VKMesh* mesh);
 
 	void LoadIndices(std::vector<uint32_t>& indices, const aiMesh* aiMesh, const aiScene* aiScene);
 
+	// box, sphere and (with VKModelImport_OrientedBounds) oriented box from the source positions.
+	void LoadBoundingVolumes(const VKVertexStreams& streams, const Vector3& mmin, const Vector3& mmax, VKMesh* mesh);
+
+	// with VKModelImport_TriangleBVH, from the source positions and indices before any optimization.
+	void LoadTriangleBVH(const VKVertexStreams& streams, const std::vector<uint32_t>& indices, VKMesh* mesh);
+
 	void LoadPrimitives(std::vector<float>& vertices, std::vector<uint32_t>& indices, VKMesh* mesh, const aiMesh* aiMesh, const aiScene* aiScene);
 
+	void OptimizeMesh(std::vector<float>& vertices, std::vector<uint32_t>& indices, VKVertexCacheStats& outCacheBefore, VKVertexCacheStats& outCacheAfter);
+
+	void GenerateLODs(VKPrimitive* primitive, VKMesh* mesh);
+
+	void BuildMeshlets(VKPrimitive* primitive, VKMesh* mesh);
+
 	void LoadAnim(const aiScene* aiScene);
 
+	VKNode* CloneNode(const VKNode* source, VKNode* parent, std::unordered_map<const VKMesh*, VKMesh*>& outMeshMap);
+
 public:
 	typedef std::unordered_map<std::string, VKNode*> NodesMap;
 	typedef std::unordered_map<std::string, VKBone*> BonesMap;
@@ -425,7 +872,9 @@ public:
 	std::shared_ptr<VulkanDevice>	device;
 
 	VKNode* rootNode;
+	// topologically sorted, linearNodes[i]->transformIndex == i.
 	std::vector<VKNode*>			linearNodes;
+	VKTransformHierarchy			transforms;
 	std::vector<VKMesh*>			meshes;
 
 	NodesMap						nodesMap;
@@ -436,9 +885,17 @@ public:
 	std::vector<VertexAttribute>	attributes;
 	std::vector<VKAnimation>		animations;
 	int32_t							animIndex = -1;
+	uint32_t						importFlags = VKModelImport_None;
+	VKModelResidency				residency = VKModelResidency_CPUAndGPU;
+
+	// set on instances, keeps the shared geometry alive.
+	std::shared_ptr<VKModel>		core;
 
 private:
 
 	VKCommandBuffer* cmdBuffer = nullptr;
 	bool                            loadSkin = false;
+
+	VKVertexCacheStats				cacheStatsBefore;
+	VKVertexCacheStats				cacheStatsAfter;
 };
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "stdafx.h"
+#include "VKModelCache.h"
+#include "StringUtils.h"
+
+void VKModelCache::CoreRelease::operator()(VKModel* model)
+{
+	// model is owned by core. A core the trim keeps is still held by its entry.
+	std::shared_ptr<VKModelCache*> owner = cache.lock();
+	if (owner) {
+		(*owner)->Trim();
+	}
+	core.reset();
+}
+
+VKModelCache::~VKModelCache()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	// instances still alive keep their core, it is released with the last one.
+	m_Self.reset();
+
+	int32_t inUse = 0;
+	for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+		if (!it->second.users.expired()) {
+			inUse += 1;
+		}
+	}
+
+	if (inUse > 0) {
+		MLOG("Model cache destroyed with %d cores still in use.", inUse);
+	}
+
+	m_Entries.clear();
+	m_ResidentBytes = 0;
+}
+
+VKModelCache* VKModelCache::Create(std::shared_ptr<VulkanDevice> vulkanDevice, int64_t budgetBytes)
+{
+	VKModelCache* cache = new VKModelCache();
+	cache->device = vulkanDevice;
+	cache->budgetBytes = budgetBytes;
+	cache->m_Self = std::make_shared<VKModelCache*>(cache);
+	return cache;
+}
+
+std::string VKModelCache::GetKey(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency)
+{
+	// the whole layout, not a hash of it, so different layouts can never share a core.
+	std::string key = StringUtils::Printf("%s|%08x|%d|", filename.c_str(), importFlags, (int32_t)residency);
+	for (int32_t i = 0; i < attributes.size(); ++i) {
+		key += StringUtils::Printf("%d,", (int32_t)attributes[i]);
+	}
+	return key;
+}
+
+VKModel* VKModelCache::CreateInstance(Entry& entry)
+{
+	std::shared_ptr<VKModel> users = entry.users.lock();
+	if (!users)
+	{
+		CoreRelease release;
+		release.core = entry.core;
+		release.cache = m_Self;
+		users = std::shared_ptr<VKModel>(entry.core.get(), release);
+		entry.users = users;
+	}
+	return VKModel::CreateInstance(users);
+}
+
+VKModel* VKModelCache::Load(const std::string& filename, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency)
+{
+	std::string key = GetKey(filename, attributes, importFlags, residency);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	m_UseCounter += 1;
+
+	// a second load of a key that is being imported waits for it instead of importing again.
+	auto it = m_Entries.find(key);
+	while (it != m_Entries.end() && it->second.loading)
+	{
+		m_Loaded.wait(lock);
+		it = m_Entries.find(key);
+	}
+
+	if (it != m_Entries.end())
+	{
+		stats.hits += 1;
+		it->second.lastUse = m_UseCounter;
+		return CreateInstance(it->second);
+	}
+
+	Entry pending;
+	pending.loading = true;
+	m_Entries.insert(std::make_pair(key, pending));
+
+	// other keys load and hit the cache meanwhile.
+	lock.unlock();
+	VKModel* model = VKModel::LoadFromFile(filename, device, cmdBuffer, attributes, importFlags, residency);
+	lock.lock();
+
+	it = m_Entries.find(key);
+
+	if (model->rootNode == nullptr)
+	{
+		MLOGE("Model %s could not be loaded into the cache.", filename.c_str());
+		delete model;
+		m_Entries.erase(it);
+		m_Loaded.notify_all();
+		return nullptr;
+	}
+
+	stats.misses += 1;
+
+	Entry& entry = it->second;
+	entry.core = std::shared_ptr<VKModel>(model);
+	entry.bytes = model->GetGPUBytes() + model->GetCPUBytes();
+	entry.lastUse = m_UseCounter;
+	entry.loading = false;
+
+	VKModel* instance = CreateInstance(entry);
+
+	m_ResidentBytes += entry.bytes;
+	m_Loaded.notify_all();
+
+	EvictUnused(budgetBytes);
+
+	return instance;
+}
+
+int32_t VKModelCache::GetRefCount(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_Entries.find(GetKey(filename, attributes, importFlags, residency));
+	if (it == m_Entries.end() || it->second.loading) {
+		return -1;
+	}
+
+	// every instance holds one reference to the users pointer.
+	return (int32_t)it->second.users.use_count();
+}
+
+void VKModelCache::EvictUnused(int64_t budget)
+{
+	while (m_ResidentBytes > budget)
+	{
+		auto oldest = m_Entries.end();
+		for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+		{
+			if (it->second.loading || !it->second.users.expired()) {
+				continue;
+			}
+			if (oldest == m_Entries.end() || it->second.lastUse < oldest->second.lastUse) {
+				oldest = it;
+			}
+		}
+
+		// everything left is in use.
+		if (oldest == m_Entries.end()) {
+			return;
+		}
+
+		m_ResidentBytes -= oldest->second.bytes;
+		m_Entries.erase(oldest);
+		stats.evictions += 1;
+	}
+}
+
+void VKModelCache::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	EvictUnused(budgetBytes);
+}
+
+void VKModelCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	EvictUnused(-1);
+}
+
+int64_t VKModelCache::GetResidentBytes()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_ResidentBytes;
+}
+
+void VKModelCache::LogStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	MLOG(
+		"Model cache: %d cores, %.2fMB of %.2fMB budget, %d hits, %d misses, %d evictions",
+		(int32_t)m_Entries.size(), m_ResidentBytes / (1024.0 * 1024.0), budgetBytes / (1024.0 * 1024.0),
+		stats.hits, stats.misses, stats.evictions
+	);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "VKModel.h"
+
+#include <condition_variable>
+#include <mutex>
+
+// Shares the geometry, skeleton and animations of models loaded from the same file with the same
+// vertex layout, import flags and residency. Load returns a VKModel::CreateInstance of the shared
+// core, so only the first load imports and uploads. When the last instance of a core is deleted the
+// cache trims itself: unused cores stay cached only while they fit the memory budget and are evicted
+// least recently used first, a budget of 0 releases every core with its last instance.
+class VKModelCache
+{
+public:
+	struct Stats
+	{
+		int32_t		hits = 0;
+		int32_t		misses = 0;
+		int32_t		evictions = 0;
+	};
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<VKModel>	core;
+		// shared by the instances, expires with the last one. See CoreRelease.
+		std::weak_ptr<VKModel>		users;
+		// GPU and CPU bytes of the core.
+		int64_t						bytes = 0;
+		uint64_t					lastUse = 0;
+		// imported outside the lock, loads of the same key wait for it.
+		bool						loading = false;
+	};
+
+	// deleter of the users pointer: keeps the core alive for the instances and tells the cache when the last one is gone.
+	struct CoreRelease
+	{
+		std::shared_ptr<VKModel>			core;
+		std::weak_ptr<VKModelCache*>		cache;
+
+		void operator()(VKModel* model);
+	};
+
+	VKModelCache()
+	{
+
+	}
+
+public:
+	~VKModelCache();
+
+	// budgetBytes only limits unused cores, cores with live instances are never evicted.
+	static VKModelCache* Create(std::shared_ptr<VulkanDevice> vulkanDevice, int64_t budgetBytes);
+
+	// delete the instance like any model. nullptr when the file could not be loaded. Different keys import
+	// in parallel, so concurrent callers need their own cmdBuffer.
+	VKModel* Load(const std::string& filename, VKCommandBuffer* cmdBuffer, const std::vector<VertexAttribute>& attributes, uint32_t importFlags = VKModelImport_None, VKModelResidency residency = VKModelResidency_CPUAndGPU);
+
+	// live instances of a cached core, -1 when it is not cached.
+	int32_t GetRefCount(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags = VKModelImport_None, VKModelResidency residency = VKModelResidency_CPUAndGPU);
+
+	// evicts unused cores until the cache fits the budget, also called when a core loses its last instance.
+	void Trim();
+
+	// evicts every unused core.
+	void Clear();
+
+	int64_t GetResidentBytes();
+
+	void LogStats();
+
+public:
+	std::shared_ptr<VulkanDevice>	device;
+	int64_t							budgetBytes = 0;
+	Stats							stats;
+
+private:
+	static std::string GetKey(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency);
+
+	// an instance of the entry's core sharing its users pointer. Called with the lock held.
+	VKModel* CreateInstance(Entry& entry);
+
+	void EvictUnused(int64_t budget);
+
+private:
+	std::unordered_map<std::string, Entry>	m_Entries;
+	uint64_t								m_UseCounter = 0;
+	int64_t									m_ResidentBytes = 0;
+	std::mutex								m_Mutex;
+	std::condition_variable					m_Loaded;
+	// expires with the cache, instances outliving it no longer call back.
+	std::shared_ptr<VKModelCache*>			m_Self;
+};
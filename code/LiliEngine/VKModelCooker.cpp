@@ -0,0 +1,493 @@
+#include "stdafx.h"
+#include "VKModelCooker.h"
+#include "FileManager.h"
+#include "StringUtils.h"
+#include "Alignment.h"
+#include "crc32.h"
+
+static const uint32_t COOKED_MODEL_MAGIC = 0x4C444D4C; // LMDL
+static const uint32_t COOKED_MODEL_VERSION = 9;
+
+struct VKCookedModelHeader
+{
+	uint32_t	magic = COOKED_MODEL_MAGIC;
+	uint32_t	version = COOKED_MODEL_VERSION;
+	uint32_t	layoutHash = 0;
+	uint32_t	dataSize = 0;
+	uint64_t	sourceSize = 0;
+	uint64_t	sourceTime = 0;
+};
+
+// every field is padded to 4 bytes, blobs are copied or uploaded straight from the mapping.
+class VKCookedWriter
+{
+public:
+	template<typename T>
+	void Write(const T& value)
+	{
+		WriteBytes(&value, sizeof(T));
+	}
+
+	template<typename T>
+	void WriteArray(const std::vector<T>& values)
+	{
+		Write<uint32_t>(values.size());
+		WriteBytes(values.data(), values.size() * sizeof(T));
+	}
+
+	void WriteString(const std::string& str)
+	{
+		Write<uint32_t>(str.size());
+		WriteBytes(str.data(), str.size());
+	}
+
+	void WriteBytes(const void* dataPtr, uint32_t size)
+	{
+		uint32_t offset = datas.size();
+		datas.resize(offset + Align(size, 4), 0);
+		if (size > 0) {
+			memcpy(datas.data() + offset, dataPtr, size);
+		}
+	}
+
+public:
+	std::vector<uint8_t> datas;
+};
+
+class VKCookedReader
+{
+public:
+	VKCookedReader(const uint8_t* inDataPtr, uint32_t inDataSize)
+		: dataPtr(inDataPtr)
+		, dataSize(inDataSize)
+	{
+
+	}
+
+	template<typename T>
+	T Read()
+	{
+		T value = {};
+		const uint8_t* src = Skip(sizeof(T));
+		if (src) {
+			memcpy(&value, src, sizeof(T));
+		}
+		return value;
+	}
+
+	template<typename T>
+	const T* ReadArrayPtr(uint32_t& outCount)
+	{
+		outCount = Read<uint32_t>();
+
+		// checked before multiplying so a corrupt count can't wrap the byte size.
+		if (failed || outCount > (dataSize - offset) / sizeof(T))
+		{
+			failed = true;
+			outCount = 0;
+			return nullptr;
+		}
+
+		const T* src = (const T*)Skip((uint64_t)outCount * sizeof(T));
+		if (src == nullptr) {
+			outCount = 0;
+		}
+		return src;
+	}
+
+	template<typename T>
+	void ReadArray(std::vector<T>& outValues)
+	{
+		uint32_t count = 0;
+		const T* src = ReadArrayPtr<T>(count);
+		outValues.resize(count);
+		if (count > 0) {
+			memcpy(outValues.data(), src, count * sizeof(T));
+		}
+	}
+
+	std::string ReadString()
+	{
+		uint32_t count = 0;
+		const char* src = ReadArrayPtr<char>(count);
+		return count > 0 ? std::string(src, count) : std::string();
+	}
+
+	const uint8_t* Skip(uint64_t size)
+	{
+		uint64_t alignedSize = Align(size, 4);
+		if (failed || alignedSize > dataSize - offset)
+		{
+			failed = true;
+			return nullptr;
+		}
+
+		const uint8_t* src = dataPtr + offset;
+		offset += (uint32_t)alignedSize;
+		return src;
+	}
+
+public:
+	const uint8_t*	dataPtr = nullptr;
+	uint32_t		dataSize = 0;
+	uint32_t		offset = 0;
+	bool			failed = false;
+};
+
+template<typename T>
+static void WriteChannel(VKCookedWriter& writer, const VKAnimChannel<T>& channel)
+{
+	writer.WriteArray(channel.keys);
+	writer.WriteArray(channel.values);
+}
+
+template<typename T>
+static void ReadChannel(VKCookedReader& reader, VKAnimChannel<T>& channel)
+{
+	reader.ReadArray(channel.keys);
+	reader.ReadArray(channel.values);
+}
+
+uint32_t VKModelCooker::GetLayoutHash(const std::vector<VertexAttribute>& attributes, uint32_t importFlags)
+{
+	std::vector<int32_t> layout(attributes.size() + 1);
+	for (int32_t i = 0; i < attributes.size(); ++i) {
+		layout[i] = (int32_t)attributes[i];
+	}
+	layout[attributes.size()] = importFlags;
+	return crc32(layout.data(), layout.size() * sizeof(int32_t));
+}
+
+std::string VKModelCooker::GetCookedPath(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags)
+{
+	return filename + StringUtils::Printf(".%08x.lmdl", GetLayoutHash(attributes, importFlags));
+}
+
+bool VKModelCooker::Save(VKModel* model, const std::string& sourcePath, const std::string& cookedPath)
+{
+	VKCookedModelHeader header;
+	header.layoutHash = GetLayoutHash(model->attributes, model->importFlags);
+	if (!FileManager::GetFileInfo(sourcePath, header.sourceSize, header.sourceTime)) {
+		return false;
+	}
+
+	VKCookedWriter writer;
+	writer.Write(header);
+
+	// bones
+	writer.Write<uint32_t>(model->bones.size());
+	for (int32_t i = 0; i < model->bones.size(); ++i)
+	{
+		VKBone* bone = model->bones[i];
+		writer.WriteString(bone->name);
+		writer.Write<int32_t>(bone->index);
+		writer.Write<int32_t>(bone->parent);
+		writer.Write(bone->inverseBindPose);
+	}
+
+	// meshes
+	std::unordered_map<VKMesh*, int32_t> meshIndexMap;
+	writer.Write<uint32_t>(model->meshes.size());
+	for (int32_t i = 0; i < model->meshes.size(); ++i)
+	{
+		VKMesh* mesh = model->meshes[i];
+		meshIndexMap.insert(std::make_pair(mesh, i));
+
+		writer.WriteString(mesh->material.diffuse);
+		writer.WriteString(mesh->material.normalmap);
+		writer.WriteString(mesh->material.specular);
+		writer.Write(mesh->bounding.min);
+		writer.Write(mesh->bounding.max);
+		writer.Write(mesh->sphere);
+		writer.Write(mesh->orientedBox);
+		writer.Write(mesh->positionScale);
+		writer.Write(mesh->positionOffset);
+		writer.Write(mesh->uvDequantize[0]);
+		writer.Write(mesh->uvDequantize[1]);
+		writer.WriteArray(mesh->bones);
+		writer.Write<uint32_t>(mesh->isSkin ? 1 : 0);
+		writer.Write<int32_t>(mesh->vertexCount);
+		writer.Write<int32_t>(mesh->triangleCount);
+
+		writer.Write<uint32_t>(mesh->triangleBVH ? 1 : 0);
+		if (mesh->triangleBVH)
+		{
+			writer.WriteArray(mesh->triangleBVH->nodes);
+			writer.WriteArray(mesh->triangleBVH->vertices);
+			writer.WriteArray(mesh->triangleBVH->triangles);
+		}
+
+		writer.Write<uint32_t>(mesh->primitives.size());
+		for (int32_t j = 0; j < mesh->primitives.size(); ++j)
+		{
+			VKPrimitive* primitive = mesh->primitives[j];
+			writer.Write<int32_t>(primitive->vertexCount);
+			writer.Write<int32_t>(primitive->triangleNum);
+			writer.WriteArray(primitive->lods);
+			writer.WriteArray(primitive->meshlets);
+			writer.WriteArray(primitive->vertices);
+			writer.Write<uint32_t>(primitive->indices32.size() > 0 ? 1 : 0);
+			if (primitive->indices32.size() > 0) {
+				writer.WriteArray(primitive->indices32);
+			}
+			else {
+				writer.WriteArray(primitive->indices);
+			}
+		}
+	}
+
+	// nodes, parents always come before their children.
+	std::unordered_map<VKNode*, int32_t> nodeIndexMap;
+	writer.Write<uint32_t>(model->linearNodes.size());
+	for (int32_t i = 0; i < model->linearNodes.size(); ++i)
+	{
+		VKNode* node = model->linearNodes[i];
+		nodeIndexMap.insert(std::make_pair(node, i));
+
+		writer.WriteString(node->name);
+		writer.Write<int32_t>(node->parent ? nodeIndexMap[node->parent] : -1);
+		writer.Write(node->GetLocalMatrix());
+
+		std::vector<int32_t> meshIndices(node->meshes.size());
+		for (int32_t j = 0; j < node->meshes.size(); ++j) {
+			meshIndices[j] = meshIndexMap[node->meshes[j]];
+		}
+		writer.WriteArray(meshIndices);
+	}
+
+	// animations
+	writer.Write<uint32_t>(model->animations.size());
+	for (int32_t i = 0; i < model->animations.size(); ++i)
+	{
+		VKAnimation& animation = model->animations[i];
+		writer.WriteString(animation.name);
+		writer.Write(animation.duration);
+
+		writer.Write<uint32_t>(animation.clips->size());
+		for (auto it = animation.clips->begin(); it != animation.clips->end(); ++it)
+		{
+			const VKAnimationClip& clip = it->second;
+			writer.WriteString(clip.nodeName);
+			writer.Write(clip.duration);
+			WriteChannel(writer, clip.positions);
+			WriteChannel(writer, clip.scales);
+			WriteChannel(writer, clip.rotations);
+		}
+	}
+
+	VKCookedModelHeader* headerPtr = (VKCookedModelHeader*)writer.datas.data();
+	headerPtr->dataSize = writer.datas.size();
+
+	return FileManager::WriteFile(cookedPath, writer.datas.data(), writer.datas.size());
+}
+
+bool VKModelCooker::Load(VKModel* model, const std::string& sourcePath, const std::string& cookedPath)
+{
+	MappedFile mappedFile;
+	if (!FileManager::MapFile(cookedPath, mappedFile)) {
+		return false;
+	}
+
+	VKCookedReader reader(mappedFile.dataPtr, mappedFile.dataSize);
+	VKCookedModelHeader header = reader.Read<VKCookedModelHeader>();
+
+	// a missing source is fine, cooked data can ship on its own.
+	uint64_t sourceSize = header.sourceSize;
+	uint64_t sourceTime = header.sourceTime;
+	FileManager::GetFileInfo(sourcePath, sourceSize, sourceTime);
+
+	if (reader.failed ||
+		header.magic != COOKED_MODEL_MAGIC ||
+		header.version != COOKED_MODEL_VERSION ||
+		header.layoutHash != GetLayoutHash(model->attributes, model->importFlags) ||
+		header.dataSize != mappedFile.dataSize ||
+		header.sourceSize != sourceSize ||
+		header.sourceTime != sourceTime)
+	{
+		FileManager::UnmapFile(mappedFile);
+		return false;
+	}
+
+	// bones
+	uint32_t boneCount = reader.Read<uint32_t>();
+	for (uint32_t i = 0; i < boneCount && !reader.failed; ++i)
+	{
+		VKBone* bone = new VKBone();
+		bone->name = reader.ReadString();
+		bone->index = reader.Read<int32_t>();
+		bone->parent = reader.Read<int32_t>();
+		bone->inverseBindPose = reader.Read<Matrix4x4>();
+		model->bones.push_back(bone);
+		model->bonesMap.insert(std::make_pair(bone->name, bone));
+	}
+
+	// GPU only models upload straight from the mapping and keep no CPU copy, deferred uploads
+	// (no cmdBuffer, e.g. VKModelLoader) need the copy because the mapping is gone by then.
+	const bool keepCPUData = model->residency != VKModelResidency_GPUOnly || model->cmdBuffer == nullptr;
+	std::vector<VKModel::PrimitiveUpload> uploads;
+
+	// meshes
+	std::vector<VKMesh*> meshes;
+	uint32_t meshCount = reader.Read<uint32_t>();
+	for (uint32_t i = 0; i < meshCount && !reader.failed; ++i)
+	{
+		VKMesh* mesh = new VKMesh();
+		meshes.push_back(mesh);
+
+		mesh->material.diffuse = reader.ReadString();
+		mesh->material.normalmap = reader.ReadString();
+		mesh->material.specular = reader.ReadString();
+		mesh->bounding.min = reader.Read<Vector3>();
+		mesh->bounding.max = reader.Read<Vector3>();
+		mesh->bounding.UpdateCorners();
+		mesh->sphere = reader.Read<VKBoundingSphere>();
+		mesh->orientedBox = reader.Read<VKOrientedBox>();
+		mesh->positionScale = reader.Read<Vector3>();
+		mesh->positionOffset = reader.Read<Vector3>();
+		mesh->uvDequantize[0] = reader.Read<Vector4>();
+		mesh->uvDequantize[1] = reader.Read<Vector4>();
+		reader.ReadArray(mesh->bones);
+		mesh->isSkin = reader.Read<uint32_t>() != 0;
+		mesh->vertexCount = reader.Read<int32_t>();
+		mesh->triangleCount = reader.Read<int32_t>();
+
+		if (reader.Read<uint32_t>() != 0)
+		{
+			VKTriangleBVH* triangleBVH = new VKTriangleBVH();
+			reader.ReadArray(triangleBVH->nodes);
+			reader.ReadArray(triangleBVH->vertices);
+			reader.ReadArray(triangleBVH->triangles);
+			mesh->triangleBVH.reset(triangleBVH);
+		}
+
+		uint32_t primitiveCount = reader.Read<uint32_t>();
+		for (uint32_t j = 0; j < primitiveCount && !reader.failed; ++j)
+		{
+			VKPrimitive* primitive = new VKPrimitive();
+			mesh->primitives.push_back(primitive);
+
+			primitive->vertexCount = reader.Read<int32_t>();
+			primitive->triangleNum = reader.Read<int32_t>();
+			reader.ReadArray(primitive->lods);
+			reader.ReadArray(primitive->meshlets);
+
+			uint32_t floatCount = 0;
+			const float* vertexPtr = reader.ReadArrayPtr<float>(floatCount);
+			bool index32 = reader.Read<uint32_t>() != 0;
+			uint32_t indexCount = 0;
+			const void* indexPtr = nullptr;
+			if (index32)
+			{
+				const uint32_t* indexPtr32 = reader.ReadArrayPtr<uint32_t>(indexCount);
+				if (keepCPUData) {
+					primitive->indices32.assign(indexPtr32, indexPtr32 + indexCount);
+				}
+				indexPtr = indexPtr32;
+			}
+			else
+			{
+				const uint16_t* indexPtr16 = reader.ReadArrayPtr<uint16_t>(indexCount);
+				if (keepCPUData) {
+					primitive->indices.assign(indexPtr16, indexPtr16 + indexCount);
+				}
+				indexPtr = indexPtr16;
+			}
+
+			if (keepCPUData) {
+				primitive->vertices.assign(vertexPtr, vertexPtr + floatCount);
+			}
+
+			if (floatCount > 0 && !reader.failed)
+			{
+				VKModel::PrimitiveUpload upload;
+				upload.primitive = primitive;
+				upload.vertices = Span<const float>(vertexPtr, floatCount);
+				upload.indices = indexPtr;
+				upload.indexCount = indexCount;
+				upload.index32 = index32;
+				uploads.push_back(upload);
+			}
+		}
+	}
+
+	// nodes
+	uint32_t nodeCount = reader.Read<uint32_t>();
+	for (uint32_t i = 0; i < nodeCount && !reader.failed; ++i)
+	{
+		std::string name = reader.ReadString();
+		int32_t parentIndex = reader.Read<int32_t>();
+		Matrix4x4 localMatrix = reader.Read<Matrix4x4>();
+
+		VKNode* parent = nullptr;
+		if (parentIndex >= 0 && parentIndex < model->linearNodes.size()) {
+			parent = model->linearNodes[parentIndex];
+		}
+		else if (model->rootNode != nullptr)
+		{
+			reader.failed = true;
+			break;
+		}
+
+		VKNode* node = new VKNode();
+		node->name = name;
+		model->AddNode(node, parent, localMatrix);
+
+		uint32_t indexCount = 0;
+		const int32_t* meshIndices = reader.ReadArrayPtr<int32_t>(indexCount);
+		for (uint32_t j = 0; j < indexCount; ++j)
+		{
+			if (meshIndices[j] < 0 || meshIndices[j] >= meshes.size()) {
+				continue;
+			}
+			VKMesh* mesh = meshes[meshIndices[j]];
+			mesh->linkNode = node;
+			node->meshes.push_back(mesh);
+			model->meshes.push_back(mesh);
+		}
+	}
+
+	// animations
+	uint32_t animationCount = reader.Read<uint32_t>();
+	for (uint32_t i = 0; i < animationCount && !reader.failed; ++i)
+	{
+		model->animations.push_back(VKAnimation());
+		VKAnimation& animation = model->animations.back();
+		animation.name = reader.ReadString();
+		animation.duration = reader.Read<float>();
+
+		std::shared_ptr<VKAnimation::ClipsMap> clips = std::make_shared<VKAnimation::ClipsMap>();
+		uint32_t clipCount = reader.Read<uint32_t>();
+		for (uint32_t j = 0; j < clipCount && !reader.failed; ++j)
+		{
+			std::string nodeName = reader.ReadString();
+			VKAnimationClip& clip = (*clips)[nodeName];
+			clip.nodeName = nodeName;
+			clip.duration = reader.Read<float>();
+			ReadChannel(reader, clip.positions);
+			ReadChannel(reader, clip.scales);
+			ReadChannel(reader, clip.rotations);
+		}
+		animation.clips = clips;
+	}
+
+	// staged from the mapping before it is closed, without a second copy.
+	if (!reader.failed) {
+		model->UploadPrimitives(uploads);
+	}
+
+	FileManager::UnmapFile(mappedFile);
+
+	if (reader.failed)
+	{
+		// meshes owned by a node are released with the model.
+		for (int32_t i = 0; i < meshes.size(); ++i)
+		{
+			if (meshes[i]->linkNode == nullptr) {
+				delete meshes[i];
+			}
+		}
+		MLOGE("Cooked model %s is corrupted.", cookedPath.c_str());
+	}
+
+	return !reader.failed;
+}
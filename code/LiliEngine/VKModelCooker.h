@@ -0,0 +1,20 @@
+#pragma once
+
+#include "VKModel.h"
+
+// Binary snapshot of an imported VKModel. Vertex and index blobs are stored in the requested
+// VertexAttribute layout next to nodes, bones, bounds and animation channels, so loading is a
+// mapped file walk with the blobs uploaded straight from the mapping.
+class VKModelCooker
+{
+public:
+	// covers the vertex layout and the VKModelImportFlags the model was imported with.
+	static uint32_t GetLayoutHash(const std::vector<VertexAttribute>& attributes, uint32_t importFlags);
+
+	static std::string GetCookedPath(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags);
+
+	// false when the cooked file is missing, stale, or was cooked for another layout or version.
+	static bool Load(VKModel* model, const std::string& sourcePath, const std::string& cookedPath);
+
+	static bool Save(VKModel* model, const std::string& sourcePath, const std::string& cookedPath);
+};
@@ -0,0 +1,402 @@
+#include "stdafx.h"
+#include "VKModelLoader.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "ThreadPool.h"
+#include "Time.h"
+
+VKModelLoader::~VKModelLoader()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		for (int32_t i = 0; i < m_Queued.size(); ++i) {
+			m_Queued[i]->m_State = VKModelLoad_Failed;
+		}
+		m_Queued.clear();
+		m_Condition.wait(lock, [this] { return m_PendingTasks == 0; });
+	}
+
+	VkDevice vkDevice = device->GetInstanceHandle();
+
+	if (m_InFlight.size() > 0)
+	{
+		vkWaitForFences(vkDevice, 1, &(m_TransferCmd->fence), VK_TRUE, UINT64_MAX);
+		FinishUpload();
+	}
+
+	if (m_AcquirePending) {
+		vkWaitForFences(vkDevice, 1, &(m_AcquireCmd->fence), VK_TRUE, UINT64_MAX);
+	}
+
+	// decoded but never uploaded.
+	for (int32_t i = 0; i < m_Decoded.size(); ++i) {
+		m_Decoded[i]->m_State = VKModelLoad_Failed;
+	}
+	m_Decoded.clear();
+
+	delete m_TransferCmd;
+	delete m_AcquireCmd;
+	m_TransferCmd = nullptr;
+	m_AcquireCmd = nullptr;
+
+	vkDestroyCommandPool(vkDevice, m_TransferPool, VULKAN_CPU_ALLOCATOR);
+	vkDestroyCommandPool(vkDevice, m_GraphicsPool, VULKAN_CPU_ALLOCATOR);
+}
+
+VKModelLoader* VKModelLoader::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VkDeviceSize uploadBytesPerFrame)
+{
+	VKModelLoader* loader = new VKModelLoader();
+	loader->device = vulkanDevice;
+	loader->uploadBytesPerFrame = uploadBytesPerFrame;
+
+	loader->m_TransferQueue = vulkanDevice->GetTransferQueue();
+	loader->m_GraphicsQueue = vulkanDevice->GetGraphicsQueue();
+	loader->m_TransferFamily = loader->m_TransferQueue->GetFamilyIndex();
+	loader->m_GraphicsFamily = loader->m_GraphicsQueue->GetFamilyIndex();
+
+	VkDevice vkDevice = vulkanDevice->GetInstanceHandle();
+
+	VkCommandPoolCreateInfo transferPoolInfo;
+	ZeroVulkanStruct(transferPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+	transferPoolInfo.queueFamilyIndex = loader->m_TransferFamily;
+	transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	VERIFYVULKANRESULT(vkCreateCommandPool(vkDevice, &transferPoolInfo, VULKAN_CPU_ALLOCATOR, &(loader->m_TransferPool)));
+
+	VkCommandPoolCreateInfo graphicsPoolInfo;
+	ZeroVulkanStruct(graphicsPoolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+	graphicsPoolInfo.queueFamilyIndex = loader->m_GraphicsFamily;
+	graphicsPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	VERIFYVULKANRESULT(vkCreateCommandPool(vkDevice, &graphicsPoolInfo, VULKAN_CPU_ALLOCATOR, &(loader->m_GraphicsPool)));
+
+	loader->m_TransferCmd = VKCommandBuffer::Create(vulkanDevice, loader->m_TransferPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, loader->m_TransferQueue);
+	loader->m_AcquireCmd = VKCommandBuffer::Create(vulkanDevice, loader->m_GraphicsPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, loader->m_GraphicsQueue);
+
+	return loader;
+}
+
+std::shared_ptr<VKModelHandle> VKModelLoader::Load(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, VKModelResidency residency, int32_t priority, VKModel* placeholder)
+{
+	std::shared_ptr<VKModelHandle> handle = std::make_shared<VKModelHandle>();
+	handle->filename = filename;
+	handle->attributes = attributes;
+	handle->importFlags = importFlags;
+	handle->residency = residency;
+	handle->placeholder = placeholder;
+	handle->m_Priority = priority;
+	handle->m_StartTime = GenericPlatformTime::Seconds();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		handle->m_Sequence = m_Sequence++;
+		m_Queued.push_back(handle);
+		m_PendingTasks += 1;
+	}
+
+	// every task decodes whichever queued model has the highest priority at the time it runs.
+	ThreadPool::Get().Submit([this]() { DecodeNext(); });
+
+	return handle;
+}
+
+void VKModelLoader::SetPriority(std::shared_ptr<VKModelHandle> handle, int32_t priority)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	handle->m_Priority = priority;
+}
+
+void VKModelLoader::DecodeNext()
+{
+	std::shared_ptr<VKModelHandle> handle;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		int32_t best = -1;
+		for (int32_t i = 0; i < m_Queued.size(); ++i)
+		{
+			if (best == -1 || m_Queued[i]->m_Priority > m_Queued[best]->m_Priority ||
+				(m_Queued[i]->m_Priority == m_Queued[best]->m_Priority && m_Queued[i]->m_Sequence < m_Queued[best]->m_Sequence)) {
+				best = i;
+			}
+		}
+
+		if (best != -1)
+		{
+			handle = m_Queued[best];
+			m_Queued.erase(m_Queued.begin() + best);
+			handle->m_State = VKModelLoad_Decoding;
+		}
+	}
+
+	// a handle only the task still holds was dropped by its owner, the load is skipped.
+	if (handle && handle.use_count() > 1)
+	{
+		// no command buffer, so nothing touches the GPU or its queues on this thread.
+		VKModel* model = VKModel::LoadFromFile(handle->filename, device, nullptr, handle->attributes, handle->importFlags, VKModelResidency_CPUOnly);
+
+		if (model->rootNode == nullptr)
+		{
+			MLOGE("Model %s could not be streamed in.", handle->filename.c_str());
+			delete model;
+			handle->m_State = VKModelLoad_Failed;
+		}
+		else
+		{
+			handle->m_Model = model;
+			handle->bounds = model->rootNode->GetBounds();
+			handle->m_State = VKModelLoad_Uploading;
+		}
+
+		// failed loads too, stats are only touched by Update.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Decoded.push_back(handle);
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_PendingTasks -= 1;
+	m_Condition.notify_all();
+}
+
+void VKModelLoader::Update()
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	if (m_InFlight.size() > 0)
+	{
+		if (vkGetFenceStatus(device->GetInstanceHandle(), m_TransferCmd->fence) != VK_SUCCESS) {
+			return;
+		}
+		FinishUpload();
+	}
+
+	std::vector<std::shared_ptr<VKModelHandle>> batch;
+	std::vector<std::shared_ptr<VKModelHandle>> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		std::stable_sort(m_Decoded.begin(), m_Decoded.end(), [](const std::shared_ptr<VKModelHandle>& a, const std::shared_ptr<VKModelHandle>& b) {
+			return a->m_Priority > b->m_Priority;
+		});
+
+		// at least one model per batch, even when it alone exceeds the budget.
+		VkDeviceSize batchSize = 0;
+		int32_t index = 0;
+		while (index < m_Decoded.size())
+		{
+			std::shared_ptr<VKModelHandle>& handle = m_Decoded[index];
+			if (handle->GetState() == VKModelLoad_Failed || handle->residency == VKModelResidency_CPUOnly)
+			{
+				finished.push_back(handle);
+				m_Decoded.erase(m_Decoded.begin() + index);
+				continue;
+			}
+
+			VkDeviceSize size = handle->m_Model->GetUploadSize();
+			if (batch.size() > 0 && batchSize + size > uploadBytesPerFrame)
+			{
+				index += 1;
+				continue;
+			}
+
+			batchSize += size;
+			batch.push_back(handle);
+			m_Decoded.erase(m_Decoded.begin() + index);
+		}
+	}
+
+	for (int32_t i = 0; i < finished.size(); ++i)
+	{
+		if (finished[i]->GetState() == VKModelLoad_Failed) {
+			stats.failed += 1;
+		}
+		else {
+			FinishHandle(finished[i].get());
+		}
+	}
+
+	if (batch.size() > 0) {
+		StartUpload(batch);
+	}
+
+	stats.maxUpdateMs = std::max(stats.maxUpdateMs, (GenericPlatformTime::Seconds() - startTime) * 1000.0);
+}
+
+void VKModelLoader::StartUpload(std::vector<std::shared_ptr<VKModelHandle>>& handles)
+{
+	VkDeviceSize totalSize = 0;
+	for (int32_t i = 0; i < handles.size(); ++i) {
+		totalSize += handles[i]->m_Model->GetUploadSize();
+	}
+
+	if (totalSize == 0)
+	{
+		for (int32_t i = 0; i < handles.size(); ++i) {
+			FinishHandle(handles[i].get());
+		}
+		return;
+	}
+
+	m_Staging = DVKBuffer::CreateBuffer(
+		device,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		totalSize
+	);
+	m_Staging->Map();
+
+	m_InFlight = handles;
+
+	m_TransferCmd->Begin();
+
+	VkDeviceSize offset = 0;
+	for (int32_t i = 0; i < handles.size(); ++i) {
+		handles[i]->m_Model->RecordUpload(m_TransferCmd->cmdBuffer, m_Staging, offset);
+	}
+
+	if (NeedsOwnershipTransfer()) {
+		RecordOwnershipBarriers(m_TransferCmd->cmdBuffer, true);
+	}
+
+	m_TransferCmd->End();
+
+	// unlike VKCommandBuffer::Submit the fence is only polled in Update.
+	VkSubmitInfo submitInfo;
+	ZeroVulkanStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &(m_TransferCmd->cmdBuffer);
+
+	vkResetFences(device->GetInstanceHandle(), 1, &(m_TransferCmd->fence));
+	vkQueueSubmit(m_TransferQueue->GetHandle(), 1, &submitInfo, m_TransferCmd->fence);
+
+	stats.uploads += 1;
+}
+
+void VKModelLoader::FinishUpload()
+{
+	if (NeedsOwnershipTransfer())
+	{
+		VkDevice vkDevice = device->GetInstanceHandle();
+		if (m_AcquirePending) {
+			vkWaitForFences(vkDevice, 1, &(m_AcquireCmd->fence), VK_TRUE, UINT64_MAX);
+		}
+
+		m_AcquireCmd->Begin();
+		RecordOwnershipBarriers(m_AcquireCmd->cmdBuffer, false);
+		m_AcquireCmd->End();
+
+		// later graphics submissions are ordered after the acquire, so the models are usable right away.
+		VkSubmitInfo submitInfo;
+		ZeroVulkanStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &(m_AcquireCmd->cmdBuffer);
+
+		vkResetFences(vkDevice, 1, &(m_AcquireCmd->fence));
+		vkQueueSubmit(m_GraphicsQueue->GetHandle(), 1, &submitInfo, m_AcquireCmd->fence);
+		m_AcquirePending = true;
+	}
+
+	m_Staging->UnMap();
+	delete m_Staging;
+	m_Staging = nullptr;
+
+	for (int32_t i = 0; i < m_InFlight.size(); ++i) {
+		FinishHandle(m_InFlight[i].get());
+	}
+	m_InFlight.clear();
+}
+
+void VKModelLoader::FinishHandle(VKModelHandle* handle)
+{
+	VKModel* model = handle->m_Model;
+	model->residency = handle->residency;
+	if (handle->residency == VKModelResidency_GPUOnly) {
+		model->ReleaseCPUData();
+	}
+
+	stats.loaded += 1;
+	MLOG("Model %s streamed in %.2fms", handle->filename.c_str(), (GenericPlatformTime::Seconds() - handle->m_StartTime) * 1000.0);
+
+	handle->m_State = VKModelLoad_Ready;
+}
+
+void VKModelLoader::RecordOwnershipBarriers(VkCommandBuffer cmdBuffer, bool release)
+{
+	std::vector<VkBufferMemoryBarrier> barriers;
+	for (int32_t i = 0; i < m_InFlight.size(); ++i)
+	{
+		VKModel* model = m_InFlight[i]->m_Model;
+		for (int32_t j = 0; j < model->meshes.size(); ++j)
+		{
+			for (int32_t k = 0; k < model->meshes[j]->primitives.size(); ++k)
+			{
+				VKPrimitive* primitive = model->meshes[j]->primitives[k];
+				DVKBuffer* buffers[2] = {
+					primitive->vertexBuffer ? primitive->vertexBuffer->dvkBuffer : nullptr,
+					primitive->indexBuffer ? primitive->indexBuffer->dvkBuffer : nullptr
+				};
+
+				for (int32_t b = 0; b < 2; ++b)
+				{
+					if (buffers[b] == nullptr) {
+						continue;
+					}
+
+					VkBufferMemoryBarrier barrier;
+					ZeroVulkanStruct(barrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
+					barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+					barrier.dstAccessMask = release ? 0 : (VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+					barrier.srcQueueFamilyIndex = m_TransferFamily;
+					barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+					barrier.buffer = buffers[b]->buffer;
+					barrier.offset = 0;
+					barrier.size = VK_WHOLE_SIZE;
+					barriers.push_back(barrier);
+				}
+			}
+		}
+	}
+
+	if (barriers.size() == 0) {
+		return;
+	}
+
+	vkCmdPipelineBarrier(
+		cmdBuffer,
+		release ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0,
+		0, nullptr,
+		barriers.size(), barriers.data(),
+		0, nullptr
+	);
+}
+
+void VKModelLoader::Flush()
+{
+	while (true)
+	{
+		Update();
+
+		if (m_InFlight.size() > 0)
+		{
+			vkWaitForFences(device->GetInstanceHandle(), 1, &(m_TransferCmd->fence), VK_TRUE, UINT64_MAX);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_Decoded.size() > 0) {
+			continue;
+		}
+		if (m_PendingTasks == 0) {
+			break;
+		}
+		m_Condition.wait(lock, [this] { return m_Decoded.size() > 0 || m_PendingTasks == 0; });
+	}
+}
+
+void VKModelLoader::LogStats() const
+{
+	MLOG(
+		"Model loader: %d loaded, %d failed, %d uploads, longest Update %.3fms",
+		stats.loaded, stats.failed, stats.uploads, stats.maxUpdateMs
+	);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "VKModel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+class VulkanQueue;
+
+enum VKModelLoadState
+{
+	VKModelLoad_Queued = 0,
+	// file read and import on a worker thread.
+	VKModelLoad_Decoding,
+	// decoded, waiting for or inside a transfer queue upload.
+	VKModelLoad_Uploading,
+	VKModelLoad_Ready,
+	VKModelLoad_Failed,
+};
+
+// Returned by VKModelLoader::Load right away, owns the model once it is decoded.
+class VKModelHandle
+{
+	friend class VKModelLoader;
+
+public:
+	~VKModelHandle()
+	{
+		delete m_Model;
+		m_Model = nullptr;
+		placeholder = nullptr;
+	}
+
+	inline VKModelLoadState GetState() const
+	{
+		return (VKModelLoadState)m_State.load();
+	}
+
+	inline bool IsReady() const
+	{
+		return GetState() == VKModelLoad_Ready;
+	}
+
+	// the loaded model when ready, the placeholder (may be nullptr) until then.
+	inline VKModel* GetModel() const
+	{
+		return IsReady() ? m_Model : placeholder;
+	}
+
+	// hands a ready model over to the caller, who deletes it.
+	VKModel* TakeModel()
+	{
+		if (!IsReady()) {
+			return nullptr;
+		}
+		VKModel* model = m_Model;
+		m_Model = nullptr;
+		return model;
+	}
+
+public:
+	std::string						filename;
+	std::vector<VertexAttribute>	attributes;
+	uint32_t						importFlags = VKModelImport_None;
+	VKModelResidency				residency = VKModelResidency_CPUAndGPU;
+	// not owned, e.g. VKDefaultRes::fullQuad.
+	VKModel*						placeholder = nullptr;
+	// bounds of the whole model, valid from VKModelLoad_Uploading on, e.g. for a box proxy.
+	VKBoundingBox					bounds;
+
+private:
+	VKModel*						m_Model = nullptr;
+	std::atomic<int32_t>			m_State{ VKModelLoad_Queued };
+	int32_t							m_Priority = 0;
+	uint64_t						m_Sequence = 0;
+	double							m_StartTime = 0.0;
+};
+
+// Streams models in without blocking the caller. Workers of ThreadPool::Get() read and import
+// the files (see VKModel::LoadFromFile) highest priority first, Update uploads the decoded ones on
+// the transfer queue in batches of at most uploadBytesPerFrame and never waits for the GPU.
+// Load, SetPriority and Update are meant for the main thread.
+class VKModelLoader
+{
+public:
+	struct Stats
+	{
+		int32_t		loaded = 0;
+		int32_t		failed = 0;
+		int32_t		uploads = 0;
+		// longest Update, the main thread cost of streaming.
+		double		maxUpdateMs = 0.0;
+	};
+
+private:
+	VKModelLoader()
+	{
+
+	}
+
+public:
+	~VKModelLoader();
+
+	static VKModelLoader* Create(std::shared_ptr<VulkanDevice> vulkanDevice, VkDeviceSize uploadBytesPerFrame = 32 * 1024 * 1024);
+
+	// higher priorities are decoded and uploaded first, e.g. for assets on screen.
+	std::shared_ptr<VKModelHandle> Load(const std::string& filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags = VKModelImport_None, VKModelResidency residency = VKModelResidency_CPUAndGPU, int32_t priority = 0, VKModel* placeholder = nullptr);
+
+	// only affects handles that are not being decoded yet.
+	void SetPriority(std::shared_ptr<VKModelHandle> handle, int32_t priority);
+
+	// once per frame: finishes a completed upload and starts the next one.
+	void Update();
+
+	// blocks until every queued model is ready or failed.
+	void Flush();
+
+	void LogStats() const;
+
+public:
+	std::shared_ptr<VulkanDevice>	device;
+	VkDeviceSize					uploadBytesPerFrame = 0;
+	Stats							stats;
+
+private:
+	void DecodeNext();
+
+	void StartUpload(std::vector<std::shared_ptr<VKModelHandle>>& handles);
+
+	void FinishUpload();
+
+	void FinishHandle(VKModelHandle* handle);
+
+	// buffers created on the transfer queue family are released to / acquired by the graphics family.
+	void RecordOwnershipBarriers(VkCommandBuffer cmdBuffer, bool release);
+
+	inline bool NeedsOwnershipTransfer() const
+	{
+		return m_TransferFamily != m_GraphicsFamily;
+	}
+
+private:
+	std::vector<std::shared_ptr<VKModelHandle>>	m_Queued;
+	std::vector<std::shared_ptr<VKModelHandle>>	m_Decoded;
+	std::vector<std::shared_ptr<VKModelHandle>>	m_InFlight;
+	// ThreadPool tasks not yet finished, they reference the loader.
+	int32_t										m_PendingTasks = 0;
+	uint64_t									m_Sequence = 0;
+	std::mutex									m_Mutex;
+	std::condition_variable						m_Condition;
+
+	std::shared_ptr<VulkanQueue>				m_TransferQueue;
+	std::shared_ptr<VulkanQueue>				m_GraphicsQueue;
+	uint32_t									m_TransferFamily = 0;
+	uint32_t									m_GraphicsFamily = 0;
+	VkCommandPool								m_TransferPool = VK_NULL_HANDLE;
+	VkCommandPool								m_GraphicsPool = VK_NULL_HANDLE;
+	VKCommandBuffer*							m_TransferCmd = nullptr;
+	VKCommandBuffer*							m_AcquireCmd = nullptr;
+	bool										m_AcquirePending = false;
+	DVKBuffer*									m_Staging = nullptr;
+};
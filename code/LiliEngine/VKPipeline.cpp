@@ -1,6 +1,101 @@
 #include "stdafx.h"
 #include "VKPipeline.h"
 #include "VulkanDevice.h"
+#include "crc32.h"
+
+bool VKGfxPipelineKey::operator==(const VKGfxPipelineKey& other) const
+{
+	if (hash != other.hash || memcmp(&states, &other.states, sizeof(States)) != 0) {
+		return false;
+	}
+
+	if (specMapEntries.size() != other.specMapEntries.size() || specData != other.specData) {
+		return false;
+	}
+
+	for (int32_t i = 0; i < specMapEntries.size(); ++i)
+	{
+		const VkSpecializationMapEntry& a = specMapEntries[i];
+		const VkSpecializationMapEntry& b = other.specMapEntries[i];
+		if (a.constantID != b.constantID || a.offset != b.offset || a.size != b.size) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+VKGfxPipelineKey VKGfxPipelineInfo::GetKey(VkRenderPass renderPass) const
+{
+	VKGfxPipelineKey key;
+	VKGfxPipelineKey::States& states = key.states;
+	memset(&states, 0, sizeof(states));
+
+	states.topology = inputAssemblyState.topology;
+	states.primitiveRestartEnable = inputAssemblyState.primitiveRestartEnable;
+
+	states.depthClampEnable = rasterizationState.depthClampEnable;
+	states.rasterizerDiscardEnable = rasterizationState.rasterizerDiscardEnable;
+	states.polygonMode = rasterizationState.polygonMode;
+	states.cullMode = rasterizationState.cullMode;
+	states.frontFace = rasterizationState.frontFace;
+	states.depthBiasEnable = rasterizationState.depthBiasEnable;
+	states.depthBiasConstantFactor = rasterizationState.depthBiasConstantFactor;
+	states.depthBiasClamp = rasterizationState.depthBiasClamp;
+	states.depthBiasSlopeFactor = rasterizationState.depthBiasSlopeFactor;
+	states.lineWidth = rasterizationState.lineWidth;
+
+	// attachments past colorAttachmentCount are not part of the pipeline.
+	for (int32_t i = 0; i < colorAttachmentCount && i < 8; ++i) {
+		states.blendAttachmentStates[i] = blendAttachmentStates[i];
+	}
+
+	states.depthTestEnable = depthStencilState.depthTestEnable;
+	states.depthWriteEnable = depthStencilState.depthWriteEnable;
+	states.depthCompareOp = depthStencilState.depthCompareOp;
+	states.depthBoundsTestEnable = depthStencilState.depthBoundsTestEnable;
+	states.stencilTestEnable = depthStencilState.stencilTestEnable;
+	states.front = depthStencilState.front;
+	states.back = depthStencilState.back;
+	states.minDepthBounds = depthStencilState.minDepthBounds;
+	states.maxDepthBounds = depthStencilState.maxDepthBounds;
+
+	states.rasterizationSamples = multisampleState.rasterizationSamples;
+	states.sampleShadingEnable = multisampleState.sampleShadingEnable;
+	states.minSampleShading = multisampleState.minSampleShading;
+	states.alphaToCoverageEnable = multisampleState.alphaToCoverageEnable;
+	states.alphaToOneEnable = multisampleState.alphaToOneEnable;
+	// the mask values, not the pointer. A missing mask enables every sample.
+	const int32_t maskWords = multisampleState.rasterizationSamples > 32 ? 2 : 1;
+	for (int32_t i = 0; i < maskWords; ++i) {
+		states.sampleMask[i] = multisampleState.pSampleMask ? multisampleState.pSampleMask[i] : 0xFFFFFFFF;
+	}
+
+	states.patchControlPoints = tessellationState.patchControlPoints;
+
+	states.vertShaderModule = vertShaderModule;
+	states.fragShaderModule = fragShaderModule;
+	states.compShaderModule = compShaderModule;
+	states.tescShaderModule = tescShaderModule;
+	states.teseShaderModule = teseShaderModule;
+	states.geomShaderModule = geomShaderModule;
+	states.shader = shader;
+
+	states.renderPass = renderPass;
+	states.subpass = subpass;
+	states.colorAttachmentCount = colorAttachmentCount;
+
+	key.specMapEntries = specMapEntries;
+	key.specData = specData;
+
+	uint32_t hash = crc32(&states, (uint32_t)sizeof(states));
+	if (specData.size() > 0) {
+		hash ^= crc32(specData.data(), (uint32_t)specData.size()) * 16777619u;
+	}
+	key.hash = hash;
+
+	return key;
+}
 
 VKGfxPipeline* VKGfxPipeline::Create(
 	std::shared_ptr<VulkanDevice> vulkanDevice,
@@ -52,6 +147,19 @@ VKGfxPipeline* VKGfxPipeline::Create(
 		pipelineInfo.FillShaderStages(shaderStages);
 	}
 
+	VkSpecializationInfo specializationInfo = {};
+	if (pipelineInfo.specMapEntries.size() > 0)
+	{
+		specializationInfo.mapEntryCount = pipelineInfo.specMapEntries.size();
+		specializationInfo.pMapEntries = pipelineInfo.specMapEntries.data();
+		specializationInfo.dataSize = pipelineInfo.specData.size();
+		specializationInfo.pData = pipelineInfo.specData.data();
+
+		for (int32_t i = 0; i < shaderStages.size(); ++i) {
+			shaderStages[i].pSpecializationInfo = &specializationInfo;
+		}
+	}
+
 	VkGraphicsPipelineCreateInfo pipelineCreateInfo;
 	ZeroVulkanStruct(pipelineCreateInfo, VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO);
 	pipelineCreateInfo.layout = pipelineLayout;
@@ -3,6 +3,77 @@
 #include "VKShader.h"
 #include "VulkanDevice.h"
 
+// Identifies a graphics pipeline variant: the values of every state that ends up in the pipeline,
+// without sTypes or pointers. hash only picks the bucket, lookups compare the whole key.
+struct VKGfxPipelineKey
+{
+	struct States
+	{
+		VkPrimitiveTopology						topology;
+		VkBool32								primitiveRestartEnable;
+
+		VkBool32								depthClampEnable;
+		VkBool32								rasterizerDiscardEnable;
+		VkPolygonMode							polygonMode;
+		VkCullModeFlags							cullMode;
+		VkFrontFace								frontFace;
+		VkBool32								depthBiasEnable;
+		float									depthBiasConstantFactor;
+		float									depthBiasClamp;
+		float									depthBiasSlopeFactor;
+		float									lineWidth;
+
+		VkPipelineColorBlendAttachmentState		blendAttachmentStates[8];
+
+		VkBool32								depthTestEnable;
+		VkBool32								depthWriteEnable;
+		VkCompareOp								depthCompareOp;
+		VkBool32								depthBoundsTestEnable;
+		VkBool32								stencilTestEnable;
+		VkStencilOpState						front;
+		VkStencilOpState						back;
+		float									minDepthBounds;
+		float									maxDepthBounds;
+
+		VkSampleCountFlagBits					rasterizationSamples;
+		VkBool32								sampleShadingEnable;
+		float									minSampleShading;
+		uint32_t								sampleMask[2];
+		VkBool32								alphaToCoverageEnable;
+		VkBool32								alphaToOneEnable;
+
+		uint32_t								patchControlPoints;
+
+		VkShaderModule							vertShaderModule;
+		VkShaderModule							fragShaderModule;
+		VkShaderModule							compShaderModule;
+		VkShaderModule							tescShaderModule;
+		VkShaderModule							teseShaderModule;
+		VkShaderModule							geomShaderModule;
+		VKShader*								shader;
+
+		VkRenderPass							renderPass;
+		int32_t									subpass;
+		int32_t									colorAttachmentCount;
+	};
+
+	// zero filled before the fields are set, so padding compares equal.
+	States									states;
+	std::vector<VkSpecializationMapEntry>	specMapEntries;
+	std::vector<uint8_t>					specData;
+	uint32_t								hash = 0;
+
+	bool operator==(const VKGfxPipelineKey& other) const;
+};
+
+struct VKGfxPipelineKeyHash
+{
+	inline size_t operator()(const VKGfxPipelineKey& key) const
+	{
+		return key.hash;
+	}
+};
+
 struct VKGfxPipelineInfo
 {
 	VkPipelineInputAssemblyStateCreateInfo		inputAssemblyState;
@@ -23,6 +94,10 @@ struct VKGfxPipelineInfo
 	int32_t			subpass = 0;
 	int32_t           colorAttachmentCount = 1;
 
+	// specialization constants, shared by every stage. ids a stage doesn't declare are ignored by the driver.
+	std::vector<VkSpecializationMapEntry>	specMapEntries;
+	std::vector<uint8_t>					specData;
+
 	VKGfxPipelineInfo()
 	{
 		ZeroVulkanStruct(inputAssemblyState, VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO);
@@ -74,6 +149,30 @@ struct VKGfxPipelineInfo
 		tessellationState.patchControlPoints = 0;
 	}
 
+	void SetSpecialization(uint32_t constantID, const void* data, uint32_t size)
+	{
+		for (int32_t i = 0; i < specMapEntries.size(); ++i)
+		{
+			if (specMapEntries[i].constantID == constantID)
+			{
+				memcpy(specData.data() + specMapEntries[i].offset, data, std::min<uint32_t>(size, specMapEntries[i].size));
+				return;
+			}
+		}
+
+		VkSpecializationMapEntry mapEntry = {};
+		mapEntry.constantID = constantID;
+		mapEntry.offset = specData.size();
+		mapEntry.size = size;
+		specMapEntries.push_back(mapEntry);
+
+		specData.resize(mapEntry.offset + size);
+		memcpy(specData.data() + mapEntry.offset, data, size);
+	}
+
+	// Every state that ends up in the pipeline created for renderPass, specialization constants included.
+	VKGfxPipelineKey GetKey(VkRenderPass renderPass) const;
+
 	void FillShaderStages(std::vector<VkPipelineShaderStageCreateInfo>& shaderStages)
 	{
 		if (vertShaderModule != VK_NULL_HANDLE)
@@ -0,0 +1,213 @@
+#include "stdafx.h"
+#include "VKRayCaster.h"
+#include "VKModel.h"
+#include "ThreadPool.h"
+#include "Time.h"
+
+void VKRayCaster::GatherMeshes(VKModel* model)
+{
+	m_Meshes.clear();
+	for (int32_t i = 0; i < model->meshes.size(); ++i)
+	{
+		VKMesh* mesh = model->meshes[i];
+		if (!mesh->triangleBVH || !mesh->linkNode) {
+			continue;
+		}
+
+		const Matrix4x4& world = mesh->linkNode->GetGlobalMatrix();
+		const VKTriangleBVHNode& root = mesh->triangleBVH->GetRoot();
+
+		MeshSpace space;
+		space.mesh = mesh;
+		space.worldToLocal = world.Inverse();
+		space.worldBounds = VKBounds::TransformBox(VKBoundingBox(root.min, root.max), world);
+		m_Meshes.push_back(space);
+	}
+}
+
+VKRay VKRayCaster::ToLocal(const MeshSpace& space, const VKRay& ray)
+{
+	// an affine map keeps the ray parameter, so distances need no conversion.
+	return VKRay(
+		space.worldToLocal.TransformPosition(ray.origin),
+		space.worldToLocal.TransformVector(ray.direction),
+		ray.maxDistance
+	);
+}
+
+void VKRayCaster::ToWorld(const MeshSpace& space, const VKRay& ray, VKTriangleHit& hit)
+{
+	// normals go through the inverse transpose of the node matrix, the transpose of worldToLocal.
+	const Matrix4x4& m = space.worldToLocal;
+	Vector3 normal(
+		hit.normal.x * m.m[0][0] + hit.normal.y * m.m[0][1] + hit.normal.z * m.m[0][2],
+		hit.normal.x * m.m[1][0] + hit.normal.y * m.m[1][1] + hit.normal.z * m.m[1][2],
+		hit.normal.x * m.m[2][0] + hit.normal.y * m.m[2][1] + hit.normal.z * m.m[2][2]
+	);
+
+	hit.position = ray.origin + ray.direction * hit.distance;
+	hit.normal = normal.GetSafeNormal();
+	hit.mesh = space.mesh;
+}
+
+bool VKRayCaster::RayCast(VKModel* model, const VKRay& ray, VKTriangleHit& outHit)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	GatherMeshes(model);
+
+	// the max distance shrinks with every hit, meshes further away are skipped by their box.
+	VKRay worldRay = ray;
+	const Vector3 invDirection = VKBounds::InverseDirection(ray.direction);
+
+	bool found = false;
+	for (int32_t i = 0; i < m_Meshes.size(); ++i)
+	{
+		const MeshSpace& space = m_Meshes[i];
+
+		float entry = 0.0f;
+		if (!VKBounds::IntersectRay(space.worldBounds.min, space.worldBounds.max, worldRay.origin, invDirection, worldRay.maxDistance, entry)) {
+			continue;
+		}
+
+		VKTriangleHit hit;
+		if (space.mesh->triangleBVH->RayCast(ToLocal(space, worldRay), hit))
+		{
+			ToWorld(space, worldRay, hit);
+			outHit = hit;
+			worldRay.maxDistance = hit.distance;
+			found = true;
+		}
+	}
+
+	stats.rays += 1;
+	stats.hits += found ? 1 : 0;
+	stats.castTime += GenericPlatformTime::Seconds() - startTime;
+
+	return found;
+}
+
+bool VKRayCaster::SegmentCast(VKModel* model, const Vector3& start, const Vector3& end, VKTriangleHit& outHit)
+{
+	return RayCast(model, VKRay(start, end - start, 1.0f), outHit);
+}
+
+bool VKRayCaster::IsOccluded(VKModel* model, const Vector3& start, const Vector3& end)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	GatherMeshes(model);
+
+	const VKRay ray(start, end - start, 1.0f);
+	const Vector3 invDirection = VKBounds::InverseDirection(ray.direction);
+
+	bool found = false;
+	for (int32_t i = 0; i < m_Meshes.size() && !found; ++i)
+	{
+		const MeshSpace& space = m_Meshes[i];
+
+		float entry = 0.0f;
+		if (VKBounds::IntersectRay(space.worldBounds.min, space.worldBounds.max, ray.origin, invDirection, ray.maxDistance, entry)) {
+			found = space.mesh->triangleBVH->Intersects(ToLocal(space, ray));
+		}
+	}
+
+	stats.rays += 1;
+	stats.hits += found ? 1 : 0;
+	stats.castTime += GenericPlatformTime::Seconds() - startTime;
+
+	return found;
+}
+
+void VKRayCaster::RayCast(VKModel* model, const std::vector<VKRay>& rays, std::vector<VKTriangleHit>& outHits)
+{
+	double startTime = GenericPlatformTime::Seconds();
+
+	GatherMeshes(model);
+
+	const int32_t count = rays.size();
+	const int32_t batch = math::Max(batchSize, 4);
+	const int32_t batchCount = (count + batch - 1) / batch;
+
+	outHits.assign(count, VKTriangleHit());
+
+	ThreadPool::Get().ParallelFor(batchCount, [&](int32_t index) {
+		const int32_t first = index * batch;
+		const int32_t last = math::Min(count, first + batch);
+
+		std::vector<VKRay> localRays(last - first);
+		std::vector<VKTriangleHit> localHits(last - first);
+		std::vector<Vector3> invDirections(last - first);
+
+		for (int32_t j = first; j < last; ++j) {
+			invDirections[j - first] = VKBounds::InverseDirection(rays[j].direction);
+		}
+
+		for (int32_t i = 0; i < m_Meshes.size(); ++i)
+		{
+			const MeshSpace& space = m_Meshes[i];
+
+			// rays carry their closest hit so far as max distance, farther triangles are never tested.
+			// rays missing the mesh box are marked unused, a batch missing it entirely skips the mesh.
+			bool anyRay = false;
+			for (int32_t j = first; j < last; ++j)
+			{
+				VKRay ray = rays[j];
+				if (outHits[j].IsValid()) {
+					ray.maxDistance = outHits[j].distance;
+				}
+
+				float entry = 0.0f;
+				if (VKBounds::IntersectRay(space.worldBounds.min, space.worldBounds.max, ray.origin, invDirections[j - first], ray.maxDistance, entry))
+				{
+					localRays[j - first] = ToLocal(space, ray);
+					anyRay = true;
+				}
+				else
+				{
+					localRays[j - first].maxDistance = -1.0f;
+				}
+				localHits[j - first] = VKTriangleHit();
+			}
+
+			if (!anyRay) {
+				continue;
+			}
+
+			space.mesh->triangleBVH->RayCast(localRays.data(), last - first, localHits.data());
+
+			for (int32_t j = first; j < last; ++j)
+			{
+				VKTriangleHit& hit = localHits[j - first];
+				if (hit.IsValid())
+				{
+					ToWorld(space, rays[j], hit);
+					outHits[j] = hit;
+				}
+			}
+		}
+	});
+
+	int64_t hits = 0;
+	for (int32_t i = 0; i < count; ++i) {
+		hits += outHits[i].IsValid() ? 1 : 0;
+	}
+
+	stats.rays += count;
+	stats.hits += hits;
+	stats.castTime += GenericPlatformTime::Seconds() - startTime;
+}
+
+void VKRayCaster::ResetStats()
+{
+	stats = Stats();
+}
+
+void VKRayCaster::LogStats() const
+{
+	MLOG(
+		"Ray cast: %lld rays, %lld hits, %.3f Mrays/s",
+		stats.rays, stats.hits,
+		stats.RaysPerSecond() / 1000000.0
+	);
+}
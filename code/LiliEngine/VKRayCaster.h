@@ -0,0 +1,66 @@
+#pragma once
+
+#include "VKTriangleBVH.h"
+#include "Matrix4x4.h"
+
+#include <vector>
+
+class VKModel;
+
+// World space ray casts against the triangle BVHs of a model's meshes (VKModelImport_TriangleBVH).
+// Rays are moved into each mesh's node space, where ray distances stay the same. Skinned meshes
+// are tested in their bind pose.
+class VKRayCaster
+{
+public:
+	struct Stats
+	{
+		int64_t		rays = 0;
+		int64_t		hits = 0;
+		double		castTime = 0.0;
+
+		inline double RaysPerSecond() const
+		{
+			return castTime > 0.0 ? rays / castTime : 0.0;
+		}
+	};
+
+	bool RayCast(VKModel* model, const VKRay& ray, VKTriangleHit& outHit);
+
+	// distance is the fraction of the way from start to end.
+	bool SegmentCast(VKModel* model, const Vector3& start, const Vector3& end, VKTriangleHit& outHit);
+
+	// any triangle between start and end, for line of sight.
+	bool IsOccluded(VKModel* model, const Vector3& start, const Vector3& end);
+
+	// outHits[i] is the closest hit of rays[i], invalid for a miss. Rays are traced as packets of 4,
+	// batches of batchSize rays run on the thread pool.
+	void RayCast(VKModel* model, const std::vector<VKRay>& rays, std::vector<VKTriangleHit>& outHits);
+
+	void ResetStats();
+
+	void LogStats() const;
+
+public:
+	Stats		stats;
+	// rays per thread pool task.
+	int32_t		batchSize = 256;
+
+private:
+	struct MeshSpace
+	{
+		VKMesh*			mesh = nullptr;
+		Matrix4x4		worldToLocal;
+		VKBoundingBox	worldBounds;
+	};
+
+	void GatherMeshes(VKModel* model);
+
+	static VKRay ToLocal(const MeshSpace& space, const VKRay& ray);
+
+	// position and normal back into world space.
+	static void ToWorld(const MeshSpace& space, const VKRay& ray, VKTriangleHit& hit);
+
+private:
+	std::vector<MeshSpace>		m_Meshes;
+};
@@ -150,6 +150,66 @@ void VKShader::ProcessUniformBuffers(spirv_cross::Compiler& compiler, spirv_cros
     }
 }
 
+void VKShader::ProcessPushConstants(spirv_cross::Compiler& compiler, spirv_cross::ShaderResources& resources, VkShaderStageFlags stageFlags)
+{
+    for (int32_t i = 0; i < resources.push_constant_buffers.size(); ++i)
+    {
+        spirv_cross::Resource& res = resources.push_constant_buffers[i];
+        spirv_cross::SPIRType type = compiler.get_type(res.base_type_id);
+        uint32_t blockEnd = compiler.get_declared_struct_size(type);
+
+        // [layout (push_constant) uniform ModelBlock { layout(offset = 64) mat4 model; }]
+        uint32_t blockStart = type.member_types.size() > 0 ? blockEnd : 0;
+        for (uint32_t j = 0; j < type.member_types.size(); ++j) {
+            blockStart = std::min(blockStart, compiler.type_struct_member_offset(type, j));
+        }
+
+        if (pushConstantRanges.size() == 0)
+        {
+            VkPushConstantRange pushConstantRange = {};
+            pushConstantRange.stageFlags = stageFlags;
+            pushConstantRange.offset = blockStart;
+            pushConstantRange.size = blockEnd - blockStart;
+            pushConstantRanges.push_back(pushConstantRange);
+        }
+        else
+        {
+            VkPushConstantRange& pushConstantRange = pushConstantRanges[0];
+            uint32_t rangeStart = std::min(pushConstantRange.offset, blockStart);
+            uint32_t rangeEnd = std::max(pushConstantRange.offset + pushConstantRange.size, blockEnd);
+            pushConstantRange.stageFlags |= stageFlags;
+            pushConstantRange.offset = rangeStart;
+            pushConstantRange.size = rangeEnd - rangeStart;
+        }
+    }
+}
+
+void VKShader::ProcessSpecConstants(spirv_cross::Compiler& compiler, VkShaderStageFlags stageFlags)
+{
+    spirv_cross::SmallVector<spirv_cross::SpecializationConstant> constants = compiler.get_specialization_constants();
+    for (int32_t i = 0; i < constants.size(); ++i)
+    {
+        const spirv_cross::SpecializationConstant& constant = constants[i];
+        const std::string& varName = compiler.get_name(constant.id);
+        const spirv_cross::SPIRType& type = compiler.get_type(compiler.get_constant(constant.id).constant_type);
+
+        auto it = specConstantParams.find(varName);
+        if (it == specConstantParams.end())
+        {
+            SpecConstantInfo specInfo = {};
+            specInfo.constantID = constant.constant_id;
+            // bool is VkBool32 on the api side.
+            specInfo.size = type.width == 64 ? 8 : 4;
+            specInfo.stageFlags = stageFlags;
+            specConstantParams.insert(std::make_pair(varName, specInfo));
+        }
+        else
+        {
+            it->second.stageFlags |= stageFlags;
+        }
+    }
+}
+
 void VKShader::ProcessTextures(spirv_cross::Compiler& compiler, spirv_cross::ShaderResources& resources, VkShaderStageFlags stageFlags)
 {
     for (int32_t i = 0; i < resources.sampled_images.size(); ++i)
@@ -162,6 +222,13 @@ void VKShader::ProcessTextures(spirv_cross::Compiler& compiler, spirv_cross::Sha
         int32_t set = compiler.get_decoration(res.id, spv::DecorationDescriptorSet);
         int32_t binding = compiler.get_decoration(res.id, spv::DecorationBinding);
 
+        // unsized array, lives in the global VKBindlessTable set.
+        if (type.array.size() > 0 && type.array[0] == 0)
+        {
+            bindlessSet = set;
+            continue;
+        }
+
         VkDescriptorSetLayoutBinding setLayoutBinding = {};
         setLayoutBinding.binding = binding;
         setLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -202,6 +269,19 @@ void VKShader::ProcessInput(spirv_cross::Compiler& compiler, spirv_cross::Shader
         int32_t inputAttributeSize = type.vecsize;
 
         VertexAttribute attribute = StringToVertexAttribute(varName.c_str());
+
+        // the declared type selects the compact encoding where it differs from the float one: uvec4 inSkinIndex
+        // and vec2 inNormal. Positions and UVs read as the same vec types either way, and SNORM positions and
+        // rescaled UNORM UVs need the VKMesh dequantize values in the shader, so those are chosen by name
+        // (inPositionSNorm, inPositionHalf, inUV0UNorm, inUV1UNorm, see VertexPacking.h).
+        bool integerType = type.basetype == spirv_cross::SPIRType::UInt || type.basetype == spirv_cross::SPIRType::Int;
+        if (attribute == VertexAttribute::VA_SkinIndex && integerType) {
+            attribute = VertexAttribute::VA_SkinIndexUInt8;
+        }
+        else if (attribute == VertexAttribute::VA_Normal && inputAttributeSize == 2) {
+            attribute = VertexAttribute::VA_NormalOct;
+        }
+
         if (attribute == VertexAttribute::VA_None)
         {
             if (inputAttributeSize == 1) {
@@ -323,6 +403,8 @@ void VKShader::ProcessShaderModule(VKShaderModule* shaderModule)
 
     ProcessAttachments(compiler, resources, shaderModule->stage);
     ProcessUniformBuffers(compiler, resources, shaderModule->stage);
+    ProcessPushConstants(compiler, resources, shaderModule->stage);
+    ProcessSpecConstants(compiler, shaderModule->stage);
     ProcessTextures(compiler, resources, shaderModule->stage);
     ProcessStorageImages(compiler, resources, shaderModule->stage);
     ProcessInput(compiler, resources, shaderModule->stage);
@@ -386,39 +468,26 @@ void VKShader::GenerateInputInfo()
         inputBindings.push_back(instanceInputBinding);
     }
 
-    int location = 0;
-    if (perVertexAttributes.size() > 0)
+    // every input keeps the location the shader declared, vertex and instance streams can interleave.
+    int32_t vertexOffset = 0;
+    int32_t instanceOffset = 0;
+    for (int32_t i = 0; i < m_InputAttributes.size(); ++i)
     {
-        int32_t offset = 0;
-        for (int32_t i = 0; i < perVertexAttributes.size(); ++i)
-        {
-            VkVertexInputAttributeDescription inputAttribute = {};
-            inputAttribute.binding = 0;
-            inputAttribute.location = location;
-            inputAttribute.format = VertexAttributeToVkFormat(perVertexAttributes[i]);
-            inputAttribute.offset = offset;
-            offset += VertexAttributeToSize(perVertexAttributes[i]);
-            inputAttributes.push_back(inputAttribute);
-
-            location += 1;
+        VertexAttribute attribute = m_InputAttributes[i].attribute;
+        if (i > 0 && m_InputAttributes[i].location == m_InputAttributes[i - 1].location) {
+            MLOGE("Vertex inputs share location %d.", m_InputAttributes[i].location);
         }
-    }
 
-    if (instancesAttributes.size() > 0)
-    {
-        int32_t offset = 0;
-        for (int32_t i = 0; i < instancesAttributes.size(); ++i)
-        {
-            VkVertexInputAttributeDescription inputAttribute = {};
-            inputAttribute.binding = 1;
-            inputAttribute.location = location;
-            inputAttribute.format = VertexAttributeToVkFormat(instancesAttributes[i]);
-            inputAttribute.offset = offset;
-            offset += VertexAttributeToSize(instancesAttributes[i]);
-            inputAttributes.push_back(inputAttribute);
-
-            location += 1;
-        }
+        bool instanced = attribute == VA_InstanceFloat1 || attribute == VA_InstanceFloat2 || attribute == VA_InstanceFloat3 || attribute == VA_InstanceFloat4;
+        int32_t& offset = instanced ? instanceOffset : vertexOffset;
+
+        VkVertexInputAttributeDescription inputAttribute = {};
+        inputAttribute.binding = instanced ? 1 : 0;
+        inputAttribute.location = m_InputAttributes[i].location;
+        inputAttribute.format = VertexAttributeToVkFormat(attribute);
+        inputAttribute.offset = offset;
+        offset += VertexAttributeToSize(attribute);
+        inputAttributes.push_back(inputAttribute);
     }
 
 }
@@ -453,9 +522,26 @@ void VKShader::GenerateLayout()
         descriptorSetLayouts.push_back(descriptorSetLayout);
     }
 
+    // the bindless set is owned by VKBindlessTable, it is only referenced by the pipeline layout.
+    DescriptorSetLayouts pipelineSetLayouts = descriptorSetLayouts;
+    if (bindlessSet >= 0)
+    {
+        if (!VKBindlessTable::IsEnabled()) {
+            MLOGE("Shader uses bindless textures but RendererConfiguration::bindless is off.");
+        }
+        else if (bindlessSet != pipelineSetLayouts.size()) {
+            MLOGE("Bindless textures must use the last descriptor set, set=%d expected=%d", bindlessSet, (int32_t)pipelineSetLayouts.size());
+        }
+        else {
+            pipelineSetLayouts.push_back(VKBindlessTable::descriptorSetLayout);
+        }
+    }
+
     VkPipelineLayoutCreateInfo pipeLayoutInfo;
     ZeroVulkanStruct(pipeLayoutInfo, VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO);
-    pipeLayoutInfo.setLayoutCount = descriptorSetLayouts.size();
-    pipeLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipeLayoutInfo.setLayoutCount = pipelineSetLayouts.size();
+    pipeLayoutInfo.pSetLayouts = pipelineSetLayouts.data();
+    pipeLayoutInfo.pushConstantRangeCount = pushConstantRanges.size();
+    pipeLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
     VERIFYVULKANRESULT(vkCreatePipelineLayout(device, &pipeLayoutInfo, VULKAN_CPU_ALLOCATOR, &pipelineLayout));
 }
\ No newline at end of file
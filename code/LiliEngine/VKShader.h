@@ -99,6 +99,12 @@ public:
 				setBinding.stageFlags = setBinding.stageFlags | binding.stageFlags;
 				return;
 			}
+			// one binding slot can't hold two kinds of descriptor.
+			if (setBinding.binding == binding.binding)
+			{
+				MLOGE("%s clashes with another resource at set=%d binding=%d.", varName.c_str(), set, binding.binding);
+				return;
+			}
 		}
 
 		setLayout->set = set;
@@ -333,6 +339,13 @@ class VKShader
 		VkShaderStageFlags	stageFlags = 0;
 	};
 
+	struct SpecConstantInfo
+	{
+		uint32_t				constantID = 0;
+		uint32_t				size = 0;
+		VkShaderStageFlags	stageFlags = 0;
+	};
+
 private:
 	typedef std::vector<VkPipelineShaderStageCreateInfo>	ShaderStageInfoArray;
 	typedef std::vector<VkDescriptorSetLayout>				DescriptorSetLayouts;
@@ -451,6 +464,10 @@ private:
 
 	void ProcessUniformBuffers(spirv_cross::Compiler& compiler, spirv_cross::ShaderResources& resources, VkShaderStageFlags stageFlags);
 
+	void ProcessPushConstants(spirv_cross::Compiler& compiler, spirv_cross::ShaderResources& resources, VkShaderStageFlags stageFlags);
+
+	void ProcessSpecConstants(spirv_cross::Compiler& compiler, VkShaderStageFlags stageFlags);
+
 	void ProcessShaderModule(VKShaderModule* shaderModule);
 
 private:
@@ -480,8 +497,13 @@ public:
 
 	DescriptorSetLayouts 			descriptorSetLayouts;
 	VkPipelineLayout 				pipelineLayout = VK_NULL_HANDLE;
+	// all push_constant blocks are merged into one range visible to every stage that declares one.
+	std::vector<VkPushConstantRange>	pushConstantRanges;
+	// set index of the VKBindlessTable array, -1 when the shader doesn't use it.
+	int32_t							bindlessSet = -1;
 	VKDescriptorSetPools			descriptorSetPools;
 
 	std::unordered_map<std::string, BufferInfo>	bufferParams;
 	std::unordered_map<std::string, ImageInfo>	imageParams;
+	std::unordered_map<std::string, SpecConstantInfo>	specConstantParams;
 };
\ No newline at end of file
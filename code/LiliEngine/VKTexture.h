@@ -3,6 +3,7 @@
 #include "VKCommandBuffer.h"
 #include "VulkanGlobals.h"
 #include "RHIDefinitions.h"
+#include "VKBindlessTable.h"
 
 class VKTexture
 {
@@ -14,6 +15,8 @@ public:
 
 	~VKTexture()
 	{
+		VKBindlessTable::Unregister(this);
+
 		if (imageView != VK_NULL_HANDLE)
 		{
 			vkDestroyImageView(device, imageView, VULKAN_CPU_ALLOCATOR);
@@ -180,4 +183,7 @@ public:
 	VkFormat                        format = VK_FORMAT_R8G8B8A8_UNORM;
 
 	bool							isCubeMap = false;
+
+	// slot in VKBindlessTable, -1 when not registered.
+	int32_t							bindlessIndex = -1;
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "VKTransformHierarchy.h"
+#include "VulkanGlobals.h"
+
+int32_t VKTransformHierarchy::Add(int32_t parent, const Matrix4x4& localMatrix)
+{
+	int32_t index = m_Parents.size();
+	if (parent >= index)
+	{
+		MLOGE("Transform parent %d added after its child %d.", parent, index);
+		parent = -1;
+	}
+
+	m_Parents.push_back(parent);
+	m_Locals.push_back(localMatrix);
+	m_Worlds.push_back(localMatrix);
+	m_DirtyFlags.push_back(1);
+	m_Dirty = true;
+
+	return index;
+}
+
+void VKTransformHierarchy::Clear()
+{
+	m_Parents.clear();
+	m_Locals.clear();
+	m_Worlds.clear();
+	m_DirtyFlags.clear();
+	m_Dirty = false;
+}
+
+void VKTransformHierarchy::Update()
+{
+	if (!m_Dirty) {
+		return;
+	}
+
+	// a parent is visited before its children, so its flag already says whether its world changed.
+	const int32_t count = m_Parents.size();
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const int32_t parent = m_Parents[i];
+		if (parent >= 0 && m_DirtyFlags[parent]) {
+			m_DirtyFlags[i] = 1;
+		}
+
+		if (m_DirtyFlags[i] == 0) {
+			continue;
+		}
+
+		m_Worlds[i] = m_Locals[i];
+		if (parent >= 0) {
+			m_Worlds[i].Append(m_Worlds[parent]);
+		}
+	}
+
+	std::fill(m_DirtyFlags.begin(), m_DirtyFlags.end(), 0);
+	m_Dirty = false;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Matrix4x4.h"
+
+#include <vector>
+
+// Node transforms of a model as parallel arrays in topological order, parents always come before
+// their children. World matrices are cached; Update recomputes the dirty nodes and everything below
+// them in one forward pass instead of walking the parent chain of every node that is asked for.
+class VKTransformHierarchy
+{
+public:
+	// parent is an index returned by an earlier Add, -1 for roots.
+	int32_t Add(int32_t parent, const Matrix4x4& localMatrix);
+
+	void Clear();
+
+	void Update();
+
+	inline int32_t Size() const
+	{
+		return (int32_t)m_Parents.size();
+	}
+
+	inline int32_t GetParent(int32_t index) const
+	{
+		return m_Parents[index];
+	}
+
+	inline const Matrix4x4& GetLocal(int32_t index) const
+	{
+		return m_Locals[index];
+	}
+
+	inline void SetLocal(int32_t index, const Matrix4x4& localMatrix)
+	{
+		m_Locals[index] = localMatrix;
+		m_DirtyFlags[index] = 1;
+		m_Dirty = true;
+	}
+
+	// the local is marked dirty up front, the caller changes it in place.
+	inline Matrix4x4& EditLocal(int32_t index)
+	{
+		m_DirtyFlags[index] = 1;
+		m_Dirty = true;
+		return m_Locals[index];
+	}
+
+	// runs the pending Update first, so a world read right after SetLocal is never stale.
+	inline const Matrix4x4& GetWorld(int32_t index)
+	{
+		if (m_Dirty) {
+			Update();
+		}
+		return m_Worlds[index];
+	}
+
+	inline bool IsDirty() const
+	{
+		return m_Dirty;
+	}
+
+private:
+	std::vector<int32_t>	m_Parents;
+	std::vector<Matrix4x4>	m_Locals;
+	std::vector<Matrix4x4>	m_Worlds;
+	std::vector<uint8_t>	m_DirtyFlags;
+	bool					m_Dirty = false;
+};
@@ -0,0 +1,589 @@
+#include "stdafx.h"
+#include "VKTriangleBVH.h"
+#include "VulkanGlobals.h"
+#include "ThreadPool.h"
+
+#include <numeric>
+
+// subtrees up to this many triangles are built by one thread.
+static const int32_t PARALLEL_BUILD_TRIANGLES = 4096;
+static const int32_t BOUNDS_BATCH_SIZE = 4096;
+// cost of visiting two children against testing one triangle.
+static const float TRAVERSAL_COST = 1.0f;
+
+struct BuildTask
+{
+	int32_t		node;
+	int32_t		first;
+	int32_t		last;
+	int32_t		depth;
+};
+
+struct BuildInput
+{
+	const Vector3*	mins;
+	const Vector3*	maxs;
+	const Vector3*	centers;
+	int32_t*		order;
+};
+
+struct RayPacket
+{
+	__m128	originX;
+	__m128	originY;
+	__m128	originZ;
+	__m128	directionX;
+	__m128	directionY;
+	__m128	directionZ;
+	__m128	invDirectionX;
+	__m128	invDirectionY;
+	__m128	invDirectionZ;
+};
+
+// splits the range of root into nodes, children of a node are always allocated as a pair. With
+// outDeferred, ranges of at most deferSize triangles are handed back with their node left unfilled.
+static void BuildNodes(const BuildInput& input, std::vector<VKTriangleBVHNode>& nodes, const BuildTask& root, int32_t deferSize, std::vector<BuildTask>* outDeferred)
+{
+	std::vector<BuildTask> tasks;
+	tasks.push_back(root);
+
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		const int32_t count = task.last - task.first;
+		if (outDeferred && count <= deferSize)
+		{
+			outDeferred->push_back(task);
+			continue;
+		}
+
+		Vector3 min(MAX_flt, MAX_flt, MAX_flt);
+		Vector3 max(-MAX_flt, -MAX_flt, -MAX_flt);
+		for (int32_t i = task.first; i < task.last; ++i)
+		{
+			min = Vector3::Min(min, input.mins[input.order[i]]);
+			max = Vector3::Max(max, input.maxs[input.order[i]]);
+		}
+		nodes[task.node].min = min;
+		nodes[task.node].max = max;
+
+		// the depth limit keeps the fixed size traversal stacks safe.
+		bool leaf = count <= 1 || task.depth >= VKTriangleBVH::MAX_DEPTH - 1;
+		int32_t middle = 0;
+		if (!leaf)
+		{
+			float splitCost = MAX_flt;
+			middle = VKBounds::PartitionSAH(input.mins, input.maxs, input.centers, input.order, task.first, task.last, &splitCost);
+
+			const float area = VKBounds::HalfArea(min, max);
+			leaf = count <= VKTriangleBVH::MAX_LEAF_TRIANGLES && TRAVERSAL_COST * area + splitCost >= count * area;
+		}
+
+		if (leaf)
+		{
+			nodes[task.node].first = task.first;
+			nodes[task.node].count = count;
+			continue;
+		}
+
+		const int32_t child = nodes.size();
+		nodes.resize(child + 2);
+		nodes[task.node].first = child;
+		nodes[task.node].count = 0;
+
+		tasks.push_back({ child + 1, middle, task.last, task.depth + 1 });
+		tasks.push_back({ child, task.first, middle, task.depth + 1 });
+	}
+}
+
+// Moeller-Trumbore, two sided.
+static inline bool IntersectTriangle(const Vector3& origin, const Vector3& direction, const Vector3* triangle, float maxDistance, float& outDistance, float& outU, float& outV)
+{
+	const Vector3 edge1 = triangle[1] - triangle[0];
+	const Vector3 edge2 = triangle[2] - triangle[0];
+	const Vector3 p = direction ^ edge2;
+	const float det = edge1 | p;
+	if (det == 0.0f) {
+		return false;
+	}
+
+	const float invDet = 1.0f / det;
+	const Vector3 s = origin - triangle[0];
+	const float u = (s | p) * invDet;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+
+	const Vector3 q = s ^ edge1;
+	const float v = (direction | q) * invDet;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+
+	const float distance = (edge2 | q) * invDet;
+	if (distance < 0.0f || distance > maxDistance) {
+		return false;
+	}
+
+	outDistance = distance;
+	outU = u;
+	outV = v;
+	return true;
+}
+
+// closest hit below the root, or the first one found with anyHit.
+static bool Traverse(const VKTriangleBVH& bvh, const VKRay& ray, bool anyHit, int32_t& outSlot, float& outDistance, float& outU, float& outV)
+{
+	if (bvh.nodes.empty() || ray.maxDistance < 0.0f) {
+		return false;
+	}
+
+	const VKTriangleBVHNode* nodes = bvh.nodes.data();
+	const Vector3* vertices = bvh.vertices.data();
+	const Vector3 invDirection = VKBounds::InverseDirection(ray.direction);
+
+	int32_t stack[VKTriangleBVH::MAX_DEPTH];
+	float entries[VKTriangleBVH::MAX_DEPTH];
+	int32_t stackSize = 0;
+
+	bool found = false;
+	float closest = ray.maxDistance;
+	float entry = 0.0f;
+	if (VKBounds::IntersectRay(nodes[0].min, nodes[0].max, ray.origin, invDirection, closest, entry))
+	{
+		stack[0] = 0;
+		entries[0] = entry;
+		stackSize = 1;
+	}
+
+	while (stackSize > 0)
+	{
+		stackSize -= 1;
+		const VKTriangleBVHNode& node = nodes[stack[stackSize]];
+		if (entries[stackSize] > closest) {
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int32_t slot = node.first; slot < node.first + node.count; ++slot)
+			{
+				float distance = 0.0f;
+				float u = 0.0f;
+				float v = 0.0f;
+				if (!IntersectTriangle(ray.origin, ray.direction, vertices + slot * 3, closest, distance, u, v)) {
+					continue;
+				}
+
+				found = true;
+				closest = distance;
+				outSlot = slot;
+				outDistance = distance;
+				outU = u;
+				outV = v;
+
+				if (anyHit) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		// the nearer child goes on top, its hits shrink the ray before the other one is visited.
+		float entry0 = 0.0f;
+		float entry1 = 0.0f;
+		const bool hit0 = VKBounds::IntersectRay(nodes[node.first].min, nodes[node.first].max, ray.origin, invDirection, closest, entry0);
+		const bool hit1 = VKBounds::IntersectRay(nodes[node.first + 1].min, nodes[node.first + 1].max, ray.origin, invDirection, closest, entry1);
+		if (hit0 && hit1)
+		{
+			const bool nearFirst = entry0 <= entry1;
+			stack[stackSize] = nearFirst ? node.first + 1 : node.first;
+			entries[stackSize++] = nearFirst ? entry1 : entry0;
+			stack[stackSize] = nearFirst ? node.first : node.first + 1;
+			entries[stackSize++] = nearFirst ? entry0 : entry1;
+		}
+		else if (hit0 || hit1)
+		{
+			stack[stackSize] = hit0 ? node.first : node.first + 1;
+			entries[stackSize++] = hit0 ? entry0 : entry1;
+		}
+	}
+
+	return found;
+}
+
+static void FillHit(const VKTriangleBVH& bvh, const VKRay& ray, int32_t slot, float distance, float u, float v, VKTriangleHit& outHit)
+{
+	const Vector3* triangle = bvh.vertices.data() + slot * 3;
+	outHit.position = ray.origin + ray.direction * distance;
+	outHit.normal = ((triangle[1] - triangle[0]) ^ (triangle[2] - triangle[0])).GetSafeNormal();
+	outHit.distance = distance;
+	outHit.u = u;
+	outHit.v = v;
+	outHit.triangle = bvh.triangles[slot];
+}
+
+// lanes whose ray overlaps the node within their closest distance.
+static inline int32_t IntersectRay4(const VKTriangleBVHNode& node, const RayPacket& packet, __m128 closest, __m128& outEntry)
+{
+	__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.x), packet.originX), packet.invDirectionX);
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.x), packet.originX), packet.invDirectionX);
+	__m128 entry = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(t0, t1));
+	__m128 exit = _mm_min_ps(closest, _mm_max_ps(t0, t1));
+
+	t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.y), packet.originY), packet.invDirectionY);
+	t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.y), packet.originY), packet.invDirectionY);
+	entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+	exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+
+	t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.z), packet.originZ), packet.invDirectionZ);
+	t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.z), packet.originZ), packet.invDirectionZ);
+	entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+	exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+
+	outEntry = entry;
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+}
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Moeller-Trumbore for 4 rays against one triangle, lanes that hit closer take the new distance.
+static inline int32_t IntersectTriangle4(const RayPacket& packet, const Vector3* triangle, __m128& closest, __m128& hitU, __m128& hitV)
+{
+	const Vector3 edge1 = triangle[1] - triangle[0];
+	const Vector3 edge2 = triangle[2] - triangle[0];
+	const __m128 e1x = _mm_set1_ps(edge1.x);
+	const __m128 e1y = _mm_set1_ps(edge1.y);
+	const __m128 e1z = _mm_set1_ps(edge1.z);
+	const __m128 e2x = _mm_set1_ps(edge2.x);
+	const __m128 e2y = _mm_set1_ps(edge2.y);
+	const __m128 e2z = _mm_set1_ps(edge2.z);
+
+	// p = direction x edge2
+	const __m128 px = _mm_sub_ps(_mm_mul_ps(packet.directionY, e2z), _mm_mul_ps(packet.directionZ, e2y));
+	const __m128 py = _mm_sub_ps(_mm_mul_ps(packet.directionZ, e2x), _mm_mul_ps(packet.directionX, e2z));
+	const __m128 pz = _mm_sub_ps(_mm_mul_ps(packet.directionX, e2y), _mm_mul_ps(packet.directionY, e2x));
+	const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	const __m128 sx = _mm_sub_ps(packet.originX, _mm_set1_ps(triangle[0].x));
+	const __m128 sy = _mm_sub_ps(packet.originY, _mm_set1_ps(triangle[0].y));
+	const __m128 sz = _mm_sub_ps(packet.originZ, _mm_set1_ps(triangle[0].z));
+	const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+	// q = s x edge1
+	const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+	const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(packet.directionX, qx), _mm_mul_ps(packet.directionY, qy)), _mm_mul_ps(packet.directionZ, qz)), invDet);
+	const __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+	const __m128 zero = _mm_setzero_ps();
+	__m128 mask = _mm_cmpneq_ps(det, zero);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(distance, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(distance, closest));
+
+	closest = Select(mask, distance, closest);
+	hitU = Select(mask, u, hitU);
+	hitV = Select(mask, v, hitV);
+	return _mm_movemask_ps(mask);
+}
+
+VKTriangleBVH* VKTriangleBVH::Create(const float* positions, int32_t stride, int32_t vertexCount, const uint32_t* indices, int32_t indexCount)
+{
+	const int32_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return nullptr;
+	}
+
+	for (int32_t i = 0; i < triangleCount * 3; ++i)
+	{
+		if (indices[i] >= (uint32_t)vertexCount)
+		{
+			MLOGE("Triangle BVH index %u is out of %d vertices.", indices[i], vertexCount);
+			return nullptr;
+		}
+	}
+
+	auto getPosition = [&](uint32_t index) {
+		const float* position = (const float*)((const uint8_t*)positions + (size_t)index * stride);
+		return Vector3(position[0], position[1], position[2]);
+	};
+
+	ThreadPool& threadPool = ThreadPool::Get();
+
+	std::vector<Vector3> mins(triangleCount);
+	std::vector<Vector3> maxs(triangleCount);
+	std::vector<Vector3> centers(triangleCount);
+	threadPool.ParallelFor((triangleCount + BOUNDS_BATCH_SIZE - 1) / BOUNDS_BATCH_SIZE, [&](int32_t batch) {
+		const int32_t first = batch * BOUNDS_BATCH_SIZE;
+		const int32_t last = math::Min(triangleCount, first + BOUNDS_BATCH_SIZE);
+		for (int32_t i = first; i < last; ++i)
+		{
+			Vector3 p0 = getPosition(indices[i * 3 + 0]);
+			Vector3 p1 = getPosition(indices[i * 3 + 1]);
+			Vector3 p2 = getPosition(indices[i * 3 + 2]);
+			mins[i] = Vector3::Min(Vector3::Min(p0, p1), p2);
+			maxs[i] = Vector3::Max(Vector3::Max(p0, p1), p2);
+			centers[i] = (mins[i] + maxs[i]) * 0.5f;
+		}
+	});
+
+	std::vector<int32_t> order(triangleCount);
+	std::iota(order.begin(), order.end(), 0);
+
+	BuildInput input;
+	input.mins = mins.data();
+	input.maxs = maxs.data();
+	input.centers = centers.data();
+	input.order = order.data();
+
+	VKTriangleBVH* bvh = new VKTriangleBVH();
+	std::vector<VKTriangleBVHNode>& nodes = bvh->nodes;
+	nodes.reserve(triangleCount * 2 - 1);
+	nodes.resize(1);
+
+	const int32_t threadCount = threadPool.GetThreadCount() + 1;
+	if (triangleCount <= PARALLEL_BUILD_TRIANGLES || threadCount == 1)
+	{
+		BuildNodes(input, nodes, { 0, 0, triangleCount, 0 }, 0, nullptr);
+	}
+	else
+	{
+		// the top levels are split here until there are a few ranges per thread, the subtrees below
+		// them work on disjoint parts of order and are built in parallel.
+		const int32_t deferSize = math::Max(PARALLEL_BUILD_TRIANGLES, triangleCount / (threadCount * 4));
+		std::vector<BuildTask> deferred;
+		BuildNodes(input, nodes, { 0, 0, triangleCount, 0 }, deferSize, &deferred);
+
+		std::vector<std::vector<VKTriangleBVHNode>> subtrees(deferred.size());
+		threadPool.ParallelFor(deferred.size(), [&](int32_t index) {
+			const BuildTask& task = deferred[index];
+			std::vector<VKTriangleBVHNode>& subtree = subtrees[index];
+			subtree.resize(1);
+			BuildNodes(input, subtree, { 0, task.first, task.last, task.depth }, 0, nullptr);
+		});
+
+		// subtree node 0 replaces the deferred node, the rest is appended with child indices moved along.
+		for (int32_t i = 0; i < deferred.size(); ++i)
+		{
+			const std::vector<VKTriangleBVHNode>& subtree = subtrees[i];
+			const int32_t base = (int32_t)nodes.size() - 1;
+			for (int32_t j = 0; j < subtree.size(); ++j)
+			{
+				VKTriangleBVHNode node = subtree[j];
+				if (node.count == 0) {
+					node.first += base;
+				}
+
+				if (j == 0) {
+					nodes[deferred[i].node] = node;
+				}
+				else {
+					nodes.push_back(node);
+				}
+			}
+		}
+	}
+
+	nodes.shrink_to_fit();
+
+	bvh->vertices.resize(triangleCount * 3);
+	bvh->triangles.resize(triangleCount);
+	for (int32_t slot = 0; slot < triangleCount; ++slot)
+	{
+		const int32_t triangle = order[slot];
+		bvh->triangles[slot] = triangle;
+		bvh->vertices[slot * 3 + 0] = getPosition(indices[triangle * 3 + 0]);
+		bvh->vertices[slot * 3 + 1] = getPosition(indices[triangle * 3 + 1]);
+		bvh->vertices[slot * 3 + 2] = getPosition(indices[triangle * 3 + 2]);
+	}
+
+	return bvh;
+}
+
+bool VKTriangleBVH::RayCast(const VKRay& ray, VKTriangleHit& outHit) const
+{
+	int32_t slot = -1;
+	float distance = 0.0f;
+	float u = 0.0f;
+	float v = 0.0f;
+	if (!Traverse(*this, ray, false, slot, distance, u, v)) {
+		return false;
+	}
+
+	FillHit(*this, ray, slot, distance, u, v, outHit);
+	return true;
+}
+
+bool VKTriangleBVH::SegmentCast(const Vector3& start, const Vector3& end, VKTriangleHit& outHit) const
+{
+	return RayCast(VKRay(start, end - start, 1.0f), outHit);
+}
+
+bool VKTriangleBVH::Intersects(const VKRay& ray) const
+{
+	int32_t slot = -1;
+	float distance = 0.0f;
+	float u = 0.0f;
+	float v = 0.0f;
+	return Traverse(*this, ray, true, slot, distance, u, v);
+}
+
+void VKTriangleBVH::RayCast4(const VKRay* rays, VKTriangleHit* outHits) const
+{
+	if (nodes.empty()) {
+		return;
+	}
+
+	Vector3 invDirections[4] = {
+		VKBounds::InverseDirection(rays[0].direction),
+		VKBounds::InverseDirection(rays[1].direction),
+		VKBounds::InverseDirection(rays[2].direction),
+		VKBounds::InverseDirection(rays[3].direction),
+	};
+
+	RayPacket packet;
+	packet.originX = _mm_setr_ps(rays[0].origin.x, rays[1].origin.x, rays[2].origin.x, rays[3].origin.x);
+	packet.originY = _mm_setr_ps(rays[0].origin.y, rays[1].origin.y, rays[2].origin.y, rays[3].origin.y);
+	packet.originZ = _mm_setr_ps(rays[0].origin.z, rays[1].origin.z, rays[2].origin.z, rays[3].origin.z);
+	packet.directionX = _mm_setr_ps(rays[0].direction.x, rays[1].direction.x, rays[2].direction.x, rays[3].direction.x);
+	packet.directionY = _mm_setr_ps(rays[0].direction.y, rays[1].direction.y, rays[2].direction.y, rays[3].direction.y);
+	packet.directionZ = _mm_setr_ps(rays[0].direction.z, rays[1].direction.z, rays[2].direction.z, rays[3].direction.z);
+	packet.invDirectionX = _mm_setr_ps(invDirections[0].x, invDirections[1].x, invDirections[2].x, invDirections[3].x);
+	packet.invDirectionY = _mm_setr_ps(invDirections[0].y, invDirections[1].y, invDirections[2].y, invDirections[3].y);
+	packet.invDirectionZ = _mm_setr_ps(invDirections[0].z, invDirections[1].z, invDirections[2].z, invDirections[3].z);
+
+	// unused rays have a negative distance and never pass a box test.
+	__m128 closest = _mm_setr_ps(rays[0].maxDistance, rays[1].maxDistance, rays[2].maxDistance, rays[3].maxDistance);
+	__m128 hitU = _mm_setzero_ps();
+	__m128 hitV = _mm_setzero_ps();
+	int32_t hitSlots[4] = { -1, -1, -1, -1 };
+
+	const VKTriangleBVHNode* nodeDatas = nodes.data();
+	const Vector3* vertexDatas = vertices.data();
+
+	int32_t stack[MAX_DEPTH];
+	__m128 entries[MAX_DEPTH];
+	int32_t stackSize = 0;
+
+	__m128 entry;
+	if (IntersectRay4(nodeDatas[0], packet, closest, entry))
+	{
+		stack[0] = 0;
+		entries[0] = entry;
+		stackSize = 1;
+	}
+
+	while (stackSize > 0)
+	{
+		stackSize -= 1;
+		const VKTriangleBVHNode& node = nodeDatas[stack[stackSize]];
+
+		// skipped once every ray has found something closer than the node.
+		if (_mm_movemask_ps(_mm_cmple_ps(entries[stackSize], closest)) == 0) {
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int32_t slot = node.first; slot < node.first + node.count; ++slot)
+			{
+				const int32_t mask = IntersectTriangle4(packet, vertexDatas + slot * 3, closest, hitU, hitV);
+				for (int32_t lane = 0; lane < 4; ++lane)
+				{
+					if (mask & (1 << lane)) {
+						hitSlots[lane] = slot;
+					}
+				}
+			}
+			continue;
+		}
+
+		__m128 entry0;
+		__m128 entry1;
+		const int32_t mask0 = IntersectRay4(nodeDatas[node.first], packet, closest, entry0);
+		const int32_t mask1 = IntersectRay4(nodeDatas[node.first + 1], packet, closest, entry1);
+		if (mask0 && mask1)
+		{
+			// the child that is nearer for most of the rays hitting both goes on top.
+			const int32_t both = mask0 & mask1;
+			const int32_t nearer0 = _mm_movemask_ps(_mm_cmple_ps(entry0, entry1)) & both;
+			int32_t votes = 0;
+			for (int32_t lane = 0; lane < 4; ++lane) {
+				votes += (nearer0 & (1 << lane)) ? 1 : ((both & (1 << lane)) ? -1 : 0);
+			}
+
+			const bool nearFirst = votes >= 0;
+			stack[stackSize] = nearFirst ? node.first + 1 : node.first;
+			entries[stackSize++] = nearFirst ? entry1 : entry0;
+			stack[stackSize] = nearFirst ? node.first : node.first + 1;
+			entries[stackSize++] = nearFirst ? entry0 : entry1;
+		}
+		else if (mask0 || mask1)
+		{
+			stack[stackSize] = mask0 ? node.first : node.first + 1;
+			entries[stackSize++] = mask0 ? entry0 : entry1;
+		}
+	}
+
+	float distances[4];
+	float us[4];
+	float vs[4];
+	_mm_storeu_ps(distances, closest);
+	_mm_storeu_ps(us, hitU);
+	_mm_storeu_ps(vs, hitV);
+
+	for (int32_t lane = 0; lane < 4; ++lane)
+	{
+		if (hitSlots[lane] >= 0) {
+			FillHit(*this, rays[lane], hitSlots[lane], distances[lane], us[lane], vs[lane], outHits[lane]);
+		}
+	}
+}
+
+void VKTriangleBVH::RayCast(const VKRay* rays, int32_t count, VKTriangleHit* outHits) const
+{
+	const int32_t packetCount = count & ~3;
+	for (int32_t i = 0; i < packetCount; i += 4) {
+		RayCast4(rays + i, outHits + i);
+	}
+
+	if (packetCount == count) {
+		return;
+	}
+
+	VKRay tailRays[4];
+	VKTriangleHit tailHits[4];
+	for (int32_t i = 0; i < 4; ++i)
+	{
+		if (packetCount + i < count)
+		{
+			tailRays[i] = rays[packetCount + i];
+			tailHits[i] = outHits[packetCount + i];
+		}
+		else
+		{
+			tailRays[i].maxDistance = -1.0f;
+		}
+	}
+
+	RayCast4(tailRays, tailHits);
+
+	for (int32_t i = 0; packetCount + i < count; ++i) {
+		outHits[packetCount + i] = tailHits[i];
+	}
+}
+
+int64_t VKTriangleBVH::GetBytes() const
+{
+	return nodes.size() * sizeof(VKTriangleBVHNode) + vertices.size() * sizeof(Vector3) + triangles.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "VKBounds.h"
+
+#include <vector>
+
+struct VKMesh;
+
+struct VKRay
+{
+	Vector3		origin;
+	// need not be normalized, distances are in units of the direction.
+	Vector3		direction;
+	// a negative distance marks an unused ray, e.g. padding of a packet.
+	float		maxDistance = MAX_flt;
+
+	VKRay()
+		: origin(0.0f, 0.0f, 0.0f)
+		, direction(0.0f, 0.0f, 1.0f)
+	{
+
+	}
+
+	VKRay(const Vector3& inOrigin, const Vector3& inDirection, float inMaxDistance = MAX_flt)
+		: origin(inOrigin)
+		, direction(inDirection)
+		, maxDistance(inMaxDistance)
+	{
+
+	}
+};
+
+struct VKTriangleHit
+{
+	Vector3		position;
+	// unit normal of the triangle, facing the side its winding is counter clockwise from.
+	Vector3		normal;
+	float		distance = MAX_flt;
+	// barycentric weights of the second and third vertex.
+	float		u = 0.0f;
+	float		v = 0.0f;
+	// source triangle of the mesh, -1 for a miss.
+	int32_t		triangle = -1;
+	// set by VKRayCaster, the BVH alone does not know its mesh.
+	VKMesh*		mesh = nullptr;
+
+	VKTriangleHit()
+		: position(0.0f, 0.0f, 0.0f)
+		, normal(0.0f, 0.0f, 0.0f)
+	{
+
+	}
+
+	inline bool IsValid() const
+	{
+		return triangle >= 0;
+	}
+};
+
+struct VKTriangleBVHNode
+{
+	Vector3		min;
+	// internal nodes: index of the first of their two adjacent children. leaves: first triangle slot.
+	int32_t		first = 0;
+	Vector3		max;
+	// triangles of a leaf, 0 for internal nodes.
+	int32_t		count = 0;
+};
+
+// Static triangle BVH of one mesh in its node space, built with binned SAH. Triangles are copied in
+// leaf order so a leaf reads one contiguous run of vertices. Queries are const and thread safe.
+class VKTriangleBVH
+{
+	friend class VKModelCooker;
+
+public:
+	static const int32_t MAX_LEAF_TRIANGLES = 4;
+	static const int32_t MAX_DEPTH = 64;
+
+private:
+	VKTriangleBVH()
+	{
+
+	}
+
+public:
+	// positions are 3 floats every stride bytes, indices 3 per triangle. Large meshes build their
+	// subtrees on the thread pool. Returns nullptr for an empty mesh or out of range indices.
+	static VKTriangleBVH* Create(const float* positions, int32_t stride, int32_t vertexCount, const uint32_t* indices, int32_t indexCount);
+
+	// closest hit, two sided. Hits are only written for rays that find a triangle within their maxDistance.
+	bool RayCast(const VKRay& ray, VKTriangleHit& outHit) const;
+
+	// distance is the fraction of the way from start to end.
+	bool SegmentCast(const Vector3& start, const Vector3& end, VKTriangleHit& outHit) const;
+
+	// stops at the first triangle found, for line of sight tests.
+	bool Intersects(const VKRay& ray) const;
+
+	// traces 4 rays together with SSE, every node and triangle is tested against all of them at once.
+	// Pays off for coherent rays that visit the same nodes, e.g. neighbouring pixels or a group of probes.
+	void RayCast4(const VKRay* rays, VKTriangleHit* outHits) const;
+
+	// packets of 4, the last one padded.
+	void RayCast(const VKRay* rays, int32_t count, VKTriangleHit* outHits) const;
+
+	inline const VKTriangleBVHNode& GetRoot() const
+	{
+		return nodes[0];
+	}
+
+	inline int32_t GetTriangleCount() const
+	{
+		return (int32_t)triangles.size();
+	}
+
+	int64_t GetBytes() const;
+
+public:
+	std::vector<VKTriangleBVHNode>	nodes;
+	// 3 per triangle slot.
+	std::vector<Vector3>			vertices;
+	// source triangle of every slot.
+	std::vector<uint32_t>			triangles;
+};
@@ -2,7 +2,12 @@
 #include "VKVertexBuffer.h"
 #include "VulkanDevice.h"
 
-VKVertexBuffer* VKVertexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, std::vector<float> vertices, const std::vector<VertexAttribute>& attributes)
+VKVertexBuffer* VKVertexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, Span<const float> vertices, const std::vector<VertexAttribute>& attributes)
+{
+	return Create(vulkanDevice, cmdBuffer, vertices.begin, vertices.length() * sizeof(float), attributes);
+}
+
+VKVertexBuffer* VKVertexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, VKCommandBuffer* cmdBuffer, const void* dataPtr, uint32_t dataSize, const std::vector<VertexAttribute>& attributes)
 {
 	VkDevice device = vulkanDevice->GetInstanceHandle();
 
@@ -14,21 +19,21 @@ VKVertexBuffer* VKVertexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevic
 		vulkanDevice,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertices.size() * sizeof(float),
-		vertices.data()
+		dataSize,
+		(void*)dataPtr
 	);
 
 	vertexBuffer->dvkBuffer = DVKBuffer::CreateBuffer(
 		vulkanDevice,
 		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertices.size() * sizeof(float)
+		dataSize
 	);
 
 	cmdBuffer->Begin();
 
 	VkBufferCopy copyRegion = {};
-	copyRegion.size = vertices.size() * sizeof(float);
+	copyRegion.size = dataSize;
 	vkCmdCopyBuffer(cmdBuffer->cmdBuffer, vertexStaging->buffer, vertexBuffer->dvkBuffer->buffer, 1, &copyRegion);
 
 	cmdBuffer->End();
@@ -70,3 +75,19 @@ VkVertexInputBindingDescription VKVertexBuffer::GetInputBinding()
 
 	return vertexInputBinding;
 }
+
+VKVertexBuffer* VKVertexBuffer::Create(std::shared_ptr<VulkanDevice> vulkanDevice, uint32_t dataSize, const std::vector<VertexAttribute>& attributes)
+{
+	VKVertexBuffer* vertexBuffer = new VKVertexBuffer();
+	vertexBuffer->device = vulkanDevice->GetInstanceHandle();
+	vertexBuffer->attributes = attributes;
+
+	vertexBuffer->dvkBuffer = DVKBuffer::CreateBuffer(
+		vulkanDevice,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		dataSize
+	);
+
+	return vertexBuffer;
+}
\ No newline at end of file
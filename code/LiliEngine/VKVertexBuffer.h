@@ -3,6 +3,7 @@
 #include "DVKBuffer.h"
 #include "VKCommandBuffer.h"
 #include "RHIDefinitions.h"
+#include "Span.h"
 
 inline int32_t VertexAttributeToSize(VertexAttribute attribute)
 {
@@ -54,6 +55,30 @@ inline int32_t VertexAttributeToSize(VertexAttribute attribute)
 	else if (attribute == VertexAttribute::VA_InstanceFloat4) {
 		return 4 * sizeof(float);
 	}
+	// compact encodings, all sizes stay multiples of 4 so they pack into float streams.
+	else if (attribute == VertexAttribute::VA_PositionSNorm16 ||
+		attribute == VertexAttribute::VA_PositionHalf ||
+		attribute == VertexAttribute::VA_SkinWeightUNorm16 ||
+		attribute == VertexAttribute::VA_SkinIndex8 ||
+		attribute == VertexAttribute::VA_SkinWeight8
+		)
+	{
+		return 4 * sizeof(uint16_t);
+	}
+	else if (attribute == VertexAttribute::VA_NormalOct ||
+		attribute == VertexAttribute::VA_UV0UNorm16 ||
+		attribute == VertexAttribute::VA_UV1UNorm16
+		)
+	{
+		return 2 * sizeof(uint16_t);
+	}
+	else if (attribute == VertexAttribute::VA_TangentOct ||
+		attribute == VertexAttribute::VA_SkinIndexUInt8 ||
+		attribute == VertexAttribute::VA_SkinWeightUNorm8
+		)
+	{
+		return 4 * sizeof(uint8_t);
+	}
 
 	return 0;
 }
@@ -108,6 +133,33 @@ inline VkFormat VertexAttributeToVkFormat(VertexAttribute attribute)
 	else if (attribute == VertexAttribute::VA_InstanceFloat4) {
 		format = VK_FORMAT_R32G32B32A32_SFLOAT;
 	}
+	else if (attribute == VertexAttribute::VA_PositionSNorm16) {
+		format = VK_FORMAT_R16G16B16A16_SNORM;
+	}
+	else if (attribute == VertexAttribute::VA_PositionHalf) {
+		format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	}
+	else if (attribute == VertexAttribute::VA_NormalOct) {
+		format = VK_FORMAT_R16G16_SNORM;
+	}
+	else if (attribute == VertexAttribute::VA_TangentOct) {
+		format = VK_FORMAT_R8G8B8A8_SNORM;
+	}
+	else if (attribute == VertexAttribute::VA_UV0UNorm16 || attribute == VertexAttribute::VA_UV1UNorm16) {
+		format = VK_FORMAT_R16G16_UNORM;
+	}
+	else if (attribute == VertexAttribute::VA_SkinIndexUInt8) {
+		format = VK_FORMAT_R8G8B8A8_UINT;
+	}
+	else if (attribute == VertexAttribute::VA_SkinWeightUNorm8) {
+		format = VK_FORMAT_R8G8B8A8_UNORM;
+	}
+	else if (attribute == VertexAttribute::VA_SkinWeightUNorm16) {
+		format = VK_FORMAT_R16G16B16A16_UNORM;
+	}
+	else if (attribute == VertexAttribute::VA_SkinIndex8 || attribute == VertexAttribute::VA_SkinWeight8) {
+		format = VK_FORMAT_R32G32_UINT;
+	}
 
 	return format;
 }
@@ -138,7 +190,13 @@ public:
 
 	std::vector<VkVertexInputAttributeDescription> GetInputAttributes(const std::vector<VertexAttribute>& shaderInputs);
 
-	static VKVertexBuffer* Create(std::shared_ptr<VulkanDevice> device, VKCommandBuffer* cmdBuffer, std::vector<float> vertices, const std::vector<VertexAttribute>& attributes);
+	static VKVertexBuffer* Create(std::shared_ptr<VulkanDevice> device, VKCommandBuffer* cmdBuffer, Span<const float> vertices, const std::vector<VertexAttribute>& attributes);
+
+	// uploads straight from dataPtr (e.g. a mapped file), no intermediate copy.
+	static VKVertexBuffer* Create(std::shared_ptr<VulkanDevice> device, VKCommandBuffer* cmdBuffer, const void* dataPtr, uint32_t dataSize, const std::vector<VertexAttribute>& attributes);
+
+	// no data, the caller records the transfer (e.g. several buffers from one staging buffer).
+	static VKVertexBuffer* Create(std::shared_ptr<VulkanDevice> device, uint32_t dataSize, const std::vector<VertexAttribute>& attributes);
 
 public:
 	VkDevice						device = VK_NULL_HANDLE;
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <emmintrin.h>
+
+// CPU encoders for the compact VertexAttribute encodings. Shader side:
+//   VA_PositionSNorm16  vec4 inPositionSNorm, position = inPositionSNorm.xyz * scale + offset,
+//                       scale/offset come from VKMesh::GetPositionDequantizeMatrix().
+//   VA_PositionHalf     vec4 inPositionHalf, used as is.
+//   VA_NormalOct        vec2 inNormalOct, normal = OctDecode(inNormalOct).
+//   VA_TangentOct       vec4 inTangentOct, tangent = vec4(OctDecode(inTangentOct.xy), inTangentOct.w).
+//   VA_UV0/1UNorm16     vec2 inUV0UNorm, uv = inUV0UNorm * d.xy + d.zw with d = VKMesh::uvDequantize[channel],
+//                       which is identity for UVs inside [0, 1].
+//   VA_SkinIndexUInt8   uvec4 inSkinIndex.
+//   VA_SkinWeight*      vec4 inSkinWeightUNorm8/16, weights sum to 1 after quantization.
+//   VA_SkinIndex8       uvec2 inSkinIndex8, bone k = (inSkinIndex8[k / 4] >> (8 * (k % 4))) & 0xFF.
+//   VA_SkinWeight8      uvec2 inSkinWeight8, weights = unpackUnorm4x8(inSkinWeight8.x/.y), strongest first.
+//
+//   vec3 OctDecode(vec2 e) {
+//       vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+//       float t = max(-v.z, 0.0);
+//       v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+//       return normalize(v);
+//   }
+
+inline uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponentBits = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// inf and nan
+	if (exponentBits == 0xFF) {
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	}
+
+	int32_t exponent = (int32_t)exponentBits - 127 + 15;
+	if (exponent >= 31) {
+		return sign | 0x7C00;
+	}
+
+	// denormals, rounded to nearest even
+	if (exponent <= 0)
+	{
+		if (exponent < -10) {
+			return sign;
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))) {
+			half += 1;
+		}
+		return sign | half;
+	}
+
+	// a mantissa carry correctly bumps the exponent
+	uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+		half += 1;
+	}
+	return half;
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	float value;
+	if (exponent == 0) {
+		value = ldexpf((float)mantissa, -24);
+	}
+	else if (exponent == 31) {
+		value = mantissa ? NAN : INFINITY;
+	}
+	else {
+		value = ldexpf((float)(mantissa | 0x400), (int32_t)exponent - 25);
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+	bits |= sign;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+inline int16_t QuantizeSNorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return (int16_t)roundf(value * 32767.0f);
+}
+
+inline int8_t QuantizeSNorm8(float value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return (int8_t)roundf(value * 127.0f);
+}
+
+inline uint16_t QuantizeUNorm16(float value)
+{
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return (uint16_t)roundf(value * 65535.0f);
+}
+
+// octahedral mapping of a unit vector onto [-1, 1]^2.
+inline void OctEncode(float x, float y, float z, float& outU, float& outV)
+{
+	float sum = fabsf(x) + fabsf(y) + fabsf(z);
+	if (sum <= 0.0f)
+	{
+		outU = 0.0f;
+		outV = 0.0f;
+		return;
+	}
+
+	x /= sum;
+	y /= sum;
+
+	if (z < 0.0f)
+	{
+		float u = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float v = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = u;
+		y = v;
+	}
+
+	outU = x;
+	outV = y;
+}
+
+// 4-lane versions of the encoders above, bit exact with them.
+
+// FloatToHalf per lane, the result sits in the low 16 bits sign extended so _mm_packs_epi32 keeps it.
+inline __m128i FloatToHalf4(__m128 value)
+{
+	const __m128i signMask = _mm_set1_epi32(0x80000000);
+	// 65536, everything from here on is inf.
+	const __m128i halfMax = _mm_set1_epi32((127 + 16) << 23);
+	// smallest float that is still a normal half.
+	const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+	// adding this float shifts denormal halves into the low mantissa bits, rounded to nearest even.
+	const __m128i denormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	// rebias the exponent and add the rounding bias below the kept mantissa bits.
+	const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+	__m128 sign = _mm_and_ps(value, _mm_castsi128_ps(signMask));
+	__m128 absValue = _mm_xor_ps(value, sign);
+	__m128i absBits = _mm_castps_si128(absValue);
+
+	__m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+	__m128i infOrNaN = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+	__m128i isRegular = _mm_cmpgt_epi32(halfMax, absBits);
+	__m128i isDenormal = _mm_cmpgt_epi32(minNormal, absBits);
+
+	__m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+	// ties go to even: one more when the lowest kept mantissa bit is set.
+	__m128i oddMantissa = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+	__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), oddMantissa), 13);
+
+	__m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+	__m128i half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNaN));
+	return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+// roundf per lane, halfway cases away from zero.
+inline __m128i RoundToInt4(__m128 value)
+{
+	__m128i truncated = _mm_cvttps_epi32(value);
+	__m128 fraction = _mm_sub_ps(value, _mm_cvtepi32_ps(truncated));
+	__m128 roundAway = _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), fraction), _mm_set1_ps(0.5f));
+	__m128i step = _mm_or_si128(_mm_srai_epi32(_mm_castps_si128(value), 31), _mm_set1_epi32(1));
+	return _mm_add_epi32(truncated, _mm_and_si128(_mm_castps_si128(roundAway), step));
+}
+
+// QuantizeSNorm16 (maxValue 32767) or QuantizeSNorm8 (maxValue 127) per lane.
+inline __m128i QuantizeSNorm4(__m128 value, float maxValue)
+{
+	value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f));
+	return RoundToInt4(_mm_mul_ps(value, _mm_set1_ps(maxValue)));
+}
+
+// QuantizeUNorm16 per lane, packed to 8 uint16 without SSE4's _mm_packus_epi32.
+inline __m128i QuantizeUNorm16x8(__m128 lo, __m128 hi)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 scale = _mm_set1_ps(65535.0f);
+	const __m128i bias = _mm_set1_epi32(32768);
+	__m128i qlo = _mm_sub_epi32(RoundToInt4(_mm_mul_ps(_mm_max_ps(_mm_min_ps(lo, one), zero), scale)), bias);
+	__m128i qhi = _mm_sub_epi32(RoundToInt4(_mm_mul_ps(_mm_max_ps(_mm_min_ps(hi, one), zero), scale)), bias);
+	return _mm_xor_si128(_mm_packs_epi32(qlo, qhi), _mm_set1_epi16((short)0x8000));
+}
+
+// OctEncode of 4 vectors given as x, y and z lanes.
+inline void OctEncode4(__m128 x, __m128 y, __m128 z, __m128& outU, __m128& outV)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 sum = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+	__m128 valid = _mm_cmpgt_ps(sum, zero);
+	x = _mm_and_ps(valid, _mm_div_ps(x, sum));
+	y = _mm_and_ps(valid, _mm_div_ps(y, sum));
+
+	__m128 signX = _mm_or_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), one), _mm_andnot_ps(_mm_cmpge_ps(x, zero), _mm_set1_ps(-1.0f)));
+	__m128 signY = _mm_or_ps(_mm_and_ps(_mm_cmpge_ps(y, zero), one), _mm_andnot_ps(_mm_cmpge_ps(y, zero), _mm_set1_ps(-1.0f)));
+	__m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(y, absMask)), signX);
+	__m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(x, absMask)), signY);
+
+	__m128 lower = _mm_and_ps(valid, _mm_cmplt_ps(z, zero));
+	outU = _mm_or_ps(_mm_and_ps(lower, foldedU), _mm_andnot_ps(lower, x));
+	outV = _mm_or_ps(_mm_and_ps(lower, foldedV), _mm_andnot_ps(lower, y));
+}
+
+// quantizes weights to maxValue steps and hands the rounding error to the largest weight, so the sum stays exact.
+inline void QuantizeWeights(const float* weights, int32_t count, uint32_t maxValue, uint32_t* outWeights)
+{
+	int32_t largest = 0;
+	int32_t sum = 0;
+	for (int32_t i = 0; i < count; ++i)
+	{
+		float weight = weights[i] < 0.0f ? 0.0f : (weights[i] > 1.0f ? 1.0f : weights[i]);
+		outWeights[i] = (uint32_t)roundf(weight * maxValue);
+		sum += outWeights[i];
+		if (weights[i] > weights[largest]) {
+			largest = i;
+		}
+	}
+
+	int32_t fixedWeight = (int32_t)outWeights[largest] + ((int32_t)maxValue - sum);
+	outWeights[largest] = fixedWeight < 0 ? 0 : fixedWeight;
+}
+
+inline void QuantizeWeights(const float weights[4], uint32_t maxValue, uint32_t outWeights[4])
+{
+	QuantizeWeights(weights, 4, maxValue, outWeights);
+}
@@ -73,8 +73,139 @@ void VulkanDevice::InitGPU(int32_t deviceIndex) noexcept
 	m_fenceManager->Init(this);
 }
 
+// descriptor indexing features are optional. When the device lacks the extension or one of the requested
+// features, the request is dropped from the feature chain and the extension list so the device still gets
+// created, and IsDescriptorIndexingEnabled() tells the renderer to stay on classic descriptor sets.
+void VulkanDevice::validateDescriptorIndexing() noexcept
+{
+	m_descriptorIndexingEnabled = false;
+
+	VkBaseOutStructure* previous = (VkBaseOutStructure*)m_physicalDeviceFeatures2;
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT* requested = nullptr;
+	while (previous && previous->pNext)
+	{
+		if (previous->pNext->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT)
+		{
+			requested = (VkPhysicalDeviceDescriptorIndexingFeaturesEXT*)previous->pNext;
+			break;
+		}
+		previous = previous->pNext;
+	}
+
+	if (!requested) {
+		return;
+	}
+
+	uint32_t count = 0;
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, nullptr);
+	std::vector<VkExtensionProperties> extensions(count);
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, extensions.data());
+
+	bool supported = false;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (strcmp(extensions[i].extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0) {
+			supported = true;
+		}
+	}
+
+	if (supported)
+	{
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT features;
+		ZeroVulkanStruct(features, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT);
+		VkPhysicalDeviceFeatures2 features2;
+		ZeroVulkanStruct(features2, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2);
+		features2.pNext = &features;
+		vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+
+		// the feature struct is a run of VkBool32 after sType and pNext.
+		const VkBool32* want = &requested->shaderInputAttachmentArrayDynamicIndexing;
+		const VkBool32* have = &features.shaderInputAttachmentArrayDynamicIndexing;
+		const size_t featureCount = (sizeof(features) - offsetof(VkPhysicalDeviceDescriptorIndexingFeaturesEXT, shaderInputAttachmentArrayDynamicIndexing)) / sizeof(VkBool32);
+		for (size_t i = 0; i < featureCount; ++i)
+		{
+			if (want[i] && !have[i])
+			{
+				Log::Message("Descriptor indexing feature " + std::to_string(i) + " is not supported");
+				supported = false;
+			}
+		}
+	}
+	else
+	{
+		Log::Message(std::string(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) + " is not supported");
+	}
+
+	if (!supported)
+	{
+		previous->pNext = (VkBaseOutStructure*)requested->pNext;
+		for (size_t i = 0; i < m_appDeviceExtensions.size(); ++i)
+		{
+			if (strcmp(m_appDeviceExtensions[i], VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0)
+			{
+				m_appDeviceExtensions.erase(m_appDeviceExtensions.begin() + i);
+				break;
+			}
+		}
+		return;
+	}
+
+	ZeroVulkanStruct(m_descriptorIndexingProperties, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT);
+	VkPhysicalDeviceProperties2 properties2;
+	ZeroVulkanStruct(properties2, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2);
+	properties2.pNext = &m_descriptorIndexingProperties;
+	vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+	m_descriptorIndexingProperties.pNext = nullptr;
+
+	m_descriptorIndexingEnabled = true;
+}
+
+// app device extensions the device lacks are dropped with a message instead of failing vkCreateDevice,
+// the caller checks IsAppExtensionEnabled and falls back.
+void VulkanDevice::validateAppDeviceExtensions() noexcept
+{
+	uint32_t count = 0;
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, nullptr);
+	std::vector<VkExtensionProperties> extensions(count);
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, extensions.data());
+
+	for (size_t i = 0; i < m_appDeviceExtensions.size();)
+	{
+		bool supported = false;
+		for (uint32_t j = 0; j < count; ++j)
+		{
+			if (strcmp(extensions[j].extensionName, m_appDeviceExtensions[i]) == 0) {
+				supported = true;
+			}
+		}
+
+		if (supported)
+		{
+			++i;
+			continue;
+		}
+
+		Log::Message(std::string(m_appDeviceExtensions[i]) + " is not supported");
+		m_appDeviceExtensions.erase(m_appDeviceExtensions.begin() + i);
+	}
+}
+
+bool VulkanDevice::IsAppExtensionEnabled(const char* name) const noexcept
+{
+	for (size_t i = 0; i < m_appDeviceExtensions.size(); ++i)
+	{
+		if (strcmp(m_appDeviceExtensions[i], name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void VulkanDevice::CreateDevice() noexcept
 {
+	validateDescriptorIndexing();
+	validateAppDeviceExtensions();
+
 	bool debugMarkersFound = false;
 	std::vector<const char*> deviceExtensions;
 	std::vector<const char*> validationLayers;
@@ -61,6 +61,21 @@ public:
         return m_physicalDeviceFeatures;
     }
 
+    // true when descriptor indexing was requested and the device supports every requested feature.
+    inline bool IsDescriptorIndexingEnabled() const noexcept
+    {
+        return m_descriptorIndexingEnabled;
+    }
+
+    // true when the extension was added with the app device extensions and the device supports it.
+    bool IsAppExtensionEnabled(const char* name) const noexcept;
+
+    // update-after-bind limits, valid when IsDescriptorIndexingEnabled().
+    inline const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& GetDescriptorIndexingProperties() const noexcept
+    {
+        return m_descriptorIndexingProperties;
+    }
+
     inline VkDevice GetInstanceHandle() const noexcept
     {
         return m_device;
@@ -109,6 +124,8 @@ private:
     void mapFormatSupport(PixelFormat format, VkFormat vkormat, int32_t blockBytes) noexcept;
     void setComponentMapping(PixelFormat format, VkComponentSwizzle r, VkComponentSwizzle g, VkComponentSwizzle b, VkComponentSwizzle a) noexcept;
     void getDeviceExtensionsAndLayers(std::vector<const char*>& outDeviceExtensions, std::vector<const char*>& outDeviceLayers, bool& bOutDebugMarkers) noexcept;
+    void validateDescriptorIndexing() noexcept;
+    void validateAppDeviceExtensions() noexcept;
 
     VkDevice                                m_device = VK_NULL_HANDLE;
     VkPhysicalDevice                        m_physicalDevice = VK_NULL_HANDLE;
@@ -130,4 +147,7 @@ private:
 
     std::vector<const char*>				m_appDeviceExtensions;
     VkPhysicalDeviceFeatures2*              m_physicalDeviceFeatures2 = nullptr;
+
+    bool                                    m_descriptorIndexingEnabled = false;
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT m_descriptorIndexingProperties = {};
 };
\ No newline at end of file
@@ -20,17 +20,7 @@ void VulkanRange::JoinConsecutiveRanges(std::vector<VulkanRange>& ranges)
         return;
     }
 
-    std::sort(ranges.begin(), ranges.end(), [](const VulkanRange& a, const VulkanRange& b) {
-        if (a.offset > b.offset) {
-            return 1;
-        }
-        else if (a.offset == b.offset) {
-            return 0;
-        }
-        else {
-            return -1;
-        }
-        });
+    std::sort(ranges.begin(), ranges.end());
 
     for (int32_t index = (int32_t)ranges.size() - 1; index > 0; --index)
     {
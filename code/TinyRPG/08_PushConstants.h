@@ -255,7 +255,7 @@ private:
 	void UpdateUniformBuffers(float time, float delta)
 	{
 		if (m_AutoRotate)
-			m_Model->rootNode->localMatrix.AppendRotation(30.0f * delta, Vector3::UpVector);
+			m_Model->rootNode->EditLocalMatrix().AppendRotation(30.0f * delta, Vector3::UpVector);
 
 		m_ViewProjData.view = m_ViewCamera.GetView();
 		m_ViewProjData.projection = m_ViewCamera.GetProjection();
@@ -175,7 +175,7 @@ private:
 			{
 				VKPrimitive* primitive = mesh->primitives[j];
 				primitive->vertexBuffer = VKVertexBuffer::Create(m_VulkanDevice, cmdBuffer, primitive->vertices, m_Model->attributes);
-				primitive->indexBuffer = VKIndexBuffer::Create(m_VulkanDevice, cmdBuffer, primitive->indices);
+				primitive->indexBuffer = primitive->CreateIndexBuffer(m_VulkanDevice, cmdBuffer);
 			}
 		}
 
@@ -50,7 +50,8 @@ bool Material::init() noexcept
 	CreateRenderPass();
 	CreateFrameBuffers();
 	CreateGUI();
-	LoadAssets();
+	if (!LoadAssets())
+		return false;
 	InitParmas();
 
 	return true;
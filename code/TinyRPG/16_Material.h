@@ -81,12 +81,21 @@ private:
 
 		UpdateUniform(time, delta);
 
-		// model
-		m_Material0->BeginFrame();
-		for (int32_t i = 0; i < m_Model->meshes.size(); ++i) {
+		// model, only the meshes inside the view frustum get an object slot and a draw.
+		m_Culler.Setup(m_ViewCamera);
+		m_Culler.Cull(m_Model->meshes, m_VisibleMeshes);
+
+		// visible meshes pick their level of detail from their size on screen.
+		m_LODSelector.ResetStats();
+
+		m_Material0->BeginFrame(m_VisibleMeshes.size());
+		for (int32_t i = 0; i < m_VisibleMeshes.size(); ++i) {
 			m_Material0->BeginObject();
-			m_Material0->SetLocalUniform("uboModel", &(m_Model->meshes[i]->linkNode->GetGlobalMatrix()), sizeof(Matrix4x4));
-			m_Material0->SetLocalUniform("uboViewProj", &m_ViewProjData, sizeof(m_ViewProjData));
+			VKMesh* mesh = m_Model->meshes[m_VisibleMeshes[i]];
+			Matrix4x4 globalMatrix = mesh->linkNode->GetGlobalMatrix();
+			m_LODSelector.Apply(mesh, globalMatrix, m_ViewCamera);
+			m_Material0->SetLocalUniform(m_ModelHandle, &globalMatrix, sizeof(Matrix4x4));
+			m_Material0->SetLocalUniform(m_ViewProjHandle, &m_ViewProjData, sizeof(m_ViewProjData));
 			m_Material0->EndObject();
 		}
 		m_Material0->EndFrame();
@@ -94,11 +103,11 @@ private:
 		// postprocess
 		m_Material1->BeginFrame();
 		m_Material1->BeginObject();
-		m_Material1->SetLocalUniform("paramData", &m_VertFragParam, sizeof(AttachmentParamBlock));
-		m_Material1->SetLocalUniform("lightDatas", &m_LightDatas, sizeof(LightDataBlock));
-		m_Material1->SetInputAttachment("inputColor", m_AttachsColor[bufferIndex]);
-		m_Material1->SetInputAttachment("inputNormal", m_AttachsNormal[bufferIndex]);
-		m_Material1->SetInputAttachment("inputDepth", m_AttachsDepth[bufferIndex]);
+		m_Material1->SetLocalUniform(m_ParamDataHandle, &m_VertFragParam, sizeof(AttachmentParamBlock));
+		m_Material1->SetLocalUniform(m_LightDatasHandle, &m_LightDatas, sizeof(LightDataBlock));
+		m_Material1->SetInputAttachment(m_InputColorHandle, m_AttachsColor[bufferIndex]);
+		m_Material1->SetInputAttachment(m_InputNormalHandle, m_AttachsNormal[bufferIndex]);
+		m_Material1->SetInputAttachment(m_InputDepthHandle, m_AttachsDepth[bufferIndex]);
 		m_Material1->EndObject();
 		m_Material1->EndFrame();
 
@@ -397,6 +406,8 @@ private:
 				}
 			}
 
+			ImGui::Text("%d/%d meshes visible", (int32_t)m_VisibleMeshes.size(), (int32_t)m_Model->meshes.size());
+			ImGui::Text("%lld/%lld triangles with LODs", m_LODSelector.trianglesSubmitted, m_LODSelector.trianglesFull);
 			ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 			ImGui::End();
 		}
@@ -409,7 +420,7 @@ private:
 		return hovered;
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		// shader0
 		m_Shader0 = VKShader::Create(
@@ -425,7 +436,8 @@ private:
 			"data/models/Room/miniHouse_FBX.FBX",
 			m_VulkanDevice,
 			cmdBuffer,
-			m_Shader0->perVertexAttributes
+			m_Shader0->perVertexAttributes,
+			VKModelImport_GenerateLODs
 		);
 		delete cmdBuffer;
 
@@ -436,9 +448,14 @@ private:
 			m_PipelineCache,
 			m_Shader0
 		);
+		if (!m_Material0) {
+			return false;
+		}
 		// renderpass
 		m_Material0->pipelineInfo.colorAttachmentCount = 2;
 		m_Material0->PreparePipeline();
+		m_ModelHandle = m_Material0->FindUniform("uboModel");
+		m_ViewProjHandle = m_Material0->FindUniform("uboViewProj");
 
 		// shader1
 		m_Shader1 = VKShader::Create(
@@ -454,12 +471,22 @@ private:
 			m_PipelineCache,
 			m_Shader1
 		);
+		if (!m_Material1) {
+			return false;
+		}
 		m_Material1->pipelineInfo.depthStencilState.depthTestEnable = VK_FALSE;
 		m_Material1->pipelineInfo.depthStencilState.depthWriteEnable = VK_FALSE;
 		m_Material1->pipelineInfo.depthStencilState.stencilTestEnable = VK_FALSE;
 		m_Material1->pipelineInfo.shader = m_Shader1;
 		m_Material1->pipelineInfo.subpass = 1;
 		m_Material1->PreparePipeline();
+		m_ParamDataHandle = m_Material1->FindUniform("paramData");
+		m_LightDatasHandle = m_Material1->FindUniform("lightDatas");
+		m_InputColorHandle = m_Material1->FindTexture("inputColor");
+		m_InputNormalHandle = m_Material1->FindTexture("inputNormal");
+		m_InputDepthHandle = m_Material1->FindTexture("inputDepth");
+
+		return true;
 	}
 
 	void DestroyAssets()
@@ -520,9 +547,9 @@ private:
 		// pass0
 		{
 			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Material0->GetPipeline());
-			for (int32_t meshIndex = 0; meshIndex < m_Model->meshes.size(); ++meshIndex) {
-				m_Material0->BindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshIndex);
-				m_Model->meshes[meshIndex]->BindDrawCmd(commandBuffer);
+			for (int32_t i = 0; i < m_VisibleMeshes.size(); ++i) {
+				m_Material0->BindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, i);
+				m_Model->meshes[m_VisibleMeshes[i]]->BindDrawCmd(commandBuffer);
 			}
 		}
 
@@ -603,6 +630,9 @@ private:
 	bool 							m_Ready = false;
 
 	VKCamera						m_ViewCamera;
+	VKFrustumCuller					m_Culler;
+	std::vector<uint32_t>			m_VisibleMeshes;
+	VKLODSelector					m_LODSelector;
 
 	ViewProjectionBlock				m_ViewProjData;
 
@@ -618,6 +648,14 @@ private:
 	VKShader* m_Shader1 = nullptr;
 	VKMaterial* m_Material1 = nullptr;
 
+	int32_t m_ModelHandle = -1;
+	int32_t m_ViewProjHandle = -1;
+	int32_t m_ParamDataHandle = -1;
+	int32_t m_LightDatasHandle = -1;
+	int32_t m_InputColorHandle = -1;
+	int32_t m_InputNormalHandle = -1;
+	int32_t m_InputDepthHandle = -1;
+
 	VKTextureArray					m_AttachsDepth;
 	VKTextureArray					m_AttachsColor;
 	VKTextureArray                 m_AttachsNormal;
@@ -49,7 +49,8 @@ bool SkeletonMatrix4x4::init() noexcept
 	m_RenderPass = m_vkContext->m_RenderPass;
 
 
-	LoadAssets();
+	if (!LoadAssets())
+		return false;
 	InitParmas();
 	CreateGUI();
 
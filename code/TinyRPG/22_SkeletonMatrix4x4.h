@@ -63,7 +63,7 @@ private:
 		UpdateAnimation(time, delta);
 
 		// Room
-		// m_RoleModel->rootNode->localMatrix.AppendRotation(delta * 90.0f, Vector3::UpVector);
+		// m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(delta * 90.0f, Vector3::UpVector);
 		m_RoleMaterial->BeginFrame();
 		for (int32_t i = 0; i < m_RoleModel->meshes.size(); ++i)
 		{
@@ -148,7 +148,7 @@ private:
 		m_AnimIndex = index;
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
 
@@ -165,7 +165,7 @@ private:
 				VertexAttribute::VA_SkinWeight
 			}
 		);
-		m_RoleModel->rootNode->localMatrix.AppendRotation(180, Vector3::UpVector);
+		m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(180, Vector3::UpVector);
 
 		SetAnimation(0);
 
@@ -191,10 +191,17 @@ private:
 			m_PipelineCache,
 			m_RoleShader
 		);
+		if (!m_RoleMaterial)
+		{
+			delete cmdBuffer;
+			return false;
+		}
 		m_RoleMaterial->PreparePipeline();
 		m_RoleMaterial->SetTexture("diffuseMap", m_RoleDiffuse);
 
 		delete cmdBuffer;
+
+		return true;
 	}
 
 	void DestroyAssets()
@@ -48,7 +48,8 @@ bool SkeletonPackIndexWeight::init() noexcept
 	m_RenderPass = m_vkContext->m_RenderPass;
 
 
-	LoadAssets();
+	if (!LoadAssets())
+		return false;
 	InitParmas();
 	CreateGUI();
 
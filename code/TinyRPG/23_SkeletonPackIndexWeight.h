@@ -65,7 +65,7 @@ private:
 		UpdateAnimation(time, delta);
 
 		// Room
-		// m_RoleModel->rootNode->localMatrix.AppendRotation(delta * 90.0f, Vector3::UpVector);
+		// m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(delta * 90.0f, Vector3::UpVector);
 		m_RoleMaterial->BeginFrame();
 		for (int32_t i = 0; i < m_RoleModel->meshes.size(); ++i)
 		{
@@ -150,7 +150,7 @@ private:
 		m_AnimIndex = index;
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
 
@@ -167,7 +167,7 @@ private:
 				VertexAttribute::VA_SkinWeight
 			}
 		);
-		m_RoleModel->rootNode->localMatrix.AppendRotation(180, Vector3::UpVector);
+		m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(180, Vector3::UpVector);
 
 		// новое
 		// uint32 packIndex   = (idx0 << 24) + (idx1 << 16) + (idx2 << 8) + idx3;
@@ -223,7 +223,7 @@ private:
 				delete primitive->vertexBuffer;
 				delete primitive->indexBuffer;
 				primitive->vertexBuffer = VKVertexBuffer::Create(m_VulkanDevice, cmdBuffer, primitive->vertices, m_RoleModel->attributes);
-				primitive->indexBuffer = VKIndexBuffer::Create(m_VulkanDevice, cmdBuffer, primitive->indices);
+				primitive->indexBuffer = primitive->CreateIndexBuffer(m_VulkanDevice, cmdBuffer);
 			}
 		}
 
@@ -251,10 +251,17 @@ private:
 			m_PipelineCache,
 			m_RoleShader
 		);
+		if (!m_RoleMaterial)
+		{
+			delete cmdBuffer;
+			return false;
+		}
 		m_RoleMaterial->PreparePipeline();
 		m_RoleMaterial->SetTexture("diffuseMap", m_RoleDiffuse);
 
 		delete cmdBuffer;
+
+		return true;
 	}
 
 	void DestroyAssets()
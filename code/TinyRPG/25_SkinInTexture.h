@@ -84,7 +84,7 @@ private:
 		UpdateAnimation(time, delta);
 
 		// Room
-		// m_RoleModel->rootNode->localMatrix.AppendRotation(delta * 90.0f, Vector3::UpVector);
+		// m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(delta * 90.0f, Vector3::UpVector);
 		m_RoleMaterial->BeginFrame();
 		for (int32_t i = 0; i < m_RoleModel->meshes.size(); ++i)
 		{
@@ -150,9 +150,9 @@ private:
 		VKAnimation& animation = m_RoleModel->GetAnimation();
 
 		m_Keys.push_back(0);
-		for (auto it = animation.clips.begin(); it != animation.clips.end(); ++it)
+		for (auto it = animation.clips->begin(); it != animation.clips->end(); ++it)
 		{
-			VKAnimationClip& clip = it->second;
+			const VKAnimationClip& clip = it->second;
 			for (int32_t i = 0; i < clip.positions.keys.size(); ++i) {
 				if (m_Keys.back() < clip.positions.keys[i]) {
 					m_Keys.push_back(clip.positions.keys[i]);
@@ -217,7 +217,7 @@ private:
 		);
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
 
@@ -233,7 +233,7 @@ private:
 				VertexAttribute::VA_SkinPack,
 			}
 		);
-		m_RoleModel->rootNode->localMatrix.AppendRotation(180, Vector3::UpVector);
+		m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(180, Vector3::UpVector);
 
 		SetAnimation(0);
 		CreateAnimTexture(cmdBuffer);
@@ -260,11 +260,18 @@ private:
 			m_PipelineCache,
 			m_RoleShader
 		);
+		if (!m_RoleMaterial)
+		{
+			delete cmdBuffer;
+			return false;
+		}
 		m_RoleMaterial->PreparePipeline();
 		m_RoleMaterial->SetTexture("diffuseMap", m_RoleDiffuse);
 		m_RoleMaterial->SetTexture("animMap", m_AnimTexture);
 
 		delete cmdBuffer;
+
+		return true;
 	}
 
 	void DestroyAssets()
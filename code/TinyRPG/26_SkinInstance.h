@@ -223,7 +223,7 @@ private:
 		);
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
 
@@ -247,7 +247,7 @@ private:
 				VertexAttribute::VA_SkinPack,
 			}
 		);
-		m_RoleModel->rootNode->localMatrix.AppendRotation(180, Vector3::UpVector);
+		m_RoleModel->rootNode->EditLocalMatrix().AppendRotation(180, Vector3::UpVector);
 
 		// animation
 		SetAnimation(0);
@@ -306,11 +306,18 @@ private:
 			m_PipelineCache,
 			m_RoleShader
 		);
+		if (!m_RoleMaterial)
+		{
+			delete cmdBuffer;
+			return false;
+		}
 		m_RoleMaterial->PreparePipeline();
 		m_RoleMaterial->SetTexture("diffuseMap", m_RoleDiffuse);
 		m_RoleMaterial->SetTexture("animMap", m_AnimTexture);
 
 		delete cmdBuffer;
+
+		return true;
 	}
 
 	void DestroyAssets()
@@ -49,7 +49,8 @@ bool FXAA::init() noexcept
 
 	CreateRenderTarget();
 	LoadAssets();
-	CreateMaterials();
+	if (!CreateMaterials())
+		return false;
 	InitParmas();
 	CreateGUI();
 
@@ -67,7 +67,7 @@ private:
 		m_MVPData.projection = m_ViewCamera.GetProjection();
 
 		if (m_AutoRotate) {
-			m_LineModel->rootNode->localMatrix.AppendRotation(delta * 15.0f, Vector3::UpVector);
+			m_LineModel->rootNode->EditLocalMatrix().AppendRotation(delta * 15.0f, Vector3::UpVector);
 		}
 
 		// model
@@ -183,7 +183,7 @@ private:
 		delete m_FXAABestShader;
 	}
 
-	void CreateMaterials()
+	bool CreateMaterials()
 	{
 		m_LineShader = VKShader::Create(
 			m_VulkanDevice,
@@ -203,6 +203,9 @@ private:
 			m_PipelineCache,
 			m_LineShader
 		);
+		if (!m_LineMaterial) {
+			return false;
+		}
 		m_LineMaterial->pipelineInfo.inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
 		m_LineMaterial->pipelineInfo.rasterizationState.cullMode = VK_CULL_MODE_NONE;
 		m_LineMaterial->pipelineInfo.rasterizationState.lineWidth = lineWidth;
@@ -256,6 +259,9 @@ private:
 			m_PipelineCache,
 			m_NormalShader
 		);
+		if (!m_NormalMaterial) {
+			return false;
+		}
 		m_NormalMaterial->PreparePipeline();
 		m_NormalMaterial->SetTexture("sourceTexture", m_RTColor);
 
@@ -266,6 +272,9 @@ private:
 			m_PipelineCache,
 			m_FXAADefaultShader
 		);
+		if (!m_FXAADefaultMaterial) {
+			return false;
+		}
 		m_FXAADefaultMaterial->PreparePipeline();
 		m_FXAADefaultMaterial->SetTexture("sourceTexture", m_RTColor);
 
@@ -276,6 +285,9 @@ private:
 			m_PipelineCache,
 			m_FXAAFastShader
 		);
+		if (!m_FXAAFastMaterial) {
+			return false;
+		}
 		m_FXAAFastMaterial->PreparePipeline();
 		m_FXAAFastMaterial->SetTexture("sourceTexture", m_RTColor);
 
@@ -286,6 +298,9 @@ private:
 			m_PipelineCache,
 			m_FXAAHighShader
 		);
+		if (!m_FXAAHighMaterial) {
+			return false;
+		}
 		m_FXAAHighMaterial->PreparePipeline();
 		m_FXAAHighMaterial->SetTexture("sourceTexture", m_RTColor);
 
@@ -296,6 +311,9 @@ private:
 			m_PipelineCache,
 			m_FXAABestShader
 		);
+		if (!m_FXAABestMaterial) {
+			return false;
+		}
 		m_FXAABestMaterial->PreparePipeline();
 		m_FXAABestMaterial->SetTexture("sourceTexture", m_RTColor);
 
@@ -312,6 +330,8 @@ private:
 		m_FilterMaterials[FXAATypes::Fast] = m_FXAAFastMaterial;
 		m_FilterMaterials[FXAATypes::High] = m_FXAAHighMaterial;
 		m_FilterMaterials[FXAATypes::Best] = m_FXAABestMaterial;
+
+		return true;
 	}
 
 	void CreateRenderTarget()
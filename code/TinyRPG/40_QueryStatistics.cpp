@@ -49,7 +49,8 @@ bool QueryStatistics::init() noexcept
 
 	CreateGUI();
 	InitParmas();
-	LoadAssets();
+	if (!LoadAssets())
+		return false;
 
 	return true;
 }
@@ -91,7 +91,7 @@ private:
 		return hovered;
 	}
 
-	void LoadAssets()
+	bool LoadAssets()
 	{
 		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
 
@@ -127,7 +127,8 @@ private:
 			{
 				VertexAttribute::VA_Position,
 				VertexAttribute::VA_Normal
-			}
+			},
+			VKModelImport_Optimize
 		);
 
 		m_Shader = VKShader::Create(
@@ -143,9 +144,16 @@ private:
 			m_PipelineCache,
 			m_Shader
 		);
+		if (!m_Material)
+		{
+			delete cmdBuffer;
+			return false;
+		}
 		m_Material->PreparePipeline();
 
 		delete cmdBuffer;
+
+		return true;
 	}
 
 	void DestroyAssets()
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#include "41_Benchmarks.h"
+//-----------------------------------------------------------------------------
+Benchmarks::Benchmarks(Configuration& configuration) noexcept
+	: m_configuration(configuration)
+	, m_engine(configuration)
+{
+}
+//-----------------------------------------------------------------------------
+void Benchmarks::StartGame() noexcept
+{
+	if (init())
+	{
+		Run();
+		close();
+		m_engine.Close();
+		Log::Close();
+	}
+}
+//-----------------------------------------------------------------------------
+bool Benchmarks::init() noexcept
+{
+	if (!m_configuration.logFileName.empty())
+	{
+		if (!Log::Open(m_configuration.logFileName))
+			return false;
+	}
+
+	Log::Message("Start Lili Engine");
+
+	if (!m_engine.Init())
+		return false;
+
+	m_vulkanRHI = &m_engine.GetRendererSystem().GetVulkanRHI();
+
+	m_vkContext = &m_engine.GetRendererSystem().GetVulkanContext();
+
+	m_VulkanDevice = m_vkContext->m_VulkanDevice;
+	m_Device = m_vkContext->m_Device;
+	m_PipelineCache = m_vkContext->m_PipelineCache;
+	m_RenderPass = m_vkContext->m_RenderPass;
+
+	return true;
+}
+//-----------------------------------------------------------------------------
+void Benchmarks::close() noexcept
+{
+	vkDeviceWaitIdle(m_Device);
+}
+//-----------------------------------------------------------------------------
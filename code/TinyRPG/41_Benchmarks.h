@@ -0,0 +1,1180 @@
+#pragma once
+
+#include <psapi.h>
+#include "LiliEngine/VertexPacking.h"
+
+// CPU measurements of the engine paths, written to the log. Nothing is drawn, the window closes
+// when every measurement has run.
+class Benchmarks final
+{
+public:
+	Benchmarks(Configuration& configuration) noexcept;
+
+	void StartGame() noexcept;
+private:
+	Benchmarks() = delete;
+	Benchmarks(const Benchmarks&) = delete;
+	Benchmarks(Benchmarks&&) = delete;
+	Benchmarks operator=(const Benchmarks&) = delete;
+	Benchmarks operator=(Benchmarks&&) = delete;
+
+	bool init() noexcept;
+	void close() noexcept;
+
+	Configuration& m_configuration;
+	Engine m_engine;
+
+	VulkanRHI* m_vulkanRHI = nullptr;
+
+	VulkanContext* m_vkContext = nullptr;
+
+	std::shared_ptr<VulkanDevice> m_VulkanDevice = nullptr;
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+	VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+
+	// level meshes and a skinned character, in the layouts the samples draw them with.
+	const char* m_BridgeFile = "data/models/simplify_BOTI_Dreamsong_Bridge1.fbx";
+	const char* m_RoomFile = "data/models/Room/miniHouse_FBX.FBX";
+	const char* m_CharacterFile = "data/models/xiaonan/nvhai.fbx";
+	const std::vector<VertexAttribute> m_StaticLayout = { VA_Position, VA_UV0, VA_Normal, VA_Tangent };
+	const std::vector<VertexAttribute> m_SkinnedLayout = { VA_Position, VA_UV0, VA_Normal, VA_SkinIndex, VA_SkinWeight };
+
+	void Run()
+	{
+		BenchmarkMaterialUniforms();
+		BenchmarkCookedLoads();
+		BenchmarkVertexPacking();
+		BenchmarkIndexWidth();
+		BenchmarkVertexCache();
+		BenchmarkLODs();
+		BenchmarkMeshlets();
+		BenchmarkIndirectDraws();
+		BenchmarkParallelImport();
+		BenchmarkSkinLoads();
+		BenchmarkTransformHierarchy();
+		BenchmarkDynamicBVH();
+		BenchmarkRayCasts();
+		BenchmarkGLTFLoads();
+		BenchmarkFrustumCulling();
+		BenchmarkBoundsTransforms();
+		BenchmarkCompactPacking();
+	}
+
+	template<typename... Args>
+	void Report(const char* format, Args... args)
+	{
+		Log::Message(StringUtils::Printf(format, args...));
+	}
+
+	// per object cost of the two uniforms 16_Material sets, resolved handles against name lookups.
+	void BenchmarkMaterialUniforms()
+	{
+		VKShader* shader = VKShader::Create(
+			m_VulkanDevice,
+			true,
+			"data/shaders/16_Material/obj.vert.spv",
+			"data/shaders/16_Material/obj.frag.spv"
+		);
+		VKMaterial* material = VKMaterial::Create(
+			m_VulkanDevice,
+			m_RenderPass,
+			m_PipelineCache,
+			shader
+		);
+		if (!material)
+		{
+			delete shader;
+			return;
+		}
+
+		const int32_t objectCount = 10000;
+		const int32_t frameCount = 16;
+		const int32_t modelHandle = material->FindUniform("uboModel");
+		const int32_t viewProjHandle = material->FindUniform("uboViewProj");
+		Matrix4x4 model;
+		Matrix4x4 viewProj[2];
+
+		double handleTime = 0.0;
+		double nameTime = 0.0;
+		for (int32_t frame = 0; frame < frameCount; ++frame)
+		{
+			double start = GenericPlatformTime::Seconds();
+			material->BeginFrame(objectCount);
+			for (int32_t i = 0; i < objectCount; ++i)
+			{
+				material->BeginObject();
+				material->SetLocalUniform(modelHandle, &model, sizeof(Matrix4x4));
+				material->SetLocalUniform(viewProjHandle, viewProj, sizeof(viewProj));
+				material->EndObject();
+			}
+			material->EndFrame();
+			handleTime += GenericPlatformTime::Seconds() - start;
+
+			start = GenericPlatformTime::Seconds();
+			material->BeginFrame(objectCount);
+			for (int32_t i = 0; i < objectCount; ++i)
+			{
+				material->BeginObject();
+				material->SetLocalUniform("uboModel", &model, sizeof(Matrix4x4));
+				material->SetLocalUniform("uboViewProj", viewProj, sizeof(viewProj));
+				material->EndObject();
+			}
+			material->EndFrame();
+			nameTime += GenericPlatformTime::Seconds() - start;
+		}
+
+		const double objects = (double)objectCount * frameCount;
+		Report("Material uniforms, %d objects: handles %.1f ns/object, names %.1f ns/object", objectCount, handleTime * 1e9 / objects, nameTime * 1e9 / objects);
+
+		delete material;
+		delete shader;
+	}
+
+	static size_t GetWorkingSet()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		counters.cb = sizeof(counters);
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+	}
+
+	// seconds LoadFromFile takes. cold removes the cooked copy first so the source gets imported.
+	// outPeakBytes receives the working set growth at its highest during the load, sampled every ms.
+	double TimeModelLoad(const char* filename, const std::vector<VertexAttribute>& attributes, uint32_t importFlags, bool cold, int32_t* outDraws = nullptr, size_t* outPeakBytes = nullptr)
+	{
+		if (cold) {
+			std::remove(VKModelCooker::GetCookedPath(filename, attributes, importFlags).c_str());
+		}
+
+		const size_t baseline = GetWorkingSet();
+		std::atomic<bool> sampling(outPeakBytes != nullptr);
+		size_t peak = baseline;
+		std::thread sampler([&sampling, &peak]()
+		{
+			while (sampling.load())
+			{
+				peak = std::max(peak, GetWorkingSet());
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+
+		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
+		double start = GenericPlatformTime::Seconds();
+		VKModel* model = VKModel::LoadFromFile(filename, m_VulkanDevice, cmdBuffer, attributes, importFlags);
+		double seconds = GenericPlatformTime::Seconds() - start;
+
+		sampling = false;
+		sampler.join();
+		if (outPeakBytes) {
+			*outPeakBytes = std::max(peak, GetWorkingSet()) - baseline;
+		}
+
+		if (outDraws) {
+			*outDraws = model ? model->GetPrimitiveCount() : 0;
+		}
+
+		delete model;
+		delete cmdBuffer;
+		return seconds;
+	}
+
+	// Assimp import plus cache write against the mapped cooked file.
+	void BenchmarkCookedLoads()
+	{
+		const char* files[2] = { m_CharacterFile, m_BridgeFile };
+		const std::vector<VertexAttribute>* layouts[2] = { &m_SkinnedLayout, &m_StaticLayout };
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			double imported = TimeModelLoad(files[i], *layouts[i], VKModelImport_None, true);
+			double cooked = TimeModelLoad(files[i], *layouts[i], VKModelImport_None, false);
+			Report("Load %s: Assimp %.1fms, cooked %.1fms", files[i], imported * 1000.0, cooked * 1000.0);
+		}
+	}
+
+	// the strided stream kernels against a per-vertex push_back of every attribute, on separate
+	// position/normal/tangent/uv arrays laid out the way Assimp hands them over.
+	void BenchmarkVertexPacking()
+	{
+		const int32_t count = 1 << 20;
+		const int32_t repeats = 8;
+		std::vector<float> positions(count * 3);
+		std::vector<float> normals(count * 3);
+		std::vector<float> tangents(count * 3);
+		std::vector<float> uvs(count * 3);
+		for (int32_t i = 0; i < count * 3; ++i)
+		{
+			positions[i] = math::RandRange(-100.0f, 100.0f);
+			normals[i] = math::RandRange(-1.0f, 1.0f);
+			tangents[i] = math::RandRange(-1.0f, 1.0f);
+			uvs[i] = math::RandRange(0.0f, 1.0f);
+		}
+
+		VKVertexStreams streams;
+		streams.count = count;
+		streams.positions = VKVertexStream(positions.data(), sizeof(float) * 3);
+		streams.normals = VKVertexStream(normals.data(), sizeof(float) * 3);
+		streams.tangents = VKVertexStream(tangents.data(), sizeof(float) * 3);
+		streams.uvs[0] = VKVertexStream(uvs.data(), sizeof(float) * 3);
+
+		const std::vector<VKVertexSkin> skins;
+		double packedTime = 0.0;
+		double naiveTime = 0.0;
+		for (int32_t r = 0; r < repeats; ++r)
+		{
+			VKMesh mesh;
+			std::vector<float> vertices;
+			Vector3 mmin(MAX_int32, MAX_int32, MAX_int32);
+			Vector3 mmax(-MAX_int32, -MAX_int32, -MAX_int32);
+			double start = GenericPlatformTime::Seconds();
+			VKModel::PackVertexStreams(m_StaticLayout, skins, streams, vertices, mmax, mmin, &mesh);
+			packedTime += GenericPlatformTime::Seconds() - start;
+
+			std::vector<float> naive;
+			Vector3 nmin(MAX_int32, MAX_int32, MAX_int32);
+			Vector3 nmax(-MAX_int32, -MAX_int32, -MAX_int32);
+			start = GenericPlatformTime::Seconds();
+			for (int32_t i = 0; i < count; ++i)
+			{
+				for (int32_t j = 0; j < m_StaticLayout.size(); ++j)
+				{
+					if (m_StaticLayout[j] == VertexAttribute::VA_Position)
+					{
+						const float* v = streams.positions.Get(i);
+						naive.push_back(v[0]);
+						naive.push_back(v[1]);
+						naive.push_back(v[2]);
+						nmin.x = math::Min(nmin.x, v[0]); nmin.y = math::Min(nmin.y, v[1]); nmin.z = math::Min(nmin.z, v[2]);
+						nmax.x = math::Max(nmax.x, v[0]); nmax.y = math::Max(nmax.y, v[1]); nmax.z = math::Max(nmax.z, v[2]);
+					}
+					else if (m_StaticLayout[j] == VertexAttribute::VA_UV0)
+					{
+						const float* v = streams.uvs[0].Get(i);
+						naive.push_back(v[0]);
+						naive.push_back(v[1]);
+					}
+					else if (m_StaticLayout[j] == VertexAttribute::VA_Normal)
+					{
+						const float* v = streams.normals.Get(i);
+						naive.push_back(v[0]);
+						naive.push_back(v[1]);
+						naive.push_back(v[2]);
+					}
+					else if (m_StaticLayout[j] == VertexAttribute::VA_Tangent)
+					{
+						const float* v = streams.tangents.Get(i);
+						naive.push_back(v[0]);
+						naive.push_back(v[1]);
+						naive.push_back(v[2]);
+						naive.push_back(1.0f);
+					}
+				}
+			}
+			naiveTime += GenericPlatformTime::Seconds() - start;
+
+			if (naive.size() != vertices.size() || memcmp(naive.data(), vertices.data(), naive.size() * sizeof(float)) != 0) {
+				MLOGE("Vertex packing differs from the per-vertex reference.");
+			}
+		}
+
+		Report("Vertex packing, %d vertices: streams %.2fms, per-vertex %.2fms (%.1fx)", count, packedTime * 1000.0 / repeats, naiveTime * 1000.0 / repeats, naiveTime / packedTime);
+	}
+
+	// one primitive per mesh with 16 or 32-bit indices against the old split at 65535 vertices.
+	void BenchmarkIndexWidth()
+	{
+		const char* files[2] = { m_BridgeFile, m_RoomFile };
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			int32_t splitDraws = 0;
+			int32_t wideDraws = 0;
+			double split = TimeModelLoad(files[i], m_StaticLayout, VKModelImport_Split16BitPrimitives, true, &splitDraws);
+			double wide = TimeModelLoad(files[i], m_StaticLayout, VKModelImport_None, true, &wideDraws);
+			Report("Index width %s: split %d draws %.1fms, per mesh %d draws %.1fms", files[i], splitDraws, split * 1000.0, wideDraws, wide * 1000.0);
+		}
+	}
+
+	// the shuffled grid quoted when the optimizer landed, then the cache stats of real level meshes.
+	void BenchmarkVertexCache()
+	{
+		const int32_t size = 100;
+		std::vector<uint32_t> indices;
+		indices.reserve(size * size * 6);
+		for (int32_t y = 0; y < size; ++y)
+		{
+			for (int32_t x = 0; x < size; ++x)
+			{
+				uint32_t v0 = y * (size + 1) + x;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + size + 1;
+				uint32_t v3 = v2 + 1;
+				uint32_t quad[6] = { v0, v2, v1, v1, v2, v3 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+
+		const int32_t triangleCount = (int32_t)indices.size() / 3;
+		for (int32_t i = triangleCount - 1; i > 0; --i)
+		{
+			int32_t j = math::RandHelper(i + 1);
+			for (int32_t k = 0; k < 3; ++k) {
+				std::swap(indices[i * 3 + k], indices[j * 3 + k]);
+			}
+		}
+
+		const int32_t vertexCount = (size + 1) * (size + 1);
+		VKVertexCacheStats before = VKMeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+		double start = GenericPlatformTime::Seconds();
+		VKMeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+		double seconds = GenericPlatformTime::Seconds() - start;
+		VKVertexCacheStats after = VKMeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+		Report("Vertex cache, shuffled %dx%d grid: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.2fms", size, size, before.ACMR(), after.ACMR(), before.ATVR(), after.ATVR(), seconds * 1000.0);
+
+		const char* files[2] = { m_BridgeFile, m_RoomFile };
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			std::remove(VKModelCooker::GetCookedPath(files[i], m_StaticLayout, VKModelImport_Optimize).c_str());
+
+			VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
+			VKModel* model = VKModel::LoadFromFile(files[i], m_VulkanDevice, cmdBuffer, m_StaticLayout, VKModelImport_Optimize);
+			if (model)
+			{
+				Report("Vertex cache %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", files[i], model->GetCacheStatsBefore().ACMR(), model->GetCacheStatsAfter().ACMR(), model->GetCacheStatsBefore().ATVR(), model->GetCacheStatsAfter().ATVR());
+			}
+
+			delete model;
+			delete cmdBuffer;
+		}
+	}
+
+	// triangles submitted with LODs against LOD 0 everywhere, with the camera backing away from the bridge.
+	void BenchmarkLODs()
+	{
+		std::remove(VKModelCooker::GetCookedPath(m_BridgeFile, m_StaticLayout, VKModelImport_GenerateLODs).c_str());
+
+		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
+		double start = GenericPlatformTime::Seconds();
+		VKModel* model = VKModel::LoadFromFile(m_BridgeFile, m_VulkanDevice, cmdBuffer, m_StaticLayout, VKModelImport_GenerateLODs);
+		double seconds = GenericPlatformTime::Seconds() - start;
+		double plain = TimeModelLoad(m_BridgeFile, m_StaticLayout, VKModelImport_None, true);
+		delete cmdBuffer;
+		if (!model) {
+			return;
+		}
+		Report("LOD generation %s: load %.1fms, without LODs %.1fms", m_BridgeFile, seconds * 1000.0, plain * 1000.0);
+
+		VKBoundingBox bounds = model->rootNode->GetBounds();
+		Vector3 boundSize = bounds.max - bounds.min;
+		Vector3 boundCenter = bounds.min + boundSize * 0.5f;
+
+		VKCamera camera;
+		camera.Perspective(PI / 4, m_configuration.window.windowWidth, m_configuration.window.windowHeight, 10.0f, 3000.0f);
+
+		VKLODSelector selector;
+		const float distances[5] = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+		for (int32_t i = 0; i < 5; ++i)
+		{
+			camera.SetPosition(boundCenter.x, boundCenter.y, boundCenter.z - boundSize.Size() * distances[i]);
+			camera.LookAt(boundCenter);
+
+			selector.ResetStats();
+			for (int32_t j = 0; j < model->meshes.size(); ++j)
+			{
+				VKMesh* mesh = model->meshes[j];
+				selector.Apply(mesh, mesh->linkNode->GetGlobalMatrix(), camera);
+			}
+
+			float saved = selector.trianglesFull > 0 ? 100.0f * (1.0f - (float)selector.trianglesSubmitted / selector.trianglesFull) : 0.0f;
+			Report("LODs at %.1fx the bridge size: %lld/%lld triangles (%.0f%% fewer)", distances[i], selector.trianglesSubmitted, selector.trianglesFull, saved);
+		}
+
+		delete model;
+	}
+
+	// the 160k triangle sphere quoted when meshlets landed, then cull throughput on the bridge.
+	void BenchmarkMeshlets()
+	{
+		const int32_t rings = 200;
+		const int32_t segments = 400;
+		const float radius = 100.0f;
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		for (int32_t y = 0; y <= rings; ++y)
+		{
+			float theta = PI * y / rings;
+			for (int32_t x = 0; x <= segments; ++x)
+			{
+				float phi = 2.0f * PI * x / segments;
+				positions.push_back(radius * math::Sin(theta) * math::Cos(phi));
+				positions.push_back(radius * math::Cos(theta));
+				positions.push_back(radius * math::Sin(theta) * math::Sin(phi));
+			}
+		}
+		for (int32_t y = 0; y < rings; ++y)
+		{
+			for (int32_t x = 0; x < segments; ++x)
+			{
+				uint32_t v0 = y * (segments + 1) + x;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + segments + 1;
+				uint32_t v3 = v2 + 1;
+				uint32_t quad[6] = { v0, v1, v2, v1, v3, v2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+
+		std::vector<VKMeshlet> meshlets;
+		double start = GenericPlatformTime::Seconds();
+		VKMeshletBuilder::Build(indices, positions, meshlets);
+		double buildTime = GenericPlatformTime::Seconds() - start;
+
+		VKCamera camera;
+		camera.Perspective(PI / 4, m_configuration.window.windowWidth, m_configuration.window.windowHeight, 10.0f, 3000.0f);
+		camera.SetPosition(0.0f, 0.0f, -radius * 4.0f);
+		camera.LookAt(Vector3(0.0f, 0.0f, 0.0f));
+
+		const int32_t repeats = 100;
+		Matrix4x4 world;
+		VKMeshletCuller culler;
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		culler.Setup(world, camera);
+		for (int32_t i = 0; i < repeats; ++i) {
+			culler.Cull(meshlets, commands);
+		}
+
+		const int32_t triangleCount = (int32_t)indices.size() / 3;
+		const float rejected = 100.0f * (1.0f - (float)culler.stats.clustersVisible / culler.stats.clustersTested);
+		Report("Meshlets, %d triangle sphere: %d clusters, %.1f triangles each, built in %.1fms, %.0f%% culled from outside, %.0f clusters/ms", triangleCount, (int32_t)meshlets.size(), (float)triangleCount / meshlets.size(), buildTime * 1000.0, rejected, culler.stats.ClustersPerMS());
+
+		std::remove(VKModelCooker::GetCookedPath(m_BridgeFile, m_StaticLayout, VKModelImport_BuildMeshlets).c_str());
+		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
+		VKModel* model = VKModel::LoadFromFile(m_BridgeFile, m_VulkanDevice, cmdBuffer, m_StaticLayout, VKModelImport_BuildMeshlets);
+		delete cmdBuffer;
+		if (!model) {
+			return;
+		}
+
+		VKBoundingBox bounds = model->rootNode->GetBounds();
+		Vector3 boundSize = bounds.max - bounds.min;
+		Vector3 boundCenter = bounds.min + boundSize * 0.5f;
+		camera.SetPosition(boundCenter.x, boundCenter.y + 1000, boundCenter.z - boundSize.Size());
+		camera.LookAt(boundCenter);
+
+		culler.ResetStats();
+		for (int32_t i = 0; i < repeats; ++i)
+		{
+			for (int32_t j = 0; j < model->meshes.size(); ++j)
+			{
+				VKMesh* mesh = model->meshes[j];
+				culler.Setup(mesh->linkNode->GetGlobalMatrix(), camera);
+				for (int32_t k = 0; k < mesh->primitives.size(); ++k) {
+					culler.Cull(mesh->primitives[k]->GetMeshlets(), commands);
+				}
+			}
+		}
+
+		const float reduction = culler.stats.trianglesTested > 0 ? 100.0f * (1.0f - (float)culler.stats.trianglesVisible / culler.stats.trianglesTested) : 0.0f;
+		Report("Meshlets %s: %lld clusters per view, %.0f%% fewer triangles, %.0f clusters/ms", m_BridgeFile, culler.stats.clustersTested / repeats, reduction, culler.stats.ClustersPerMS());
+
+		delete model;
+	}
+
+	// draws of 64 copies of the bridge, one vkCmdDrawIndexed each on the direct path, against the
+	// indirect calls one bucket needs and the time to write its commands.
+	void BenchmarkIndirectDraws()
+	{
+		VKModel* model = VKModel::LoadFromFile(m_BridgeFile, m_VulkanDevice, nullptr, m_StaticLayout);
+		if (!model) {
+			return;
+		}
+
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		for (int32_t i = 0; i < model->meshes.size(); ++i)
+		{
+			for (int32_t j = 0; j < model->meshes[i]->primitives.size(); ++j)
+			{
+				vertexCount += model->meshes[i]->primitives[j]->vertexCount;
+				indexCount += model->meshes[i]->primitives[j]->GetIndexCount();
+			}
+		}
+
+		VKCommandBuffer* cmdBuffer = VKCommandBuffer::Create(m_VulkanDevice, m_vkContext->m_CommandPool);
+		VKGeometryArena* arena = VKGeometryArena::Create(m_VulkanDevice, m_StaticLayout, vertexCount, indexCount);
+		if (!arena || !model->MoveToArena(arena, cmdBuffer))
+		{
+			delete model;
+			delete arena;
+			delete cmdBuffer;
+			return;
+		}
+
+		const int32_t copies = 64;
+		const int32_t frameCount = 16;
+		VKIndirectDrawBuffer* drawBuffer = VKIndirectDrawBuffer::Create(m_VulkanDevice, copies * model->GetPrimitiveCount(), 1);
+
+		uint32_t commands = 0;
+		uint32_t drawCalls = 0;
+		double seconds = 0.0;
+		for (int32_t frame = 0; frame < frameCount; ++frame)
+		{
+			double start = GenericPlatformTime::Seconds();
+			drawBuffer->Begin(frame);
+			int32_t bucket = drawBuffer->BeginBucket();
+			for (int32_t i = 0; i < copies; ++i)
+			{
+				for (int32_t j = 0; j < model->meshes.size(); ++j) {
+					drawBuffer->Add(model->meshes[j]);
+				}
+			}
+			drawBuffer->EndBucket();
+			seconds += GenericPlatformTime::Seconds() - start;
+
+			commands = drawBuffer->buckets[bucket].commandCount;
+			drawCalls = drawBuffer->GetDrawCallCount(bucket);
+		}
+
+		Report("Indirect draws, %d bridges: %d direct draws, %d indirect calls, %.1fus to write the commands", copies, commands, drawCalls, seconds * 1e6 / frameCount);
+
+		delete drawBuffer;
+		delete model;
+		delete arena;
+		delete cmdBuffer;
+	}
+
+	// cold imports with the per mesh work spread over 1, 2, 4... threads. Optimize and LODs give the
+	// mesh jobs enough work for the scaling to show next to the serial Assimp parse.
+	void BenchmarkParallelImport()
+	{
+		ThreadPool& pool = ThreadPool::Get();
+		const uint32_t importFlags = VKModelImport_Optimize | VKModelImport_GenerateLODs;
+		const char* files[2] = { m_RoomFile, m_BridgeFile };
+		for (int32_t i = 0; i < 2; ++i)
+		{
+			double serial = 0.0;
+			for (int32_t threads = 1; threads <= pool.GetThreadCount() + 1; threads *= 2)
+			{
+				pool.SetMaxParallelism(threads);
+				double seconds = TimeModelLoad(files[i], m_StaticLayout, importFlags, true);
+				if (threads == 1) {
+					serial = seconds;
+				}
+				Report("Parallel import %s, %d threads: %.1fms (%.2fx)", files[i], threads, seconds * 1000.0, serial / seconds);
+			}
+		}
+		pool.SetMaxParallelism(0);
+	}
+
+	// skin gathering on bone-major weights as Assimp stores them, the old map keyed by vertex id
+	// against the dense per-vertex array, then cold character loads with and without skins.
+	void BenchmarkSkinLoads()
+	{
+		const int32_t vertexCount = 1 << 18;
+		const int32_t boneCount = 64;
+		const int32_t influences = 6;
+		std::vector<std::vector<std::pair<uint32_t, float>>> boneWeights(boneCount);
+		for (int32_t i = 0; i < vertexCount; ++i)
+		{
+			for (int32_t j = 0; j < influences; ++j) {
+				boneWeights[math::RandHelper(boneCount)].push_back(std::make_pair((uint32_t)i, math::RandRange(0.01f, 1.0f)));
+			}
+		}
+
+		double start = GenericPlatformTime::Seconds();
+		std::unordered_map<uint32_t, VKVertexSkin> skinMap;
+		for (int32_t i = 0; i < boneCount; ++i)
+		{
+			for (int32_t j = 0; j < boneWeights[i].size(); ++j)
+			{
+				VKVertexSkin& skin = skinMap[boneWeights[i][j].first];
+				if (skin.used < 4)
+				{
+					skin.indices[skin.used] = i;
+					skin.weights[skin.used] = boneWeights[i][j].second;
+					skin.used += 1;
+				}
+			}
+		}
+		std::vector<VKVertexSkin> mapSkins(vertexCount);
+		for (auto it = skinMap.begin(); it != skinMap.end(); ++it) {
+			mapSkins[it->first] = it->second;
+		}
+		double mapTime = GenericPlatformTime::Seconds() - start;
+
+		start = GenericPlatformTime::Seconds();
+		std::vector<VKVertexSkin> skins(vertexCount);
+		for (int32_t i = 0; i < boneCount; ++i)
+		{
+			for (int32_t j = 0; j < boneWeights[i].size(); ++j) {
+				skins[boneWeights[i][j].first].Add(i, boneWeights[i][j].second, 4);
+			}
+		}
+		double denseTime = GenericPlatformTime::Seconds() - start;
+		Report("Skin gathering, %d vertices x %d influences: map %.2fms, dense %.2fms (%.1fx)", vertexCount, influences, mapTime * 1000.0, denseTime * 1000.0, mapTime / denseTime);
+
+		const std::vector<VertexAttribute> skinned8Layout = { VA_Position, VA_UV0, VA_Normal, VA_SkinIndex8, VA_SkinWeight8 };
+		double skinned = TimeModelLoad(m_CharacterFile, m_SkinnedLayout, VKModelImport_None, true);
+		double skinned8 = TimeModelLoad(m_CharacterFile, skinned8Layout, VKModelImport_None, true);
+		double plain = TimeModelLoad(m_CharacterFile, m_StaticLayout, VKModelImport_None, true);
+		Report("Skin load %s: 4 influences %.1fms, 8 influences %.1fms, without skin %.1fms", m_CharacterFile, skinned * 1000.0, skinned8 * 1000.0, plain * 1000.0);
+	}
+
+	// every bone of a deep skeleton animated and read once per frame, the cached hierarchy against
+	// walking the parent chain per bone the way GetGlobalMatrix used to.
+	void BenchmarkTransformHierarchy()
+	{
+		const int32_t chains = 8;
+		const int32_t depth = 64;
+		const int32_t frameCount = 100;
+
+		VKTransformHierarchy hierarchy;
+		int32_t root = hierarchy.Add(-1, Matrix4x4());
+		for (int32_t i = 0; i < chains; ++i)
+		{
+			int32_t parent = root;
+			for (int32_t j = 0; j < depth; ++j) {
+				parent = hierarchy.Add(parent, Matrix4x4());
+			}
+		}
+
+		const int32_t count = hierarchy.Size();
+		std::vector<Matrix4x4> locals(count);
+		std::vector<Matrix4x4> worlds(count);
+		double cachedTime = 0.0;
+		double recursiveTime = 0.0;
+		for (int32_t frame = 0; frame < frameCount; ++frame)
+		{
+			for (int32_t i = 0; i < count; ++i)
+			{
+				locals[i].SetIdentity();
+				locals[i].AppendRotation(0.5f * frame + i, Vector3::UpVector);
+				locals[i].AppendTranslation(Vector3(0.0f, 1.0f, 0.0f));
+			}
+
+			double start = GenericPlatformTime::Seconds();
+			for (int32_t i = 0; i < count; ++i) {
+				hierarchy.SetLocal(i, locals[i]);
+			}
+			for (int32_t i = 0; i < count; ++i) {
+				worlds[i] = hierarchy.GetWorld(i);
+			}
+			cachedTime += GenericPlatformTime::Seconds() - start;
+
+			start = GenericPlatformTime::Seconds();
+			for (int32_t i = 0; i < count; ++i)
+			{
+				Matrix4x4 world = locals[i];
+				for (int32_t parent = hierarchy.GetParent(i); parent >= 0; parent = hierarchy.GetParent(parent)) {
+					world.Append(locals[parent]);
+				}
+				worlds[i] = world;
+			}
+			recursiveTime += GenericPlatformTime::Seconds() - start;
+		}
+
+		Report("Transforms, %d bones %d deep: cached %.1fus, parent chains %.1fus per frame (%.1fx)", count, depth, cachedTime * 1e6 / frameCount, recursiveTime * 1e6 / frameCount, recursiveTime / cachedTime);
+	}
+
+	// box queries against a linear scan at 1k, 10k and 100k objects of constant density, plus the
+	// per frame cost of moving a tenth of them.
+	void BenchmarkDynamicBVH()
+	{
+		const int32_t counts[3] = { 1000, 10000, 100000 };
+		const int32_t queryCount = 1000;
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			const int32_t count = counts[c];
+			const float worldSize = 10.0f * std::cbrt((float)count);
+			std::vector<VKBoundingBox> boxes(count);
+			std::vector<int32_t> leaves(count);
+			VKDynamicBVH bvh;
+			for (int32_t i = 0; i < count; ++i)
+			{
+				Vector3 center(math::RandRange(0.0f, worldSize), math::RandRange(0.0f, worldSize), math::RandRange(0.0f, worldSize));
+				Vector3 extent(math::RandRange(0.5f, 2.0f), math::RandRange(0.5f, 2.0f), math::RandRange(0.5f, 2.0f));
+				boxes[i] = VKBoundingBox(center - extent, center + extent);
+				leaves[i] = bvh.Insert(boxes[i], i);
+			}
+			bvh.Rebuild();
+
+			std::vector<VKBoundingBox> queries(queryCount);
+			for (int32_t i = 0; i < queryCount; ++i)
+			{
+				Vector3 center(math::RandRange(0.0f, worldSize), math::RandRange(0.0f, worldSize), math::RandRange(0.0f, worldSize));
+				queries[i] = VKBoundingBox(center - Vector3(10.0f, 10.0f, 10.0f), center + Vector3(10.0f, 10.0f, 10.0f));
+			}
+
+			std::vector<uint32_t> results;
+			int64_t treeHits = 0;
+			double start = GenericPlatformTime::Seconds();
+			for (int32_t i = 0; i < queryCount; ++i)
+			{
+				bvh.Query(queries[i], results);
+				treeHits += results.size();
+			}
+			double treeTime = GenericPlatformTime::Seconds() - start;
+
+			int64_t scanHits = 0;
+			start = GenericPlatformTime::Seconds();
+			for (int32_t i = 0; i < queryCount; ++i)
+			{
+				results.clear();
+				const VKBoundingBox& query = queries[i];
+				for (int32_t j = 0; j < count; ++j)
+				{
+					const VKBoundingBox& box = boxes[j];
+					if (box.min.x <= query.max.x && box.max.x >= query.min.x &&
+						box.min.y <= query.max.y && box.max.y >= query.min.y &&
+						box.min.z <= query.max.z && box.max.z >= query.min.z) {
+						results.push_back(j);
+					}
+				}
+				scanHits += results.size();
+			}
+			double scanTime = GenericPlatformTime::Seconds() - start;
+
+			if (treeHits != scanHits) {
+				MLOGE("Dynamic BVH found %lld objects, the linear scan %lld.", treeHits, scanHits);
+			}
+
+			const int32_t frameCount = 16;
+			bvh.autoRebuild = false;
+			start = GenericPlatformTime::Seconds();
+			for (int32_t frame = 0; frame < frameCount; ++frame)
+			{
+				for (int32_t i = frame % 10; i < count; i += 10)
+				{
+					Vector3 offset(math::RandRange(-1.0f, 1.0f), math::RandRange(-1.0f, 1.0f), math::RandRange(-1.0f, 1.0f));
+					boxes[i] = VKBoundingBox(boxes[i].min + offset, boxes[i].max + offset);
+					bvh.Update(leaves[i], boxes[i]);
+				}
+				bvh.Refit();
+			}
+			double moveTime = GenericPlatformTime::Seconds() - start;
+
+			Report("Dynamic BVH, %d objects: query %.2fus, linear scan %.2fus (%.1fx), moving 10%% %.2fms per frame", count, treeTime * 1e6 / queryCount, scanTime * 1e6 / queryCount, scanTime / treeTime, moveTime * 1000.0 / frameCount);
+		}
+	}
+
+	// closest hit rays against the bridge BVHs: one at a time, batched packets on one thread and
+	// batched on the whole pool.
+	void BenchmarkRayCasts()
+	{
+		std::remove(VKModelCooker::GetCookedPath(m_BridgeFile, m_StaticLayout, VKModelImport_TriangleBVH).c_str());
+		double start = GenericPlatformTime::Seconds();
+		VKModel* model = VKModel::LoadFromFile(m_BridgeFile, m_VulkanDevice, nullptr, m_StaticLayout, VKModelImport_TriangleBVH);
+		double buildTime = GenericPlatformTime::Seconds() - start;
+		if (!model) {
+			return;
+		}
+		double plain = TimeModelLoad(m_BridgeFile, m_StaticLayout, VKModelImport_None, true);
+		Report("Triangle BVH %s: load %.1fms, without BVHs %.1fms", m_BridgeFile, buildTime * 1000.0, plain * 1000.0);
+
+		VKBoundingBox bounds = model->rootNode->GetBounds();
+		Vector3 boundSize = bounds.max - bounds.min;
+		Vector3 boundCenter = bounds.min + boundSize * 0.5f;
+		Vector3 eye(boundCenter.x, boundCenter.y + 1000, boundCenter.z - boundSize.Size());
+
+		const int32_t rayCount = 1 << 18;
+		std::vector<VKRay> rays(rayCount);
+		for (int32_t i = 0; i < rayCount; ++i)
+		{
+			Vector3 target(
+				math::RandRange(bounds.min.x, bounds.max.x),
+				math::RandRange(bounds.min.y, bounds.max.y),
+				math::RandRange(bounds.min.z, bounds.max.z)
+			);
+			rays[i] = VKRay(eye, target - eye, 2.0f);
+		}
+
+		VKRayCaster caster;
+		VKTriangleHit hit;
+		for (int32_t i = 0; i < rayCount; ++i) {
+			caster.RayCast(model, rays[i], hit);
+		}
+		const double single = caster.stats.RaysPerSecond();
+		const int64_t singleHits = caster.stats.hits;
+
+		std::vector<VKTriangleHit> hits;
+		ThreadPool::Get().SetMaxParallelism(1);
+		caster.ResetStats();
+		caster.RayCast(model, rays, hits);
+		const double packets = caster.stats.RaysPerSecond();
+		ThreadPool::Get().SetMaxParallelism(0);
+
+		caster.ResetStats();
+		caster.RayCast(model, rays, hits);
+		const double batched = caster.stats.RaysPerSecond();
+
+		Report("Ray casts %s, %d rays: single %.2f Mrays/s, packets %.2f Mrays/s, batched on %d threads %.2f Mrays/s, hits %lld/%lld", m_BridgeFile, rayCount, single / 1e6, packets / 1e6, ThreadPool::Get().GetThreadCount() + 1, batched / 1e6, singleHits, caster.stats.hits);
+
+		delete model;
+	}
+
+	// writes the meshes of model as a .glb with one interleaved vertex view and a uint32 index view per
+	// primitive. attributes has to be position, normal, uv0.
+	bool WriteGLB(VKModel* model, const char* filename)
+	{
+		std::vector<uint8_t> bin;
+		std::string accessors;
+		std::string views;
+		std::string meshes;
+		std::string nodes;
+		std::string roots;
+
+		auto append = [&bin](const void* data, size_t size)
+		{
+			size_t offset = bin.size();
+			bin.resize(Align<size_t>(offset + size, 4));
+			memcpy(bin.data() + offset, data, size);
+			return offset;
+		};
+
+		int32_t viewCount = 0;
+		int32_t accessorCount = 0;
+		int32_t meshCount = 0;
+		for (int32_t i = 0; i < model->meshes.size(); ++i)
+		{
+			VKMesh* mesh = model->meshes[i];
+			std::string primitives;
+			for (int32_t j = 0; j < mesh->primitives.size(); ++j)
+			{
+				VKPrimitive* primitive = mesh->primitives[j];
+				const int32_t vertexCount = primitive->vertices.size() / 8;
+				std::vector<uint32_t> indices(primitive->indices32.begin(), primitive->indices32.end());
+				if (indices.empty()) {
+					indices.assign(primitive->indices.begin(), primitive->indices.end());
+				}
+				if (vertexCount == 0 || indices.empty()) {
+					continue;
+				}
+
+				Vector3 vmin(MAX_flt, MAX_flt, MAX_flt);
+				Vector3 vmax(-MAX_flt, -MAX_flt, -MAX_flt);
+				for (int32_t k = 0; k < vertexCount; ++k)
+				{
+					const float* position = &primitive->vertices[k * 8];
+					vmin.Set(math::Min(vmin.x, position[0]), math::Min(vmin.y, position[1]), math::Min(vmin.z, position[2]));
+					vmax.Set(math::Max(vmax.x, position[0]), math::Max(vmax.y, position[1]), math::Max(vmax.z, position[2]));
+				}
+
+				size_t vertexOffset = append(primitive->vertices.data(), primitive->vertices.size() * sizeof(float));
+				size_t indexOffset = append(indices.data(), indices.size() * sizeof(uint32_t));
+
+				views += StringUtils::Printf("{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"byteStride\":32,\"target\":34962},", vertexOffset, primitive->vertices.size() * sizeof(float));
+				views += StringUtils::Printf("{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963},", indexOffset, indices.size() * sizeof(uint32_t));
+				accessors += StringUtils::Printf(
+					"{\"bufferView\":%d,\"byteOffset\":0,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},",
+					viewCount, vertexCount, vmin.x, vmin.y, vmin.z, vmax.x, vmax.y, vmax.z
+				);
+				accessors += StringUtils::Printf("{\"bufferView\":%d,\"byteOffset\":12,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},", viewCount, vertexCount);
+				accessors += StringUtils::Printf("{\"bufferView\":%d,\"byteOffset\":24,\"componentType\":5126,\"count\":%d,\"type\":\"VEC2\"},", viewCount, vertexCount);
+				accessors += StringUtils::Printf("{\"bufferView\":%d,\"componentType\":5125,\"count\":%d,\"type\":\"SCALAR\"},", viewCount + 1, (int32_t)indices.size());
+				primitives += StringUtils::Printf(
+					"{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d,\"TEXCOORD_0\":%d},\"indices\":%d},",
+					accessorCount, accessorCount + 1, accessorCount + 2, accessorCount + 3
+				);
+
+				viewCount += 2;
+				accessorCount += 4;
+			}
+
+			if (primitives.empty()) {
+				continue;
+			}
+			primitives.pop_back();
+
+			const int32_t meshIndex = meshCount++;
+			meshes += "{\"primitives\":[" + primitives + "]},";
+
+			// row vector matrices stored row by row are glTF's column major column vector matrices.
+			const Matrix4x4& matrix = mesh->linkNode->GetGlobalMatrix();
+			std::string values;
+			for (int32_t r = 0; r < 4; ++r) {
+				for (int32_t c = 0; c < 4; ++c) {
+					values += StringUtils::Printf("%.9g,", matrix.m[r][c]);
+				}
+			}
+			values.pop_back();
+
+			roots += StringUtils::Printf("%d,", meshIndex);
+			nodes += StringUtils::Printf("{\"mesh\":%d,\"matrix\":[%s]},", meshIndex, values.c_str());
+		}
+
+		if (meshes.empty()) {
+			return false;
+		}
+		accessors.pop_back();
+		views.pop_back();
+		meshes.pop_back();
+		nodes.pop_back();
+		roots.pop_back();
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" + roots + "]}]";
+		json += ",\"nodes\":[" + nodes + "],\"meshes\":[" + meshes + "],\"accessors\":[" + accessors + "],\"bufferViews\":[" + views + "]";
+		json += StringUtils::Printf(",\"buffers\":[{\"byteLength\":%zu}]}", bin.size());
+		json.resize(Align<size_t>(json.size(), 4), ' ');
+
+		const uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size()) };
+		const uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4E4F534A };
+		const uint32_t binChunk[2] = { (uint32_t)bin.size(), 0x004E4942 };
+
+		std::vector<uint8_t> file;
+		file.insert(file.end(), (const uint8_t*)header, (const uint8_t*)header + sizeof(header));
+		file.insert(file.end(), (const uint8_t*)jsonChunk, (const uint8_t*)jsonChunk + sizeof(jsonChunk));
+		file.insert(file.end(), json.begin(), json.end());
+		file.insert(file.end(), (const uint8_t*)binChunk, (const uint8_t*)binChunk + sizeof(binChunk));
+		file.insert(file.end(), bin.begin(), bin.end());
+
+		return FileManager::WriteFile(filename, file.data(), (uint32_t)file.size());
+	}
+
+	// the bridge written as .glb and imported cold through VKGLTFLoader and through Assimp.
+	void BenchmarkGLTFLoads()
+	{
+		const std::vector<VertexAttribute> layout = { VA_Position, VA_Normal, VA_UV0 };
+		const std::string glbFile = std::string(m_BridgeFile) + ".glb";
+
+		VKModel* source = VKModel::LoadFromFile(m_BridgeFile, m_VulkanDevice, nullptr, layout, VKModelImport_None, VKModelResidency_CPUOnly);
+		bool written = source && WriteGLB(source, glbFile.c_str());
+		delete source;
+		if (!written)
+		{
+			MLOGE("Could not write %s.", glbFile.c_str());
+			return;
+		}
+
+		size_t nativePeak = 0;
+		size_t assimpPeak = 0;
+		double native = TimeModelLoad(glbFile.c_str(), layout, VKModelImport_None, true, nullptr, &nativePeak);
+		double assimp = TimeModelLoad(glbFile.c_str(), layout, VKModelImport_AssimpOnly, true, nullptr, &assimpPeak);
+		Report(
+			"Load %s: native %.1fms peak +%.1fMB, Assimp %.1fms peak +%.1fMB",
+			glbFile.c_str(), native * 1000.0, nativePeak / (1024.0 * 1024.0), assimp * 1000.0, assimpPeak / (1024.0 * 1024.0)
+		);
+
+		std::remove(glbFile.c_str());
+	}
+
+	// boxes and spheres scattered around the camera at 1k to 1M objects, one batch on the calling thread
+	// against the default batches on the thread pool.
+	void BenchmarkFrustumCulling()
+	{
+		VKCamera camera;
+		camera.Perspective(PI / 4, m_configuration.window.windowWidth, m_configuration.window.windowHeight, 10.0f, 3000.0f);
+		camera.SetPosition(0.0f, 0.0f, 0.0f);
+		camera.LookAt(Vector3(0.0f, 0.0f, 1.0f));
+
+		const int32_t counts[4] = { 1000, 10000, 100000, 1000000 };
+		const int32_t repeats = 16;
+		for (int32_t c = 0; c < 4; ++c)
+		{
+			const int32_t count = counts[c];
+			VKBoxArray boxes;
+			VKSphereArray spheres;
+			boxes.Resize(count);
+			spheres.Resize(count);
+			for (int32_t i = 0; i < count; ++i)
+			{
+				boxes.centerX[i] = spheres.centerX[i] = math::RandRange(-3000.0f, 3000.0f);
+				boxes.centerY[i] = spheres.centerY[i] = math::RandRange(-3000.0f, 3000.0f);
+				boxes.centerZ[i] = spheres.centerZ[i] = math::RandRange(-3000.0f, 3000.0f);
+				boxes.extentX[i] = math::RandRange(1.0f, 20.0f);
+				boxes.extentY[i] = math::RandRange(1.0f, 20.0f);
+				boxes.extentZ[i] = math::RandRange(1.0f, 20.0f);
+				spheres.radius[i] = math::RandRange(1.0f, 20.0f);
+			}
+
+			std::vector<uint32_t> visible;
+			double rates[2][2];
+			for (int32_t pooled = 0; pooled < 2; ++pooled)
+			{
+				VKFrustumCuller culler;
+				culler.Setup(camera);
+				culler.batchSize = pooled ? culler.batchSize : count;
+
+				for (int32_t i = 0; i < repeats; ++i) {
+					culler.Cull(boxes, visible);
+				}
+				rates[pooled][0] = culler.stats.ObjectsPerUS();
+
+				culler.ResetStats();
+				for (int32_t i = 0; i < repeats; ++i) {
+					culler.Cull(spheres, visible);
+				}
+				rates[pooled][1] = culler.stats.ObjectsPerUS();
+			}
+
+			Report(
+				"Frustum culling, %d objects: boxes %.0f/us single, %.0f/us pooled, spheres %.0f/us single, %.0f/us pooled, %d visible",
+				count, rates[0][0], rates[1][0], rates[0][1], rates[1][1], (int32_t)visible.size()
+			);
+		}
+	}
+
+	// the bounds self test, then Arvo's TransformBox one box at a time against the 8 transformed corners
+	// and the batched TransformBoxes into SoA arrays, at thousands of random boxes and matrices.
+	void BenchmarkBoundsTransforms()
+	{
+		Report("Bounds self test: %s", VKBounds::SelfTest() ? "passed" : "failed, see the errors above");
+
+		const int32_t counts[3] = { 1000, 10000, 100000 };
+		const int32_t repeats = 16;
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			const int32_t count = counts[c];
+			std::vector<VKBoundingBox> boxes(count);
+			std::vector<Matrix4x4> matrices(count);
+			std::vector<const VKBoundingBox*> boxPtrs(count);
+			std::vector<const Matrix4x4*> matrixPtrs(count);
+			for (int32_t i = 0; i < count; ++i)
+			{
+				Vector3 center(math::RandRange(-100.0f, 100.0f), math::RandRange(-100.0f, 100.0f), math::RandRange(-100.0f, 100.0f));
+				Vector3 extent(math::RandRange(0.5f, 10.0f), math::RandRange(0.5f, 10.0f), math::RandRange(0.5f, 10.0f));
+				boxes[i] = VKBoundingBox(center - extent, center + extent);
+				boxes[i].UpdateCorners();
+				matrices[i].AppendRotation(math::RandRange(0.0f, 360.0f), Vector3(math::RandRange(-1.0f, 1.0f), 1.0f, math::RandRange(-1.0f, 1.0f)).GetSafeNormal());
+				matrices[i].AppendTranslation(Vector3(math::RandRange(-1000.0f, 1000.0f), 0.0f, math::RandRange(-1000.0f, 1000.0f)));
+				boxPtrs[i] = &boxes[i];
+				matrixPtrs[i] = &matrices[i];
+			}
+
+			std::vector<VKBoundingBox> results(count);
+			double start = GenericPlatformTime::Seconds();
+			for (int32_t r = 0; r < repeats; ++r) {
+				for (int32_t i = 0; i < count; ++i) {
+					results[i] = VKBounds::TransformBox(boxes[i], matrices[i]);
+				}
+			}
+			double arvoTime = GenericPlatformTime::Seconds() - start;
+
+			start = GenericPlatformTime::Seconds();
+			for (int32_t r = 0; r < repeats; ++r)
+			{
+				for (int32_t i = 0; i < count; ++i)
+				{
+					Vector3 vmin(MAX_flt, MAX_flt, MAX_flt);
+					Vector3 vmax(-MAX_flt, -MAX_flt, -MAX_flt);
+					for (int32_t k = 0; k < 8; ++k)
+					{
+						Vector3 corner = matrices[i].TransformPosition(boxes[i].corners[k]);
+						vmin = Vector3::Min(vmin, corner);
+						vmax = Vector3::Max(vmax, corner);
+					}
+					results[i] = VKBoundingBox(vmin, vmax);
+				}
+			}
+			double cornerTime = GenericPlatformTime::Seconds() - start;
+
+			VKBoxArray boxArray;
+			start = GenericPlatformTime::Seconds();
+			for (int32_t r = 0; r < repeats; ++r) {
+				VKBounds::TransformBoxes(boxPtrs.data(), matrixPtrs.data(), count, boxArray);
+			}
+			double batchTime = GenericPlatformTime::Seconds() - start;
+
+			const double transformed = (double)count * repeats;
+			Report(
+				"Box transforms, %d boxes: TransformBox %.1fns, 8 corners %.1fns, TransformBoxes %.1fns per box",
+				count, arvoTime * 1e9 / transformed, cornerTime * 1e9 / transformed, batchTime * 1e9 / transformed
+			);
+		}
+	}
+
+	// the SSE stream kernels of the compact encodings against the scalar encoders in VertexPacking.h,
+	// per vertex, on the same Assimp-style arrays as BenchmarkVertexPacking.
+	void BenchmarkCompactPacking()
+	{
+		const int32_t count = 1 << 20;
+		const int32_t repeats = 8;
+		std::vector<float> positions(count * 3);
+		std::vector<float> normals(count * 3);
+		std::vector<float> tangents(count * 3);
+		std::vector<float> uvs(count * 3);
+		for (int32_t i = 0; i < count * 3; ++i)
+		{
+			positions[i] = math::RandRange(-100.0f, 100.0f);
+			normals[i] = math::RandRange(-1.0f, 1.0f);
+			tangents[i] = math::RandRange(-1.0f, 1.0f);
+			uvs[i] = math::RandRange(0.0f, 1.0f);
+		}
+
+		VKVertexStreams streams;
+		streams.count = count;
+		streams.positions = VKVertexStream(positions.data(), sizeof(float) * 3);
+		streams.normals = VKVertexStream(normals.data(), sizeof(float) * 3);
+		streams.tangents = VKVertexStream(tangents.data(), sizeof(float) * 3);
+		streams.uvs[0] = VKVertexStream(uvs.data(), sizeof(float) * 3);
+
+		const std::vector<VertexAttribute> layouts[2] = {
+			{ VA_PositionSNorm16, VA_UV0UNorm16, VA_NormalOct, VA_TangentOct },
+			{ VA_PositionHalf, VA_UV0UNorm16, VA_NormalOct, VA_TangentOct }
+		};
+		const std::vector<VKVertexSkin> skins;
+		for (int32_t l = 0; l < 2; ++l)
+		{
+			const std::vector<VertexAttribute>& layout = layouts[l];
+			double packedTime = 0.0;
+			double scalarTime = 0.0;
+			for (int32_t r = 0; r < repeats; ++r)
+			{
+				VKMesh mesh;
+				std::vector<float> vertices;
+				Vector3 mmin(MAX_int32, MAX_int32, MAX_int32);
+				Vector3 mmax(-MAX_int32, -MAX_int32, -MAX_int32);
+				double start = GenericPlatformTime::Seconds();
+				VKModel::PackVertexStreams(layout, skins, streams, vertices, mmax, mmin, &mesh);
+				packedTime += GenericPlatformTime::Seconds() - start;
+
+				// 8 bytes position, then 4 each for uv, normal and tangent.
+				std::vector<uint8_t> scalar(count * 20);
+				const Vector3 invScale(1.0f / mesh.positionScale.x, 1.0f / mesh.positionScale.y, 1.0f / mesh.positionScale.z);
+				start = GenericPlatformTime::Seconds();
+				for (int32_t i = 0; i < count; ++i)
+				{
+					uint8_t* dst = scalar.data() + i * 20;
+					const float* p = streams.positions.Get(i);
+					if (l == 0)
+					{
+						int16_t packed[4] = {
+							QuantizeSNorm16((p[0] - mesh.positionOffset.x) * invScale.x),
+							QuantizeSNorm16((p[1] - mesh.positionOffset.y) * invScale.y),
+							QuantizeSNorm16((p[2] - mesh.positionOffset.z) * invScale.z),
+							32767
+						};
+						memcpy(dst, packed, 8);
+					}
+					else
+					{
+						uint16_t packed[4] = { FloatToHalf(p[0]), FloatToHalf(p[1]), FloatToHalf(p[2]), 0x3C00 };
+						memcpy(dst, packed, 8);
+					}
+
+					const float* uv = streams.uvs[0].Get(i);
+					uint16_t packedUV[2] = { QuantizeUNorm16(uv[0]), QuantizeUNorm16(uv[1]) };
+					memcpy(dst + 8, packedUV, 4);
+
+					float u, v;
+					const float* n = streams.normals.Get(i);
+					OctEncode(n[0], n[1], n[2], u, v);
+					int16_t packedNormal[2] = { QuantizeSNorm16(u), QuantizeSNorm16(v) };
+					memcpy(dst + 12, packedNormal, 4);
+
+					const float* t = streams.tangents.Get(i);
+					OctEncode(t[0], t[1], t[2], u, v);
+					int8_t packedTangent[4] = { QuantizeSNorm8(u), QuantizeSNorm8(v), 0, 127 };
+					memcpy(dst + 16, packedTangent, 4);
+				}
+				scalarTime += GenericPlatformTime::Seconds() - start;
+
+				if (vertices.size() * sizeof(float) != scalar.size() || memcmp(vertices.data(), scalar.data(), scalar.size()) != 0) {
+					MLOGE("Compact vertex packing differs from the scalar encoders.");
+				}
+			}
+
+			Report(
+				"Compact packing (%s positions), %d vertices: SSE streams %.2fms, scalar %.2fms (%.1fx)",
+				l == 0 ? "SNORM16" : "half", count, packedTime * 1000.0 / repeats, scalarTime * 1000.0 / repeats, scalarTime / packedTime
+			);
+		}
+	}
+};
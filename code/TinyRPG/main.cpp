@@ -19,6 +19,7 @@
 #include "26_SkinInstance.h"
 #include "28_FXAA.h"
 #include "40_QueryStatistics.h"
+#include "41_Benchmarks.h"
 //-----------------------------------------------------------------------------
 #pragma comment(lib, "LiliEngine.lib")
 #pragma comment(lib, "3rdparty.lib")
@@ -51,6 +52,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
 	//SkinInstance game(configuration);
 	//FXAA game(configuration);
 	QueryStatistics game(configuration);
+	//Benchmarks game(configuration);
 	//GameApplication game(configuration);
 	game.StartGame();
 	return 0;
@@ -4,6 +4,8 @@
 #include "LiliEngine/Configuration.h"
 #include "LiliEngine/Engine.h"
 #include "LiliEngine/Log.h"
+#include "LiliEngine/Time.h"
+#include "LiliEngine/ThreadPool.h"
 #include "LiliEngine/Matrix4x4.h"
 #include "LiliEngine/VulkanRHI.h"
 #include "LiliEngine/VulkanDevice.h"
@@ -12,6 +14,12 @@
 #include "LiliEngine/FileManager.h"
 #include "LiliEngine/VKCamera.h"
 #include "LiliEngine/VKModel.h"
+#include "LiliEngine/VKModelCooker.h"
+#include "LiliEngine/VKFrustumCuller.h"
+#include "LiliEngine/VKDynamicBVH.h"
+#include "LiliEngine/VKRayCaster.h"
+#include "LiliEngine/VKLODSelector.h"
+#include "LiliEngine/VKIndirectDrawBuffer.h"
 #include "LiliEngine/VKUtils.h"
 #include "LiliEngine/ImageGUIContext.h"
 #include "LiliEngine/VKIndexBuffer.h"